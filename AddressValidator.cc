@@ -0,0 +1,560 @@
+/*
+ * Mail-Sending Program
+ * AddressValidator.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+
+#include "AddressValidator.hh"
+#include <cstring>
+#include <strings.h>
+#include <arpa/inet.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ADDRESSVALIDATOR_X86 1
+#endif
+
+using namespace std;
+
+// Character classes (bits), RFC 5321 4.1.2 / RFC 5322 3.2.3.
+
+enum {
+	Atext		= 0x01,		// ALPHA DIGIT !#$%&'*+-/=?^_`{|}~
+	LetDig		= 0x02,		// ALPHA DIGIT
+	Ldh			= 0x04,		// ALPHA DIGIT -
+	Qtext		= 0x08,		// In "quoted string": 32-126 but " and \ .
+	Dcontent	= 0x10,		// In [literal]: 33-126 but [ \ ]
+	Vchar		= 0x20		// After \ in "quoted string": 32-126
+};
+
+struct CharTable {
+	uint8_t			cls[256];
+};
+
+// Class bits of every byte value, computed at compile time.
+
+static constexpr CharTable
+MakeCharTable()
+{
+
+	CharTable		t = {};
+	const char		*specials = "!#$%&'*+-/=?^_`{|}~";
+
+	for (int c = 0; c < 256; c++) {
+
+		bool	alpha = (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z'),
+				digit = c >= '0' && c <= '9';
+
+		if (alpha || digit)
+
+			t.cls[c] |= Atext | LetDig | Ldh;
+
+		for (const char *s = specials; *s != '\0'; s++) {
+
+			if (c == *s)
+
+				t.cls[c] |= Atext;
+
+		}
+
+		if (c == '-')
+
+			t.cls[c] |= Ldh;
+
+		if (c >= 32 && c <= 126) {
+
+			t.cls[c] |= Vchar;
+
+			if (c != '"' && c != '\\')
+
+				t.cls[c] |= Qtext;
+
+			if (c != ' ' && c != '[' && c != '\\' && c != ']')
+
+				t.cls[c] |= Dcontent;
+
+		}
+
+	}
+
+	return t;
+
+}
+
+static constexpr CharTable	Chars = MakeCharTable();
+
+static inline bool
+Is(char c, int cls)
+{
+
+	return Chars.cls[(unsigned char)c] & cls;
+
+}
+
+#ifdef ADDRESSVALIDATOR_X86
+
+// Bytes of v in [lo, hi] (ASCII; bytes >= 0x80 compare negative).
+
+__attribute__((target("sse2")))
+static inline __m128i
+InRange(__m128i v, char lo, char hi)
+{
+
+	return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)),
+						 _mm_cmplt_epi8(v, _mm_set1_epi8(hi + 1)));
+
+}
+
+/*
+ * SSE2 fast path for the common address: up to 64 chars, all of
+ * them letters, digits or ".-_+@". The address is classified 16
+ * bytes at a time into 64-bit masks (bit i: byte i), then checked
+ * on the masks: one '@' w/ something on both sides, no leading,
+ * trailing or double dot on either side, no '_' or '+' in the
+ * domain, no hyphen starting or ending a domain label. Labels
+ * and the local part are short enough by length alone.
+ * @args:	address (const char *p, size_t len)
+ * @return:	true (valid), false (not valid, or not this path's)
+ */
+__attribute__((target("sse2")))
+static bool
+FastSse2(const char *p, size_t len)
+{
+
+	alignas(16) char	buf[64];
+	uint64_t		fast = 0,	// Letters, digits, ".-_+@"
+					at = 0,
+					dot = 0,
+					hyphen = 0,
+					local_only = 0,	// '_', '+'
+					valid,		// Bytes of the address
+					domain;
+	int				a;			// Position of '@'
+
+	if (len == 0 || len > sizeof(buf))
+
+		return false;
+
+	memset(buf, 0, sizeof(buf));
+	memcpy(buf, p, len);
+
+	for (int i = 0; i < 64; i += 16) {
+
+		__m128i		v = _mm_load_si128((const __m128i *)(buf + i)),
+					d = _mm_cmpeq_epi8(v, _mm_set1_epi8('.')),
+					h = _mm_cmpeq_epi8(v, _mm_set1_epi8('-')),
+					u = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('_')),
+									 _mm_cmpeq_epi8(v, _mm_set1_epi8('+'))),
+					f = _mm_or_si128(_mm_or_si128(InRange(v, '0', '9'),
+												  InRange(v, '@', 'Z')),
+									 _mm_or_si128(InRange(v, 'a', 'z'),
+												  _mm_or_si128(d, _mm_or_si128(h, u))));
+
+		fast |= (uint64_t)(unsigned int)_mm_movemask_epi8(f) << i;
+		at |= (uint64_t)(unsigned int)_mm_movemask_epi8(
+				_mm_cmpeq_epi8(v, _mm_set1_epi8('@'))) << i;
+		dot |= (uint64_t)(unsigned int)_mm_movemask_epi8(d) << i;
+		hyphen |= (uint64_t)(unsigned int)_mm_movemask_epi8(h) << i;
+		local_only |= (uint64_t)(unsigned int)_mm_movemask_epi8(u) << i;
+
+	}
+
+	valid = len == 64 ? ~0ULL : (1ULL << len) - 1;
+
+	if ((fast & valid) != valid || __builtin_popcountll(at) != 1)
+
+		return false;
+
+	a = __builtin_ctzll(at);
+
+	if (a == 0 || a == (int)len - 1)
+
+		return false;		// Empty local part or domain
+
+	domain = valid & ~((at << 1) - 1);
+
+	if ((dot & (dot >> 1)) != 0 ||
+		(dot & (1ULL | at >> 1 | at << 1 | 1ULL << (len - 1))) != 0)
+
+		return false;		// "..", '.' first/last in local/domain
+
+	if ((local_only & domain) != 0 ||
+		(hyphen & domain & ((dot | at) << 1 | dot >> 1 |
+							1ULL << (len - 1))) != 0)
+
+		return false;		// Not a domain label
+
+	return true;
+
+}
+
+#endif /* ADDRESSVALIDATOR_X86 */
+
+/*
+ * Select the kernel. Auto picks the best the CPU supports; a
+ * kernel the CPU (or build) lacks falls back to scalar (table
+ * only).
+ * @args:	kernel to use (Kernel kernel), Auto by default
+ */
+AddressValidator::AddressValidator(Kernel kernel)
+{
+
+	Selected = Scalar;
+	FastPath = NULL;
+
+#ifdef ADDRESSVALIDATOR_X86
+	__builtin_cpu_init();
+
+	if ((kernel == Auto || kernel == Sse2) &&
+		__builtin_cpu_supports("sse2")) {
+
+		Selected = Sse2;
+		FastPath = FastSse2;
+
+	}
+#endif
+
+}
+
+/*
+ * Name of the kernel in use, for reports.
+ * @return:	"scalar" or "sse2"
+ */
+const char *
+AddressValidator::kernel_name() const
+{
+
+	return Selected == Sse2 ? "sse2" : "scalar";
+
+}
+
+/*
+ * @args:	status (Status status)
+ * @return:	what is wrong w/ the address (const char *)
+ */
+const char *
+AddressValidator::status_name(Status status)
+{
+
+	switch (status) {
+
+	case Valid:			return "valid";
+	case BadLength:		return "bad length";
+	case NoAt:			return "no @";
+	case BadLocal:		return "bad local part";
+	case BadDomain:		return "bad domain";
+
+	}
+
+	return "unknown";
+
+}
+
+/*
+ * Check the syntax of one address: fast path first, if any, the
+ * table otherwise.
+ * @args:	address, w/o angle brackets (string_view addr)
+ * @return:	Valid, or what is wrong (Status)
+ */
+AddressValidator::Status
+AddressValidator::check(string_view addr) const
+{
+
+	if (FastPath != NULL && FastPath(addr.data(), addr.length()))
+
+		return Valid;
+
+	return check_table(addr.data(), addr.length());
+
+}
+
+/*
+ * Check a batch of addresses.
+ * @args:	addresses (const string_view *addrs, size_t n)
+ * 			Status of each, out (uint8_t *status)
+ * @return:	# valid addresses
+ */
+size_t
+AddressValidator::check(const string_view *addrs, size_t n,
+						uint8_t *status) const
+{
+
+	size_t			valid = 0;
+
+	for (size_t i = 0; i < n; i++) {
+
+		status[i] = check(addrs[i]);
+		valid += status[i] == Valid;
+
+	}
+
+	return valid;
+
+}
+
+/*
+ * Check a batch of addresses into a bitmap.
+ * @args:	addresses (const string_view *addrs, size_t n)
+ * 			bitmap of (n + 63) / 64 words, out (uint64_t *bits)
+ * @return:	# valid addresses
+ */
+size_t
+AddressValidator::valid_bits(const string_view *addrs, size_t n,
+							 uint64_t *bits) const
+{
+
+	size_t			valid = 0;
+	uint64_t		word = 0;
+
+	for (size_t i = 0; i < n; i++) {
+
+		if (check(addrs[i]) == Valid) {
+
+			word |= 1ULL << (i % 64);
+			valid++;
+
+		}
+
+		if (i % 64 == 63 || i == n - 1) {
+
+			bits[i / 64] = word;
+			word = 0;
+
+		}
+
+	}
+
+	return valid;
+
+}
+
+/*
+ * Table-driven check of the whole Mailbox grammar. The local part
+ * ends at the last '@' (a quoted local part may contain '@').
+ * @args:	address (const char *p, size_t len)
+ * @return:	Valid, or what is wrong (Status)
+ */
+AddressValidator::Status
+AddressValidator::check_table(const char *p, size_t len)
+{
+
+	const char		*at;
+	size_t			local,		// Lengths
+					domain;
+
+	if (len == 0 || len > MaxPath)
+
+		return BadLength;
+
+	if ((at = (const char *)memrchr(p, '@', len)) == NULL)
+
+		return NoAt;
+
+	local = at - p;
+	domain = len - local - 1;
+
+	if (local == 0 || local > MaxLocal ||
+		!(p[0] == '"' ? check_quoted(p, local) :
+						check_dot_string(p, local)))
+
+		return BadLocal;
+
+	if (domain == 0 || domain > MaxDomain ||
+		!(at[1] == '[' ? check_literal(at + 1, domain) :
+						 check_domain(at + 1, domain)))
+
+		return BadDomain;
+
+	return Valid;
+
+}
+
+/*
+ * Dot-string: atoms of atext, one dot between two of them.
+ * @args:	local part (const char *p, size_t len), len > 0
+ * @return:	true (valid)
+ */
+bool
+AddressValidator::check_dot_string(const char *p, size_t len)
+{
+
+	if (p[0] == '.' || p[len - 1] == '.')
+
+		return false;
+
+	for (size_t i = 0; i < len; i++) {
+
+		if (p[i] == '.') {
+
+			if (p[i - 1] == '.')
+
+				return false;		// Empty atom
+
+		}
+		else if (!Is(p[i], Atext))
+
+			return false;
+
+	}
+
+	return true;
+
+}
+
+/*
+ * Quoted-string: DQUOTE, qtext or backslash + printable char,
+ * DQUOTE.
+ * @args:	local part (const char *p, size_t len), p[0] == '"'
+ * @return:	true (valid)
+ */
+bool
+AddressValidator::check_quoted(const char *p, size_t len)
+{
+
+	if (len < 2 || p[len - 1] != '"')
+
+		return false;
+
+	for (size_t i = 1; i < len - 1; i++) {
+
+		if (p[i] == '\\') {
+
+			if (++i >= len - 1 || !Is(p[i], Vchar))
+
+				return false;		// Would escape the closing DQUOTE
+
+		}
+		else if (!Is(p[i], Qtext))
+
+			return false;
+
+	}
+
+	return true;
+
+}
+
+/*
+ * Domain: dot-separated labels of 1 to 63 letters, digits and
+ * hyphens, starting and ending w/ a letter or digit.
+ * @args:	domain (const char *p, size_t len), len > 0
+ * @return:	true (valid)
+ */
+bool
+AddressValidator::check_domain(const char *p, size_t len)
+{
+
+	size_t			label = 0;		// Length of current label
+
+	for (size_t i = 0; i <= len; i++) {
+
+		if (i == len || p[i] == '.') {
+
+			if (label == 0 || label > 63 || p[i - 1] == '-')
+
+				return false;
+
+			label = 0;
+
+		}
+		else if (!Is(p[i], label == 0 ? LetDig : Ldh))
+
+			return false;
+
+		else
+
+			label++;
+
+	}
+
+	return true;
+
+}
+
+/*
+ * Address literal: "[1.2.3.4]", "[IPv6:::1]", or a general
+ * "[tag:text]" w/ an Ldh tag and dcontent text.
+ * @args:	domain (const char *p, size_t len), p[0] == '['
+ * @return:	true (valid)
+ */
+bool
+AddressValidator::check_literal(const char *p, size_t len)
+{
+
+	char			addr[MaxDomain + 1];
+	unsigned char	bin[16];
+	const char		*colon;
+	size_t			tag;
+
+	if (len < 3 || p[len - 1] != ']')
+
+		return false;
+
+	memcpy(addr, p + 1, len - 2);
+	addr[len - 2] = '\0';
+
+	if (strncasecmp(addr, "IPv6:", 5) == 0)
+
+		return inet_pton(AF_INET6, addr + 5, bin) == 1;
+
+	if ((colon = strchr(addr, ':')) == NULL)
+
+		return inet_pton(AF_INET, addr, bin) == 1;
+
+	// General-address-literal: Standardized-tag ":" 1*dcontent
+	tag = colon - addr;
+
+	if (tag == 0 || !Is(addr[0], LetDig) || !Is(addr[tag - 1], LetDig) ||
+		colon[1] == '\0')
+
+		return false;
+
+	for (size_t i = 1; i < tag; i++) {
+
+		if (!Is(addr[i], Ldh))
+
+			return false;
+
+	}
+
+	for (const char *c = colon + 1; *c != '\0'; c++) {
+
+		if (!Is(*c, Dcontent))
+
+			return false;
+
+	}
+
+	return true;
+
+}
@@ -0,0 +1,123 @@
+/*
+ * Mail-Sending Program
+ * AddressValidator.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+
+
+#ifndef ADDRESSVALIDATOR_HH_
+#define ADDRESSVALIDATOR_HH_
+
+#include <string_view>
+#include <cstddef>
+#include <stdint.h>
+
+using namespace std;
+
+/*
+ * AddressValidator object
+ * Syntax check of envelope addresses, RFC 5321 (4.1.2, 4.5.3.1):
+ * 	Mailbox		= Local-part "@" ( Domain / address-literal )
+ * 	Local-part	= Dot-string (atext atoms, single dots between)
+ * 				  / Quoted-string (printable ASCII, \-pairs)
+ * 	Domain		= labels of letters, digits and inner hyphens,
+ * 				  1 to 63 chars, dot-separated
+ * 	literal		= "[" IPv4 / "IPv6:" IPv6 / tag ":" text "]"
+ * w/ at most 64 chars of local part, 255 of domain and 254 in all.
+ * Characters are classified w/ one lookup in a 256-entry table
+ * built at compile time. Most addresses (up to 64 chars of
+ * letters, digits and ".-_+@") are accepted by a fast path that
+ * classifies 16 bytes at a time (SSE2) and checks the structure
+ * on bit masks; anything it does not accept is checked again by
+ * the table-driven path, which gives the reason.
+ * Batch use: check() a whole array of addresses into a status
+ * array, or valid_bits() into a bitmap.
+ */
+class AddressValidator
+{
+  public:
+
+	enum Kernel { Auto, Scalar, Sse2 };
+
+	enum Status { Valid, BadLength, NoAt, BadLocal, BadDomain };
+
+	enum { MaxLocal = 64, MaxDomain = 255, MaxPath = 254 };
+
+			 AddressValidator(Kernel kernel = Auto);
+
+	 // Check one address.
+
+	Status			check(string_view addr) const;
+
+	 // Check n addresses into status[n], return # valid.
+
+	size_t			check(const string_view *addrs, size_t n,
+						  uint8_t *status) const;
+
+	 // Check n addresses into bits (bit i of bits[i / 64] set:
+
+	 // addrs[i] valid), return # valid.
+
+	size_t			valid_bits(const string_view *addrs, size_t n,
+							   uint64_t *bits) const;
+
+	 // Reason an address is not valid, for reports.
+
+	static const char	*status_name(Status status);
+
+	 // Kernel in use: "scalar" or "sse2".
+
+	const char		*kernel_name() const;
+
+  private:
+
+	typedef bool	(*Fast)(const char *p, size_t len);
+
+	Kernel			Selected;		// Kernel in use
+	Fast			FastPath;		// Valid, or not sure (NULL: none)
+
+	 // Table-driven check of the whole grammar.
+
+	static Status	check_table(const char *p, size_t len);
+
+	static bool		check_dot_string(const char *p, size_t len);
+
+	static bool		check_quoted(const char *p, size_t len);
+
+	static bool		check_domain(const char *p, size_t len);
+
+	static bool		check_literal(const char *p, size_t len);
+
+};
+
+#endif /* ADDRESSVALIDATOR_HH_ */
@@ -0,0 +1,234 @@
+/*
+ * Mail-Sending Program
+ * Arena.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+
+#include "Arena.hh"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+using namespace std;
+
+atomic<uint64_t>	Arena::Totals[4];
+
+Arena::Arena(size_t block):
+	Head(NULL), Next(NULL), End(NULL), BlockSize(block)
+{
+
+	memset(&Counts, 0, sizeof(Counts));
+	memset(&Reported, 0, sizeof(Reported));
+
+}
+
+Arena::~Arena()
+{
+
+	Block			*next;
+
+	report();
+
+	for (; Head != NULL; Head = next) {
+
+		next = Head->next;
+		free(Head);
+
+	}
+
+}
+
+/*
+ * Hand out the next len bytes of the current block, aligned; when
+ * they do not fit, start a new block (see grow).
+ * @args:	bytes (size_t len), alignment, a power of 2 (size_t align)
+ * @return:	memory (void *), valid until reset()
+ */
+void *
+Arena::alloc(size_t len, size_t align)
+{
+
+	char			*p = (char *)(((uintptr_t)Next + align - 1) &
+								  ~(uintptr_t)(align - 1));
+
+	if (Head == NULL || p + len > End) {
+
+		grow(len + align);
+		p = (char *)(((uintptr_t)Next + align - 1) &
+					 ~(uintptr_t)(align - 1));
+
+	}
+
+	Next = p + len;
+	Counts.allocs++;
+	Counts.bytes += len;
+
+	return p;
+
+}
+
+/*
+ * Concatenate parts into the arena, w/o a temporary per part.
+ * @args:	text pieces (initializer_list<string_view> parts)
+ * @return:	the text (string_view), valid until reset()
+ */
+string_view
+Arena::join(initializer_list<string_view> parts)
+{
+
+	size_t			len = 0;
+	char			*text,
+					*p;
+
+	for (string_view part : parts)
+
+		len += part.length();
+
+	p = text = (char *)alloc(len, 1);
+
+	for (string_view part : parts) {
+
+		memcpy(p, part.data(), part.length());
+		p += part.length();
+
+	}
+
+	return string_view(text, len);
+
+}
+
+/*
+ * End of a transaction: rewind the current block. Several blocks
+ * (the transaction outgrew one) are replaced w/ one of their total
+ * size, so the next transaction of that size fits in one block.
+ */
+void
+Arena::reset()
+{
+
+	size_t			total = 0;
+	Block			*next;
+
+	Counts.resets++;
+
+	if (Head != NULL && Head->next != NULL) {
+
+		for (; Head != NULL; Head = next) {
+
+			next = Head->next;
+			total += Head->size;
+			free(Head);
+
+		}
+
+		BlockSize = total;
+		grow(0);
+
+	}
+
+	if (Head != NULL) {
+
+		Next = (char *)(Head + 1);
+		End = Next + Head->size;
+
+	}
+
+	report();
+
+}
+
+/*
+ * @return:	counters of all arenas, as of their last reset (Stats)
+ */
+Arena::Stats
+Arena::totals()
+{
+
+	Stats			all;
+
+	all.allocs = Totals[0].load(memory_order_relaxed);
+	all.bytes = Totals[1].load(memory_order_relaxed);
+	all.blocks = Totals[2].load(memory_order_relaxed);
+	all.resets = Totals[3].load(memory_order_relaxed);
+
+	return all;
+
+}
+
+/*
+ * Take a new block from the heap, of BlockSize bytes or len if
+ * larger, and make it the current one. The next block will be
+ * twice as large.
+ * @args:	bytes needed (size_t len)
+ */
+void
+Arena::grow(size_t len)
+{
+
+	size_t			size = max(BlockSize, len);
+	Block			*block = (Block *)malloc(sizeof(Block) + size);
+
+	if (block == NULL)
+
+		throw bad_alloc();
+
+	block->next = Head;
+	block->size = size;
+	Head = block;
+	Next = (char *)(block + 1);
+	End = Next + size;
+	BlockSize = size * 2;
+	Counts.blocks++;
+
+}
+
+/*
+ * Add what this arena counted since its last report to the totals
+ * of all arenas: a few atomic adds per transaction, not per alloc.
+ */
+void
+Arena::report()
+{
+
+	Totals[0].fetch_add(Counts.allocs - Reported.allocs,
+						memory_order_relaxed);
+	Totals[1].fetch_add(Counts.bytes - Reported.bytes,
+						memory_order_relaxed);
+	Totals[2].fetch_add(Counts.blocks - Reported.blocks,
+						memory_order_relaxed);
+	Totals[3].fetch_add(Counts.resets - Reported.resets,
+						memory_order_relaxed);
+	Reported = Counts;
+
+}
@@ -0,0 +1,133 @@
+/*
+ * Mail-Sending Program
+ * Arena.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+
+#ifndef ARENA_HH_
+#define ARENA_HH_
+
+#include <string_view>
+#include <initializer_list>
+#include <atomic>
+#include <cstddef>
+#include <stdint.h>
+
+using namespace std;
+
+/*
+ * Arena object
+ * Bump-pointer allocator for the short-lived data of one SMTP
+ * transaction (commands, envelope addresses): alloc() hands out the
+ * next bytes of the current block, and reset() takes all of them
+ * back at once when the transaction is over. If a transaction
+ * needed more than one block, reset() replaces them w/ a single
+ * block of their total size, so after the first transactions the
+ * arena holds one block large enough for any of them and alloc()
+ * no longer goes to the heap.
+ * Nothing is freed or destructed one by one: only trivially
+ * destructible data (chars, string_views, offsets) goes in.
+ * Counters of each arena, and totals of all of them (added at each
+ * reset), show how often the heap is still used.
+ * @methods:	alloc, copy, join, reset, stats, totals
+ */
+class Arena
+{
+  public:
+
+	enum { DefaultBlock = 4096 };	// Bytes of the first block
+
+	struct Stats {
+		uint64_t		allocs,		// alloc() calls
+						bytes,		// Bytes handed out
+						blocks,		// Blocks taken from the heap
+						resets;		// Transactions
+	};
+
+			 Arena(size_t block = DefaultBlock);
+			~Arena();
+
+			 Arena(const Arena &) = delete;
+	Arena	&operator=(const Arena &) = delete;
+
+	 // len bytes aligned to align, valid until reset().
+
+	void			*alloc(size_t len, size_t align = alignof(max_align_t));
+
+	template<class T>
+	T				*alloc_array(size_t n)
+						{ return (T *)alloc(n * sizeof(T), alignof(T)); }
+
+	 // Copy of text, or the parts of text one after another.
+
+	string_view		copy(string_view text) { return join({ text }); }
+
+	string_view		join(initializer_list<string_view> parts);
+
+	 // Take back everything allocated.
+
+	void			reset();
+
+	 // Counters of this arena, totals of all arenas.
+
+	const Stats		&stats() const { return Counts; }
+
+	static Stats	totals();
+
+  private:
+
+	struct Block {
+		Block			*next;		// Block filled before this one
+		size_t			size;		// Bytes after the header
+	};
+
+	Block			*Head;			// Current block, or NULL
+	char			*Next,			// Free bytes of Head
+					*End;
+	size_t			BlockSize;		// Size of the next new block
+	Stats			Counts,
+					Reported;		// Part of Counts in the totals
+
+	static atomic<uint64_t>	Totals[4];	// Stats of all arenas
+
+	 // Start a new block of at least len bytes.
+
+	void			grow(size_t len);
+
+	 // Add the counts since the last report to Totals.
+
+	void			report();
+
+};
+
+#endif /* ARENA_HH_ */
@@ -0,0 +1,380 @@
+/*
+ * Mail-Sending Program
+ * Connector.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+
+#include "Connector.hh"
+#include "SmtpMetrics.hh"
+#include "Logger.hh"
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+
+using namespace std;
+
+Connector &
+Connector::shared()
+{
+
+	static Connector	connector;
+
+	return connector;
+
+}
+
+/*
+ * Race connects to the addresses of a relay (see Connector): an
+ * attempt is started on the next address every AttemptDelay ms, or
+ * as soon as one fails, while none has connected. The first socket
+ * to connect is kept, the other attempts are abandoned. An attempt
+ * still pending after AttemptTimeout ms fails w/ ETIMEDOUT.
+ * @args:	relay host & port (const string &host, int port)
+ * 			its addresses (const vector<Resolver::Address> &addrs)
+ * @return:	connected (blocking) socket
+ * - error: -1 (errno of the last attempt to fail: ETIMEDOUT,
+ * 			ECONNREFUSED, ENETUNREACH ...)
+ */
+int
+Connector::connect(const string &host,
+				   int port,
+				   const vector<Resolver::Address> &addrs)
+{
+
+	vector<Resolver::Address>	try_addrs(addrs);	// In order
+	size_t			n = addrs.size(),
+					next = 0,		// Next address to try
+					winner = n;
+	vector<pollfd>	pfds(n);		// Attempts, fd -1: over
+	vector<uint64_t>	deadline(n);	// us
+	uint64_t		start = SmtpMetrics::now(),
+					now,
+					next_start = start,	// Of the next attempt
+					wake;
+	int				fd = -1,
+					live = 0,		// Attempts in flight
+					error = EHOSTUNREACH,
+					ret;
+	socklen_t		len;
+
+	order(host, port, try_addrs);
+
+	while (fd < 0 && (next < n || live > 0)) {
+
+		now = SmtpMetrics::now();
+
+		// Next attempt when due, at once if none is in flight.
+		if (next < n && (live == 0 || now >= next_start)) {
+
+			const Resolver::Address	&a = try_addrs[next];
+
+			pfds[next].fd = -1;
+			pfds[next].events = POLLOUT;
+			pfds[next].revents = 0;
+
+			if ((ret = socket(a.addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK |
+							  SOCK_CLOEXEC, 0)) < 0)
+
+				error = errno;
+
+			else if (::connect(ret, (const sockaddr *)&a.addr, a.len) == 0) {
+
+				fd = ret;		// At once (e.g. loopback)
+				winner = next;
+
+			}
+			else if (errno == EINPROGRESS) {
+
+				pfds[next].fd = ret;
+				deadline[next] = now + AttemptTimeout * 1000ULL;
+				live++;
+
+			}
+			else {
+
+				error = errno;
+				close(ret);
+				Logger::shared().print(LogInfo, "%s: %s: %s", host.c_str(),
+									   format(a).c_str(), strerror(error));
+
+			}
+
+			// Failed at once: the next one right away, too.
+			next_start = pfds[next].fd >= 0 ? now + AttemptDelay * 1000ULL : now;
+			next++;
+			continue;
+
+		}
+
+		// Wait for a connect, the next attempt or a deadline.
+		wake = next < n ? next_start : UINT64_MAX;
+
+		for (size_t i = 0; i < next; i++) {
+
+			if (pfds[i].fd >= 0)
+
+				wake = min(wake, deadline[i]);
+
+		}
+
+		if ((ret = poll(&pfds[0], next,
+						wake > now ? (wake - now + 999) / 1000 : 0)) < 0) {
+
+			if (errno == EINTR)
+
+				continue;
+
+			error = errno;
+			break;
+
+		}
+
+		now = SmtpMetrics::now();
+
+		for (size_t i = 0; i < next && fd < 0; i++) {
+
+			if (pfds[i].fd < 0)
+
+				continue;
+
+			if (pfds[i].revents != 0) {
+
+				len = sizeof(ret);
+
+				if (getsockopt(pfds[i].fd, SOL_SOCKET, SO_ERROR, &ret, &len) != 0)
+
+					ret = errno;
+
+				if (ret == 0) {
+
+					fd = pfds[i].fd;	// Connected: it wins
+					pfds[i].fd = -1;
+					winner = i;
+					break;
+
+				}
+
+				error = ret;
+
+			}
+			else if (now >= deadline[i])
+
+				error = ETIMEDOUT;
+
+			else
+
+				continue;		// Still connecting
+
+			Logger::shared().print(LogInfo, "%s: %s: %s", host.c_str(),
+								   format(try_addrs[i]).c_str(),
+								   strerror(error));
+			close(pfds[i].fd);
+			pfds[i].fd = -1;
+			live--;
+			next_start = now;	// Failed: next address at once
+
+		}
+
+	}
+
+	for (size_t i = 0; i < next; i++) {
+
+		if (pfds[i].fd >= 0)
+
+			close(pfds[i].fd);	// Lost the race
+
+	}
+
+	if (fd < 0) {
+
+		errno = error;
+		return -1;
+
+	}
+
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+	won(host, port, try_addrs[winner], SmtpMetrics::now() - start);
+
+	return fd;
+
+}
+
+/*
+ * Order the addresses of a relay for connecting (RFC 8305, 4):
+ * families interleaved, starting w/ the family of the first address
+ * (the resolver's preference), each in the resolver's order; then
+ * the address that won last for this relay first.
+ * @args:	relay host & port (const string &host, int port)
+ * 			its addresses, reordered (vector<Resolver::Address> &)
+ */
+void
+Connector::order(const string &host,
+				 int port,
+				 vector<Resolver::Address> &addrs)
+{
+
+	vector<Resolver::Address>	first,	// Family of addrs[0]
+								other;
+	map<string, Winner>::iterator	it;
+	size_t			i,
+					k = 0;
+
+	if (addrs.size() < 2)
+
+		return;
+
+	for (i = 0; i < addrs.size(); i++)
+
+		(addrs[i].addr.ss_family == addrs[0].addr.ss_family ?
+		 first : other).push_back(addrs[i]);
+
+	for (i = 0; i < max(first.size(), other.size()); i++) {
+
+		if (i < first.size())
+
+			addrs[k++] = first[i];
+
+		if (i < other.size())
+
+			addrs[k++] = other[i];
+
+	}
+
+	lock_guard<mutex>	guard(Lock);
+
+	if ((it = Winners.find(host + ":" + to_string(port))) == Winners.end())
+
+		return;
+
+	for (i = 0; i < addrs.size(); i++) {
+
+		if (same(addrs[i], it->second.addr)) {
+
+			rotate(addrs.begin(), addrs.begin() + i, addrs.begin() + i + 1);
+			break;
+
+		}
+
+	}
+
+}
+
+/*
+ * Remember the address a relay was last reached at, to try it
+ * first next time (see order).
+ * @args:	relay host & port (const string &host, int port)
+ * 			address that won (const Resolver::Address &addr)
+ * 			time the connect took (uint64_t usec)
+ */
+void
+Connector::won(const string &host,
+			   int port,
+			   const Resolver::Address &addr,
+			   uint64_t usec)
+{
+
+	lock_guard<mutex>	guard(Lock);
+	Winner			&w = Winners[host + ":" + to_string(port)];
+
+	if (!same(w.addr, addr) || w.usec == 0)
+
+		Logger::shared().print(LogInfo, "%s: connected to %s in %.1f ms",
+							   host.c_str(), format(addr).c_str(),
+							   usec / 1000.0);
+
+	w.addr = addr;
+	w.usec = usec;
+
+}
+
+/*
+ * @args:	address (const Resolver::Address &addr)
+ * @return:	"[2001:db8::1]:25" (IPv6) or "192.0.2.1:25" (IPv4)
+ */
+string
+Connector::format(const Resolver::Address &addr)
+{
+
+	char			text[INET6_ADDRSTRLEN];
+
+	if (addr.addr.ss_family == AF_INET6) {
+
+		const sockaddr_in6	*sin6 = (const sockaddr_in6 *)&addr.addr;
+
+		inet_ntop(AF_INET6, &sin6->sin6_addr, text, sizeof(text));
+
+		return "[" + string(text) + "]:" + to_string(ntohs(sin6->sin6_port));
+
+	}
+
+	const sockaddr_in	*sin = (const sockaddr_in *)&addr.addr;
+
+	inet_ntop(AF_INET, &sin->sin_addr, text, sizeof(text));
+
+	return string(text) + ":" + to_string(ntohs(sin->sin_port));
+
+}
+
+/*
+ * @args:	two addresses (const Resolver::Address &a, &b)
+ * @return:	true (same family, address and port)
+ */
+bool
+Connector::same(const Resolver::Address &a, const Resolver::Address &b)
+{
+
+	if (a.addr.ss_family != b.addr.ss_family)
+
+		return false;
+
+	if (a.addr.ss_family == AF_INET6) {
+
+		const sockaddr_in6	*x = (const sockaddr_in6 *)&a.addr,
+							*y = (const sockaddr_in6 *)&b.addr;
+
+		return x->sin6_port == y->sin6_port &&
+			   memcmp(&x->sin6_addr, &y->sin6_addr, sizeof(x->sin6_addr)) == 0;
+
+	}
+
+	const sockaddr_in	*x = (const sockaddr_in *)&a.addr,
+						*y = (const sockaddr_in *)&b.addr;
+
+	return a.addr.ss_family == AF_INET && x->sin_port == y->sin_port &&
+		   x->sin_addr.s_addr == y->sin_addr.s_addr;
+
+}
@@ -0,0 +1,130 @@
+/*
+ * Mail-Sending Program
+ * Connector.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+
+#ifndef CONNECTOR_HH_
+#define CONNECTOR_HH_
+
+#include "Resolver.hh"
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <stdint.h>
+
+using namespace std;
+
+/*
+ * Connector object
+ * Thread-safe dual-stack TCP connect to a relay, "Happy Eyeballs"
+ * (RFC 8305): the relay's addresses (IPv6 and IPv4, see Resolver)
+ * are tried in order, families interleaved, but w/o waiting for
+ * each to fail: a non-blocking connect is started to the next
+ * address every AttemptDelay ms while none has finished (at once
+ * when one fails), and the first to connect wins. A dead or slow
+ * address costs AttemptDelay, not the kernel's connect timeout.
+ * Every attempt has a hard deadline of AttemptTimeout ms.
+ * The address that won last for each relay (host:port) is
+ * remembered, w/ its connect time, and tried first next time.
+ * @methods:	shared, connect, order, won, set_timeouts, attempt_delay,
+ * 			attempt_timeout
+ */
+class Connector
+{
+  public:
+
+	enum { DefaultAttemptDelay = 250,		// Ms. before the next address
+		   DefaultAttemptTimeout = 10000 };	// Ms. an attempt may take
+
+			 Connector(int attempt_delay = DefaultAttemptDelay,
+					   int attempt_timeout = DefaultAttemptTimeout):
+				 AttemptDelay(attempt_delay), AttemptTimeout(attempt_timeout) { }
+			~Connector() { }
+
+	 // Connector shared by all senders (of all threads).
+
+	static Connector	&shared();
+
+	 // Connect to relay host:port at one of its addresses.
+
+	int				connect(const string &host, int port,
+							const vector<Resolver::Address> &addrs);
+
+	 // Put addresses in the order to try them.
+
+	void			order(const string &host, int port,
+						  vector<Resolver::Address> &addrs);
+
+	 // Remember the address a connect to host:port won w/.
+
+	void			won(const string &host, int port,
+						const Resolver::Address &addr, uint64_t usec);
+
+	void			set_timeouts(int attempt_delay, int attempt_timeout)
+					{ AttemptDelay = attempt_delay; AttemptTimeout = attempt_timeout; }
+
+	 // Ms. between attempts, ms. an attempt may take (for callers
+	 // that race connects in their own event loop, see SmtpEngine).
+
+	int				attempt_delay() const { return AttemptDelay; }
+
+	int				attempt_timeout() const { return AttemptTimeout; }
+
+	 // Printable address, "[2001:db8::1]:25" or "192.0.2.1:25".
+
+	static string	format(const Resolver::Address &addr);
+
+  private:
+
+	 // Last address to win for a relay, and its connect time.
+
+	struct Winner {
+		Resolver::Address	addr;
+		uint64_t			usec;
+	};
+
+	mutex			Lock;			// Guards Winners
+	map<string, Winner>	Winners;	// By "host:port"
+	int				AttemptDelay,	// Ms.
+					AttemptTimeout;
+
+	 // Same address and port?
+
+	static bool		same(const Resolver::Address &a,
+						 const Resolver::Address &b);
+
+};
+
+#endif /* CONNECTOR_HH_ */
@@ -0,0 +1,317 @@
+/*
+ * Mail-Sending Program
+ * HeaderScanner.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+
+#include "HeaderScanner.hh"
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+struct FieldName {				// Name to Field
+	const char				*name;
+	size_t					len;
+	HeaderScanner::Field	field;
+};
+
+const FieldName	FieldNames[] = {
+	{ "From",		4,	HeaderScanner::From },
+	{ "To",			2,	HeaderScanner::To },
+	{ "Cc",			2,	HeaderScanner::Cc },
+	{ "Bcc",		3,	HeaderScanner::Bcc },
+	{ "Message-ID",	10,	HeaderScanner::MessageId }
+};
+
+/*
+ * Scan the header of a message file (see scan(int)).
+ * @args:	message file (const string &filename)
+ * @return:	0 (success)
+ *  -error: -1 (file not opened/read, header too large, errno)
+ */
+int
+HeaderScanner::scan(const string &filename)
+{
+
+	int				fd,
+					result,
+					error;
+
+	if ((fd = open(filename.c_str(), O_RDONLY)) < 0)
+
+		return -1;		// Errno set
+
+	result = scan(fd);
+	error = errno;
+	close(fd);
+	errno = error;
+
+	return result;
+
+}
+
+/*
+ * Read a message from fd until its header is complete (a blank
+ * line, or the end of the file for a message w/o body), scanning
+ * each block as it arrives. A field cut by the end of a block is
+ * scanned again once the block after it is in.
+ * @args:	open file (int fd)
+ * @return:	0 (success)
+ *  -error: -1 (read error, errno; header over MaxHeader, EMSGSIZE)
+ */
+int
+HeaderScanner::scan(int fd)
+{
+
+	size_t			len = 0,	// Bytes in Buf
+					pos = 0;	// Next field
+	ssize_t			n;
+
+	reset();
+
+	if (Buf.size() < Block)
+
+		Buf.resize(Block);
+
+	do {
+
+		if (len == Buf.size()) {
+
+			if (len >= MaxHeader) {
+
+				errno = EMSGSIZE;
+				return -1;
+
+			}
+
+			Buf.resize(len * 2);
+
+		}
+
+		if ((n = read(fd, &Buf[len], Buf.size() - len)) < 0) {
+
+			if (errno == EINTR)
+
+				continue;
+
+			return -1;		// Errno set
+
+		}
+
+		len += n;
+
+	} while (parse(&Buf[0], len, pos, n == 0) == 0);
+
+	Data = &Buf[0];
+
+	return 0;
+
+}
+
+/*
+ * Scan the header of a message in memory, which must stay put
+ * while the values are in use.
+ * @args:	message (const char *message, size_t len)
+ */
+void
+HeaderScanner::scan(const char *message, size_t len)
+{
+
+	size_t			pos = 0;
+
+	reset();
+	parse(message, len, pos, true);
+	Data = message;
+
+}
+
+/*
+ * @args:	field (Field f), occurrence (int n)
+ * @return:	value of the n-th f field (string_view), "" if none
+ */
+string_view
+HeaderScanner::value(Field f, int n) const
+{
+
+	if (n >= Count[f])
+
+		return string_view();
+
+	return string_view(Data + Start[f][n], Len[f][n]);
+
+}
+
+void
+HeaderScanner::reset()
+{
+
+	Length = 0;
+
+	for (int f = 0; f < Fields; f++)
+
+		Count[f] = 0;
+
+}
+
+/*
+ * Scan whole fields, each up to the end of its last (folded) line,
+ * from pos on; stop at the blank line ending the header. W/o eof,
+ * a field is only whole once the first byte of the next line is
+ * in (it may be a continuation).
+ * @args:	bytes read (const char *data, size_t len)
+ * 			next field, advanced (size_t &pos)
+ * 			no more data to come (bool eof)
+ * @return:	1 (header done, Length set)
+ * 			0 (more data needed)
+ */
+int
+HeaderScanner::parse(const char *data, size_t len, size_t &pos, bool eof)
+{
+
+	const char		*nl;		// Line feed
+	size_t			end;		// Of field
+
+	while (pos < len) {
+
+		// Blank line (LF or CRLF) ends the header.
+		if (data[pos] == '\n') {
+
+			Length = pos + 1;
+			return 1;
+
+		}
+
+		if (data[pos] == '\r' && pos + 1 < len && data[pos + 1] == '\n') {
+
+			Length = pos + 2;
+			return 1;
+
+		}
+
+		for (end = pos; ; ) {
+
+			if ((nl = (const char *)memchr(data + end, '\n',
+										   len - end)) == NULL) {
+
+				end = len;		// Line not complete
+				break;
+
+			}
+
+			end = nl - data + 1;
+
+			if (end == len || (data[end] != ' ' && data[end] != '\t'))
+
+				break;			// Not folded, or unknown yet
+
+		}
+
+		if (end == len && !eof)
+
+			return 0;			// Rest of field still to come
+
+		field(data, pos, end);
+		pos = end;
+
+	}
+
+	if (!eof)
+
+		return 0;
+
+	Length = len;				// No body
+	return 1;
+
+}
+
+/*
+ * Record a field if its name is one of FieldNames (case does not
+ * matter, whitespace before the colon is allowed).
+ * @args:	header (const char *data)
+ * 			field, incl. its line end(s) (size_t start, size_t end)
+ */
+void
+HeaderScanner::field(const char *data, size_t start, size_t end)
+{
+
+	const char		*colon;
+	size_t			name_len,
+					value;		// Start of value
+
+	if ((colon = (const char *)memchr(data + start, ':',
+									  end - start)) == NULL)
+
+		return;			// Not a header field
+
+	name_len = colon - data - start;
+
+	while (name_len > 0 && (data[start + name_len - 1] == ' ' ||
+							data[start + name_len - 1] == '\t'))
+
+		name_len--;
+
+	value = colon - data + 1;
+
+	while (value < end && (data[value] == ' ' || data[value] == '\t'))
+
+		value++;
+
+	while (end > value && (data[end - 1] == '\n' || data[end - 1] == '\r'))
+
+		end--;
+
+	for (size_t i = 0; i < sizeof(FieldNames) / sizeof(FieldNames[0]); i++) {
+
+		const FieldName	&fn = FieldNames[i];
+
+		if (fn.len == name_len &&
+			strncasecmp(data + start, fn.name, name_len) == 0) {
+
+			if (Count[fn.field] < MaxEach) {
+
+				Start[fn.field][Count[fn.field]] = value;
+				Len[fn.field][Count[fn.field]] = end - value;
+				Count[fn.field]++;
+
+			}
+
+			return;
+
+		}
+
+	}
+
+}
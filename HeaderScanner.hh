@@ -0,0 +1,117 @@
+/*
+ * Mail-Sending Program
+ * HeaderScanner.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+
+
+#ifndef HEADERSCANNER_HH_
+#define HEADERSCANNER_HH_
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sys/types.h>
+
+using namespace std;
+
+/*
+ * HeaderScanner object
+ * Single pass over the header of a message (RFC 5322), finding the
+ * fields the envelope is made of. Only the header region is read,
+ * in Block-sized reads into a buffer reused from message to
+ * message; line and field boundaries are found w/ memchr(), so the
+ * cost is one vectorized pass over the header whatever the number
+ * of fields. Values are returned as string_views into the buffer
+ * (valid until the next scan), w/ folded lines left in place (CRLF
+ * + WSP is whitespace to ParseAddressList) and no allocation per
+ * field. Field names are matched exactly: "Reply-To:" is not "To:".
+ * @methods:	scan (file, descriptor or memory), header, count, value
+ */
+class HeaderScanner
+{
+  public:
+
+	enum Field { From, To, Cc, Bcc, MessageId, Fields };
+
+	enum { Block = 16384,			// Bytes read at a time
+		   MaxHeader = 1 << 20,		// Larger headers are refused
+		   MaxEach = 8 };			// Occurrences kept per field
+
+			 HeaderScanner(): Data(NULL), Length(0) { reset(); }
+
+	 // Scan the header of a message file, of an open file (from its
+
+	 // current offset) or of a message in memory (not copied).
+
+	int				scan(const string &filename);
+
+	int				scan(int fd);
+
+	void			scan(const char *message, size_t len);
+
+	 // Header, up to and including the blank line after it.
+
+	string_view		header() const { return string_view(Data, Length); }
+
+	 // Occurrences of a field, value of the n-th (w/o the name, the
+
+	 // leading whitespace and the line end), "" if none.
+
+	int				count(Field f) const { return Count[f]; }
+
+	string_view		value(Field f, int n = 0) const;
+
+  private:
+
+	vector<char>	Buf;			// File header (and some body)
+	const char		*Data;			// Scanned header
+	size_t			Length,			// Header bytes
+					Start[Fields][MaxEach],	// Values: offset in Data
+					Len[Fields][MaxEach];	// and length
+	int				Count[Fields];
+
+	void			reset();
+
+	 // Scan the fields from pos on. 1: header done, 0: need more.
+
+	int				parse(const char *data, size_t len,
+						  size_t &pos, bool eof);
+
+	 // Record the field at [start, end) if it is one of Fields.
+
+	void			field(const char *data, size_t start, size_t end);
+
+};
+
+#endif /* HEADERSCANNER_HH_ */
@@ -0,0 +1,424 @@
+/*
+ * Mail-Sending Program
+ * Logger.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+
+#include "Logger.hh"
+#include <cstring>
+#include <cstdarg>
+#include <ctime>
+#include <csignal>
+#include <chrono>
+#include <pthread.h>
+
+using namespace std;
+
+const char		*LevelNames[] = { "ERROR", "WARN", "INFO", "DEBUG" };
+
+/*
+ * Record: header of a log record in a ring, followed by its text
+ * (len bytes), padded to a multiple of 16 bytes. A Pad record
+ * fills the end of the ring when the next record does not fit
+ * there, and is skipped.
+ */
+struct Record
+{
+	enum { Pad = 0xff };
+
+	uint64_t		time;		// Nanoseconds since the epoch
+	uint32_t		len;		// Text bytes
+	uint8_t			level;		// LogLevel, or Pad
+	char			tag[3];		// "C", "S" ... NUL-terminated
+};
+
+/*
+ * Logger::Ring: single producer (its thread), single consumer
+ * (the flusher, under Lock) byte ring. head and tail only grow;
+ * the producer publishes records w/ a release store of head, the
+ * consumer frees them w/ one of tail. Each sits on its own cache
+ * line. A ring outlives its thread, so records logged just before
+ * a thread exits are still written; it is freed w/ the Logger.
+ */
+struct Logger::Ring
+{
+	Logger				*owner;
+	int					id;			// Thread # in the log
+	alignas(64) atomic<size_t>	head;	// Bytes written
+	alignas(64) atomic<size_t>	tail;	// Bytes consumed
+	alignas(64) char	buf[RingSize];
+};
+
+// Bytes a record of len text bytes takes in a ring.
+
+static size_t	RecordSize(size_t len)
+{
+
+	return sizeof(Record) + ((len + 15) & ~(size_t)15);
+
+}
+
+Logger::Logger(): Level(LogWarn), Body(false), Dropped(0), Out(stderr),
+				  Stopping(false), Flusher(&Logger::run, this)
+{
+
+}
+
+Logger::~Logger()
+{
+
+	stop();
+
+	for (list<Ring *>::iterator it = Rings.begin(); it != Rings.end(); it++)
+
+		delete *it;
+
+}
+
+/*
+ * Log of the whole process.
+ * @return:	the shared Logger (Logger &)
+ */
+Logger &
+Logger::shared()
+{
+
+	static Logger	log;
+
+	return log;
+
+}
+
+/*
+ * Write records to a file instead of stderr, appended.
+ * @args:	log file (const string &path)
+ * @return:	0 (success)
+ *  -error: -1 (file not opened, errno)
+ */
+int
+Logger::open(const string &path)
+{
+
+	FILE			*file;
+
+	if ((file = fopen(path.c_str(), "a")) == NULL)
+
+		return -1;		// Errno set
+
+	lock_guard<mutex>	guard(Lock);
+
+	drain();			// What is logged so far, to the old file
+
+	if (Out != stderr)
+
+		fclose(Out);
+
+	Out = file;
+	return 0;
+
+}
+
+/*
+ * Log a printf() formatted message, at most MaxRecord bytes of it.
+ * Formatting is done by the caller, and only if level is enabled.
+ * @args:	level (LogLevel level), format & args (see printf)
+ */
+void
+Logger::print(LogLevel level, const char *format, ...)
+{
+
+	char			text[MaxRecord];
+	va_list			args;
+	int				n;
+
+	if (!enabled(level))
+
+		return;
+
+	va_start(args, format);
+	n = vsnprintf(text, sizeof(text), format, args);
+	va_end(args);
+
+	if (n < 0)
+
+		return;
+
+	write(level, "", text, min((size_t)n, sizeof(text) - 1));
+
+}
+
+/*
+ * Copy a record into the calling thread's ring, split in records
+ * of at most MaxRecord bytes. A record that does not fit is
+ * dropped (counted), the caller never waits on the flusher.
+ * @args:	level (LogLevel level), tag (const char *tag)
+ * 			text (const char *text, size_t len)
+ */
+void
+Logger::write(LogLevel level, const char *tag,
+			  const char *text, size_t len)
+{
+
+	Ring			*r = ring();
+	Record			*rec;
+	timespec		ts;
+	size_t			i = 0,		// Text written
+					piece,
+					size,		// Bytes of record
+					head,
+					off,		// Of record in buf
+					room;		// Up to the end of buf
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+
+	do {
+
+		piece = min(len - i, (size_t)MaxRecord);
+		size = RecordSize(piece);
+		head = r->head.load(memory_order_relaxed);
+		off = head % RingSize;
+		room = RingSize - off;
+
+		if (RingSize - (head - r->tail.load(memory_order_acquire)) <
+			(size <= room ? size : room + size)) {
+
+			Dropped++;		// Full, flusher behind
+			return;
+
+		}
+
+		if (size > room) {
+
+			rec = (Record *)(r->buf + off);		// Skip to the start
+			rec->level = Record::Pad;
+			rec->len = room - sizeof(Record);
+			head += room;
+			off = 0;
+
+		}
+
+		rec = (Record *)(r->buf + off);
+		rec->time = ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+		rec->len = piece;
+		rec->level = level;
+		strncpy(rec->tag, tag, sizeof(rec->tag) - 1);
+		rec->tag[sizeof(rec->tag) - 1] = '\0';
+		memcpy(rec + 1, text + i, piece);
+
+		r->head.store(head + size, memory_order_release);
+		i += piece;
+
+	} while (i < len);
+
+}
+
+/*
+ * Ring of the calling thread, allocated and registered (under
+ * Lock) the first time the thread logs, cached in a thread_local
+ * pointer afterwards.
+ * @return:	the thread's ring (Ring *)
+ */
+Logger::Ring *
+Logger::ring()
+{
+
+	static thread_local Ring	*mine = NULL;
+
+	if (mine != NULL && mine->owner == this)
+
+		return mine;
+
+	mine = new Ring;
+	mine->owner = this;
+	mine->head = 0;
+	mine->tail = 0;
+
+	lock_guard<mutex>	guard(Lock);
+
+	mine->id = Rings.size() + 1;
+	Rings.push_back(mine);
+	return mine;
+
+}
+
+/*
+ * Background thread: drain the rings every FlushMs until stopped.
+ * Signals are blocked here so they go to the threads that wait
+ * for them (see DumpOnSignal in main.cc).
+ */
+void
+Logger::run()
+{
+
+	sigset_t		all;
+
+	sigfillset(&all);
+	pthread_sigmask(SIG_BLOCK, &all, NULL);
+
+	unique_lock<mutex>	lock(Lock);
+
+	while (!Stopping) {
+
+		Wake.wait_for(lock, chrono::milliseconds(FlushMs));
+		drain();
+
+	}
+
+	drain();
+
+}
+
+/*
+ * Format the records of every ring and write them out, one line
+ * per line of text:
+ * 	2026-10-18T09:30:00.123456Z DEBUG [2] C: MAIL FROM:<a@b.c>
+ * Lock must be held.
+ */
+void
+Logger::drain()
+{
+
+	char			stamp[40];
+	size_t			head,
+					tail;
+	time_t			secs;
+	tm				when;
+
+	for (list<Ring *>::iterator it = Rings.begin(); it != Rings.end(); it++) {
+
+		Ring	*r = *it;
+
+		head = r->head.load(memory_order_acquire);
+		tail = r->tail.load(memory_order_relaxed);
+
+		while (tail != head) {
+
+			Record		*rec = (Record *)(r->buf + tail % RingSize);
+			const char	*text = (const char *)(rec + 1),
+						*end = text + rec->len,
+						*eol;
+
+			if (rec->level == Record::Pad) {
+
+				tail += sizeof(Record) + rec->len;
+				continue;
+
+			}
+
+			secs = rec->time / 1000000000ULL;
+			gmtime_r(&secs, &when);
+			strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S", &when);
+
+			// A line per line of text, w/o its CRLF.
+			do {
+
+				if ((eol = (const char *)memchr(text, '\n',
+												end - text)) == NULL)
+
+					eol = end;
+
+				fprintf(Out, "%s.%06uZ %s [%d] %s%s%.*s\n", stamp,
+						(unsigned int)(rec->time / 1000 % 1000000),
+						LevelNames[rec->level], r->id, rec->tag,
+						rec->tag[0] != '\0' ? ": " : "",
+						(int)(eol - text -
+							  (eol > text && eol[-1] == '\r')), text);
+				text = eol + 1;
+
+			} while (text < end);
+
+			tail += RecordSize(rec->len);
+
+		}
+
+		r->tail.store(tail, memory_order_release);
+
+	}
+
+	fflush(Out);
+
+}
+
+/*
+ * Write out every record logged so far.
+ */
+void
+Logger::flush()
+{
+
+	lock_guard<mutex>	guard(Lock);
+
+	drain();
+
+}
+
+/*
+ * Stop the background thread after a last drain, and report the
+ * records dropped, if any. Records logged afterwards are written
+ * only by flush().
+ */
+void
+Logger::stop()
+{
+
+	{
+		lock_guard<mutex>	guard(Lock);
+
+		if (Stopping)
+
+			return;
+
+		Stopping = true;
+
+	}
+
+	Wake.notify_one();
+	Flusher.join();
+
+	lock_guard<mutex>	guard(Lock);
+
+	if (Dropped > 0)
+
+		fprintf(Out, "%llu log records dropped (ring full)\n",
+				(unsigned long long)Dropped.load());
+
+	fflush(Out);
+
+	if (Out != stderr) {
+
+		fclose(Out);
+		Out = stderr;
+
+	}
+
+}
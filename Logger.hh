@@ -0,0 +1,163 @@
+/*
+ * Mail-Sending Program
+ * Logger.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+
+
+#ifndef LOGGER_HH_
+#define LOGGER_HH_
+
+#include <string>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <stdint.h>
+
+using namespace std;
+
+// Severity of a log record, most severe first.
+
+enum LogLevel { LogError, LogWarn, LogInfo, LogDebug };
+
+/*
+ * Logger object
+ * Asynchronous leveled log. A thread that logs copies the record
+ * (time, level, tag, text) as is into a ring buffer of its own,
+ * w/o locking, formatting or system calls; a background thread
+ * drains the rings every FlushMs, formats the records and writes
+ * them out (stderr by default). A record that does not fit in a
+ * full ring is dropped and counted, the sender never waits.
+ * log() of a disabled level is an inlined load and compare, so log
+ * statements may stay in the SMTP hot path.
+ * 	Debug	SMTP transcript ("C:" commands, "S:" replies)
+ * 	body	message data as sent ("D:"), only if also enabled
+ * @methods:	shared, enabled, log, print, log_body, flush, stop
+ */
+class Logger
+{
+  public:
+
+	enum { RingSize = 1 << 18,		// Bytes of ring per thread
+		   MaxRecord = 1 << 14,		// Text bytes per record
+		   FlushMs = 50 };			// Drain interval
+
+			 Logger();
+			~Logger();
+
+	 // Log of the whole process.
+
+	static Logger	&shared();
+
+	 // Is level (body: message data) logged.
+
+	bool			enabled(LogLevel level) const
+						{ return level <= Level.load(memory_order_relaxed); }
+
+	bool			body() const
+						{ return Body.load(memory_order_relaxed) &&
+								 enabled(LogDebug); }
+
+	void			set_level(LogLevel level) { Level = level; }
+
+	void			set_body(bool body) { Body = body; }
+
+	 // Write to a file (appended) instead of stderr.
+
+	int				open(const string &path);
+
+	 // Log text w/ a short tag ("C", "S" ...), may contain CRLFs.
+
+	void			log(LogLevel level, const char *tag,
+						const char *text, size_t len)
+						{ if (enabled(level)) write(level, tag, text, len); }
+
+	void			log(LogLevel level, const char *tag,
+						const string &text)
+						{ log(level, tag, text.data(), text.length()); }
+
+	 // Log a printf() formatted message.
+
+	void			print(LogLevel level, const char *format, ...)
+						__attribute__((format(printf, 3, 4)));
+
+	 // Log message data, if body logging is on.
+
+	void			log_body(const char *data, size_t len)
+						{ if (body()) write(LogDebug, "D", data, len); }
+
+	 // Write out what is logged so far; stop the thread (at exit).
+
+	void			flush();
+
+	void			stop();
+
+	 // Records dropped for a full ring.
+
+	uint64_t		dropped() const { return Dropped.load(); }
+
+  private:
+
+	struct Ring;				// One per logging thread
+
+	atomic<int>		Level;
+	atomic<bool>	Body;
+	atomic<uint64_t>	Dropped;
+	mutex			Lock;		// Guards Rings, Out, Stopping; drains
+	condition_variable	Wake;
+	list<Ring *>	Rings;
+	FILE			*Out;
+	bool			Stopping;
+	thread			Flusher;
+
+	 // Copy a record into the calling thread's ring.
+
+	void			write(LogLevel level, const char *tag,
+						  const char *text, size_t len);
+
+	 // Ring of the calling thread, added on first use.
+
+	Ring			*ring();
+
+	 // Background thread; format and write records (Lock held).
+
+	void			run();
+
+	void			drain();
+
+};
+
+#endif /* LOGGER_HH_ */
@@ -0,0 +1,954 @@
+/*
+ * Mail-Sending Program
+ * MailMerge.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+#include "MailMerge.hh"
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cctype>
+#include <cerrno>
+#include <strings.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+// Whitespace between JSON tokens.
+
+static inline bool
+json_space(char c)
+{
+
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+
+}
+
+// 4 hex digits of a JSON "\u" escape.
+
+static bool
+hex4(const char *p, unsigned int &code)
+{
+
+	code = 0;
+
+	for (int i = 0; i < 4; i++) {
+
+		unsigned char	c = p[i];
+
+		if (!isxdigit(c))
+
+			return false;
+
+		code = code << 4 | (isdigit(c) ? c - '0' : (c | 0x20) - 'a' + 10);
+
+	}
+
+	return true;
+
+}
+
+/*
+ * Read a template file and compile it (see compile).
+ * @args:	template file (const string &filename)
+ * @return:	0 (success)
+ *  -error:	-1 (file error, errno, or syntax error, see error())
+ */
+int
+MergeTemplate::load(const string &filename)
+{
+
+	ifstream		fin(filename.c_str(), ios::in | ios::binary);
+	ostringstream	text;
+
+	if (!fin.is_open()) {
+
+		Error = strerror(errno);
+		return -1;
+
+	}
+
+	text << fin.rdbuf();
+
+	return compile(text.str());
+
+}
+
+/*
+ * Compile a template: its header line by line, so that Bcc: fields
+ * (and their folded lines) go to the Hidden list w/o their name,
+ * the other lines to the Body list, and then the body in one piece.
+ * Literal segments next to each other are merged, so a message is
+ * about one segment per placeholder.
+ * @args:	template text (string_view text)
+ * @return:	0 (success)
+ *  -error:	-1 (bad placeholder, see error())
+ */
+int
+MergeTemplate::compile(string_view text)
+{
+
+	size_t			pos = 0,	// Start of the current line
+					eol;		// Past its LF
+	bool			in_bcc = false;	// In a Bcc: field
+
+	Text.clear();
+	Body.clear();
+	Hidden.clear();
+	Names.clear();
+	Error.clear();
+
+	while (pos < text.length()) {
+
+		string_view	line;
+
+		eol = text.find('\n', pos);
+		eol = eol == string_view::npos ? text.length() : eol + 1;
+		line = text.substr(pos, eol - pos);
+
+		if (line == "\n" || line == "\r\n")
+
+			break;		// Blank line: the body follows
+
+		if (line[0] != ' ' && line[0] != '\t') {
+
+			in_bcc = line.length() >= 4 &&
+					 strncasecmp(line.data(), "Bcc:", 4) == 0;
+
+			if (in_bcc) {
+
+				line.remove_prefix(4);
+
+				if (!Hidden.empty() && add(Hidden, ",", true) != 0)
+
+					return -1;
+
+			}
+
+		}
+
+		if (add(in_bcc ? Hidden : Body, line, true) != 0)
+
+			return -1;
+
+		pos = eol;
+
+	}
+
+	return add(Body, text.substr(pos), false);
+
+}
+
+/*
+ * Add text to a segment list: the literal text between
+ * placeholders, merged into the last segment if that is literal
+ * too, and a segment per "{{name}}" (whitespace around the name is
+ * allowed). Names are letters, digits, '_', '-' and '.'.
+ * @args:	segment list (vector<Segment> &list)
+ * 			text to add (string_view text)
+ * 			text is in the header (bool header)
+ * @return:	0 (success)
+ *  -error:	-1 (unterminated or bad placeholder, see error())
+ */
+int
+MergeTemplate::add(vector<Segment> &list, string_view text, bool header)
+{
+
+	size_t			open,		// "{{"
+					close;		// "}}"
+	Segment			seg;
+
+	while (!text.empty()) {
+
+		open = text.find("{{");
+
+		if (open > 0) {
+
+			string_view	literal = text.substr(0, open);
+
+			if (!list.empty() && list.back().field < 0 &&
+				list.back().header == header &&
+				list.back().offset + list.back().length == Text.length())
+
+				list.back().length += literal.length();
+
+			else {
+
+				seg.offset = Text.length();
+				seg.length = literal.length();
+				seg.field = -1;
+				seg.header = header;
+				list.push_back(seg);
+
+			}
+
+			Text.append(literal);
+
+		}
+
+		if (open == string_view::npos)
+
+			break;
+
+		if ((close = text.find("}}", open + 2)) == string_view::npos) {
+
+			Error = "unterminated placeholder: " +
+					string(text.substr(open, 20));
+			return -1;
+
+		}
+
+		string_view	name = text.substr(open + 2, close - open - 2);
+
+		while (!name.empty() && isspace((unsigned char)name.front()))
+
+			name.remove_prefix(1);
+
+		while (!name.empty() && isspace((unsigned char)name.back()))
+
+			name.remove_suffix(1);
+
+		for (size_t i = 0; i < name.length(); i++) {
+
+			unsigned char	c = name[i];
+
+			if (!isalnum(c) && c != '_' && c != '-' && c != '.')
+
+				name = string_view();
+
+		}
+
+		if (name.empty()) {
+
+			Error = "bad placeholder: " +
+					string(text.substr(open, close + 2 - open));
+			return -1;
+
+		}
+
+		seg.offset = seg.length = 0;
+		seg.field = 0;
+		seg.header = header;
+
+		while (seg.field < (int)Names.size() && Names[seg.field] != name)
+
+			seg.field++;
+
+		if (seg.field == (int)Names.size())
+
+			Names.push_back(string(name));
+
+		list.push_back(seg);
+		text.remove_prefix(close + 2);
+
+	}
+
+	return 0;
+
+}
+
+/*
+ * @args:	values of the fields, in order of fields()
+ * 			(const string_view *values)
+ * 			message, overwritten (vector<char> &message)
+ * 			Bcc: addresses, overwritten (vector<char> &bcc)
+ */
+void
+MergeTemplate::render(const string_view *values,
+					  vector<char> &message,
+					  vector<char> &bcc) const
+{
+
+	message.clear();		// Capacity is kept
+	bcc.clear();
+	append(message, Body, Text, values);
+	append(bcc, Hidden, Text, values);
+
+}
+
+/*
+ * @args:	buffer to append to (vector<char> &out)
+ * 			segments (const vector<Segment> &list)
+ * 			their literal text (const string &text)
+ * 			field values (const string_view *values)
+ */
+void
+MergeTemplate::append(vector<char> &out,
+					  const vector<Segment> &list,
+					  const string &text,
+					  const string_view *values)
+{
+
+	for (size_t i = 0; i < list.size(); i++) {
+
+		const Segment	&seg = list[i];
+
+		if (seg.field < 0) {
+
+			out.insert(out.end(), text.data() + seg.offset,
+					   text.data() + seg.offset + seg.length);
+			continue;
+
+		}
+
+		size_t		at = out.size();
+
+		out.insert(out.end(), values[seg.field].begin(),
+				   values[seg.field].end());
+
+		if (seg.header) {
+
+			// A line break would start a new header field.
+			for (size_t j = at; j < out.size(); j++) {
+
+				if (out[j] == '\r' || out[j] == '\n')
+
+					out[j] = ' ';
+
+			}
+
+		}
+
+	}
+
+}
+
+/*
+ * @args:	data file (const string &filename)
+ * @return:	0 (success)
+ *  -error:	-1 (see open(filename, format))
+ */
+int
+MergeData::open(const string &filename)
+{
+
+	size_t			dot = filename.rfind('.');
+	string			suffix = dot == string::npos ? "" : filename.substr(dot);
+
+	return open(filename, suffix == ".jsonl" || suffix == ".json" ?
+						  Jsonl : Csv);
+
+}
+
+/*
+ * Read a data file into memory and index its records; the header
+ * record of a CSV file gives the column names.
+ * @args:	data file (const string &filename)
+ * 			its format (Format format)
+ * @return:	0 (success)
+ *  -error:	-1 (file error, errno, or no CSV header, see error())
+ */
+int
+MergeData::open(const string &filename, Format format)
+{
+
+	struct stat		st;
+	ssize_t			n;
+	size_t			got = 0;
+	int				fd;
+
+	Kind = format;
+	Data.clear();
+	Spans.clear();
+	Columns.clear();
+	Error.clear();
+
+	if ((fd = ::open(filename.c_str(), O_RDONLY)) < 0 ||
+		fstat(fd, &st) != 0) {
+
+		Error = strerror(errno);
+
+		if (fd >= 0)
+
+			close(fd);
+
+		return -1;
+
+	}
+
+	Data.resize(st.st_size);
+
+	while (got < Data.size() &&
+		   (n = ::read(fd, &Data[got], Data.size() - got)) != 0) {
+
+		if (n < 0) {
+
+			if (errno == EINTR)
+
+				continue;
+
+			Error = strerror(errno);
+			close(fd);
+			return -1;
+
+		}
+
+		got += n;
+
+	}
+
+	close(fd);
+	Data.resize(got);
+	index();
+
+	if (Kind == Csv) {
+
+		Record		header;
+
+		if (Spans.empty()) {
+
+			Error = "no header record";
+			return -1;
+
+		}
+
+		header.arena.resize(Spans[0].end - Spans[0].start);
+
+		if (read_csv(Spans[0], header, true) != 0) {
+
+			Error = "header: " + header.error;
+			return -1;
+
+		}
+
+		Columns.assign(header.values.begin(), header.values.end());
+		Spans.erase(Spans.begin());
+
+	}
+
+	return 0;
+
+}
+
+/*
+ * Find the records: lines, w/ their CR dropped, except that a CSV
+ * record goes on past a line end inside a quoted field (an odd #
+ * of quotes so far). Blank lines are skipped, as is a UTF-8 byte
+ * order mark.
+ */
+void
+MergeData::index()
+{
+
+	const char		*data = Data.data(),
+					*nl,		// Line end
+					*q;
+	size_t			size = Data.size(),
+					pos = 0,	// Record start
+					scan,		// Line being scanned
+					end,
+					line = 1;	// Line of pos
+	bool			quoted;		// In a quoted CSV field
+
+	if (Data.compare(0, 3, "\xef\xbb\xbf") == 0)
+
+		pos = 3;
+
+	while (pos < size) {
+
+		Span		span;
+
+		span.start = scan = pos;
+		span.line = line;
+		quoted = false;
+
+		while (true) {
+
+			nl = (const char *)memchr(data + scan, '\n', size - scan);
+			end = nl ? nl - data : size;
+
+			for (q = data + scan; Kind == Csv &&
+				 (q = (const char *)memchr(q, '"', data + end - q)) != NULL;
+				 q++)
+
+				quoted = !quoted;
+
+			if (!quoted || end == size)
+
+				break;
+
+			scan = end + 1;		// Line end inside a field
+			line++;
+
+		}
+
+		pos = end < size ? end + 1 : size;
+		line++;
+		span.end = end > span.start && data[end - 1] == '\r' ? end - 1 : end;
+
+		while (Kind == Jsonl && span.end > span.start &&
+			   json_space(data[span.end - 1]))
+
+			span.end--;
+
+		if (span.end > span.start)
+
+			Spans.push_back(span);
+
+	}
+
+}
+
+/*
+ * Fields to read: the values of a record come in this order. Each
+ * has to be a column of a CSV file; JSONL records are checked one
+ * by one (see read).
+ * @args:	field names (const vector<string> &names)
+ * @return:	0 (success)
+ *  -error:	-1 (no such column, see error())
+ */
+int
+MergeData::bind(const vector<string> &names)
+{
+
+	Names = names;
+	Bound.assign(Columns.size(), -1);
+
+	for (size_t i = 0; i < Names.size() && Kind == Csv; i++) {
+
+		size_t		c = 0;
+
+		while (c < Columns.size() && Columns[c] != Names[i])
+
+			c++;
+
+		if (c == Columns.size()) {
+
+			Error = "no column \"" + Names[i] + "\"";
+			return -1;
+
+		}
+
+		if (Bound[c] < 0)
+
+			Bound[c] = i;
+
+	}
+
+	return 0;
+
+}
+
+/*
+ * Values of a record, for the names bound. The arena is grown to
+ * the record's length if it is shorter; then nothing is allocated
+ * (after the first records, w/ rec reused).
+ * @args:	record # (size_t n)
+ * 			values, arena, error (Record &rec)
+ * @return:	0 (success)
+ *  -error:	-1 (malformed, a name has no value, see rec.error)
+ */
+int
+MergeData::read(size_t n, Record &rec) const
+{
+
+	const Span		&span = Spans[n];
+
+	rec.values.assign(Names.size(), string_view());	// data(): NULL
+
+	if (rec.arena.size() < span.end - span.start)
+
+		rec.arena.resize(span.end - span.start);
+
+	if ((Kind == Csv ? read_csv(span, rec, false) :
+					   read_json(span, rec)) != 0)
+
+		return -1;
+
+	for (size_t i = 0; i < Names.size(); i++) {
+
+		if (rec.values[i].data() == NULL) {
+
+			rec.error = "no field \"" + Names[i] + "\"";
+			return -1;
+
+		}
+
+	}
+
+	return 0;
+
+}
+
+/*
+ * Split a CSV record into fields: a quoted field is copied into
+ * the arena w/o its quotes and w/ "" made ", others are left in
+ * place.
+ * @args:	record (const Span &span)
+ * 			values, arena, error (Record &rec)
+ * 			header record: append every field (bool header)
+ * @return:	0 (success)
+ *  -error:	-1 (malformed, or # of fields not that of the header)
+ */
+int
+MergeData::read_csv(const Span &span, Record &rec, bool header) const
+{
+
+	const char		*p = Data.data() + span.start,
+					*end = Data.data() + span.end,
+					*q;
+	char			*out = rec.arena.data(),	// Unquoted fields
+					*start;
+	size_t			column = 0;
+	string_view		value;
+
+	while (true) {
+
+		if (p < end && *p == '"') {
+
+			start = out;
+			p++;
+
+			while (true) {
+
+				if ((q = (const char *)memchr(p, '"', end - p)) == NULL) {
+
+					rec.error = "unterminated quoted field";
+					return -1;
+
+				}
+
+				memcpy(out, p, q - p);
+				out += q - p;
+				p = q + 1;
+
+				if (p == end || *p != '"')
+
+					break;
+
+				*out++ = '"';		// "" in a quoted field
+				p++;
+
+			}
+
+			if (p < end && *p != ',') {
+
+				rec.error = "text after quoted field";
+				return -1;
+
+			}
+
+			value = string_view(start, out - start);
+
+		}
+		else {
+
+			if ((q = (const char *)memchr(p, ',', end - p)) == NULL)
+
+				q = end;
+
+			value = string_view(p, q - p);
+			p = q;
+
+		}
+
+		if (header)
+
+			rec.values.push_back(value);
+
+		else if (column < Bound.size() && Bound[column] >= 0)
+
+			rec.values[Bound[column]] = value;
+
+		column++;
+
+		if (p >= end)
+
+			break;
+
+		p++;		// ','
+
+	}
+
+	if (!header && column != Columns.size()) {
+
+		rec.error = to_string(column) + " fields, header has " +
+					to_string(Columns.size());
+		return -1;
+
+	}
+
+	return 0;
+
+}
+
+/*
+ * Parse a JSON object of one level: string values are decoded
+ * into the arena, numbers, true and false are taken as written,
+ * null as "". Names not bound are skipped; of a repeated name the
+ * last value counts.
+ * @args:	record (const Span &span)
+ * 			values, arena, error (Record &rec)
+ * @return:	0 (success)
+ *  -error:	-1 (malformed, or a nested object/array)
+ */
+int
+MergeData::read_json(const Span &span, Record &rec) const
+{
+
+	const char		*p = Data.data() + span.start,
+					*end = Data.data() + span.end,
+					*v;
+	char			*out = rec.arena.data(),	// Decoded strings
+					*start;
+	string_view		name,
+					value;
+
+	while (p < end && json_space(*p))
+
+		p++;
+
+	if (p == end || *p++ != '{') {
+
+		rec.error = "not a JSON object";
+		return -1;
+
+	}
+
+	while (p < end && json_space(*p))
+
+		p++;
+
+	if (p < end && *p == '}' && ++p == end)
+
+		return 0;		// {}
+
+	while (p < end) {
+
+		while (p < end && json_space(*p))
+
+			p++;
+
+		start = out;
+
+		if (p == end || *p++ != '"' || json_string(p, end, out) != 0) {
+
+			rec.error = "bad name";
+			return -1;
+
+		}
+
+		name = string_view(start, out - start);
+
+		while (p < end && json_space(*p))
+
+			p++;
+
+		if (p == end || *p++ != ':') {
+
+			rec.error = "no ':' after \"" + string(name) + "\"";
+			return -1;
+
+		}
+
+		while (p < end && json_space(*p))
+
+			p++;
+
+		if (p < end && *p == '"') {
+
+			start = out;
+			p++;
+
+			if (json_string(p, end, out) != 0) {
+
+				rec.error = "bad string value of \"" + string(name) + "\"";
+				return -1;
+
+			}
+
+			value = string_view(start, out - start);
+
+		}
+		else {
+
+			for (v = p; p < end && *p != ',' && *p != '}' &&
+				 !json_space(*p); p++)
+
+				;
+
+			value = string_view(v, p - v);
+
+			if (value.empty() || *v == '{' || *v == '[') {
+
+				rec.error = "value of \"" + string(name) +
+							"\" is not a string, number or literal";
+				return -1;
+
+			}
+
+			if (value == "null")
+
+				value = string_view(v, 0);
+
+		}
+
+		for (size_t i = 0; i < Names.size(); i++) {
+
+			if (Names[i] == name) {
+
+				rec.values[i] = value;
+				break;
+
+			}
+
+		}
+
+		while (p < end && json_space(*p))
+
+			p++;
+
+		if (p < end && *p == ',') {
+
+			p++;
+			continue;
+
+		}
+
+		if (p < end && *p == '}' && ++p == end)
+
+			break;
+
+		rec.error = "expected ',' or '}' after \"" + string(name) + "\"";
+		return -1;
+
+	}
+
+	return 0;
+
+}
+
+/*
+ * Decode a JSON string (RFC 8259, 7), escapes included; "\u"
+ * escapes (surrogate pairs too) are written as UTF-8.
+ * @args:	text, past the opening quote; left past the closing
+ * 			one (const char *&p, const char *end)
+ * 			where to decode to, left past the text (char *&out)
+ * @return:	0 (success)
+ *  -error:	-1 (unterminated string, bad escape)
+ */
+int
+MergeData::json_string(const char *&p, const char *end, char *&out)
+{
+
+	unsigned int	code,
+					low;
+
+	while (p < end) {
+
+		char		c = *p++;
+
+		if (c == '"')
+
+			return 0;
+
+		if (c != '\\') {
+
+			*out++ = c;
+			continue;
+
+		}
+
+		if (p == end)
+
+			return -1;
+
+		switch (c = *p++) {
+
+		case '"': case '\\': case '/':
+			*out++ = c;
+			continue;
+
+		case 'b': *out++ = '\b'; continue;
+		case 'f': *out++ = '\f'; continue;
+		case 'n': *out++ = '\n'; continue;
+		case 'r': *out++ = '\r'; continue;
+		case 't': *out++ = '\t'; continue;
+
+		case 'u':
+			break;
+
+		default:
+			return -1;
+
+		}
+
+		if (end - p < 4 || !hex4(p, code))
+
+			return -1;
+
+		p += 4;
+
+		// High surrogate: the low one follows, "\uDC00".."\uDFFF".
+		if (code >= 0xd800 && code < 0xdc00 && end - p >= 6 &&
+			p[0] == '\\' && p[1] == 'u' && hex4(p + 2, low) &&
+			low >= 0xdc00 && low < 0xe000) {
+
+			code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+			p += 6;
+
+		}
+
+		if (code < 0x80)
+
+			*out++ = code;
+
+		else if (code < 0x800) {
+
+			*out++ = 0xc0 | code >> 6;
+			*out++ = 0x80 | (code & 0x3f);
+
+		}
+		else if (code < 0x10000) {
+
+			*out++ = 0xe0 | code >> 12;
+			*out++ = 0x80 | ((code >> 6) & 0x3f);
+			*out++ = 0x80 | (code & 0x3f);
+
+		}
+		else {
+
+			*out++ = 0xf0 | code >> 18;
+			*out++ = 0x80 | ((code >> 12) & 0x3f);
+			*out++ = 0x80 | ((code >> 6) & 0x3f);
+			*out++ = 0x80 | (code & 0x3f);
+
+		}
+
+	}
+
+	return -1;
+
+}
@@ -0,0 +1,217 @@
+/*
+ * Mail-Sending Program
+ * MailMerge.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+#ifndef MAILMERGE_HH_
+#define MAILMERGE_HH_
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+using namespace std;
+
+/*
+ * MergeTemplate object
+ * A message w/ placeholders, "{{name}}", compiled once into a list
+ * of segments, each either literal text (all of it kept in one
+ * string) or the value of a field, by field number. render() then
+ * builds the message of each recipient by appending the segments
+ * in order into a buffer the caller reuses: one pass, and no
+ * allocation once the buffer has grown to size.
+ * Values placed in the header are made header-safe: CR and LF
+ * become spaces, so data cannot add header fields. Bcc: fields are
+ * compiled apart and rendered into the recipient list only, as
+ * ReadDataHeader leaves them out of a message file.
+ * @methods:	load, compile, fields, render, error
+ */
+class MergeTemplate
+{
+  public:
+
+			 MergeTemplate() { }
+
+	 // Read a template file and compile it.
+
+	int				load(const string &filename);
+
+	 // Compile template text; on a syntax error see error().
+
+	int				compile(string_view text);
+
+	 // Placeholder names, each once, in order of first use.
+
+	const vector<string>	&fields() const { return Names; }
+
+	 // Render the message of one recipient, w/o its Bcc: fields,
+
+	 // and the Bcc: addresses (comma separated); values[i] is the
+
+	 // value of fields()[i]. Both buffers are overwritten.
+
+	void			render(const string_view *values,
+						   vector<char> &message,
+						   vector<char> &bcc) const;
+
+	 // What load() or compile() found wrong.
+
+	const string	&error() const { return Error; }
+
+  private:
+
+	struct Segment {
+		uint32_t		offset,		// Literal: Text[offset, +length)
+						length;
+		int				field;		// Or value of field, -1: literal
+		bool			header;		// In the header: no CR/LF
+	};
+
+	string			Text;			// Literal text of all segments
+	vector<Segment>	Body,			// Message segments
+					Hidden;			// Bcc: value segments
+	vector<string>	Names;			// Field names
+	string			Error;
+
+	 // Compile text into segments of list.
+
+	int				add(vector<Segment> &list,
+						string_view text,
+						bool header);
+
+	 // Append the segments of list to out.
+
+	static void		append(vector<char> &out,
+						   const vector<Segment> &list,
+						   const string &text,
+						   const string_view *values);
+
+};
+
+/*
+ * MergeData object
+ * Recipient data for a MergeTemplate: a CSV file (RFC 4180, the
+ * first record naming the columns) or a JSONL file (one flat JSON
+ * object per line; string, number, true/false and null values).
+ * The file is read into memory and its records are indexed in one
+ * pass (memchr() for line ends, quotes counted between them), so
+ * records can be read in any order, by any number of threads, each
+ * w/ its own Record.
+ * Values are string_views into the file, or, when they have to be
+ * unescaped (quoted CSV field, JSON string w/ escapes), into the
+ * Record's arena, sized once per record to the record's length
+ * (unescaping never makes text longer) and reused from record to
+ * record.
+ * @methods:	open, bind, records, line, read, error
+ */
+class MergeData
+{
+  public:
+
+	enum Format { Csv, Jsonl };
+
+	 // Values of one record, for the names bound.
+
+	struct Record {
+		vector<string_view>	values;		// In order of bind() names
+		vector<char>		arena;		// Unescaped values
+		string				error;		// What read() found wrong
+	};
+
+			 MergeData(): Kind(Csv) { }
+
+	 // Read and index a data file, format from its name (".jsonl"
+
+	 // or ".json": JSONL, otherwise CSV).
+
+	int				open(const string &filename);
+
+	int				open(const string &filename, Format format);
+
+	 // Fields to read (the placeholders); CSV columns are checked.
+
+	int				bind(const vector<string> &names);
+
+	 // # of records, line of the file record n starts on.
+
+	size_t			records() const { return Spans.size(); }
+
+	size_t			line(size_t n) const { return Spans[n].line; }
+
+	 // Values of record n; -1 if malformed or missing a field.
+
+	int				read(size_t n, Record &rec) const;
+
+	 // What open() or bind() found wrong.
+
+	const string	&error() const { return Error; }
+
+  private:
+
+	struct Span {
+		size_t			start,		// Record: Data[start, end)
+						end,
+						line;		// Line of the file it starts on
+	};
+
+	Format			Kind;
+	string			Data;			// The file
+	vector<Span>	Spans;			// Its records
+	vector<string>	Columns;		// CSV: header record
+	vector<int>		Bound;			// CSV: name # of each column, -1
+	vector<string>	Names;			// Names bound
+	string			Error;
+
+	 // Index the records of Data.
+
+	void			index();
+
+	 // Fields of a CSV record, each to slot Bound[column].
+
+	int				read_csv(const Span &span, Record &rec,
+							 bool header) const;
+
+	 // Members of a JSON object, each to the slot of its name.
+
+	int				read_json(const Span &span, Record &rec) const;
+
+	 // JSON string at p (past '"'), decoded into out.
+
+	static int		json_string(const char *&p, const char *end,
+								char *&out);
+
+};
+
+#endif /* MAILMERGE_HH_ */
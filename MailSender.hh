@@ -37,40 +37,63 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
 
 using namespace std;
 
 /*
  * MailSender object, abstract base class
  * @data:		name of email file to send (string Filename) [Private]
- * @methods:	get Filename (string get_filename()) [Protected]
+ * @methods:	set Filename (void set_filename(...)) [Public]
+ * 				get Filename (const string &get_filename()) [Protected]
  *
  * This is an abstract base class with a single data member,
  * Filename and it's protected 'get' file.
  * The pure virtual function 'Send' is to be overloaded and
  * implemented in the derived class to send the contents within
- * "filename" via SMTP.
+ * "filename" via SMTP, to any number of recipients at once.
  */
 class MailSender
 {
   public:
 
 			 MailSender(const string &filename) { Filename = filename; }
-			~MailSender() { };
+	virtual	~MailSender() { };
 
 	 // Pure virtual method to send an email (formatted to
 
 	 // RFC 821 specifications) to a relay host (param 1) by
 
-	 // way of SMTP interface.
+	 // way of SMTP interface, once for a list of recipients.
+
+	 // Status of each recipient is returned in param 4.
 
 	virtual int		send(const string &host_to,
 						 const string &envelope_from,
-						 const string &envelope_to) = 0;
+						 const vector<string> &envelope_to,
+						 vector<int> &rcpt_status) = 0;
+
+	 // Send an email to a single recipient.
+
+	int				send(const string &host_to,
+						 const string &envelope_from,
+						 const string &envelope_to)
+	{
+		vector<string>	to(1, envelope_to);
+		vector<int>		status;
+
+		return send(host_to, envelope_from, to, status);
+	}
+
+	 // Point the sender at the next email file, so one object
+
+	 // (and its open session) can deliver a batch of files.
+
+	void			set_filename(const string &filename) { Filename = filename; }
 
   protected:
 
-	string			get_filename() { return Filename; }
+	const string	&get_filename() const { return Filename; }
 
   private:
 
@@ -33,339 +33,1762 @@
 	*/
 
 #include "MailSenderSmtp.hh"
+#include "WireFile.hh"
+#include "Resolver.hh"
+#include "Connector.hh"
+#include "Logger.hh"
 #include <iostream>
 #include <string>
+#include <algorithm>
 #include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cctype>
 #include <fstream>
 #include <cerrno>
+#include <strings.h>
+#include <fcntl.h>
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <sys/socket.h>
+#include <sys/sendfile.h>
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
 
 using namespace std;
 
-const int MAX_BUF = 1024;	// Size of receive buffer (1 kb)
+// Does a header line start field name (e.g. "Bcc:")?
+
+static bool
+IsField(const char *line, const char *eol, const char *name)
+{
+
+	size_t			len = strlen(name);
+
+	return (size_t)(eol - line) >= len && strncasecmp(line, name, len) == 0;
+
+}
+
+// ESMTP service extensions recognized in the EHLO reply.
+
+const MailSenderSmtp::Extension MailSenderSmtp::Extensions[] = {
+	{ "PIPELINING",				SmtpSession::ExtPipelining },
+	{ "8BITMIME",				SmtpSession::Ext8BitMime },
+	{ "ENHANCEDSTATUSCODES",	SmtpSession::ExtEnhancedStatus },
+	{ "CHUNKING",				SmtpSession::ExtChunking },
+	{ "STARTTLS",				SmtpSession::ExtStartTls },
+	{ "BINARYMIME",				SmtpSession::ExtBinaryMime },
+	{ "AUTH",					SmtpSession::ExtAuth },
+	{ NULL,						0 }
+};
 
 /*
  * MailSender public send method
  * Emails contents of instantiated filename email file to specified
- * relay host (host_to parameter).
+ * relay host (host_to parameter), for every recipient in the list.
  * TCP/IPv4 socket is created and used to interface w/ relay host
  * using SMTP client-server protocol.
+ * An idle session to the relay is taken from the pool if there is
+ * one, so the message only costs a RSET instead of a connect,
+ * greeting and EHLO; otherwise a new session is opened. Afterwards
+ * the session goes back to the pool, unless it broke (errno set)
+ * or has run MaxPerConn transactions.
+ * All recipients go in one transaction, so the body is sent once.
+ * Recipients the server defers w/ "452" (too many recipients) are
+ * sent in a further transaction, as long as each one makes progress.
+ * The per-message buffers (recipient lists, reply codes) are
+ * members reused from message to message, and what a transaction
+ * formats goes in its session's arena, reset after it: once warmed
+ * up, sending a message takes nothing from the heap.
  * Uses socket function "write(...)" instead of "send(...)" because
  * of name clash w/ this function.
- * 	- open_clientfd: creates socket/file descriptor/connects to host
+ * 	- open_session: creates socket/connects to host, greeting/EHLO
  * 	- smtp_client: interface w/ host using SMTP commands
  * @args:	relay host domain (const string &host_to)
  * 			email sender (const string &envelope_from)
- * 			email recipient (const string &envelope_to)
- * @return:	0 (success)
+ * 			email recipients (const vector<string> &envelope_to)
+ * 			reply code per recipient (vector<int> &rcpt_status):
+ * 				final reply to the message data (250: delivered)
+ * 				if RCPT was accepted, otherwise the RCPT reply
+ * 				(e.g. 550), -1 if no reply was received
+ * @return:	0 (success, delivered to every recipient)
  *  -error: -1 (errno specified on connection errors in clientfd(...))
- *  		-1 (SMTP error, server response code)
+ *  		-1 (SMTP error, server response codes in rcpt_status)
  */
 int
 MailSenderSmtp::send(const string &host_to,
 					 const string &envelope_from,
-					 const string &envelope_to)
+					 const vector<string> &envelope_to,
+					 vector<int> &rcpt_status)
 {
 
-	int				clientfd;		// Socket file descriptor
+	SmtpSession		*session;		// Session to the relay
+	const vector<string>	*to = &envelope_to;	// This transaction's
+	int				result = 0,
+					delivered,		// Recipients done this round
+					rounds = 0;		// Transactions
 
-	// Set client file descrip, make connection to host
-	if ((clientfd = open_clientfd(host_to)) == -1) {
+	rcpt_status.assign(envelope_to.size(), -1);
+	Throttled = 0;
 
-		// Error creating socket/making connection
-		// Check "errno"
-		return -1;
+	if (Metrics == NULL || MetricsHost != host_to || MetricsPort != Port) {
+
+		string	relay = host_to;	// Metrics key: host[:port]
+
+		if (Port != DefaultPort)
+
+			relay += ":" + to_string(Port);
+
+		Metrics = SmtpMetrics::shared().relay(relay);
+		MetricsHost = host_to;
+		MetricsPort = Port;
 
 	}
 
-	// Interface with SMTP server.
-	if (smtp_client(clientfd, envelope_from, envelope_to) != 0) {
+	Index.clear();
 
-		// Error interfacting w/server.
-		// Check recv'd SMTP message.
-		return -1;
+	for (unsigned int i = 0; i < envelope_to.size(); i++)
+
+		Index.push_back(i);
+
+	while (!Index.empty()) {
+
+		// Reuse an idle session, or make connection to host
+		if ((session = Pool->acquire(host_to, Port)) == NULL &&
+			(session = open_session(host_to, envelope_from)) == NULL) {
+
+			// Error creating socket/making connection
+			// Check "errno"
+			Logger::shared().print(LogWarn, "%s: no session: %s",
+								   Metrics->host.c_str(), errno != 0 ?
+								   strerror(errno) : "SMTP error");
+			Metrics->failed++;
+			return -1;
+
+		}
+
+		session->metrics = Metrics;
+
+		if (rounds++ > 0) {
+
+			Metrics->retries++;		// Deferred recipients again
+			Rcpts.resize(Index.size());
+
+			for (unsigned int i = 0; i < Index.size(); i++)
+
+				Rcpts[i] = envelope_to[Index[i]];	// Capacity kept
+
+			to = &Rcpts;
+
+		}
+
+		errno = 0;
+
+		// Interface with SMTP server.
+		// Error interfacing w/server: errno set on connection error,
+		// otherwise check recv'd SMTP message.
+		result = smtp_client(session, envelope_from, *to, Status);
+
+		session->sent++;	// One more transaction on this session
+		session->arena.reset();	// Its commands are no longer needed
+
+		if (session->throttled != 0) {
+
+			Throttled = session->throttled;
+			session->throttled = 0;
+
+		}
+
+		if (result != 0 && errno != 0)
+
+			Pool->discard(session, false);	// Broken connection
+
+		else if (session->sent >= MaxPerConn)
+
+			Pool->discard(session);			// Worn out, QUIT
+
+		else
+
+			Pool->release(session);			// Keep for reuse
+
+		// Record replies, keep "too many recipients" for next round.
+		Deferred.clear();
+		delivered = 0;
+
+		for (unsigned int i = 0; i < Index.size(); i++) {
+
+			rcpt_status[Index[i]] = Status[i];
+
+			if (Status[i] == 452)
+
+				Deferred.push_back(Index[i]);
+
+			else if (Status[i] / 100 == 2)
+
+				delivered++;		// 250, or 251: will forward
+
+		}
+
+		if (delivered == 0)
+
+			break;			// No progress, give up on the rest
+
+		Index.swap(Deferred);
 
 	}
 
-	close(clientfd);	// Close socket.
+	for (unsigned int i = 0; i < rcpt_status.size(); i++) {
 
-	return 0;
+		if (rcpt_status[i] / 100 != 2) {
+
+			Metrics->failed++;
+			return -1;		// Not delivered to everyone
+
+		}
+
+	}
+
+	if (result == 0)
+
+		Metrics->sent++;
+
+	else
+
+		Metrics->failed++;
+
+	return result;
 
 }
 
 /*
- * Create TCP/IPv4 Socket to specified host domain, SMTP port (25)
- * @args:	 SMTP server hostname
- * @return:	 file descriptor <int> (on success)
- * - error:  -1, errno flag
+ * Open a new session w/ the relay host: connect, accept the
+ * server greeting and introduce the client w/ EHLO (or HELO); then,
+ * if so set, start TLS (and EHLO again) and log in w/ AUTH.
+ * @args:	relay host domain (const string &host)
+ * 			email sender (const string &envelope_from), HELO domain
+ * @return:	new session (SmtpSession *), not yet in the pool
+ *  -error: NULL (connection error, errno)
+ *  		NULL (SMTP error, server response code)
  */
-int
-MailSenderSmtp::open_clientfd(const string &host)
+SmtpSession *
+MailSenderSmtp::open_session(const string &host,
+							 const string &envelope_from)
 {
 
-	int				clientfd;	// File descriptor.
-	hostent			*hp;
-	sockaddr_in		serveraddr;
+	SmtpSession		*session;
+	SmtpReply		reply;				// Server reply
+	int				clientfd;			// Socket file descriptor
+	uint64_t		start;				// Phase timer
+
+	if ((clientfd = open_clientfd(host)) == -1) {
+
+		return NULL;	// Check errno
+
+	}
+
+	start = SmtpMetrics::now();
+	Metrics->connections++;
 
-	// Create socket file descriptor: TCP/IPv4
-	if ((clientfd = socket(AF_INET, SOCK_STREAM, 0)) <= 0) {
+	session = new SmtpSession;
+	session->fd = clientfd;
+	session->tls = NULL;
+	session->host = host;
+	session->port = Port;
+	session->sent = 0;
+	session->ext = 0;
+	session->last_used = SmtpPool::now();
+	session->metrics = Metrics;
+	session->throttled = 0;
+
+	// Server confirm connection
+	// Check for error in greeting.
+	if (read_reply(session, reply) != 220) {
 
-		return -1;	// check errno for cause of error
+		Throttled = session->throttled;
+		Pool->discard(session, false);
+		return NULL; 		// Error establishing connection
 
 	}
 
-	if ((hp = gethostbyname(host.c_str())) == NULL) {
+	Metrics->time(RelayMetrics::Greeting, start);
+	start = SmtpMetrics::now();
+
+	// EHLO command, HELO if the server does not speak ESMTP
+	if (ehlo(session,
+			 string_view(envelope_from).substr(	// Domain of sender
+					 envelope_from.find('@', 0) + 1)) != 0) {
 
-		return -1;	// check errno for cause of error
+		Throttled = session->throttled;
+		Pool->discard(session, errno == 0);
+		return NULL;	// Error
 
 	}
 
-	// Init sockaddr_in to '0'
-	bzero((char *) &serveraddr, sizeof(serveraddr));
-	serveraddr.sin_family = AF_INET;	// IPv4
-	bcopy((char *)hp->h_addr,
-		  (char *)&serveraddr.sin_addr.s_addr,
-		  hp->h_length);
-	serveraddr.sin_port = htons(Smtp);	// Convert to network-byte order
+	Metrics->time(RelayMetrics::Ehlo, start);
 
-	if(connect(clientfd,
-			   (sockaddr *)&serveraddr,
-			   sizeof(serveraddr)) < 0) {
+	if (starttls(session,
+				 string_view(envelope_from).substr(
+						 envelope_from.find('@', 0) + 1)) != 0 ||
+		authenticate(session) != 0) {
 
-		return -1; // Error, check errno for connection error
+		Throttled = session->throttled;
+		Pool->discard(session, errno == 0);
+		return NULL;	// Error
 
 	}
 
-	return clientfd;	// Valid file descriptor
+	Logger::shared().print(LogInfo, "%s: session open, extensions 0x%x%s",
+						   host.c_str(), session->ext,
+						   session->tls != NULL ? ", TLS" : "");
+
+	return session;
 
 }
 
 /*
- * Interface w/ SMTP server to send contents of email file
- * using read/write(...) methods via sockets. No longer uses
- * "send/recv(...)" because of name clashing of MailSender.send(...)
- * with the socket function "send(...)".
- * @args:	file descriptor, sender e-mail address, recipient
- * 			e-mail address.
- * @return:	0 (on success)
- * - error: -1 (SMTP server response error)
- *
- * SMTP Server/Client Dialogue:
- * 	Server: Acknowledge client connection
- * 	"HELO <client-domain>"	(Server OK: "250...")
- * 	"MAIL FROM: <sender>"	(Server OK: "250...")
- * 	"RCPT TO: <recipient>"	(Server OK: "250...")
- * 	"DATA"					(Server OK: "354...")
- * 	Input file stream: open filename
- * 	WHILE getchar != EOF
- * 		THEN add file character to buffer
- * 	SEND buffer
- * 	"QUIT"
- * 	close file stream
+ * Introduce the client w/ EHLO and record the service extensions
+ * the server advertises, one per line of its "250" reply:
+ * 	250-relay.example.com
+ * 	250-PIPELINING
+ * 	250 8BITMIME
+ * A server that rejects EHLO (no ESMTP) is greeted w/ HELO instead,
+ * and no extensions are used.
+ * @args:	new session (SmtpSession *session)
+ * 			client domain (string_view domain)
+ * @return:	0 (success)
+ * - error: -1 (failure, errno set on connection error)
  */
 int
-MailSenderSmtp::smtp_client(int clientfd,
-							const string &envelope_from,
-							const string &envelope_to)
+MailSenderSmtp::ehlo(SmtpSession *session, string_view domain)
 {
 
-	string			to_send;			// Send buffer
-	char			buffer[MAX_BUF];	// Recv buffer, 1024 bytes
-	int				sent_bytes,			// # bytes received
-					recv_bytes;			// and sent.
+	SmtpReply		reply;		// Multi-line EHLO reply
+	int				code;
 
-	ifstream fin(get_filename().c_str());	// Open email file
+	if (write_cmd(session,
+				  session->arena.join({ "EHLO ", domain, "\r\n" })) != 0)
 
-	// Server confirm connection
-	recv_bytes = read(clientfd, buffer, MAX_BUF - 1);
-	buffer[recv_bytes] = '\0';
-	cout << buffer << endl;
+		return -1;
 
-	// Check for error in greeting.
-	if (strncmp(buffer, "220", 3)) {
+	if ((code = read_reply(session, reply)) < 0)
+
+		return -1;		// Lost connection
+
+	if (code != 250)
+
+		// Not ESMTP: fall back to HELO.
+		return send_recv_cmd(session, "HELO ", domain);
+
+	session->ext = parse_extensions(reply);
 
-		return -1; 		// Error establishing connection
+	return 0;
+
+}
+
+/*
+ * Upgrade a new session to TLS w/ STARTTLS (RFC 3207), as the TLS
+ * policy wants: not at all (TlsOff), if the relay offers it
+ * (TlsIfOffered; a relay refusing it w/ 454 is used in plaintext)
+ * or always (TlsRequired). The handshake resumes the relay's cached
+ * session if it can (see TlsClient), and is counted in the relay's
+ * metrics either way. What the relay said in plaintext no longer
+ * counts: its extensions are asked for again w/ EHLO, and bytes
+ * after its "220" are an attack on the session (EPROTO).
+ * @args:	new session, after EHLO (SmtpSession *session)
+ * 			client domain (string_view domain)
+ * @return:	0 (success, TLS on or not wanted)
+ * - error: -1 (TLS required but not offered or refused; handshake
+ * 			failed or certificate not valid, EPROTO; connection
+ * 			error, errno set)
+ */
+int
+MailSenderSmtp::starttls(SmtpSession *session, string_view domain)
+{
+
+	SmtpReply		reply;		// Reply to STARTTLS
+	int				code;
+	bool			resumed;	// Cached TLS session taken
+	uint64_t		start = SmtpMetrics::now();	// Phase timer
+
+	if (Tls == TlsOff ||
+		(Tls == TlsIfOffered && !(session->ext & SmtpSession::ExtStartTls)))
+
+		return 0;
+
+	errno = 0;
+
+	if (!(session->ext & SmtpSession::ExtStartTls)) {
+
+		Logger::shared().print(LogWarn, "%s: STARTTLS not offered",
+							   session->host.c_str());
+		return -1;
 
 	}
 
-	// HELO command
-	if (send_recv_cmd(clientfd,
-					  "HELO ",
-					  envelope_from.substr(		// Domain of sender
-							  envelope_from.find('@', 0) + 1)) != 0) {
+	if (write_cmd(session, "STARTTLS\r\n") != 0 ||
+		(code = read_reply(session, reply)) < 0)
 
-		return -1;	// Error
+		return -1;		// Lost connection
+
+	if (code != 220) {
+
+		Logger::shared().print(LogWarn, "%s: STARTTLS refused: %.*s",
+							   session->host.c_str(),
+							   (int)reply.length, reply.text);
+		errno = 0;
+		return Tls == TlsRequired ? -1 : 0;
 
 	}
 
-	// MAIL FROM command
-	if (send_recv_cmd(clientfd,
-					  "MAIL FROM:",
-					  envelope_from) != 0) {
+	if (!session->reader.empty()) {
 
-		return -1;	// Error
+		errno = EPROTO;		// Plaintext injected before the handshake
+		return -1;
 
 	}
 
-	// RCPT TO command
-	if (send_recv_cmd(clientfd,
-					  "RCPT TO:",
-					  envelope_to) != 0) {
+	if ((session->tls = TlsClient::shared().start(session->fd,
+												  session->host,
+												  session->port,
+												  resumed)) == NULL)
 
-		return -1;	// Error
+		return -1;		// Check errno
+
+	Metrics->tls_handshakes++;
+
+	if (resumed)
+
+		Metrics->tls_resumed++;
+
+	Metrics->time(RelayMetrics::Tls, start);
+	session->ext = 0;
+
+	return ehlo(session, domain);
+
+}
+
+/*
+ * Log in w/ AUTH (RFC 4954), if a mechanism is set:
+ * 	PLAIN (RFC 4616)	"AUTH PLAIN <base64 of NUL user NUL password>"
+ * 						(Server OK: "235")
+ * 	LOGIN				"AUTH LOGIN"	(Server: "334")
+ * 						<base64 of user>	(Server: "334")
+ * 						<base64 of password>	(Server OK: "235")
+ * Credentials are only sent over TLS, and are not logged (the
+ * transcript shows "*" for them).
+ * @args:	new session, TLS started (SmtpSession *session)
+ * @return:	0 (success, or no AUTH set)
+ * - error: -1 (no TLS, AUTH not offered or credentials rejected;
+ * 			connection error, errno set)
+ */
+int
+MailSenderSmtp::authenticate(SmtpSession *session)
+{
+
+	SmtpReply		reply;		// Server reply
+	string_view		steps[3];	// Lines to send
+	const char		*shown[3];	// And as they are logged
+	int				expect[3],	// And their replies
+					nsteps = 0,
+					code;
+	string			plain;		// PLAIN message
+	uint64_t		start = SmtpMetrics::now();	// Phase timer
+
+	if (AuthMechanism.empty())
+
+		return 0;
+
+	errno = 0;
+
+	if (session->tls == NULL || !(session->ext & SmtpSession::ExtAuth)) {
+
+		Logger::shared().print(LogWarn, "%s: %s, credentials not sent",
+							   session->host.c_str(), session->tls == NULL ?
+							   "no TLS" : "AUTH not offered");
+		return -1;
 
 	}
 
-	// DATA command
-	if (send_recv_cmd(clientfd,
-					  "DATA",
-					  "",
-					  "354") != 0) {
+	if (strcasecmp(AuthMechanism.c_str(), "login") == 0) {
 
-		return -1;	// Error
+		steps[nsteps] = shown[nsteps] = "AUTH LOGIN\r\n";
+		expect[nsteps++] = 334;
+		steps[nsteps] = session->arena.join({ Base64Line(AuthUser), "\r\n" });
+		shown[nsteps] = "*\r\n";
+		expect[nsteps++] = 334;
+		steps[nsteps] = session->arena.join({ Base64Line(AuthPassword),
+											  "\r\n" });
+		shown[nsteps] = "*\r\n";
+		expect[nsteps++] = 235;
+
+	}
+	else {
+
+		plain.append(1, '\0').append(AuthUser);
+		plain.append(1, '\0').append(AuthPassword);
+		steps[nsteps] = session->arena.join({ "AUTH PLAIN ", Base64Line(plain),
+											  "\r\n" });
+		shown[nsteps] = "AUTH PLAIN *\r\n";
+		expect[nsteps++] = 235;
 
 	}
 
-	to_send.clear();	// Clear send buffer
+	for (int i = 0; i < nsteps; i++) {
+
+		Logger::shared().log(LogDebug, "C", shown[i], strlen(shown[i]));
+
+		if (write_data(session, steps[i].data(), steps[i].length()) != 0 ||
+			(code = read_reply(session, reply)) < 0)
+
+			return -1;		// Lost connection
+
+		if (code != expect[i]) {
 
-	// Read File data
-	while (fin.getline(buffer, MAX_BUF)) {
+			Logger::shared().print(LogWarn, "%s: AUTH failed: %.*s",
+								   session->host.c_str(),
+								   (int)reply.length, reply.text);
+			errno = 0;
+			return -1;
 
-		to_send.append(buffer);
-		to_send.append("\n");
+		}
 
 	}
 
-	fin.close();	// Close file stream.
+	Metrics->time(RelayMetrics::Auth, start);
 
-	cout << "<Start \"" << get_filename() << "\">\n\n" << to_send
-		 << "\n\n<End of \"" << get_filename() << "\">\n\n";
-	to_send.append("\r\n.\r\n");	// End of data: <CRLF>.<CRLF>
+	return 0;
 
-	sent_bytes = write(clientfd, to_send.c_str(), to_send.length());
+}
 
-	// Server confirm email contents, attempts to relay e-mail
-	recv_bytes = read(clientfd, buffer, MAX_BUF - 1);
-	buffer[recv_bytes] = '\0';
-	cout << "S: " << buffer;
+/*
+ * Find the service extensions we know in an EHLO reply: the first
+ * line is the server's greeting, each following line starts w/ an
+ * extension keyword, e.g. "250-PIPELINING".
+ * @args:	"250" reply to EHLO (const SmtpReply &reply)
+ * @return:	supported extensions (SmtpSession::Extension flags)
+ */
+unsigned int
+MailSenderSmtp::parse_extensions(const SmtpReply &reply)
+{
 
-	// Check if email is blocked by SpamAssassin
-	if (strncmp("550", buffer, 3) == 0) {
+	unsigned int	ext = 0;
+	size_t			len;		// Keyword length
 
-		sent_bytes = write(clientfd, "QUIT", 4);
-		return -1;
+	// First line is the server's greeting, extensions follow.
+	for (int i = 1; i < reply.lines && i < SmtpReply::MaxLines; i++) {
+
+		// Keyword ends at a space (parameters follow) or line end.
+		for (len = 0; len < reply.len[i] && reply.line[i][len] != ' '; len++)
+			;
+
+		for (int j = 0; Extensions[j].keyword != NULL; j++) {
+
+			if (strlen(Extensions[j].keyword) == len &&
+				strncasecmp(reply.line[i], Extensions[j].keyword, len) == 0)
+
+				ext |= Extensions[j].flag;
+
+		}
 
 	}
 
-	// Client: QUIT command
-	sent_bytes = write(clientfd, "QUIT", 4);
+	return ext;
 
-	// Server closes connection
+}
 
-	return 0;		// Return success.
+/*
+ * Create TCP Socket to specified host domain, relay port (Port).
+ * The host is resolved by the shared Resolver (thread-safe, answers
+ * cached, see Resolver.hh) to all its addresses, IPv6 and IPv4,
+ * and the shared Connector races connects to them (Happy Eyeballs,
+ * see Connector.hh): the address that won last time first, the
+ * next one 250 ms later if it has not connected yet, and so on,
+ * each w/ a hard deadline.
+ * @args:	 SMTP server hostname
+ * @return:	 file descriptor <int> (on success)
+ * - error:  -1, errno flag (EHOSTUNREACH: host not found, EAGAIN:
+ * 			 lookup failed for now, ETIMEDOUT: no address answered in
+ * 			 time)
+ */
+int
+MailSenderSmtp::open_clientfd(const string &host)
+{
+
+	int				clientfd,		// File descriptor.
+					one = 1;
+	vector<Resolver::Address>	addrs;
+	uint64_t		start = SmtpMetrics::now();	// Phase timer
+
+	if (Resolver::shared().resolve(host, Port, addrs) != 0)
+
+		return -1;		// check errno for cause of error
+
+	Metrics->time(RelayMetrics::Resolve, start);
+	start = SmtpMetrics::now();
+
+	if ((clientfd = Connector::shared().connect(host, Port, addrs)) < 0)
+
+		return -1;		// check errno for cause of error
+
+	// Commands and the end of data are small writes that wait for
+	// a reply: do not hold them back (Nagle).
+	setsockopt(clientfd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	Metrics->time(RelayMetrics::Connect, start);
+
+	return clientfd;	// Valid file descriptor
 
 }
 
 /*
- * SMTP client-server command handler
- * Construct command to send to server, compare server
- * response to one that is expected.
- * Allow for two attempts in the case of lost packets
- * in communication and/or unexpected server response.
- * Uses methods "read(...)" and "write(...)" via sockets.
- * @args:	socket file descrip (int sockfd)
- * 			command to issue (const string &cmd)
- * 			command parameter (const string &param)
- * 			expected server reply (const string &confirm)
- * 				(by default: "250")
- * @return:	0  (success)
- * - error: -1 (failure, lost packets/unexpected reply)
+ * Run one mail transaction on an open session (see open_session)
+ * to send contents of email file
+ * using read/write(...) methods via sockets. No longer uses
+ * "send/recv(...)" because of name clashing of MailSender.send(...)
+ * with the socket function "send(...)".
+ * The envelope is sent by send_envelope, in a single write if the
+ * server supports PIPELINING. The message data is sent once for all
+ * accepted recipients. "Bcc:" header fields are left out of the
+ * data, the Bcc recipients are in the envelope only.
+ * The file is opened once and its first DataChunk bytes read into
+ * the reused input buffer, which tells a wire file (see WireData)
+ * from a plain one. A plain file is streamed in chunks through the
+ * DATA encoder (CRLF line endings, dot-stuffing, see send_text).
+ * A wire file (see WireFile.hh) is already in DATA form, and is
+ * sent w/ sendfile() instead. Only a header or wire envelope
+ * longer than DataChunk is read w/ the (allocating) stream
+ * functions.
+ * A message in memory (see set_text) goes through the encoder in
+ * one piece.
+ * If the relay offers CHUNKING (and chunks are not turned off, see
+ * set_chunk_size), a plain message is sent w/ BDAT instead of DATA:
+ * the encoder only fixes line endings, and its output is sent in
+ * chunks of about ChunkSize bytes, each w/ its length (see
+ * send_chunk), so neither side looks for the end of data
+ * indicator. MAIL FROM declares BODY=BINARYMIME if the relay offers
+ * it w/ CHUNKING, BODY=8BITMIME if it offers 8BITMIME.
+ * Wire files are stored in DATA form (dot-stuffed), so they keep
+ * going out w/ DATA and sendfile().
+ * W/ attachments (see set_attachments) the message is sent as
+ * multipart/mixed: the text, then each file encoded in base64
+ * while it is read (see send_attachments). A wire file cannot have
+ * attachments (EINVAL).
+ * @args:	open session, sender e-mail address, recipient
+ * 			e-mail addresses, reply code per recipient.
+ * @return:	0 (on success)
+ * - error: -1 (SMTP server response error, errno set on connection
+ * 			error)
+ *
+ * SMTP Server/Client Dialogue:
+ * 	"MAIL FROM:<sender>"	(Server OK: "250...")
+ * 	"RCPT TO:<recipient>"	(Server OK: "250...", per recipient)
+ * 	"DATA"					(Server OK: "354...")
+ * 	Input file: open filename, read 1st chunk
+ * 	SEND header w/o Bcc: fields, encoded
+ * 	WHILE read chunk != EOF
+ * 		SEND chunk, encoded
+ * 	SEND attachments, base64 (if any)
+ * 	SEND ".<CRLF>"
+ * 	close file
+ * or, w/ CHUNKING, no DATA command and:
+ * 	WHILE encoded data >= ChunkSize
+ * 		"BDAT <size>", chunk	(Server OK: "250...")
+ * 	"BDAT <size> LAST", rest	(Server OK: "250...")
  */
 int
-MailSenderSmtp::send_recv_cmd(int sockfd,
-							  const string &cmd,
-							  const string &param,
-							  const string &confirm)
+MailSenderSmtp::smtp_client(SmtpSession *session,
+							const string &envelope_from,
+							const vector<string> &envelope_to,
+							vector<int> &rcpt_status)
 {
 
-	string			to_send;			// Send buffer
-	char			buf[MAX_BUF];		// Recv buffer
-	int				sent_bytes,			// Size of sent command
-					recv_bytes;			// Size of recv command
+	SmtpReply		reply;				// Server reply
+	int				code,
+					fd = -1;			// Email file descriptor
+	ssize_t			head = 0;			// Bytes of it in InBuf
+	off_t			offset = 0,			// Message data in wire file
+					length = 0;
+	size_t			header = 0,			// Header bytes of plain file
+					need;				// Output buffer size
+	ifstream		fin;				// Long header/envelope only
+	uint64_t		start,				// Transaction, phase timers
+					phase;
 
-	for(int i = 0; i < 2; i++) {	// Allow 2 attempts
+	rcpt_status.assign(envelope_to.size(), -1);
 
-		to_send = cmd;
+	if (InBuf.empty())
 
-		// Surround param w/ angle brackets on attempt 2
-		// Some servers have required angle bracets around
-		// email address parameters.
-		if (i == 1 &&
-			param.length() > 0)	{
+		InBuf.resize(DataChunk);
 
-			to_send.append("<");
+	// Open email file: wire-ready file or plain message
+	// (unless the message is in memory)
+	if (Text == NULL) {
 
-		}
+		if ((fd = open(get_filename().c_str(), O_RDONLY)) < 0 ||
+			(head = read_full(fd, &InBuf[0], DataChunk)) < 0) {
 
-		to_send.append(param);
+			if (fd >= 0)
 
-		if (i == 1 &&
-			param.length() > 0) {
+				close(fd);
 
-			to_send.append(">");
+			return -1;	// Check errno
 
 		}
 
-		to_send.append("\n");
-		cout << "C: " << to_send;
+		if ((offset = WireData(&InBuf[0], head)) != 0) {
 
-		// Send command
-		if ((sent_bytes = write(sockfd, to_send.c_str(),
-			 to_send.length())) < (int)to_send.length()) {
+			struct stat	st;
 
-			if (i > 0) {		// 2nd attempt
+			if (Attachments != NULL) {
 
-				return -1;		// Lost bytes or empty command
+				// Already in DATA form, no multipart of it.
+				close(fd);
+				errno = EINVAL;
+				return -1;
 
 			}
+			else if (offset < 0) {
 
-		}
+				// Envelope longer than a chunk: read it line by line.
+				string			wire_from;
+				vector<string>	wire_to;
+
+				close(fd);
 
-		// Receive server reply
-		if ((recv_bytes = read(sockfd, buf, MAX_BUF - 1)) < 1) {
+				if ((fd = WireOpen(get_filename(), wire_from, wire_to,
+								   offset, length)) < 0)
 
-			if (i > 0) {		// 2nd attempt
+					return -1;	// Check errno
 
-				return -1;		// Lost bytes from server
+			}
+			else if (fstat(fd, &st) != 0) {
+
+				close(fd);
+				return -1;	// Check errno
 
 			}
+			else
+
+				length = st.st_size - offset;
 
 		}
+		else if ((header = DataHeaderEnd(&InBuf[0], head)) == 0 &&
+				 head == DataChunk) {
+
+			// Header longer than a chunk: read it line by line.
+			close(fd);
+			fd = -1;
+			fin.open(get_filename().c_str(), ios::in | ios::binary);
 
-		buf[recv_bytes] = '\0';
-		cout << "S: " << buf << endl;
+			if (!fin.is_open()) {
 
-		// Server confirmation or repeated command
-		if (strncmp(buf, confirm.c_str(), 3) == 0 ||
-			strncmp(buf, "503", 3) == 0) {	// 503: Repeated cmd
+				return -1;	// Check errno
 
-			return 0;	// Confirmed, success
+			}
 
 		}
+		else if (header == 0)
+
+			header = head;		// No body
 
 	}
 
-	return -1;		// Fail
+	// BDAT if the relay takes it, the chunk builds up in OutBuf.
+	Chunked = ChunkSize > 0 && offset == 0 &&
+			  (session->ext & SmtpSession::ExtChunking);
+	need = SmtpDataEncoder::max_output(DataChunk) +
+		   SmtpDataEncoder::MaxFinish + (Chunked ? ChunkSize : 0);
+
+	if (OutBuf.size() < need)
+
+		OutBuf.resize(need);
+
+	Encoder.set_dot_stuffing(!Chunked);
+	Fill = 0;
+	Pending = Refused = 0;
+
+	// MAIL FROM, RCPT TO..., DATA
+	start = phase = SmtpMetrics::now();
+
+	if (send_envelope(session, envelope_from,
+					  envelope_to, rcpt_status) != 0) {
+
+		if (fd >= 0)
+
+			close(fd);
+
+		return -1;	// Error
+
+	}
+
+	Metrics->time(RelayMetrics::Envelope, phase);
+	phase = SmtpMetrics::now();
+
+	if (Text != NULL)
+
+		code = send_text(session, Text, TextLength);
+
+	else if (offset > 0)
+
+		// Data is wire-ready: straight from page cache to socket.
+		code = send_file(session, fd, offset, length);
+
+	else if (fd >= 0)
+
+		// Encode plain text into DATA form while streaming it.
+		code = send_text(session, fd, head, header);
+
+	else
+
+		code = send_text(session, fin);
+
+	if (fd >= 0)
+
+		close(fd);
+
+	if (code != 0 && Refused == 0) {
+
+		return -1;	// Session is unusable mid-DATA
+
+	}
+
+	Metrics->time(RelayMetrics::Body, phase);
+	phase = SmtpMetrics::now();
+
+	// Server confirm email contents, attempts to relay e-mail
+	// Rejected, e.g. email is blocked by SpamAssassin ("550").
+	// The session stays open, next transaction starts w/ RSET.
+	// A refused BDAT chunk already ended the transaction.
+	code = Refused != 0 ? Refused : read_reply(session, reply);
+
+	if (code > 0) {
+
+		Metrics->time(RelayMetrics::FinalReply, phase);
+		Metrics->time(RelayMetrics::Message, start);
+
+	}
+
+	for (unsigned int i = 0; i < rcpt_status.size(); i++) {
+
+		if (rcpt_status[i] == 250 || rcpt_status[i] == 251)
+
+			rcpt_status[i] = code;	// Accepted: message's fate
+
+	}
+
+	if (code != 250) {
+
+		return -1;
+
+	}
+
+	return 0;		// Return success.
 
 }
 
+/*
+ * Send the envelope of a transaction: RSET (on a reused session),
+ * MAIL FROM (w/ the BODY type the relay takes), one RCPT TO per
+ * recipient and DATA (unless the data goes w/ BDAT).
+ * If the server supports PIPELINING (RFC 2920) the commands are
+ * written as one batch and the batch of replies is matched in
+ * order: one round trip instead of one per command. Otherwise each
+ * command waits for its reply, and DATA is not sent unless a
+ * recipient was accepted.
+ * If DATA is accepted ("354") although MAIL failed or no recipient
+ * was accepted, an empty message is terminated right away so the
+ * server drops it.
+ * @args:	open session (SmtpSession *session)
+ * 			sender e-mail address, recipient e-mail addresses
+ * 			RCPT reply code per recipient (vector<int> &rcpt_status)
+ * @return:	0 (success, server waiting for message data or BDAT)
+ * - error: -1 (rejected, errno set on connection error)
+ */
+int
+MailSenderSmtp::send_envelope(SmtpSession *session,
+							  const string &envelope_from,
+							  const vector<string> &envelope_to,
+							  vector<int> &rcpt_status)
+{
+
+	Arena			&arena = session->arena;	// Until the reset
+	string_view		*cmds;		// Envelope commands, in order
+	char			*batch;		// Pipelined commands
+	SmtpReply		reply;		// Server reply
+	size_t			ncmds = 0,	// # of cmds
+					len = 0;
+	int				code,
+					first_rcpt,	// Index of 1st RCPT in cmds
+					end_rcpt,	// and past the last
+					accepted = 0;	// # recipients accepted
+	bool			pipelined = session->ext & SmtpSession::ExtPipelining,
+					mail_ok = false;
+	string_view		body;		// BODY= parameter of MAIL FROM
+
+	cmds = arena.alloc_array<string_view>(envelope_to.size() + 3);
+
+	if (session->sent > 0)
+
+		cmds[ncmds++] = "RSET\r\n";	// Reused session
+
+	if (Chunked && (session->ext & SmtpSession::ExtBinaryMime))
+
+		body = " BODY=BINARYMIME";
+
+	else if (session->ext & SmtpSession::Ext8BitMime)
+
+		body = " BODY=8BITMIME";
 
+	cmds[ncmds++] = arena.join({ "MAIL FROM:<", envelope_from, ">",
+								 body, "\r\n" });
+	first_rcpt = ncmds;
 
+	for (unsigned int i = 0; i < envelope_to.size(); i++)
 
+		cmds[ncmds++] = arena.join({ "RCPT TO:<", envelope_to[i], ">\r\n" });
 
+	end_rcpt = ncmds;
 
+	if (!Chunked)
 
+		cmds[ncmds++] = "DATA\r\n";
+
+	if (pipelined) {
+
+		for (size_t i = 0; i < ncmds; i++)
+
+			len += cmds[i].length();
+
+		batch = (char *)arena.alloc(len, 1);
+		len = 0;
+
+		for (size_t i = 0; i < ncmds; i++) {
+
+			memcpy(batch + len, cmds[i].data(), cmds[i].length());
+			len += cmds[i].length();
+
+		}
+
+		if (write_cmd(session, string_view(batch, len)) != 0)
+
+			return -1;
+
+	}
+
+	for (unsigned int i = 0; i < ncmds; i++) {
+
+		bool	is_rcpt = (int)i >= first_rcpt && (int)i < end_rcpt,
+				is_data = (int)i == end_rcpt;
+
+		if (!pipelined) {
+
+			// No point in going on w/o sender or recipients.
+			if ((is_rcpt && !mail_ok) || (is_data && accepted == 0))
+
+				return -1;
+
+			if (write_cmd(session, cmds[i]) != 0)
+
+				return -1;
+
+		}
+
+		if ((code = read_reply(session, reply)) < 0)
+
+			return -1;		// Lost connection
+
+		if (is_rcpt) {
+
+			rcpt_status[i - first_rcpt] = code;
+
+			// "251": user not local, will forward
+			if (mail_ok && (code == 250 || code == 251))
+
+				accepted++;
+
+		}
+		else if (is_data) {
+
+			if (code != 354)
+
+				return -1;		// Rejected
+
+		}
+		else if (i == (unsigned int)first_rcpt - 1)
+
+			mail_ok = code == 250;		// MAIL FROM
+
+	}
+
+	if (!mail_ok || accepted == 0) {
+
+		// Server wants data for a failed envelope: send none.
+		if (!Chunked && write_cmd(session, ".\r\n") == 0)
+
+			read_reply(session, reply);
+
+		return -1;
+
+	}
+
+	return 0;
+
+}
+
+/*
+ * Stream a plain message into DATA form: the header (w/o Bcc:
+ * fields, see send_header) and then the body in DataChunk-sized
+ * reads, each piece run through the encoder into the reusable
+ * output buffer and written out, the attachments, and finally the
+ * end of data indicator. Memory use does not depend on the size of
+ * the message.
+ * @args:	open session, server waiting for data (SmtpSession *)
+ * 			message stream, at its start (istream &fin)
+ * @return:	0 (success)
+ * - error: -1 (connection error, errno set)
+ */
+int
+MailSenderSmtp::send_text(SmtpSession *session, istream &fin)
+{
+
+	string			header;		// Header w/o Bcc: fields
+
+	Encoder.reset();
+	ReadDataHeader(fin, header);
+
+	if (send_header(session, header.data(), header.length()) != 0)
+
+		return -1;
+
+	while (fin.read(&InBuf[0], DataChunk) || fin.gcount() > 0) {
+
+		if (send_encoded(session, &InBuf[0], fin.gcount()) != 0)
+
+			return -1;
+
+	}
+
+	if (send_attachments(session) != 0)
+
+		return -1;
+
+	return end_data(session);		// End of data: .<CRLF>
+
+}
+
+/*
+ * Stream a plain message file into DATA form, from the chunk of it
+ * in the input buffer: the header (see send_header), the rest of
+ * the chunk, then each further chunk read, the attachments and the
+ * end of data indicator. Nothing is copied but by the encoder.
+ * @args:	open session, server waiting for data (SmtpSession *)
+ * 			message file (int fd), read up to head bytes, which are
+ * 			in InBuf (ssize_t head)
+ * 			length of the header, blank line included (size_t header)
+ * @return:	0 (success)
+ * - error: -1 (connection or file error, errno set)
+ */
+int
+MailSenderSmtp::send_text(SmtpSession *session,
+						  int fd,
+						  ssize_t head,
+						  size_t header)
+{
+
+	ssize_t			n;
+
+	Encoder.reset();
+
+	if (send_header(session, &InBuf[0], header) != 0 ||
+		send_encoded(session, &InBuf[header], head - header) != 0)
+
+		return -1;
+
+	while ((n = read_full(fd, &InBuf[0], DataChunk)) > 0) {
+
+		if (send_encoded(session, &InBuf[0], n) != 0)
+
+			return -1;
+
+	}
+
+	if (n < 0 || send_attachments(session) != 0)
+
+		return -1;		// Check errno
+
+	return end_data(session);		// End of data: .<CRLF>
+
+}
+
+/*
+ * Send a message header, each run of lines encoded in place, w/o
+ * its Bcc: fields. W/ attachments it is made the header of a
+ * multipart/mixed message (RFC 2046, 5.1.3), and the text the
+ * first part of it: the MIME-Version field is replaced, and the
+ * Content-* fields (type and encoding of the text) go to the
+ * header of that part:
+ * 	<header w/o Bcc:, MIME-Version:, Content-*:>
+ * 	MIME-Version: 1.0
+ * 	Content-Type: multipart/mixed; boundary="<boundary>"
+ *
+ * 	--<boundary>
+ * 	<Content-*: fields of the header>
+ *
+ * The text and each attachment follow (see send_attachments).
+ * @args:	open session, server waiting for data (SmtpSession *)
+ * 			header, blank line included (const char *text,
+ * 			size_t header)
+ * @return:	0 (success)
+ * - error: -1 (connection error, errno set)
+ */
+int
+MailSenderSmtp::send_header(SmtpSession *session,
+							const char *text,
+							size_t header)
+{
+
+	const char		*end = text + header,
+					*line,		// Header line
+					*eol,		// Its end
+					*run = text;	// Lines to send so far
+	bool			mime = Attachments != NULL,
+					skip = false;	// In a field left out
+	string_view		part;		// Multipart header, first part's
+
+	for (line = text; line < end; line = eol) {
+
+		if ((eol = (const char *)memchr(line, '\n', end - line)) == NULL)
+
+			eol = end;
+
+		else
+
+			eol++;
+
+		if (*line != ' ' && *line != '\t')
+
+			skip = IsField(line, eol, "Bcc:") ||
+				   (mime && (IsField(line, eol, "Content-") ||
+							 IsField(line, eol, "MIME-Version:") ||
+							 *line == '\r' || *line == '\n'));
+
+		if (skip) {
+
+			// Send the lines before this one, skip it.
+			if (send_encoded(session, run, line - run) != 0)
+
+				return -1;
+
+			run = eol;
+
+		}
+
+	}
+
+	if (send_encoded(session, run, end - run) != 0)
+
+		return -1;
+
+	if (!mime)
+
+		return 0;
+
+	MimeBoundary(Boundary, sizeof(Boundary));
+	part = session->arena.join({ "MIME-Version: 1.0\r\n"
+								 "Content-Type: multipart/mixed;\r\n"
+								 "\tboundary=\"", Boundary, "\"\r\n\r\n"
+								 "--", Boundary, "\r\n" });
+
+	if (send_encoded(session, part.data(), part.length()) != 0)
+
+		return -1;
+
+	for (line = text; line < end; line = eol) {
+
+		if ((eol = (const char *)memchr(line, '\n', end - line)) == NULL)
+
+			eol = end;
+
+		else
+
+			eol++;
+
+		if (*line != ' ' && *line != '\t')
+
+			skip = !IsField(line, eol, "Content-");
+
+		if (!skip && send_encoded(session, line, eol - line) != 0)
+
+			return -1;
+
+	}
+
+	return send_encoded(session, "\r\n", 2);		// End of part header
+
+}
+
+/*
+ * Send the attachments, each as a body part: the boundary, its
+ * header (see MimeAttachment) and its data in base64, then the
+ * closing boundary. A file is read in pieces of a whole number of
+ * base64 lines into the input buffer and encoded (see
+ * Base64Encoder) straight into the output buffer, which is written
+ * out (or added to the BDAT chunk) as it is: base64 lines need no
+ * dot-stuffing. No file is ever in memory as a whole.
+ * @args:	open session, server waiting for data (SmtpSession *)
+ * @return:	0 (success, or no attachments)
+ * - error: -1 (connection or file error, errno set)
+ */
+int
+MailSenderSmtp::send_attachments(SmtpSession *session)
+{
+
+	const size_t	piece = DataChunk - DataChunk % Base64Encoder::LineBytes;
+	string_view		delim;		// Boundary and part header
+	ssize_t			n;
+	int				fd;
+
+	if (Attachments == NULL)
+
+		return 0;
+
+	for (size_t i = 0; i < Attachments->size(); i++) {
+
+		const MimeAttachment	&part = (*Attachments)[i];
+
+		// After the text, the CRLF before the boundary is its own;
+		// base64 ends w/ one.
+		delim = session->arena.join({ i == 0 ? "\r\n--" : "--", Boundary,
+									  "\r\n", part.header });
+
+		if (send_encoded(session, delim.data(), delim.length()) != 0 ||
+			(fd = open(part.path.c_str(), O_RDONLY)) < 0)
+
+			return -1;		// Check errno
+
+		Base64.reset();
+
+		while ((n = read_full(fd, &InBuf[0], piece)) > 0) {
+
+			if (send_output(session,
+							Base64.encode(&InBuf[0], n, &OutBuf[Fill])) != 0)
+
+				break;
+
+		}
+
+		close(fd);
+
+		if (n != 0 ||
+			send_output(session, Base64.finish(&OutBuf[Fill])) != 0)
+
+			return -1;		// Check errno
+
+	}
+
+	delim = session->arena.join({ "--", Boundary, "--\r\n" });
+
+	return send_encoded(session, delim.data(), delim.length());
+
+}
+
+/*
+ * Send a message in memory in DATA form: the text encoded (its
+ * header made multipart w/ attachments, see send_header), the
+ * attachments, and the end of data indicator.
+ * @args:	open session, server waiting for data (SmtpSession *)
+ * 			message, w/o Bcc: fields (const char *text, size_t len)
+ * @return:	0 (success)
+ * - error: -1 (connection error, errno set)
+ */
+int
+MailSenderSmtp::send_text(SmtpSession *session,
+						  const char *text,
+						  size_t len)
+{
+
+	size_t			header = 0;	// Header, w/ attachments
+
+	Encoder.reset();
+
+	if (Attachments != NULL && (header = DataHeaderEnd(text, len)) == 0)
+
+		header = len;		// No body
+
+	if (send_header(session, text, header) != 0 ||
+		send_encoded(session, text + header, len - header) != 0 ||
+		send_attachments(session) != 0)
+
+		return -1;
+
+	return end_data(session);		// End of data: .<CRLF>
+
+}
+
+/*
+ * Read up to len bytes of a file, despite short reads.
+ * @args:	file (int fd), buffer (char *buf, size_t len)
+ * @return:	bytes read, < len at end of file (ssize_t)
+ *  -error:	-1 (errno set)
+ */
+ssize_t
+MailSenderSmtp::read_full(int fd, char *buf, size_t len)
+{
+
+	size_t			got = 0;
+	ssize_t			n;
+
+	while (got < len && (n = read(fd, buf + got, len - got)) != 0) {
+
+		if (n < 0) {
+
+			if (errno == EINTR)
+
+				continue;
+
+			return -1;
+
+		}
+
+		got += n;
+
+	}
+
+	return got;
+
+}
+
+/*
+ * Encode message text (see SmtpDataEncoder) and write it out, at
+ * most DataChunk input bytes at a time so the output buffer is
+ * always large enough. W/ BDAT the output is added to the chunk
+ * in OutBuf instead, sent once it has ChunkSize bytes.
+ * @args:	open session (SmtpSession *session)
+ * 			message text (const char *text, size_t len)
+ * @return:	0 (success)
+ * - error: -1 (connection error, errno set)
+ */
+int
+MailSenderSmtp::send_encoded(SmtpSession *session,
+							 const char *text,
+							 size_t len)
+{
+
+	size_t			chunk;
+
+	for (size_t i = 0; i < len; i += chunk) {
+
+		chunk = min(len - i, (size_t)DataChunk);
+
+		if (send_output(session,
+						Encoder.encode(text + i, chunk, &OutBuf[Fill])) != 0)
+
+			return -1;
+
+	}
+
+	return 0;
+
+}
+
+/*
+ * Send the n bytes an encoder wrote to OutBuf at Fill, in DATA
+ * form: write them out, or w/ BDAT add them to the chunk and send
+ * it once it has ChunkSize bytes. They are logged if body logging
+ * is on.
+ * @args:	open session (SmtpSession *session)
+ * 			bytes written to OutBuf (size_t n)
+ * @return:	0 (success)
+ * - error: -1 (connection error, errno set; or a chunk refused)
+ */
+int
+MailSenderSmtp::send_output(SmtpSession *session, size_t n)
+{
+
+	Logger::shared().log_body(&OutBuf[Fill], n);
+
+	if (!Chunked)
+
+		return write_data(session, &OutBuf[0], n);
+
+	if ((Fill += n) >= ChunkSize)
+
+		return send_chunk(session, false);
+
+	return 0;
+
+}
+
+/*
+ * End the message data: terminate its last line and send the end
+ * of data indicator, or w/ BDAT the rest of the data as the LAST
+ * chunk (possibly empty, "BDAT 0 LAST").
+ * @args:	open session (SmtpSession *session)
+ * @return:	0 (success)
+ * - error: -1 (connection error, errno set; or a chunk refused)
+ */
+int
+MailSenderSmtp::end_data(SmtpSession *session)
+{
+
+	size_t			n = Encoder.finish(&OutBuf[Fill]);
+
+	if (!Chunked)
+
+		return write_data(session, &OutBuf[0], n);
+
+	Fill += n;
+
+	return send_chunk(session, true);
+
+}
+
+/*
+ * Send the Fill bytes in OutBuf as one BDAT chunk (RFC 3030), as
+ * they are: "BDAT <size>" then the data, "BDAT <size> LAST" for
+ * the last one. The reply to each chunk but the last is read
+ * right away, or w/ PIPELINING up to ChunkWindow chunks later, so
+ * the next chunks go out while the relay takes this one in. After
+ * the last chunk every reply but its own (the final reply, read by
+ * smtp_client) is read.
+ * A chunk the relay refuses fails the transaction: no further
+ * chunk is sent, the replies still due are read and the refusal
+ * is kept in Refused.
+ * @args:	open session (SmtpSession *session)
+ * 			last chunk? (bool last)
+ * @return:	0 (success)
+ * - error: -1 (connection error, errno set; or a chunk refused)
+ */
+int
+MailSenderSmtp::send_chunk(SmtpSession *session, bool last)
+{
+
+	SmtpReply		reply;		// Reply to an earlier chunk
+	char			cmd[48];	// BDAT command
+	int				code,
+					window;		// Chunks left unanswered
+
+	snprintf(cmd, sizeof(cmd), "BDAT %zu%s\r\n", Fill,
+			 last ? " LAST" : "");
+
+	if (write_cmd(session, cmd) != 0 ||
+		write_data(session, &OutBuf[0], Fill) != 0)
+
+		return -1;
+
+	Fill = 0;
+
+	if (!last)
+
+		Pending++;
+
+	window = !last && (session->ext & SmtpSession::ExtPipelining) ?
+			 ChunkWindow : 0;
+
+	while (Pending > window || (Refused != 0 && Pending > 0)) {
+
+		if ((code = read_reply(session, reply)) < 0)
+
+			return -1;		// Lost connection
+
+		Pending--;
+
+		if (code != 250 && Refused == 0)
+
+			Refused = code;
+
+	}
+
+	if (Refused != 0) {
+
+		// The last chunk has its own reply, to read as well.
+		if (last)
+
+			read_reply(session, reply);
+
+		return -1;
+
+	}
+
+	return 0;
+
+}
+
+/*
+ * Write a complete command (or command batch) to the session
+ * socket, resuming after partial writes; it is logged at LogDebug.
+ * @args:	open session (SmtpSession *session)
+ * 			bytes to write (string_view data)
+ * @return:	0 (success)
+ * - error: -1 (connection error, errno set)
+ */
+int
+MailSenderSmtp::write_cmd(SmtpSession *session, string_view data)
+{
+
+	Logger::shared().log(LogDebug, "C", data.data(), data.length());
+
+	return write_data(session, data.data(), data.length());
+
+}
+
+/*
+ * Write all of a buffer to the session socket (through TLS if it is
+ * on), resuming after partial writes.
+ * @args:	open session (SmtpSession *session)
+ * 			bytes to write (const char *data, size_t len)
+ * @return:	0 (success)
+ * - error: -1 (connection error, errno set)
+ */
+int
+MailSenderSmtp::write_data(SmtpSession *session,
+						   const char *data,
+						   size_t len)
+{
+
+	size_t			sent = 0;	// Bytes written so far
+	ssize_t			n;
+
+	while (sent < len) {
+
+		if ((n = session->tls != NULL ?
+				 TlsClient::write(session->tls, data + sent, len - sent) :
+				 write(session->fd, data + sent, len - sent)) < 0) {
+
+			if (errno == EINTR)
+
+				continue;
+
+			return -1;	// Check errno
+
+		}
+
+		sent += n;
+
+		if (session->metrics != NULL)
+
+			session->metrics->bytes += n;
+
+	}
+
+	return 0;
+
+}
+
+/*
+ * Send length bytes of a file, from offset, to the session socket
+ * w/ sendfile(): the kernel copies from the page cache to the
+ * socket, the data never passes through user space. Over TLS the
+ * data has to be encrypted, so it is read (a record at a time) and
+ * written out instead.
+ * @args:	open session (SmtpSession *session)
+ * 			file descriptor (int fd)
+ * 			start & length of data in the file (off_t offset, length)
+ * @return:	0 (success)
+ * - error: -1 (connection/file error, errno set)
+ */
+int
+MailSenderSmtp::send_file(SmtpSession *session,
+						  int fd,
+						  off_t offset,
+						  off_t length)
+{
+
+	ssize_t			n;
+	char			buf[16384];		// A TLS record's worth
+
+	while (session->tls != NULL && length > 0) {
+
+		if ((n = pread(fd, buf, min(length, (off_t)sizeof(buf)),
+					   offset)) <= 0) {
+
+			if (n < 0 && errno == EINTR)
+
+				continue;
+
+			if (n == 0)
+
+				errno = EIO;	// File shorter than expected
+
+			return -1;
+
+		}
+
+		if (write_data(session, buf, n) != 0)
+
+			return -1;
+
+		offset += n;
+		length -= n;
+
+	}
+
+	while (length > 0) {
+
+		if ((n = sendfile(session->fd, fd, &offset, length)) <= 0) {
+
+			if (n < 0 && errno == EINTR)
+
+				continue;
+
+			if (n == 0)
+
+				errno = EIO;	// File shorter than expected
+
+			return -1;
+
+		}
+
+		length -= n;
+
+		if (session->metrics != NULL)
+
+			session->metrics->bytes += n;
+
+	}
+
+	return 0;
+
+}
+
+/*
+ * Read what the server sent into the session's reply buffer, from
+ * the socket or through TLS.
+ * @args:	open session (SmtpSession *session)
+ * @return:	# of bytes read, 0 (connection closed)
+ * - error: -1 (errno set, see SmtpReplyReader::fill)
+ */
+ssize_t
+MailSenderSmtp::receive(SmtpSession *session)
+{
+
+	char			*free;		// Free end of the reply buffer
+	size_t			len;
+	ssize_t			n;
+
+	if (session->tls == NULL)
+
+		return session->reader.fill(session->fd);
+
+	if ((free = session->reader.space(len)) == NULL)
+
+		return -1;		// Reply too long
+
+	if ((n = TlsClient::read(session->tls, free, len)) > 0)
+
+		session->reader.filled(n);
+
+	return n;
+
+}
+
+/*
+ * Read one complete server reply. A reply is one or more lines;
+ * all but the last have a '-' after the 3-digit code:
+ * 	250-first line
+ * 	250 last line
+ * The session's SmtpReplyReader parses what has been received and
+ * reads more only while no complete reply is buffered. Bytes past
+ * the end of the reply (the next pipelined reply) stay buffered for
+ * the next call, so no reply is lost or misattributed.
+ * @args:	open session (SmtpSession *session)
+ * 			complete reply, valid until the next read (SmtpReply &)
+ * @return:	reply code, e.g. 250 (success)
+ * - error: -1 (connection closed or error, errno set; EPROTO:
+ * 			malformed reply)
+ */
+int
+MailSenderSmtp::read_reply(SmtpSession *session, SmtpReply &reply)
+{
+
+	int				found;
+	ssize_t			recv_bytes;
+
+	while ((found = session->reader.next(reply)) == 0) {
+
+		if ((recv_bytes = receive(session)) <= 0) {
+
+			if (recv_bytes < 0 && errno == EINTR)
+
+				continue;
+
+			if (recv_bytes == 0)
+
+				errno = ECONNRESET;		// Server closed connection
+
+			return -1;
+
+		}
+
+	}
+
+	if (found < 0)
+
+		return -1;		// Malformed, errno set
+
+	if (session->metrics != NULL)
+
+		session->metrics->reply(reply.code);
+
+	if (reply.code == 421 || reply.code == 451)
+
+		session->throttled = reply.code;	// Relay pushing back
+
+	Logger::shared().log(LogDebug, "S", reply.text, reply.length);
+
+	return reply.code;
+
+}
+
+/*
+ * SMTP client-server command handler
+ * Construct command to send to server, compare server
+ * response to one that is expected.
+ * A reply is never lost (see read_reply), so an unexpected reply
+ * is the server's answer and the command is not sent again.
+ * Uses methods "read(...)" and "write(...)" via sockets.
+ * @args:	open session (SmtpSession *session)
+ * 			command to issue (string_view cmd)
+ * 			command parameter (string_view param)
+ * 			expected server reply (int confirm)
+ * 				(by default: 250)
+ * @return:	0  (success)
+ * - error: -1 (failure, lost connection (errno set)/unexpected
+ * 			reply)
+ */
+int
+MailSenderSmtp::send_recv_cmd(SmtpSession *session,
+							  string_view cmd,
+							  string_view param,
+							  int confirm)
+{
+
+	string_view		to_send;			// In the session's arena
+	SmtpReply		reply;				// Server reply
+	int				code;				// Reply code
+
+	// Commands end in <CRLF>
+	to_send = session->arena.join({ cmd, param, "\r\n" });
+
+	// Send command
+	// Receive server reply
+	if (write_cmd(session, to_send) != 0 ||
+		(code = read_reply(session, reply)) < 0) {
+
+		return -1;		// Lost connection, errno set
+
+	}
+
+	// Server confirmation or repeated command
+	if (code == confirm ||
+		code == 503) {	// 503: Repeated cmd
+
+		return 0;	// Confirmed, success
+
+	}
+
+	return -1;		// Fail
+
+}
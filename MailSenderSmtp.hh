@@ -36,8 +36,14 @@
 #define MAILSENDERSMTP_HH_
 
 #include "MailSender.hh"
+#include "SmtpPool.hh"
+#include "SmtpData.hh"
+#include "Mime.hh"
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <vector>
+#include <sys/types.h>
 
 using namespace std;
 
@@ -47,52 +53,283 @@ using namespace std;
  * Send contents of an RFC-821 formatted e-mail through
  * an SMTP server relay, interfacing w/ the server using
  * the RFC-822 Server-Client model.
- * Standard SMTP protocol, port 25 w/ no authorization
- * protocol.
+ * Standard SMTP protocol, port 25 (or set_port), w/ STARTTLS
+ * (RFC 3207) and AUTH PLAIN or LOGIN (RFC 4954) if set (see set_tls,
+ * set_auth). TLS sessions are resumed from TlsClient's cache by
+ * relay, so a reconnect costs an abbreviated handshake.
+ * Sessions to the relay are taken from, and returned to, an
+ * SmtpPool (by default the shared one), so successive calls to
+ * send() reuse an open session, separated w/ RSET. A session is
+ * recycled (QUIT + reconnect) after MaxPerConn messages.
+ * A message to many recipients is sent once, w/ one RCPT per
+ * recipient in the same transaction.
+ * A plain message goes to a relay that offers CHUNKING (RFC 3030)
+ * in BDAT chunks of about set_chunk_size bytes, w/o dot-stuffing;
+ * otherwise, and for wire files, w/ DATA.
+ * Files may be attached to each plain message (see set_attachments):
+ * it goes out as multipart/mixed, the files base64-encoded as they
+ * are read, a chunk at a time.
+ * The transcript is logged at LogDebug, w/o AUTH credentials, and
+ * message data only if body logging is on (see Logger.hh); wire
+ * files go out by sendfile() (read and written through TLS on a
+ * TLS session) and their data is not logged.
  */
 class MailSenderSmtp : public MailSender
 {
   public:
-			 MailSenderSmtp(const string &filename): MailSender(filename) { }
+			 MailSenderSmtp(const string &filename,
+							int max_per_conn = DefaultMaxPerConn,
+							SmtpPool *pool = &SmtpPool::shared()):
+				 MailSender(filename),
+				 MaxPerConn(max_per_conn), Port(DefaultPort), Pool(pool),
+				 Metrics(NULL), MetricsPort(0), Throttled(0), Text(NULL), TextLength(0),
+				 ChunkSize(DefaultChunkSize), Chunked(false), Fill(0),
+				 Pending(0), Refused(0), Attachments(NULL), Tls(TlsOff) { }
 			~MailSenderSmtp() { }
 
+	enum { DefaultMaxPerConn = 100,	// Messages per session
+		   DefaultPort = 25,		// SMTP
+		   DefaultChunkSize = 1048576 };	// Bytes per BDAT chunk
+
+	enum TlsPolicy { TlsOff,		// Plaintext
+					 TlsIfOffered,	// STARTTLS if the relay offers it
+					 TlsRequired };	// No session w/o TLS
+
+	using MailSender::send;		// Single recipient form
+
 	// Send email to relay host via TCP/IPv4 and interfacing
 
-	// with an SMTP server.
+	// with an SMTP server. One transaction (one copy of the
+
+	// body) for all recipients; per-recipient reply codes
+
+	// are returned in rcpt_status.
 
 	int			send(const string &host_to,
 					 const string &envelope_from,
-					 const string &envelope_to);
+					 const vector<string> &envelope_to,
+					 vector<int> &rcpt_status);
+
+	 // Port of the relay(s) the next messages go to.
+
+	void		set_port(int port) { Port = port; }
+
+	 // Send a message from memory (plain text, w/o Bcc: fields)
+
+	 // instead of the file; NULL: the file again. The text must
+
+	 // stay put until send() returns.
+
+	void		set_text(const char *text, size_t len)
+	{
+		Text = text;
+		TextLength = len;
+	}
+
+	 // Attach files to each message (not to wire files); NULL:
+
+	 // send messages as they are. The list must stay put.
+
+	void		set_attachments(const vector<MimeAttachment> *parts)
+					{ Attachments = parts; }
+
+	 // STARTTLS on the sessions opened from now on.
+
+	void		set_tls(TlsPolicy policy) { Tls = policy; }
+
+	 // AUTH w/ mechanism "plain" or "login" on the sessions opened
+
+	 // from now on, over TLS only; "": none.
+
+	void		set_auth(const string &mechanism,
+						 const string &user,
+						 const string &password)
+	{
+		AuthMechanism = mechanism;
+		AuthUser = user;
+		AuthPassword = password;
+	}
+
+	 // Bytes of message data per BDAT chunk; 0: always DATA.
+
+	void		set_chunk_size(size_t bytes) { ChunkSize = bytes; }
+
+	 // Throttling reply (421, 451) the last send() got, or 0.
+
+	int			throttled() const { return Throttled; }
+
+	 // Extensions advertised in a reply to EHLO.
+
+	static unsigned int	parse_extensions(const SmtpReply &reply);
 
   private:
 
-	enum Port { Smtp = 25 };	// Port #: 25 (SMTP)
+	friend class SmtpPool;		// Issues NOOP/QUIT on idle sessions
+
+	enum { DataChunk = 65536,	// Bytes of message read at a time
+		   ChunkWindow = 8 };		// BDAT chunks sent ahead of replies
+
+	int			MaxPerConn;		// Transactions before reconnecting
+	int			Port;			// Relay port
+	SmtpPool	*Pool;			// Idle sessions to reuse
+	RelayMetrics	*Metrics;	// Of the relay being sent to
+	string		MetricsHost;	// Relay of Metrics
+	int			MetricsPort;
+	int			Throttled;		// 421/451 read in this send()
+	const char	*Text;			// Message in memory, or NULL
+	size_t		TextLength;
+
+	SmtpDataEncoder	Encoder;	// CRLF/dot-stuffing of message data
+	vector<char>	InBuf,		// Message chunk, reused
+					OutBuf;		// Encoded chunk, reused
+	size_t			ChunkSize;	// BDAT chunk, 0: no BDAT
+	bool			Chunked;	// This transaction sends BDAT
+	size_t			Fill;		// Bytes of the BDAT chunk in OutBuf
+	int				Pending,	// BDAT replies not read yet
+					Refused;	// Reply that failed a chunk, or 0
+	const vector<MimeAttachment>	*Attachments;	// Or NULL
+	Base64Encoder	Base64;		// Of the attachments
+	char			Boundary[64];	// Of the message being sent
+	TlsPolicy		Tls;		// STARTTLS on new sessions
+	string			AuthMechanism,	// AUTH on new sessions, or ""
+					AuthUser,
+					AuthPassword;
+	vector<string>	Rcpts;		// Recipients of a later round
+	vector<int>		Status,		// Reply codes of a transaction
+					Index,		// Its recipients in envelope_to
+					Deferred;	// Those to try again (452)
+
+	 // Connect to host, accept greeting and introduce client (HELO).
+
+	SmtpSession	*open_session(const string &host,
+							  const string &envelope_from);
 
 	 // Create socket, connect to host.
 
 	int			open_clientfd(const string &host);
 
-	 // Interface w/ SMTP server to send contents of email file
+	 // Introduce client w/ EHLO, record server extensions.
+
+	int			ehlo(SmtpSession *session, string_view domain);
+
+	 // Start TLS (as the policy wants), EHLO again.
+
+	int			starttls(SmtpSession *session, string_view domain);
+
+	 // Log in w/ AUTH, if credentials are set.
+
+	int			authenticate(SmtpSession *session);
+
+	 // Run one mail transaction (MAIL/RCPT/DATA) on an open
 
-	 // using write/recv methods via sockets.
+	 // session to send contents of email file.
 
-	int			smtp_client(int clientfd,
+	int			smtp_client(SmtpSession *session,
 							const string &envelope_from,
-							const string &envelope_to);
+							const vector<string> &envelope_to,
+							vector<int> &rcpt_status);
+
+	 // Send RSET/MAIL/RCPT.../DATA, in one write if the server
+
+	 // supports PIPELINING, and match the replies.
+
+	int			send_envelope(SmtpSession *session,
+							  const string &envelope_from,
+							  const vector<string> &envelope_to,
+							  vector<int> &rcpt_status);
 
 	 // Format write/read commands, call those functions.
 
 	 // Compare server responce to expected response (param 4).
 
-	 // If server response is unexpected or lost packets exist,
+	static int	send_recv_cmd(SmtpSession *session,
+							  string_view cmd,
+							  string_view param,
+							  int confirm = 250);
+							  // Default server reply: 'OK'
 
-	 // attempt transfer a second time.
+	 // Stream a plain message through the DATA encoder: from a
 
-	int			send_recv_cmd(int sockfd,
-							  const string &cmd,
-							  const string &param,
-							  const string &confirm = "250");
-							  // Default server reply: 'OK'
+	 // file whose first head bytes are in InBuf, from a stream
+
+	 // (header longer than DataChunk) or from memory.
+
+	int			send_text(SmtpSession *session,
+						  int fd,
+						  ssize_t head,
+						  size_t header);
+
+	int			send_text(SmtpSession *session, istream &fin);
+
+	int			send_text(SmtpSession *session,
+						  const char *text,
+						  size_t len);
+
+	 // Send a message header w/o Bcc: fields; w/ attachments,
+
+	 // made the header of a multipart message and its first part.
+
+	int			send_header(SmtpSession *session,
+							const char *text,
+							size_t header);
+
+	 // Send the attachments, base64, and the closing boundary.
+
+	int			send_attachments(SmtpSession *session);
+
+	 // Encode message text, write it out (or add it to the
+
+	 // BDAT chunk).
+
+	int			send_encoded(SmtpSession *session,
+							 const char *text,
+							 size_t len);
+
+	 // Send what an encoder put in OutBuf (at Fill).
+
+	int			send_output(SmtpSession *session, size_t n);
+
+	 // End the message data: ".<CRLF>", or the last BDAT chunk.
+
+	int			end_data(SmtpSession *session);
+
+	 // Send OutBuf as a BDAT chunk, read the replies due.
+
+	int			send_chunk(SmtpSession *session, bool last);
+
+	 // Write all of a command/data, despite partial writes.
+
+	static int	write_cmd(SmtpSession *session, string_view data);
+
+	static int	write_data(SmtpSession *session,
+						   const char *data,
+						   size_t len);
+
+	 // Read a file into a buffer, despite short reads.
+
+	static ssize_t	read_full(int fd, char *buf, size_t len);
+
+	 // Send part of a file w/ sendfile(), no user-space copy.
+
+	static int	send_file(SmtpSession *session,
+						  int fd,
+						  off_t offset,
+						  off_t length);
+
+	 // Read what the server sent into the session's reply buffer.
+
+	static ssize_t	receive(SmtpSession *session);
+
+	 // Read one complete (multi-line) reply, return its code.
+
+	static int	read_reply(SmtpSession *session, SmtpReply &reply);
+
+	struct Extension {				// EHLO keyword to flag
+		const char		*keyword;
+		unsigned int	flag;
+	};
+
+	static const Extension	Extensions[];	// Recognized extensions
 
 };
 
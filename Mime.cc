@@ -0,0 +1,642 @@
+/*
+ * Mail-Sending Program
+ * Mime.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+
+#include "Mime.hh"
+#include <string>
+#include <atomic>
+#include <random>
+#include <cstring>
+#include <cstdio>
+#include <cctype>
+#include <cerrno>
+#include <stdint.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MIME_X86 1
+#endif
+
+using namespace std;
+
+static const char	Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+								 "abcdefghijklmnopqrstuvwxyz"
+								 "0123456789+/";
+
+// Media types by file name extension (RFC 6838 registry).
+
+static const struct {
+	const char		*ext;
+	const char		*type;
+} Types[] = {
+	{ "csv",	"text/csv" },
+	{ "txt",	"text/plain" },
+	{ "htm",	"text/html" },
+	{ "html",	"text/html" },
+	{ "xml",	"application/xml" },
+	{ "json",	"application/json" },
+	{ "pdf",	"application/pdf" },
+	{ "zip",	"application/zip" },
+	{ "gz",		"application/gzip" },
+	{ "doc",	"application/msword" },
+	{ "docx",	"application/vnd.openxmlformats-officedocument."
+				"wordprocessingml.document" },
+	{ "xls",	"application/vnd.ms-excel" },
+	{ "xlsx",	"application/vnd.openxmlformats-officedocument."
+				"spreadsheetml.sheet" },
+	{ "png",	"image/png" },
+	{ "jpg",	"image/jpeg" },
+	{ "jpeg",	"image/jpeg" },
+	{ "gif",	"image/gif" },
+	{ NULL,		NULL }
+};
+
+/*
+ * Scalar kernel: encode the whole lines in in[0..len), each 57
+ * bytes into 76 characters and CRLF.
+ * @return:	bytes of input used
+ */
+static size_t
+EncodeLinesScalar(const unsigned char *in, size_t len, char *out)
+{
+
+	size_t			i = 0;
+	uint32_t		v;
+
+	for (; i + Base64Encoder::LineBytes <= len;
+		 i += Base64Encoder::LineBytes) {
+
+		for (int j = 0; j < Base64Encoder::LineBytes; j += 3) {
+
+			v = in[i + j] << 16 | in[i + j + 1] << 8 | in[i + j + 2];
+			*out++ = Alphabet[v >> 18];
+			*out++ = Alphabet[(v >> 12) & 63];
+			*out++ = Alphabet[(v >> 6) & 63];
+			*out++ = Alphabet[v & 63];
+
+		}
+
+		*out++ = '\r';
+		*out++ = '\n';
+
+	}
+
+	return i;
+
+}
+
+#ifdef MIME_X86
+
+/*
+ * SSSE3 block: 12 bytes (low 12 of in) to 16 characters.
+ * Each 3 bytes are spread over a 32-bit lane, the four 6-bit
+ * groups moved to the low bits of its bytes w/ two 16-bit
+ * multiplies; then each group (0..63) is mapped to its character
+ * by adding an offset looked up w/ a byte shuffle, by range:
+ * 	0..25 'A', 26..51 'a' - 26, 52..61 '0' - 52, 62 '+', 63 '/'
+ */
+__attribute__((target("ssse3")))
+static inline __m128i
+EncodeBlockSsse3(__m128i in)
+{
+
+	__m128i			groups,
+					range;
+
+	in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7,
+										   4, 5, 3, 4, 1, 2, 0, 1));
+	groups = _mm_or_si128(
+			_mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)),
+							_mm_set1_epi32(0x04000040)),
+			_mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)),
+							_mm_set1_epi32(0x01000010)));
+
+	// Range: 0 for 26..51, 1..12 for 52..63, 13 for 0..25.
+	range = _mm_or_si128(_mm_subs_epu8(groups, _mm_set1_epi8(51)),
+						 _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26),
+													  groups),
+									   _mm_set1_epi8(13)));
+
+	return _mm_add_epi8(groups,
+			_mm_shuffle_epi8(_mm_setr_epi8('a' - 26, '0' - 52, '0' - 52,
+										   '0' - 52, '0' - 52, '0' - 52,
+										   '0' - 52, '0' - 52, '0' - 52,
+										   '0' - 52, '0' - 52, '+' - 62,
+										   '/' - 63, 'A', 0, 0),
+							 range));
+
+}
+
+/*
+ * SSSE3 kernel: a line is 5 blocks of 12 bytes, the last one 3
+ * bytes past the line: its 4 extra characters are overwritten by
+ * the CRLF and the next line. The last block reads 16 bytes, so a
+ * line is only encoded here w/ 7 bytes of input after it.
+ * @return:	bytes of input used
+ */
+__attribute__((target("ssse3")))
+static size_t
+EncodeLinesSsse3(const unsigned char *in, size_t len, char *out)
+{
+
+	size_t			i = 0;
+
+	for (; i + 64 <= len; i += Base64Encoder::LineBytes) {
+
+		for (int j = 0; j < 60; j += 12)
+
+			_mm_storeu_si128((__m128i *)(out + j / 3 * 4),
+					EncodeBlockSsse3(
+							_mm_loadu_si128((const __m128i *)(in + i + j))));
+
+		out += Base64Encoder::LineChars;
+		*out++ = '\r';
+		*out++ = '\n';
+
+	}
+
+	return i;
+
+}
+
+/*
+ * AVX2 block: 24 bytes (12 in the low 12 bytes of each 128-bit
+ * half) to 32 characters, as the SSSE3 block in each half.
+ */
+__attribute__((target("avx2")))
+static inline __m256i
+EncodeBlockAvx2(__m256i in)
+{
+
+	__m256i			groups,
+					range;
+
+	in = _mm256_shuffle_epi8(in, _mm256_set_epi8(
+			10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+			10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+	groups = _mm256_or_si256(
+			_mm256_mulhi_epu16(
+					_mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00)),
+					_mm256_set1_epi32(0x04000040)),
+			_mm256_mullo_epi16(
+					_mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0)),
+					_mm256_set1_epi32(0x01000010)));
+	range = _mm256_or_si256(
+			_mm256_subs_epu8(groups, _mm256_set1_epi8(51)),
+			_mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), groups),
+							 _mm256_set1_epi8(13)));
+
+	return _mm256_add_epi8(groups,
+			_mm256_shuffle_epi8(_mm256_setr_epi8(
+					'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+					'0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+					'0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+					'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+					'0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+					'0' - 52, '+' - 62, '/' - 63, 'A', 0, 0),
+								range));
+
+}
+
+/*
+ * AVX2 kernel: a line is 2 blocks of 24 bytes and an SSSE3 block
+ * for the last 9, read and written as in the SSSE3 kernel.
+ * @return:	bytes of input used
+ */
+__attribute__((target("avx2")))
+static size_t
+EncodeLinesAvx2(const unsigned char *in, size_t len, char *out)
+{
+
+	size_t			i = 0;
+	const unsigned char	*p;
+
+	for (; i + 64 <= len; i += Base64Encoder::LineBytes) {
+
+		p = in + i;
+
+		for (int j = 0; j < 48; j += 24)
+
+			_mm256_storeu_si256((__m256i *)(out + j / 3 * 4),
+					EncodeBlockAvx2(_mm256_inserti128_si256(
+							_mm256_castsi128_si256(
+									_mm_loadu_si128((const __m128i *)(p + j))),
+							_mm_loadu_si128((const __m128i *)(p + j + 12)),
+							1)));
+
+		_mm_storeu_si128((__m128i *)(out + 64),
+				EncodeBlockSsse3(_mm_loadu_si128((const __m128i *)(p + 48))));
+
+		out += Base64Encoder::LineChars;
+		*out++ = '\r';
+		*out++ = '\n';
+
+	}
+
+	return i;
+
+}
+
+#endif /* MIME_X86 */
+
+/*
+ * Select the encoder kernel. Auto picks the best the CPU supports;
+ * a kernel the CPU (or build) lacks falls back to scalar.
+ * @args:	kernel to use (Kernel kernel), Auto by default
+ */
+Base64Encoder::Base64Encoder(Kernel kernel)
+{
+
+	if (kernel == Auto)
+
+		kernel = best_kernel();
+
+	Selected = Scalar;
+	Lines = EncodeLinesScalar;
+
+#ifdef MIME_X86
+	__builtin_cpu_init();
+
+	if (kernel == Avx2 && __builtin_cpu_supports("avx2")) {
+
+		Selected = Avx2;
+		Lines = EncodeLinesAvx2;
+
+	}
+	else if (kernel == Ssse3 && __builtin_cpu_supports("ssse3")) {
+
+		Selected = Ssse3;
+		Lines = EncodeLinesSsse3;
+
+	}
+#endif
+
+	reset();
+
+}
+
+/*
+ * Best kernel supported by this CPU.
+ * @return:	Avx2, Ssse3 or Scalar (Kernel)
+ */
+Base64Encoder::Kernel
+Base64Encoder::best_kernel()
+{
+
+#ifdef MIME_X86
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2"))
+
+		return Avx2;
+
+	if (__builtin_cpu_supports("ssse3"))
+
+		return Ssse3;
+#endif
+
+	return Scalar;
+
+}
+
+/*
+ * Name of the kernel in use, for reports.
+ * @return:	"scalar", "ssse3" or "avx2"
+ */
+const char *
+Base64Encoder::kernel_name() const
+{
+
+	switch (Selected) {
+
+	case Avx2:
+		return "avx2";
+
+	case Ssse3:
+		return "ssse3";
+
+	default:
+		return "scalar";
+
+	}
+
+}
+
+/*
+ * Encode a chunk of data into whole lines, the rest held for the
+ * next chunk:
+ * 	IF bytes held THEN complete their line from the chunk, encode it
+ * 	encode lines w/ the kernel while it can read past them
+ * 	encode the lines left (scalar)
+ * 	hold the bytes of the last, partial line
+ * @args:	input chunk (const char *in, size_t len)
+ * 			output buffer, >= max_output(len) bytes (char *out)
+ * @return:	# bytes written to out
+ */
+size_t
+Base64Encoder::encode(const char *in, size_t len, char *out)
+{
+
+	const unsigned char	*p = (const unsigned char *)in;
+	char			*o = out;
+	size_t			n;
+
+	if (Held > 0) {
+
+		n = min(len, LineBytes - Held);
+		memcpy(Hold + Held, p, n);
+		Held += n;
+		p += n;
+		len -= n;
+
+		if (Held < LineBytes)
+
+			return 0;		// Line continues in next chunk
+
+		EncodeLinesScalar(Hold, LineBytes, o);
+		o += LineChars + 2;
+		Held = 0;
+
+	}
+
+	n = Lines(p, len, o);
+	o += n / LineBytes * (LineChars + 2);
+	p += n;
+	len -= n;
+
+	n = EncodeLinesScalar(p, len, o);
+	o += n / LineBytes * (LineChars + 2);
+
+	Held = len - n;
+	memcpy(Hold, p + n, Held);
+
+	return o - out;
+
+}
+
+/*
+ * End of data: encode the bytes held as the last line, w/ '=' for
+ * each byte missing from its last group of 3, and end it.
+ * @args:	output buffer, >= max_output(0) bytes (char *out)
+ * @return:	# bytes written to out
+ */
+size_t
+Base64Encoder::finish(char *out)
+{
+
+	char			*o = out;
+	size_t			i;
+	uint32_t		v;
+
+	if (Held == 0)
+
+		return 0;
+
+	for (i = 0; i < Held; i += 3) {
+
+		v = Hold[i] << 16;
+
+		if (i + 1 < Held)
+
+			v |= Hold[i + 1] << 8;
+
+		if (i + 2 < Held)
+
+			v |= Hold[i + 2];
+
+		*o++ = Alphabet[v >> 18];
+		*o++ = Alphabet[(v >> 12) & 63];
+		*o++ = i + 1 < Held ? Alphabet[(v >> 6) & 63] : '=';
+		*o++ = i + 2 < Held ? Alphabet[v & 63] : '=';
+
+	}
+
+	*o++ = '\r';
+	*o++ = '\n';
+	reset();
+
+	return o - out;
+
+}
+
+/*
+ * Base64 of a short string, in one line of any length w/o CRLF, as
+ * SASL exchanges want it (RFC 4954, 4).
+ * @args:	data to encode (string_view data)
+ * @return:	its base64, '=' padded
+ */
+string
+Base64Line(string_view data)
+{
+
+	string			out;
+	uint32_t		v;
+
+	out.reserve((data.length() + 2) / 3 * 4);
+
+	for (size_t i = 0; i < data.length(); i += 3) {
+
+		v = (unsigned char)data[i] << 16;
+
+		if (i + 1 < data.length())
+
+			v |= (unsigned char)data[i + 1] << 8;
+
+		if (i + 2 < data.length())
+
+			v |= (unsigned char)data[i + 2];
+
+		out += Alphabet[v >> 18];
+		out += Alphabet[(v >> 12) & 63];
+		out += i + 1 < data.length() ? Alphabet[(v >> 6) & 63] : '=';
+		out += i + 2 < data.length() ? Alphabet[v & 63] : '=';
+
+	}
+
+	return out;
+
+}
+
+/*
+ * A parameter of a header field, "; attr=value" w/o the "; ": a
+ * quoted string, or for a value that is not plain ASCII the
+ * RFC 2231 form, attr*=utf-8''<value, %-encoded>.
+ * @args:	parameter name (const char *attr), value
+ * @return:	the parameter
+ */
+static string
+MimeParam(const char *attr, const string &value)
+{
+
+	static const char	hex[] = "0123456789ABCDEF";
+	string			param = attr;
+	bool			plain = true;
+
+	for (size_t i = 0; i < value.length(); i++)
+
+		plain = plain && value[i] >= 0x20 && value[i] < 0x7f;
+
+	if (plain) {
+
+		param += "=\"";
+
+		for (size_t i = 0; i < value.length(); i++) {
+
+			if (value[i] == '"' || value[i] == '\\')
+
+				param += '\\';	// Quoted pair
+
+			param += value[i];
+
+		}
+
+		return param + "\"";
+
+	}
+
+	param += "*=utf-8''";
+
+	for (size_t i = 0; i < value.length(); i++) {
+
+		unsigned char	ch = value[i];
+
+		if (isalnum(ch) || strchr("!#$&+-.^_`|~", ch) != NULL)
+
+			param += ch;
+
+		else {
+
+			param += '%';
+			param += hex[ch >> 4];
+			param += hex[ch & 15];
+
+		}
+
+	}
+
+	return param;
+
+}
+
+/*
+ * Check that a file can be attached (a regular file we can read),
+ * and make the header of its body part (see MimeAttachment). The
+ * name given is the last part of the path.
+ * @args:	file to attach (const string &path)
+ * 			attachment found (MimeAttachment &part)
+ * @return:	0 (success)
+ *  -error:	-1 (errno: file not found/unreadable, EISDIR, EINVAL)
+ */
+int
+MimeAttach(const string &path, MimeAttachment &part)
+{
+
+	struct stat		st;
+	string			name = path.substr(path.rfind('/') + 1);
+
+	if (stat(path.c_str(), &st) != 0)
+
+		return -1;		// Errno set
+
+	if (!S_ISREG(st.st_mode)) {
+
+		errno = S_ISDIR(st.st_mode) ? EISDIR : EINVAL;
+		return -1;
+
+	}
+
+	if (access(path.c_str(), R_OK) != 0)
+
+		return -1;		// Errno set
+
+	part.path = path;
+	part.header = string("Content-Type: ") + MimeType(path) + ";\r\n\t" +
+				  MimeParam("name", name) + "\r\n"
+				  "Content-Disposition: attachment;\r\n\t" +
+				  MimeParam("filename", name) + "\r\n"
+				  "Content-Transfer-Encoding: base64\r\n\r\n";
+
+	return 0;
+
+}
+
+/*
+ * @args:	file name (const string &path)
+ * @return:	media type of its extension, application/octet-stream
+ * 			if unknown
+ */
+const char *
+MimeType(const string &path)
+{
+
+	size_t			dot = path.rfind('.');
+
+	if (dot != string::npos && path.find('/', dot) == string::npos) {
+
+		for (int i = 0; Types[i].ext != NULL; i++) {
+
+			if (strcasecmp(path.c_str() + dot + 1, Types[i].ext) == 0)
+
+				return Types[i].type;
+
+		}
+
+	}
+
+	return "application/octet-stream";
+
+}
+
+/*
+ * A new boundary: a random number drawn once per process and a
+ * message count, "=_MailSender_<random>_<count>". The "=_" cannot
+ * be in base64 or quoted-printable text, the random number makes
+ * it unlikely in any other.
+ * @args:	buffer (char *boundary), its size, >= 48 (size_t len)
+ */
+void
+MimeBoundary(char *boundary, size_t len)
+{
+
+	static const unsigned long long	seed =
+			((unsigned long long)random_device()() << 32) ^ random_device()();
+	static atomic<unsigned long long>	count(0);
+
+	snprintf(boundary, len, "=_MailSender_%016llx_%llx", seed, count++);
+
+}
@@ -0,0 +1,144 @@
+/*
+ * Mail-Sending Program
+ * Mime.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+
+#ifndef MIME_HH_
+#define MIME_HH_
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+using namespace std;
+
+/*
+ * Base64Encoder object
+ * Streaming base64 (RFC 2045, 6.8) of attachment data, in lines of
+ * 76 characters ended w/ CRLF: ready for SMTP DATA as it is (no
+ * line starts w/ '.'), so it can skip SmtpDataEncoder.
+ * Input may be fed in chunks of any size: a line is 57 bytes of
+ * input, the start of one split between two chunks is held until
+ * the rest comes. Chunks that are a multiple of 57 bytes are never
+ * copied. finish() pads and ends the last line.
+ * Output goes to a caller-supplied buffer of at least
+ * max_output(len) bytes.
+ * Lines are encoded 12 (SSSE3) or 24 (AVX2) bytes at a time, the
+ * 6-bit groups split w/ multiplies and mapped to characters w/ a
+ * byte shuffle; the kernel is selected at run time from what the
+ * CPU supports, w/ a portable scalar fallback.
+ */
+class Base64Encoder
+{
+  public:
+
+	enum Kernel { Auto, Scalar, Ssse3, Avx2 };
+
+	enum { LineBytes = 57,			// Input bytes per line
+		   LineChars = 76 };		// Characters per line, w/o CRLF
+
+			 Base64Encoder(Kernel kernel = Auto);
+
+	 // Largest output encode() or finish() can produce for len
+
+	 // bytes of input (a kernel may write a few bytes past the end
+
+	 // of what it returns).
+
+	static size_t	max_output(size_t len)
+						{ return (len / LineBytes + 2) * (LineChars + 2) + 16; }
+
+	 // Encode a chunk of data, return # bytes written.
+
+	size_t			encode(const char *in, size_t len, char *out);
+
+	 // End of data: encode the held bytes, padded, as the last line.
+
+	size_t			finish(char *out);
+
+	 // Start new data.
+
+	void			reset() { Held = 0; }
+
+	 // Kernel in use: "scalar", "ssse3" or "avx2".
+
+	const char		*kernel_name() const;
+
+	 // Best kernel this CPU supports.
+
+	static Kernel	best_kernel();
+
+  private:
+
+	typedef size_t	(*EncodeLines)(const unsigned char *in, size_t len,
+								   char *out);
+
+	unsigned char	Hold[LineBytes];	// Start of a line, rest to come
+	size_t			Held;				// Bytes in Hold
+	Kernel			Selected;			// Kernel in use
+	EncodeLines		Lines;				// Whole lines, return bytes used
+
+};
+
+/*
+ * An attachment, w/ the header of its body part (RFC 2046, 5.1):
+ * 	Content-Type: <type by file name extension>; name="<file>"
+ * 	Content-Disposition: attachment; filename="<file>"
+ * 	Content-Transfer-Encoding: base64
+ * and the blank line after it. A file name that is not plain ASCII
+ * goes in RFC 2231 form (filename*=utf-8''...).
+ */
+struct MimeAttachment
+{
+	string			path;		// File to attach
+	string			header;		// Part header, through the blank line
+};
+
+// Check that a file can be attached, make its part header.
+
+int				MimeAttach(const string &path, MimeAttachment &part);
+
+// Media type of a file, by its name's extension.
+
+const char		*MimeType(const string &path);
+
+// Base64 of a short string as one line, w/o CRLF (SASL).
+
+string			Base64Line(string_view data);
+
+// New boundary of a multipart message, unique to it.
+
+void			MimeBoundary(char *boundary, size_t len);
+
+#endif /* MIME_HH_ */
@@ -0,0 +1,453 @@
+/*
+ * Mail-Sending Program
+ * RelayRouter.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+
+#include "RelayRouter.hh"
+#include "MailSenderSmtp.hh"
+#include "SmtpMetrics.hh"
+#include "Logger.hh"
+#include <chrono>
+
+using namespace std;
+
+const double	Alpha = 0.2;	// Weight of a new sample in the EWMAs
+
+const double	Drift = 1.01;	// Rise of the lowest latency per sample
+
+RelayRouter::RelayRouter(const vector<RelayConfig> &relays)
+{
+
+	State			s;
+
+	s.latency = 0;
+	s.errors = 0;
+	s.measured = false;
+	s.in_flight = 0;
+	s.failures = 0;
+	s.breaker = Closed;
+	s.open_until = 0;
+	s.backoff = ProbeAfter;
+
+	for (size_t i = 0; i < relays.size() && i < MaxRelays; i++) {
+
+		RelayConfig		&c = s.config;
+		string			key = relays[i].host;	// As MailSenderSmtp's
+
+		c = relays[i];
+		c.weight = max(c.weight, 1);
+		c.min_conn = max(c.min_conn, 1);
+		c.min_rate = max(c.max_rate > 0 ? min(c.min_rate, c.max_rate) :
+										  c.min_rate, 1);
+		s.ceiling = c.max_conn > 0 ? max(c.max_conn, c.min_conn) :
+									 (int)MaxWindow;
+		s.window = min(s.ceiling, (double)max((int)InitialWindow,
+											  c.min_conn));
+		s.rate = c.max_rate;
+		s.tokens = 1;
+		s.lowest = 0;
+		s.refilled = SmtpMetrics::now();
+		s.cut = 0;
+
+		if (c.port != MailSenderSmtp::DefaultPort)
+
+			key += ":" + to_string(c.port);
+
+		s.metrics = SmtpMetrics::shared().relay(key);
+		s.metrics->window = s.window;
+		s.metrics->rate = s.rate;
+		Relays.push_back(s);
+
+	}
+
+}
+
+/*
+ * Relay for the next message, waiting for one under its cap.
+ * @args:	relays not to use (uint64_t exclude), bit r: relay r
+ * @return:	relay # (int), counted in flight until done()
+ *  -error:	-1 (every relay excluded)
+ */
+int
+RelayRouter::pick(uint64_t exclude)
+{
+
+	unique_lock<mutex>	lock(Lock);
+	int				r;
+	uint64_t		usec;
+
+	while ((r = choose(exclude)) < 0) {
+
+		if ((~exclude & all()) == 0)
+
+			return -1;		// Nothing left to try
+
+		if ((usec = wait_us(exclude)) > 0)
+
+			Freed.wait_for(lock, chrono::microseconds(usec));	// Token
+
+		else
+
+			Freed.wait(lock);
+
+	}
+
+	return r;
+
+}
+
+/*
+ * Relay for the next message, if one is under its cap.
+ * @args:	relays not to use (uint64_t exclude), bit r: relay r
+ * @return:	relay # (int), counted in flight until done()
+ *  -error:	-1 (all at their cap, or excluded)
+ */
+int
+RelayRouter::try_pick(uint64_t exclude)
+{
+
+	lock_guard<mutex>	guard(Lock);
+
+	return choose(exclude);
+
+}
+
+/*
+ * Ms. until a relay gets its next token or, circuit-broken, its
+ * probe time, for a caller that cannot wait in pick() (e.g. an
+ * event loop).
+ * @args:	relays not to use (uint64_t exclude), bit r: relay r
+ * @return:	ms. (int), rounded up
+ *  -error:	-1 (no relay waits for a time, only for done())
+ */
+int
+RelayRouter::delay(uint64_t exclude)
+{
+
+	lock_guard<mutex>	guard(Lock);
+	uint64_t		usec = wait_us(exclude);
+
+	return usec > 0 ? (usec + 999) / 1000 : -1;
+
+}
+
+/*
+ * Score every free relay (see RelayRouter), take the lowest. A
+ * relay is free under its window, w/ a token if it has a rate;
+ * tokens are added for the time since the last look. A relay
+ * Open past its probe time becomes HalfOpen when picked,
+ * and takes no more until the probe is done. A broken relay is
+ * only used if no other one is working, even at its cap.
+ * @args:	relays not to use (uint64_t exclude)
+ * @return:	relay # (int), now in flight
+ *  -error:	-1 (none free)
+ */
+int
+RelayRouter::choose(uint64_t exclude)
+{
+
+	uint64_t		now = SmtpMetrics::now();
+	int				best = -1,
+					forced = -1;	// Open, back the soonest
+	bool			busy = false;	// A working relay is at its cap
+	double			best_score = 0,
+					score;
+
+	for (int r = 0; r < (int)Relays.size(); r++) {
+
+		State	&s = Relays[r];
+		bool	full;
+
+		if (s.rate > 0) {
+
+			s.tokens = min(1 + s.rate / 10, s.tokens +
+						   s.rate * (now - s.refilled) / 1e6);
+			s.refilled = now;
+
+		}
+
+		full = s.in_flight >= (int)s.window ||
+			   (s.rate > 0 && s.tokens < 1);
+
+		if ((exclude >> r & 1) != 0)
+
+			continue;		// Tried
+
+		if (s.breaker == Open && now < s.open_until) {
+
+			if (!full &&
+				(forced < 0 || s.open_until < Relays[forced].open_until))
+
+				forced = r;
+
+			continue;
+
+		}
+
+		if (full || (s.breaker != Closed && s.in_flight > 0)) {
+
+			busy = true;	// At its cap, or probe under way
+			continue;
+
+		}
+
+		score = (s.latency + 1000) * (1 + 4 * s.errors) *
+				(s.in_flight + 1) / s.config.weight;
+
+		if (best < 0 || score < best_score) {
+
+			best = r;
+			best_score = score;
+
+		}
+
+	}
+
+	if (best < 0 && !busy)
+
+		best = forced;		// Every relay is broken
+
+	if (best < 0)
+
+		return -1;
+
+	if (Relays[best].breaker == Open && now >= Relays[best].open_until) {
+
+		Relays[best].breaker = HalfOpen;
+		Logger::shared().print(LogInfo, "relay %s:%d: probing",
+							   Relays[best].config.host.c_str(),
+							   Relays[best].config.port);
+
+	}
+
+	Relays[best].in_flight++;
+
+	if (Relays[best].rate > 0)
+
+		Relays[best].tokens -= 1;
+
+	return best;
+
+}
+
+/*
+ * Us. until the 1st relay not excluded, under its window, may be
+ * free again: it gets a token, or (Open) its probe time comes; a
+ * relay at its window is freed by done() (Lock held).
+ * @args:	relays not to use (uint64_t exclude)
+ * @return:	us. (uint64_t), 0 if no relay waits for a time
+ */
+uint64_t
+RelayRouter::wait_us(uint64_t exclude)
+{
+
+	uint64_t		now = SmtpMetrics::now(),
+					usec = 0,
+					need;
+
+	for (int r = 0; r < (int)Relays.size(); r++) {
+
+		State	&s = Relays[r];
+
+		if ((exclude >> r & 1) != 0 || s.in_flight >= (int)s.window)
+
+			continue;
+
+		if (s.rate > 0 && s.tokens < 1)
+
+			need = (1 - s.tokens) / s.rate * 1e6 + 1;	// Token
+
+		else if (s.breaker == Open && now < s.open_until)
+
+			need = s.open_until - now;					// Probe
+
+		else
+
+			continue;
+
+		if (usec == 0 || need < usec)
+
+			usec = need;
+
+	}
+
+	return usec;
+
+}
+
+/*
+ * Account for a finished message: update the EWMAs, the circuit
+ * breaker and the window and rate (see RelayRouter). A throttled
+ * message backs off; one sent grows the window (if it was in use,
+ * i.e. full but for this message) and the rate, unless the latency
+ * has risen, which backs off instead. Wakes threads waiting in
+ * pick().
+ * @args:	relay # (int r)
+ * 			sent or refused by the relay (true), relay failure (false)
+ * 			time taken, us (uint64_t usec)
+ * 			relay replied 421/451 (bool throttled)
+ */
+void
+RelayRouter::done(int r, bool ok, uint64_t usec, bool throttled)
+{
+
+	lock_guard<mutex>	guard(Lock);
+	State			&s = Relays[r];
+	uint64_t		now = SmtpMetrics::now();
+
+	s.in_flight--;
+
+	if (throttled) {
+
+		s.metrics->throttled++;
+		back_off(s, now, true);
+
+	}
+
+	if (ok) {
+
+		if (!throttled) {
+
+			// A quick refusal says nothing of the relay's latency.
+			s.latency = s.measured ?
+						s.latency + Alpha * (usec - s.latency) : usec;
+			s.lowest = s.measured ? min(s.lowest * Drift, s.latency) :
+									s.latency;
+			s.measured = true;
+
+			if (s.latency > LatencyRise * s.lowest)
+
+				back_off(s, now, false);
+
+			else {
+
+				if (s.in_flight + 1 >= (int)s.window)	// Window in use
+
+					s.window = min(s.ceiling, s.window + 1 / s.window);
+
+				if (s.rate > 0 && s.tokens < 1) {	// Rate in use
+
+					s.rate += 1 / s.rate;
+
+					if (s.config.max_rate > 0)
+
+						s.rate = min(s.rate, (double)s.config.max_rate);
+
+				}
+
+				s.metrics->window = s.window;
+				s.metrics->rate = s.rate;
+
+			}
+
+		}
+
+		s.errors *= 1 - Alpha;
+		s.failures = 0;
+
+		if (s.breaker != Closed) {
+
+			s.breaker = Closed;
+			s.backoff = ProbeAfter;
+			Logger::shared().print(LogInfo, "relay %s:%d: back in use",
+								   s.config.host.c_str(), s.config.port);
+
+		}
+
+	}
+	else {
+
+		s.errors += Alpha * (1 - s.errors);
+		s.failures++;
+
+		if (s.breaker == HalfOpen ||
+			(s.breaker == Closed && s.failures >= BreakAfter)) {
+
+			s.breaker = Open;
+			s.open_until = SmtpMetrics::now() + s.backoff * 1000000ULL;
+			Logger::shared().print(LogWarn, "relay %s:%d: failing, "
+								   "out of use for %d s",
+								   s.config.host.c_str(), s.config.port,
+								   s.backoff);
+			s.backoff = min(s.backoff * 2, (int)MaxProbeAfter);
+
+		}
+
+	}
+
+	Freed.notify_all();
+
+}
+
+/*
+ * Multiplicative decrease: halve the window (down to min_conn), and
+ * the rate if the relay throttled (down to min_rate); w/o max_rate,
+ * the 1st throttle starts the rate at half of window / latency. Done once per
+ * latency at most, so the messages already in flight when the relay
+ * pushed back do not halve it again.
+ * @args:	relay (State &s), time now, us (uint64_t now)
+ * 			relay replied 421/451 (bool throttled)
+ */
+void
+RelayRouter::back_off(State &s, uint64_t now, bool throttled)
+{
+
+	if (s.cut != 0 && now - s.cut < max(s.latency, 1000.0))
+
+		return;
+
+	s.cut = now;
+	s.window = max((double)s.config.min_conn, s.window / 2);
+
+	if (throttled && s.rate == 0) {
+
+		// No rate yet: start from what the window lets through.
+		s.rate = s.window * 1e6 / max(s.latency, 1000.0);
+		s.tokens = 1;
+		s.refilled = now;
+
+	}
+
+	if (throttled)
+
+		s.rate = max((double)s.config.min_rate, s.rate / 2);
+
+	s.metrics->window = s.window;
+	s.metrics->rate = s.rate;
+	Logger::shared().print(LogInfo, "relay %s:%d: %s, window %.1f, "
+						   "rate %.1f/s", s.config.host.c_str(),
+						   s.config.port, throttled ? "throttled" :
+						   "latency up", s.window, s.rate);
+
+}
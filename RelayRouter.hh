@@ -0,0 +1,195 @@
+/*
+ * Mail-Sending Program
+ * RelayRouter.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+
+
+#ifndef RELAYROUTER_HH_
+#define RELAYROUTER_HH_
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <stdint.h>
+
+using namespace std;
+
+struct RelayMetrics;
+
+/*
+ * RelayConfig
+ * One relay of mailsender.conf (see LoadRelays in main.cc).
+ */
+struct RelayConfig
+{
+	string			host;		// Relay host
+	int				port;		// SMTP port, 25 by default
+	int				weight;		// Share of the load, >= 1
+	int				min_conn,	// Messages in flight at once: floor
+					max_conn;	// ... and ceiling, 0: MaxWindow
+	int				min_rate,	// Messages per second: floor
+					max_rate;	// ... and ceiling, 0: none
+	string			auth;		// AUTH mechanism, "plain"/"login"; "0": none
+	string			user,		// AUTH credentials
+					pass;
+	int				tls;		// STARTTLS: 0 no, 1 if offered, 2 always
+	string			cafile;		// CA certificates to trust too, or ""
+	int				chunk;		// BDAT chunk, KiB; 0: DATA only
+};
+
+/*
+ * RelayRouter object
+ * Picks the relay each message is sent through, among any number
+ * of relays (up to MaxRelays), for any number of threads.
+ * Each relay keeps exponentially weighted moving averages (EWMA)
+ * of its message latency and error rate; a message goes to the
+ * relay w/ the lowest
+ * 	(latency + 1 ms) * (1 + 4 * error rate) * (in flight + 1) / weight
+ * among those under their max_conn cap, so load follows weight and
+ * moves away from slow or failing relays.
+ * A relay that fails BreakAfter messages in a row is circuit-broken
+ * (Open): it gets no messages for ProbeAfter seconds, then a single
+ * probe message (HalfOpen). The probe delivered closes the circuit;
+ * failed, the relay stays out twice as long (up to MaxProbeAfter).
+ * Only when every relay is broken is one used regardless (the one
+ * due back first), so messages fail over rather than stall.
+ * Each relay's load is also paced to what it takes:
+ * 	an AIMD window (additive increase, multiplicative decrease) of
+ * 	messages in flight, from min_conn to max_conn: it grows by
+ * 	1/window w/ each message sent while the window is in use, and
+ * 	is halved when the relay throttles (421/451) or its latency
+ * 	rises past LatencyRise times the lowest seen, at most once
+ * 	per latency.
+ * 	a token bucket of up to max_rate messages per second, of
+ * 	1 + rate/10 tokens: a throttle halves the rate (down to
+ * 	min_rate), each message sent while the rate is in use adds
+ * 	1/rate back. W/o max_rate, there is no bucket until the 1st
+ * 	throttle, nor a ceiling.
+ * So the load settles near what the relay can take.
+ * @methods:	pick (waits for a free relay), try_pick, delay, done
+ */
+class RelayRouter
+{
+  public:
+
+	enum { MaxRelays = 64,			// Relays (bits of pick's exclude)
+		   BreakAfter = 3,			// Failures in a row to open
+		   ProbeAfter = 5,			// Secs. open before a probe
+		   MaxProbeAfter = 60,		// Longest time open
+		   InitialWindow = 4,		// Messages in flight at first
+		   MaxWindow = 1000,		// Ceiling if max_conn is 0
+		   LatencyRise = 2 };		// Latency/lowest to back off at
+
+			 RelayRouter(const vector<RelayConfig> &relays);
+
+	 // # of relays, configuration of one.
+
+	int				size() const { return Relays.size(); }
+
+	const RelayConfig	&relay(int r) const { return Relays[r].config; }
+
+	 // Bits of all relays, as in an exclude mask.
+
+	uint64_t		all() const { return Relays.size() >= MaxRelays ? ~0ULL :
+										 (1ULL << Relays.size()) - 1; }
+
+	 // Relay for the next message, not one of exclude (bit r: relay r
+
+	 // already tried). pick() waits while all are at their cap;
+
+	 // try_pick() returns -1 then. Both: -1 if all are excluded.
+
+	int				pick(uint64_t exclude = 0);
+
+	int				try_pick(uint64_t exclude = 0);
+
+	 // Ms. until a relay not excluded gets a token or its probe
+
+	 // time, if that is what holds them back; -1 otherwise.
+
+	int				delay(uint64_t exclude = 0);
+
+	 // A message picked for relay r is done: sent or refused by the
+
+	 // relay (ok), or lost to a relay failure; time taken in us;
+
+	 // throttled: the relay replied 421/451.
+
+	void			done(int r, bool ok, uint64_t usec,
+						 bool throttled = false);
+
+  private:
+
+	enum Breaker { Closed, Open, HalfOpen };
+
+	struct State {
+		RelayConfig		config;
+		double			latency,	// EWMA, us
+						errors;		// EWMA of failures, 0 to 1
+		bool			measured;	// latency has a sample
+		int				in_flight,	// Messages picked, not done
+						failures;	// In a row
+		Breaker			breaker;
+		uint64_t		open_until;	// Probe time (Open), us
+		int				backoff;	// Secs. open next time
+		double			window,		// AIMD: messages in flight
+						ceiling,	// ... at most
+						rate,		// Token bucket: messages/s
+						tokens,
+						lowest;		// Lowest latency EWMA, us
+		uint64_t		refilled,	// Tokens added, us
+						cut;		// Last decrease, us
+		RelayMetrics	*metrics;
+	};
+
+	mutex			Lock;			// Guards Relays' state
+	condition_variable	Freed;		// A message is done
+	vector<State>	Relays;
+
+	 // Best relay now (Lock held), -1 if none is free.
+
+	int				choose(uint64_t exclude);
+
+	 // Us. until a token or probe (see delay), 0 if none (Lock held).
+
+	uint64_t		wait_us(uint64_t exclude);
+
+	 // Multiplicative decrease, of the rate too if throttled.
+
+	void			back_off(State &s, uint64_t now, bool throttled);
+
+};
+
+#endif /* RELAYROUTER_HH_ */
@@ -0,0 +1,572 @@
+/*
+ * Mail-Sending Program
+ * Resolver.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+#include "Resolver.hh"
+#include <algorithm>
+#include <utility>
+#include <cstring>
+#include <cerrno>
+#include <climits>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <arpa/nameser.h>
+#include <resolv.h>
+
+using namespace std;
+
+/*
+ * @args:	max. secs. to cache an answer (int ttl)
+ * 			secs. to cache a failed lookup (int negative_ttl)
+ */
+Resolver::Resolver(int ttl, int negative_ttl):
+	Ttl(ttl), NegativeTtl(negative_ttl), UseNameserver(false),
+	Lookups(0), Hits(0)
+{
+
+	memset(&Nameserver, 0, sizeof(Nameserver));
+
+}
+
+/*
+ * @return:	process-wide resolver (Resolver &)
+ */
+Resolver &
+Resolver::shared()
+{
+
+	static Resolver		resolver;
+
+	return resolver;
+
+}
+
+/*
+ * Addresses of a host, IPv4 and/or IPv6, in the order to try them.
+ * @args:	hostname or numeric address (const string &host)
+ * 			port to put in the addresses (int port)
+ * 			addresses (vector<Address> &addrs)
+ * @return:	0 (success, at least one address)
+ * - error: -1 (errno: EHOSTUNREACH no such host, EAGAIN temporary
+ * 			failure; both cached, see Resolver)
+ */
+int
+Resolver::resolve(const string &host, int port, vector<Address> &addrs)
+{
+
+	Entry			entry;
+
+	if (lookup(host, false, entry) != 0)
+
+		return -1;
+
+	addrs = entry.addrs;
+
+	for (size_t i = 0; i < addrs.size(); i++) {
+
+		if (addrs[i].addr.ss_family == AF_INET6)
+
+			((sockaddr_in6 *)&addrs[i].addr)->sin6_port = htons(port);
+
+		else
+
+			((sockaddr_in *)&addrs[i].addr)->sin_port = htons(port);
+
+	}
+
+	return 0;
+
+}
+
+/*
+ * Mail exchangers of a domain, for delivery straight to it: the MX
+ * hosts in order of preference or, if it has no MX record, the
+ * domain itself (implicit MX, RFC 5321 5.1).
+ * @args:	mail domain (const string &domain)
+ * 			MX hostnames (vector<string> &hosts)
+ * @return:	0 (success)
+ * - error: -1 (errno: EHOSTUNREACH no such domain, or "null MX",
+ * 			RFC 7505: the domain accepts no mail; EAGAIN temporary
+ * 			failure)
+ */
+int
+Resolver::resolve_mx(const string &domain, vector<string> &hosts)
+{
+
+	Entry			entry;
+
+	if (lookup(domain, true, entry) != 0)
+
+		return -1;
+
+	hosts = entry.hosts;
+
+	return 0;
+
+}
+
+/*
+ * Query this nameserver instead of the system's resolver: A, AAAA
+ * and MX records are asked for directly, and their TTLs are used.
+ * Cached answers are dropped.
+ * @args:	IPv4 address of the nameserver (const string &ip)
+ * 			UDP/TCP port (int port)
+ * @return:	0 (success)
+ * - error: -1 (not an IPv4 address, errno EINVAL)
+ */
+int
+Resolver::set_nameserver(const string &ip, int port)
+{
+
+	sockaddr_in		ns;
+
+	memset(&ns, 0, sizeof(ns));
+	ns.sin_family = AF_INET;
+	ns.sin_port = htons(port);
+
+	if (inet_pton(AF_INET, ip.c_str(), &ns.sin_addr) != 1) {
+
+		errno = EINVAL;
+		return -1;
+
+	}
+
+	lock_guard<mutex>	guard(Lock);
+
+	Nameserver = ns;
+	UseNameserver = true;
+	Cache.clear();
+
+	return 0;
+
+}
+
+/*
+ * @args:	max. secs. to cache an answer (int ttl)
+ * 			secs. to cache a failed lookup (int negative_ttl)
+ */
+void
+Resolver::set_ttls(int ttl, int negative_ttl)
+{
+
+	lock_guard<mutex>	guard(Lock);
+
+	Ttl = ttl;
+	NegativeTtl = negative_ttl;
+
+}
+
+/*
+ * Forget all cached answers; lookups in progress are kept.
+ */
+void
+Resolver::flush()
+{
+
+	lock_guard<mutex>	guard(Lock);
+	map<string, Entry>::iterator	e;
+
+	for (e = Cache.begin(); e != Cache.end(); ) {
+
+		if (e->second.pending)
+
+			++e;
+
+		else
+
+			Cache.erase(e++);
+
+	}
+
+}
+
+/*
+ * Cached answer for a name, if it has not expired. Otherwise look
+ * the name up, w/o holding the lock, and cache the answer. A thread
+ * that finds a lookup of the name in progress waits for its answer.
+ * @args:	hostname/domain (const string &name)
+ * 			MX (true) or address (false) lookup
+ * 			answer (Entry &entry)
+ * @return:	0 (success)
+ * - error: -1 (errno set, see resolve)
+ */
+int
+Resolver::lookup(const string &name, bool mx, Entry &entry)
+{
+
+	unique_lock<mutex>	guard(Lock);
+	string			key = (mx ? "MX " : "A ") + name;
+	map<string, Entry>::iterator	e;
+
+	while ((e = Cache.find(key)) != Cache.end()) {
+
+		if (e->second.pending) {
+
+			Resolved.wait(guard);		// Another thread's lookup
+			continue;
+
+		}
+
+		if (e->second.expires <= now())
+
+			break;		// Stale
+
+		Hits++;
+		entry = e->second;
+		errno = entry.error;
+
+		return entry.error == 0 ? 0 : -1;
+
+	}
+
+	Cache[key].pending = true;
+	guard.unlock();
+
+	if (mx)
+
+		query_mx(name, entry);
+
+	else
+
+		query_addrs(name, entry);
+
+	Lookups++;
+	entry.pending = false;
+
+	guard.lock();
+	Cache[key] = entry;
+	Resolved.notify_all();
+
+	errno = entry.error;
+
+	return entry.error == 0 ? 0 : -1;
+
+}
+
+/*
+ * Look up the addresses of a host. Numeric addresses and, w/o a
+ * nameserver set, all names go through getaddrinfo() (hosts file,
+ * system resolver), whose answers carry no TTL and are kept for
+ * Ttl seconds. W/ a nameserver set, AAAA and A records are asked
+ * for and kept for the lowest TTL among them.
+ * @args:	hostname (const string &host), answer (Entry &entry)
+ */
+void
+Resolver::query_addrs(const string &host, Entry &entry)
+{
+
+	addrinfo		hints,
+					*res,
+					*ai;
+	Address			addr;
+	unsigned char	answer[NS_PACKETSZ * 4];
+	int				len,
+					herror,
+					gai,
+					ttl,
+					negative,
+					types[2] = { ns_t_aaaa, ns_t_a };
+	bool			use_ns;
+	ns_msg			msg;
+	ns_rr			rr;
+
+	{
+		lock_guard<mutex>	guard(Lock);
+
+		ttl = Ttl;
+		negative = NegativeTtl;
+		use_ns = UseNameserver;
+	}
+
+	entry.addrs.clear();
+	entry.error = 0;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = use_ns ? AI_NUMERICHOST : 0;
+
+	if ((gai = getaddrinfo(host.c_str(), NULL, &hints, &res)) == 0) {
+
+		for (ai = res; ai != NULL; ai = ai->ai_next) {
+
+			memset(&addr, 0, sizeof(addr));
+			memcpy(&addr.addr, ai->ai_addr, ai->ai_addrlen);
+			addr.len = ai->ai_addrlen;
+			entry.addrs.push_back(addr);
+
+		}
+
+		freeaddrinfo(res);
+		entry.expires = now() + ttl;
+		return;
+
+	}
+
+	if (!use_ns) {
+
+		// EAI_AGAIN: no answer from the nameserver (yet); EAI_SYSTEM,
+		// EAI_MEMORY: out of resources here. Worth trying again soon.
+		if (gai == EAI_AGAIN || gai == EAI_SYSTEM || gai == EAI_MEMORY) {
+
+			entry.error = EAGAIN;
+			entry.expires = now() + TransientTtl;
+
+		}
+		else {
+
+			entry.error = EHOSTUNREACH;
+			entry.expires = now() + negative;
+
+		}
+
+		return;
+
+	}
+
+	herror = HOST_NOT_FOUND;
+
+	for (int t = 0; t < 2; t++) {
+
+		int		err;
+
+		if ((len = query(host, types[t], answer, sizeof(answer), err)) < 0) {
+
+			if (err == TRY_AGAIN)
+
+				herror = TRY_AGAIN;
+
+			continue;
+
+		}
+
+		ns_initparse(answer, len, &msg);
+
+		for (int i = 0; i < ns_msg_count(msg, ns_s_an); i++) {
+
+			if (ns_parserr(&msg, ns_s_an, i, &rr) != 0 ||
+				ns_rr_type(rr) != types[t])
+
+				continue;	// E.g. CNAME on the way
+
+			memset(&addr, 0, sizeof(addr));
+
+			if (types[t] == ns_t_aaaa && ns_rr_rdlen(rr) == 16) {
+
+				sockaddr_in6	*sin6 = (sockaddr_in6 *)&addr.addr;
+
+				sin6->sin6_family = AF_INET6;
+				memcpy(&sin6->sin6_addr, ns_rr_rdata(rr), 16);
+				addr.len = sizeof(*sin6);
+
+			}
+			else if (types[t] == ns_t_a && ns_rr_rdlen(rr) == 4) {
+
+				sockaddr_in		*sin = (sockaddr_in *)&addr.addr;
+
+				sin->sin_family = AF_INET;
+				memcpy(&sin->sin_addr, ns_rr_rdata(rr), 4);
+				addr.len = sizeof(*sin);
+
+			}
+			else
+
+				continue;
+
+			entry.addrs.push_back(addr);
+			ttl = min(ttl, (int)ns_rr_ttl(rr));
+
+		}
+
+	}
+
+	if (entry.addrs.empty()) {
+
+		entry.error = herror == TRY_AGAIN ? EAGAIN : EHOSTUNREACH;
+		entry.expires = now() + (herror == TRY_AGAIN ? TransientTtl : negative);
+		return;
+
+	}
+
+	entry.expires = now() + ttl;
+
+}
+
+/*
+ * Look up the MX records of a domain and order the hosts by
+ * preference. The answer is kept for the lowest TTL among them.
+ * @args:	mail domain (const string &domain), answer (Entry &entry)
+ */
+void
+Resolver::query_mx(const string &domain, Entry &entry)
+{
+
+	unsigned char	answer[NS_PACKETSZ * 4];
+	char			host[NS_MAXDNAME];
+	vector<pair<int, string> >	mx;		// (preference, host)
+	int				len,
+					herror,
+					ttl,
+					negative;
+	ns_msg			msg;
+	ns_rr			rr;
+
+	{
+		lock_guard<mutex>	guard(Lock);
+
+		ttl = Ttl;
+		negative = NegativeTtl;
+	}
+
+	entry.hosts.clear();
+	entry.error = 0;
+
+	if ((len = query(domain, ns_t_mx, answer, sizeof(answer), herror)) < 0) {
+
+		if (herror == NO_DATA) {
+
+			// Domain w/o MX: its own address is the exchanger.
+			entry.hosts.push_back(domain);
+			entry.expires = now() + ttl;
+
+		}
+		else {
+
+			entry.error = herror == TRY_AGAIN ? EAGAIN : EHOSTUNREACH;
+			entry.expires = now() + (herror == TRY_AGAIN ? TransientTtl
+														 : negative);
+
+		}
+
+		return;
+
+	}
+
+	ns_initparse(answer, len, &msg);
+
+	for (int i = 0; i < ns_msg_count(msg, ns_s_an); i++) {
+
+		if (ns_parserr(&msg, ns_s_an, i, &rr) != 0 ||
+			ns_rr_type(rr) != ns_t_mx || ns_rr_rdlen(rr) < 3 ||
+			dn_expand(ns_msg_base(msg), ns_msg_end(msg),
+					  ns_rr_rdata(rr) + 2, host, sizeof(host)) < 0)
+
+			continue;
+
+		mx.push_back(make_pair((int)ns_get16(ns_rr_rdata(rr)), string(host)));
+		ttl = min(ttl, (int)ns_rr_ttl(rr));
+
+	}
+
+	stable_sort(mx.begin(), mx.end());
+
+	for (size_t i = 0; i < mx.size(); i++)
+
+		entry.hosts.push_back(mx[i].second);
+
+	// Null MX, "0 ." (RFC 7505): no mail for this domain.
+	if (entry.hosts.empty() ||
+		(entry.hosts.size() == 1 && entry.hosts[0].empty())) {
+
+		entry.hosts.clear();
+		entry.error = EHOSTUNREACH;
+		entry.expires = now() + negative;
+		return;
+
+	}
+
+	entry.expires = now() + ttl;
+
+}
+
+/*
+ * Send a DNS query (class IN) to the configured nameserver, or the
+ * system's ones, w/ a private resolver state (thread-safe).
+ * @args:	name, record type (ns_t_a, ns_t_aaaa, ns_t_mx)
+ * 			answer buffer (unsigned char *answer, int size)
+ * 			resolver error (int &herror): HOST_NOT_FOUND
+ * 			(NXDOMAIN), NO_DATA (no such record), TRY_AGAIN...
+ * @return:	length of the answer
+ * - error: -1 (see herror)
+ */
+int
+Resolver::query(const string &name, int type,
+				unsigned char *answer, int size, int &herror)
+{
+
+	struct __res_state	state;
+	int				len;
+
+	memset(&state, 0, sizeof(state));
+
+	if (res_ninit(&state) != 0) {
+
+		herror = NO_RECOVERY;
+		return -1;
+
+	}
+
+	{
+		lock_guard<mutex>	guard(Lock);
+
+		if (UseNameserver) {
+
+			state.nsaddr_list[0] = Nameserver;
+			state.nscount = 1;
+
+		}
+	}
+
+	len = res_nquery(&state, name.c_str(), ns_c_in, type, answer, size);
+	herror = state.res_h_errno;
+	res_nclose(&state);
+
+	return len;
+
+}
+
+/*
+ * @return:	seconds on the monotonic clock
+ */
+time_t
+Resolver::now()
+{
+
+	timespec		ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec;
+
+}
@@ -0,0 +1,165 @@
+/*
+ * Mail-Sending Program
+ * Resolver.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+
+#ifndef RESOLVER_HH_
+#define RESOLVER_HH_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <ctime>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+using namespace std;
+
+/*
+ * Resolver object
+ * Thread-safe, caching name resolution for relay hosts:
+ * 	- resolve: addresses of a host (IPv4 and IPv6), w/ getaddrinfo(),
+ * 	  or by querying the configured nameserver for AAAA/A records
+ * 	- resolve_mx: mail exchangers of a domain, by preference, for
+ * 	  direct-to-domain delivery (MX records, RFC 5321 5.1)
+ * Answers, including failures, are cached: DNS answers for the TTL
+ * of their records (at most Ttl seconds), getaddrinfo() answers for
+ * Ttl seconds, failures for NegativeTtl seconds; temporary failures
+ * (EAGAIN) only for TransientTtl, so one lost DNS answer does not
+ * fail the sends to a host for long. Threads asking for
+ * a name that is already being looked up wait for that lookup
+ * instead of starting their own.
+ * set_nameserver() sends every query to one server, e.g. a local
+ * stub DNS server (see bench/DnsCheck.cc).
+ * @methods:	resolve, resolve_mx, set_nameserver, set_ttls, flush,
+ * 				lookups/hits (counters)
+ */
+class Resolver
+{
+  public:
+
+	 // One address of a host, port set by resolve().
+
+	struct Address {
+		sockaddr_storage	addr;
+		socklen_t			len;
+	};
+
+	enum { DefaultTtl = 300,			// Max. secs. to cache an answer
+		   DefaultNegativeTtl = 30,		// Secs. to cache a failure
+		   TransientTtl = 1 };			// Secs. to cache a temporary one
+
+			 Resolver(int ttl = DefaultTtl,
+					  int negative_ttl = DefaultNegativeTtl);
+			~Resolver() { }
+
+	 // Resolver shared by all senders (of all threads).
+
+	static Resolver	&shared();
+
+	 // Addresses of a host, for a port.
+
+	int				resolve(const string &host, int port,
+							vector<Address> &addrs);
+
+	 // Mail exchangers of a domain, most preferred first.
+
+	int				resolve_mx(const string &domain,
+							   vector<string> &hosts);
+
+	 // Send all queries to this nameserver (IPv4 address).
+
+	int				set_nameserver(const string &ip, int port = 53);
+
+	void			set_ttls(int ttl, int negative_ttl);
+
+	 // Forget all cached answers.
+
+	void			flush();
+
+	 // Lookups done, answers taken from the cache.
+
+	size_t			lookups() const { return Lookups; }
+
+	size_t			hits() const { return Hits; }
+
+  private:
+
+	 // Cached answer, or lookup in progress.
+
+	struct Entry {
+		vector<Address>	addrs;		// resolve()
+		vector<string>	hosts;		// resolve_mx()
+		int				error;		// errno, 0: success
+		time_t			expires;	// Monotonic secs.
+		bool			pending;	// Lookup in progress
+	};
+
+	mutex			Lock;			// Guards Cache, settings
+	condition_variable	Resolved;	// A pending lookup finished
+	map<string, Entry>	Cache;		// "A name" / "MX name"
+	int				Ttl,
+					NegativeTtl;
+	bool			UseNameserver;
+	sockaddr_in		Nameserver;
+	atomic<size_t>	Lookups,
+					Hits;
+
+	 // Cached answer, or look it up (once for all threads).
+
+	int				lookup(const string &name, bool mx, Entry &entry);
+
+	 // Addresses w/ getaddrinfo(), or from the nameserver.
+
+	void			query_addrs(const string &host, Entry &entry);
+
+	 // MX records.
+
+	void			query_mx(const string &domain, Entry &entry);
+
+	 // Send one DNS query, walk the records of the answer.
+
+	int				query(const string &name, int type,
+						  unsigned char *answer, int size,
+						  int &herror);
+
+	static time_t	now();
+
+};
+
+#endif /* RESOLVER_HH_ */
@@ -0,0 +1,402 @@
+/*
+ * Mail-Sending Program
+ * SmtpData.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+#include "SmtpData.hh"
+#include <string>
+#include <cstring>
+#include <strings.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SMTPDATA_X86 1
+#endif
+
+using namespace std;
+
+/*
+ * Scalar kernel: offset of the first LF in p[0..len), or len.
+ */
+static size_t
+FindLFScalar(const char *p, size_t len)
+{
+
+	const void		*lf = memchr(p, '\n', len);
+
+	return lf == NULL ? len : (const char *)lf - p;
+
+}
+
+#ifdef SMTPDATA_X86
+
+/*
+ * SSE2 kernel: compare 16 bytes at a time against '\n', the first
+ * set bit of the comparison mask is the offset of the LF.
+ */
+__attribute__((target("sse2")))
+static size_t
+FindLFSse2(const char *p, size_t len)
+{
+
+	const __m128i	lf = _mm_set1_epi8('\n');
+	size_t			i = 0;
+	int				mask;
+
+	for (; i + 16 <= len; i += 16) {
+
+		mask = _mm_movemask_epi8(
+				_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + i)),
+							   lf));
+
+		if (mask != 0)
+
+			return i + __builtin_ctz(mask);
+
+	}
+
+	for (; i < len; i++) {		// Tail, < 16 bytes
+
+		if (p[i] == '\n')
+
+			return i;
+
+	}
+
+	return len;
+
+}
+
+/*
+ * AVX2 kernel: as the SSE2 kernel, 32 bytes at a time.
+ */
+__attribute__((target("avx2")))
+static size_t
+FindLFAvx2(const char *p, size_t len)
+{
+
+	const __m256i	lf = _mm256_set1_epi8('\n');
+	size_t			i = 0;
+	unsigned int	mask;
+
+	for (; i + 32 <= len; i += 32) {
+
+		mask = _mm256_movemask_epi8(
+				_mm256_cmpeq_epi8(
+						_mm256_loadu_si256((const __m256i *)(p + i)), lf));
+
+		if (mask != 0)
+
+			return i + __builtin_ctz(mask);
+
+	}
+
+	for (; i < len; i++) {		// Tail, < 32 bytes
+
+		if (p[i] == '\n')
+
+			return i;
+
+	}
+
+	return len;
+
+}
+
+#endif /* SMTPDATA_X86 */
+
+/*
+ * Select the encoder kernel. Auto picks the best the CPU supports;
+ * a kernel the CPU (or build) lacks falls back to scalar.
+ * @args:	kernel to use (Kernel kernel), Auto by default
+ */
+SmtpDataEncoder::SmtpDataEncoder(Kernel kernel)
+{
+
+	if (kernel == Auto)
+
+		kernel = best_kernel();
+
+	Selected = Scalar;
+	Find = FindLFScalar;
+	DotStuffing = true;
+
+#ifdef SMTPDATA_X86
+	__builtin_cpu_init();
+
+	if (kernel == Avx2 && __builtin_cpu_supports("avx2")) {
+
+		Selected = Avx2;
+		Find = FindLFAvx2;
+
+	}
+	else if (kernel == Sse2 && __builtin_cpu_supports("sse2")) {
+
+		Selected = Sse2;
+		Find = FindLFSse2;
+
+	}
+#endif
+
+	reset();
+
+}
+
+/*
+ * Best kernel supported by this CPU.
+ * @return:	Avx2, Sse2 or Scalar (Kernel)
+ */
+SmtpDataEncoder::Kernel
+SmtpDataEncoder::best_kernel()
+{
+
+#ifdef SMTPDATA_X86
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2"))
+
+		return Avx2;
+
+	if (__builtin_cpu_supports("sse2"))
+
+		return Sse2;
+#endif
+
+	return Scalar;
+
+}
+
+/*
+ * Name of the kernel in use, for reports.
+ * @return:	"scalar", "sse2" or "avx2"
+ */
+const char *
+SmtpDataEncoder::kernel_name() const
+{
+
+	switch (Selected) {
+
+	case Avx2:
+		return "avx2";
+
+	case Sse2:
+		return "sse2";
+
+	default:
+		return "scalar";
+
+	}
+
+}
+
+/*
+ * Encode a chunk of message text. Runs of bytes between line ends
+ * are copied as a block; only line ends and the byte after them
+ * are looked at one by one.
+ * 	WHILE input left
+ * 		IF at line start AND byte == '.' THEN write '.' (DATA form)
+ * 		find next LF (kernel), copy bytes up to it
+ * 		IF no LF THEN remember whether last byte was CR, done
+ * 		IF byte before LF != CR THEN write CR
+ * 		write LF, now at line start
+ * @args:	input chunk (const char *in, size_t len)
+ * 			output buffer, >= max_output(len) bytes (char *out)
+ * @return:	# bytes written to out
+ */
+size_t
+SmtpDataEncoder::encode(const char *in, size_t len, char *out)
+{
+
+	char			*o = out;
+	size_t			i = 0,		// Position in input
+					n;			// Bytes up to next LF
+
+	while (i < len) {
+
+		if (AtLineStart) {
+
+			AtLineStart = false;
+
+			if (in[i] == '.' && DotStuffing)
+
+				*o++ = '.';		// Dot-stuffing
+
+		}
+
+		n = Find(in + i, len - i);
+		memcpy(o, in + i, n);
+		o += n;
+
+		if (i + n == len) {		// Line continues in next chunk
+
+			if (n > 0)
+
+				PrevCR = in[len - 1] == '\r';
+
+			break;
+
+		}
+
+		// Bare LF: insert CR. (CR may have ended the last chunk.)
+		if (n > 0 ? in[i + n - 1] != '\r' : !PrevCR)
+
+			*o++ = '\r';
+
+		*o++ = '\n';
+		PrevCR = false;
+		AtLineStart = true;
+		i += n + 1;
+
+	}
+
+	return o - out;
+
+}
+
+/*
+ * End of message: terminate a last line that has no line ending,
+ * then write the end of data indicator ".<CRLF>" (DATA form only).
+ * @args:	output buffer, >= MaxFinish bytes (char *out)
+ * @return:	# bytes written to out
+ */
+size_t
+SmtpDataEncoder::finish(char *out)
+{
+
+	char			*o = out;
+
+	if (!AtLineStart) {
+
+		if (!PrevCR)
+
+			*o++ = '\r';
+
+		*o++ = '\n';
+
+	}
+
+	if (DotStuffing) {
+
+		*o++ = '.';
+		*o++ = '\r';
+		*o++ = '\n';
+
+	}
+
+	reset();
+
+	return o - out;
+
+}
+
+/*
+ * Read the message header, up to and including the blank line that
+ * separates it from the body, leaving fin at the start of the body.
+ * Bcc: fields (and their folded continuation lines) are dropped:
+ * the Bcc recipients are in the envelope only. Lines are returned
+ * w/ LF endings, ready for SmtpDataEncoder.
+ * @args:	message stream (istream &fin)
+ * 			header w/o Bcc: fields (string &header)
+ */
+void
+ReadDataHeader(istream &fin, string &header)
+{
+
+	string			line;
+	bool			in_bcc = false;		// In a Bcc: field
+
+	header.clear();
+
+	while (getline(fin, line)) {
+
+		if (!line.empty() && line[line.length() - 1] == '\r')
+
+			line.erase(line.length() - 1);		// CRLF file
+
+		if (line.empty()) {
+
+			header.append("\n");		// Blank line ends header
+			break;
+
+		}
+
+		if (line[0] != ' ' && line[0] != '\t')
+
+			in_bcc = strncasecmp(line.c_str(), "Bcc:", 4) == 0;
+
+		if (in_bcc)
+
+			continue;		// Bcc: field and its folded lines
+
+		header.append(line);
+		header.append("\n");
+
+	}
+
+}
+
+/*
+ * Find the end of the header of a message in memory: the blank
+ * line (LF or CRLF) after the last field, or right at the start
+ * (a message w/o header).
+ * @args:	message text, or its start (const char *text, size_t len)
+ * @return:	header length, blank line included (size_t)
+ * 			0 (no blank line in text)
+ */
+size_t
+DataHeaderEnd(const char *text, size_t len)
+{
+
+	const char		*p = text,
+					*end = text + len;
+
+	// Each line end: is the next line blank?
+	for (; p < end; p++) {
+
+		if (*p == '\n')
+
+			return p + 1 - text;
+
+		if (*p == '\r' && p + 1 < end && p[1] == '\n')
+
+			return p + 2 - text;
+
+		if ((p = (const char *)memchr(p, '\n', end - p)) == NULL)
+
+			break;
+
+	}
+
+	return 0;
+
+}
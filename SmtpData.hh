@@ -0,0 +1,128 @@
+/*
+ * Mail-Sending Program
+ * SmtpData.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+#ifndef SMTPDATA_HH_
+#define SMTPDATA_HH_
+
+#include <istream>
+#include <string>
+#include <cstddef>
+
+using namespace std;
+
+/*
+ * SmtpDataEncoder object
+ * Streaming transform of message text into SMTP DATA form
+ * (RFC 5321, 4.5.2):
+ * 	- bare LF line endings become CRLF (CRLF is left alone)
+ * 	- a '.' at the beginning of a line is doubled (dot-stuffing)
+ * 	- finish() ends the last line and adds the ".<CRLF>" terminator
+ * W/o dot-stuffing (see set_dot_stuffing) it gives BDAT form
+ * (RFC 3030) instead: line endings only, no terminator, as chunks
+ * are sent w/ their length.
+ * Input may be fed in chunks of any size: a CR/LF pair or a line
+ * start split between two chunks is handled by the encoder state.
+ * Output goes to a caller-supplied buffer of at least
+ * max_output(len) bytes, so a sender can reuse one buffer for
+ * every chunk of every message.
+ * Line ends are located 16 (SSE2) or 32 (AVX2) bytes at a time;
+ * the kernel is selected at run time from what the CPU supports,
+ * w/ a portable scalar fallback.
+ */
+class SmtpDataEncoder
+{
+  public:
+
+	enum Kernel { Auto, Scalar, Sse2, Avx2 };
+
+			 SmtpDataEncoder(Kernel kernel = Auto);
+
+	 // Largest output encode() can produce for len bytes of input.
+
+	static size_t	max_output(size_t len) { return 2 * len; }
+
+	 // Largest output finish() can produce.
+
+	enum { MaxFinish = 5 };		// <CRLF>.<CRLF>
+
+	 // Encode a chunk of message text, return # bytes written.
+
+	size_t			encode(const char *in, size_t len, char *out);
+
+	 // End of message: terminate last line, add ".<CRLF>".
+
+	size_t			finish(char *out);
+
+	 // Start a new message.
+
+	void			reset() { AtLineStart = true; PrevCR = false; }
+
+	 // DATA form (true, the default) or BDAT form (false).
+
+	void			set_dot_stuffing(bool on) { DotStuffing = on; }
+
+	 // Kernel in use: "scalar", "sse2" or "avx2".
+
+	const char		*kernel_name() const;
+
+	 // Best kernel this CPU supports.
+
+	static Kernel	best_kernel();
+
+  private:
+
+	typedef size_t	(*FindLF)(const char *p, size_t len);
+
+	bool			AtLineStart;	// Next byte begins a line
+	bool			PrevCR;			// Last byte seen was CR
+	bool			DotStuffing;	// '.' doubled, terminator added
+	Kernel			Selected;		// Kernel in use
+	FindLF			Find;			// Offset of next LF, or len
+
+};
+
+// Read a message header (through the blank line that ends it) w/o
+
+// its Bcc: fields, each line terminated w/ LF.
+
+void			ReadDataHeader(istream &fin, string &header);
+
+// Length of the header at the start of text, through the blank
+
+// line that ends it; 0 if that line is not in text.
+
+size_t			DataHeaderEnd(const char *text, size_t len);
+
+#endif /* SMTPDATA_HH_ */
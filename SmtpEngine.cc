@@ -0,0 +1,1551 @@
+/*
+ * Mail-Sending Program
+ * SmtpEngine.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+#include "SmtpEngine.hh"
+#include "MailSenderSmtp.hh"
+#include "WireFile.hh"
+#include "Resolver.hh"
+#include "Connector.hh"
+#include "Logger.hh"
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <ctime>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/sendfile.h>
+
+using namespace std;
+
+const int		MaxEvents = 256;	// Events per epoll_wait
+const int		CheckEvery = 100;	// ms between timeout checks
+
+/*
+ * Message queued or in delivery.
+ */
+struct SmtpEngine::Entry
+{
+	unsigned long	id;
+	Job				job;
+};
+
+/*
+ * Relay (host, port): its queue of messages and sessions.
+ */
+struct SmtpEngine::Relay
+{
+	string			host;
+	int				port;
+	int				sessions,		// Open sessions
+					starting;		// Sessions not yet ready
+	deque<Entry *>	queue;			// Messages waiting for a session
+	list<Session *>	idle;			// Sessions waiting for messages
+};
+
+/*
+ * Non-blocking connect of a session to one address of its relay.
+ */
+struct SmtpEngine::Attempt
+{
+	int				fd;
+	size_t			addr;			// Index in the session's addrs
+	long			deadline;		// ms
+};
+
+/*
+ * One connection and the state of its current transaction.
+ */
+struct SmtpEngine::Session
+{
+	int				fd;				// -1 while Connecting
+	Relay			*relay;
+	State			state;
+	long			deadline;		// ms, for the current state
+	unsigned int	events;			// epoll interest
+	bool			ready;			// Greeted & introduced
+	unsigned int	ext;			// ESMTP extensions
+	int				sent;			// Transactions started
+	string			domain;			// EHLO domain
+	SmtpReplyReader	reader;			// Received, not yet handled
+	string			wbuf;			// To write
+	size_t			woff;			// Written part of wbuf
+
+	// Connecting
+	vector<Resolver::Address>	addrs;	// Relay's, in Connector order
+	size_t			next_addr;		// Next one to try
+	vector<Attempt>	attempts;		// In flight
+	long			started,		// Connect, ms
+					next_attempt;	// ms, next address if none won
+	int				error;			// Of the last attempt to fail
+
+	// Current transaction
+	Entry			*job;
+	Result			res;
+	vector<string>	cmds;			// [RSET] MAIL RCPT... DATA
+	size_t			next_cmd,		// Next command to write
+					replies;		// Replies received
+	int				first_rcpt;		// Index of 1st RCPT in cmds
+	bool			mail_ok,		// MAIL FROM accepted
+					aborted,		// Data refused by us
+					body_done;		// All data in wbuf
+	int				accepted;		// Recipients accepted
+	int				throttled;		// 421/451 seen (session's life)
+
+	// Message data
+	int				wirefd;			// Wire file, or -1
+	off_t			offset,			// Wire data left to send
+					remaining;
+	ifstream		fin;			// Plain file
+	bool			header_done;
+	SmtpDataEncoder	encoder;
+};
+
+/*
+ * Create the epoll instance.
+ * @args:	max. sessions in total (int max_sessions)
+ * 			max. sessions per relay (int max_per_relay)
+ */
+SmtpEngine::SmtpEngine(int max_sessions, int max_per_relay):
+	MaxSessions(max_sessions), MaxPerRelay(max_per_relay),
+	MaxPerConn(DefaultMaxPerConn), Sessions(0),
+	ConnectTimeout(30), ReadTimeout(300), WriteTimeout(180),
+	FinalTimeout(600), IdleTimeout(30),
+	NextId(1), Pending(0), LastCheck(0),
+	In(DataChunk),
+	Out(SmtpDataEncoder::max_output(DataChunk) + SmtpDataEncoder::MaxFinish)
+{
+
+	Epfd = epoll_create1(EPOLL_CLOEXEC);
+
+}
+
+/*
+ * Close every session (idle ones w/ a best-effort QUIT) and drop
+ * messages not yet delivered.
+ */
+SmtpEngine::~SmtpEngine()
+{
+
+	map<pair<string, int>, Relay *>::iterator	r;
+
+	for (list<Session *>::iterator s = All.begin(); s != All.end(); ++s) {
+
+		if ((*s)->state == Idle &&
+			write((*s)->fd, "QUIT\r\n", 6) < 0) { }
+
+		if ((*s)->state != Closed) {
+
+			abandon(*s);
+
+			if ((*s)->fd >= 0)
+
+				close((*s)->fd);
+
+		}
+
+		if ((*s)->job != NULL)
+
+			delete (*s)->job;
+
+		if ((*s)->wirefd >= 0)
+
+			close((*s)->wirefd);
+
+		delete *s;
+
+	}
+
+	for (r = Relays.begin(); r != Relays.end(); ++r) {
+
+		for (size_t i = 0; i < r->second->queue.size(); i++)
+
+			delete r->second->queue[i];
+
+		delete r->second;
+
+	}
+
+	close(Epfd);
+
+}
+
+/*
+ * Set the timeouts, in seconds.
+ * @args:	connect, read (waiting for a reply), write (waiting for
+ * 			the socket to drain), final reply to the message data,
+ * 			idle session before QUIT
+ */
+void
+SmtpEngine::set_timeouts(int connect, int read, int write,
+						 int final, int idle)
+{
+
+	ConnectTimeout = connect;
+	ReadTimeout = read;
+	WriteTimeout = write;
+	FinalTimeout = final;
+	IdleTimeout = idle;
+
+}
+
+/*
+ * Queue a message for delivery to its relay. Nothing is sent until
+ * run() is called.
+ * @args:	message (const Job &job)
+ * @return:	id of the message, also in its Result
+ */
+unsigned long
+SmtpEngine::submit(const Job &job)
+{
+
+	Entry			*entry = new Entry;
+	Relay			*&relay = Relays[make_pair(job.host, job.port)];
+
+	if (relay == NULL) {
+
+		relay = new Relay;
+		relay->host = job.host;
+		relay->port = job.port;
+		relay->sessions = 0;
+		relay->starting = 0;
+
+	}
+
+	entry->id = NextId++;
+	entry->job = job;
+	relay->queue.push_back(entry);
+	Pending++;
+
+	return entry->id;
+
+}
+
+/*
+ * Collect the result of any finished message.
+ * @args:	result (Result &result)
+ * @return:	true (result collected), false (none ready)
+ */
+bool
+SmtpEngine::complete(Result &result)
+{
+
+	if (Done.empty())
+
+		return false;
+
+	result = Done.front();
+	Done.pop_front();
+	Pending--;
+
+	return true;
+
+}
+
+/*
+ * Collect the result of a given message.
+ * @args:	id from submit (unsigned long id), result (Result &)
+ * @return:	true (result collected), false (not finished)
+ */
+bool
+SmtpEngine::complete(unsigned long id, Result &result)
+{
+
+	for (deque<Result>::iterator d = Done.begin(); d != Done.end(); ++d) {
+
+		if (d->id == id) {
+
+			result = *d;
+			Done.erase(d);
+			Pending--;
+			return true;
+
+		}
+
+	}
+
+	return false;
+
+}
+
+/*
+ * Event loop: start sessions for queued messages, wait for socket
+ * events and run each session's state machine on them, fail
+ * sessions past their deadline.
+ * @args:	ms to wait for events (int timeout_ms), -1: loop until
+ * 			another message completes or nothing is left to do
+ * @return:	# of results ready to collect
+ */
+int
+SmtpEngine::run(int timeout_ms)
+{
+
+	epoll_event		ev[MaxEvents];
+	size_t			done = Done.size();
+	int				n,
+					wait;
+
+	do {
+
+		start_sessions();
+
+		if (timeout_ms < 0 && (Done.size() > done || Pending == Done.size()))
+
+			break;
+
+		// Wake up in time to check deadlines.
+		wait = (timeout_ms < 0 || timeout_ms > CheckEvery) ?
+			   CheckEvery : timeout_ms;
+
+		if ((n = epoll_wait(Epfd, ev, MaxEvents, wait)) < 0 &&
+			errno != EINTR)
+
+			break;
+
+		for (int i = 0; i < n; i++)
+
+			handle((Session *)ev[i].data.ptr, ev[i].events);
+
+		if (now_ms() - LastCheck >= CheckEvery)
+
+			check_timeouts();
+
+		reap();
+
+	} while (timeout_ms < 0);
+
+	return Done.size();
+
+}
+
+/*
+ * Put queued messages to work: first on idle sessions to their
+ * relay, then on new sessions, up to MaxPerRelay per relay and
+ * MaxSessions in total.
+ */
+void
+SmtpEngine::start_sessions()
+{
+
+	map<pair<string, int>, Relay *>::iterator	r;
+	Relay			*relay;
+	Session			*session;
+
+	for (r = Relays.begin(); r != Relays.end(); ++r) {
+
+		relay = r->second;
+
+		while (!relay->queue.empty() && !relay->idle.empty()) {
+
+			session = relay->idle.front();
+			relay->idle.pop_front();
+			next_job(session);
+
+		}
+
+		// One new session per message not yet covered by one.
+		while ((int)relay->queue.size() > relay->starting &&
+			   relay->sessions < MaxPerRelay &&
+			   Sessions < MaxSessions) {
+
+			if (connect_session(relay) != 0) {
+
+				// Unreachable relay: fail what is queued for it.
+				int		error = errno;
+
+				while (!relay->queue.empty() && relay->sessions == 0) {
+
+					Result	res;
+					Entry	*entry = relay->queue.front();
+
+					relay->queue.pop_front();
+					res.id = entry->id;
+					res.result = -1;
+					res.error = error;
+					res.rcpt_status.assign(entry->job.to.size(), -1);
+					res.throttled = 0;
+					res.user = entry->job.user;
+					Done.push_back(res);
+					delete entry;
+
+				}
+
+				break;
+
+			}
+
+		}
+
+	}
+
+}
+
+/*
+ * Open a session to a relay: resolve its address (see Resolver,
+ * answers are cached), order its addresses (see Connector: the
+ * address that won last for the relay first, families interleaved)
+ * and start a non-blocking connect to the first that takes one.
+ * The others are raced in the loop (see connecting).
+ * @args:	relay (Relay *relay)
+ * @return:	0 (connect started)
+ * - error: -1 (errno set, EHOSTUNREACH: no such host; or of the
+ * 			last address to fail)
+ */
+int
+SmtpEngine::connect_session(Relay *relay)
+{
+
+	Session			*session = new Session;
+	const string	&from = relay->queue.front()->job.from;
+
+	session->fd = -1;
+	session->relay = relay;
+	session->next_addr = 0;
+	session->started = now_ms();
+	session->error = EHOSTUNREACH;
+
+	if (Resolver::shared().resolve(relay->host, relay->port,
+								   session->addrs) != 0) {
+
+		delete session;
+		return -1;
+
+	}
+
+	Connector::shared().order(relay->host, relay->port, session->addrs);
+
+	if (attempt(session) != 0) {
+
+		int		saved = errno;
+
+		delete session;
+		errno = saved;
+		return -1;
+
+	}
+
+	session->events = 0;
+	session->ready = false;
+	session->ext = 0;
+	session->sent = 0;
+	session->throttled = 0;
+	session->domain = from.substr(from.find('@') + 1);
+	session->woff = 0;
+	session->job = NULL;
+	session->wirefd = -1;
+
+	All.push_back(session);
+	relay->sessions++;
+	relay->starting++;
+	Sessions++;
+
+	session->state = Connecting;
+	session->deadline = min(session->next_attempt,
+							session->attempts[0].deadline);
+
+	return 0;
+
+}
+
+/*
+ * Start a connect attempt on the next address of a session, or on
+ * the one after if it fails at once, and so on. The socket is
+ * watched for writability, w/ the session as its epoll data.
+ * @args:	session (Session *session)
+ * @return:	0 (attempt in flight)
+ * - error: -1 (no address left, errno of the last to fail)
+ */
+int
+SmtpEngine::attempt(Session *session)
+{
+
+	Connector		&connector = Connector::shared();
+	Attempt			a;
+	epoll_event		ev;
+	long			t = now_ms();
+
+	while (session->next_addr < session->addrs.size()) {
+
+		const Resolver::Address	&addr = session->addrs[session->next_addr];
+
+		a.addr = session->next_addr++;
+
+		if ((a.fd = socket(addr.addr.ss_family, SOCK_STREAM |
+						   SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0) {
+
+			session->error = errno;
+			continue;
+
+		}
+
+		if (connect(a.fd, (const sockaddr *)&addr.addr, addr.len) != 0 &&
+			errno != EINPROGRESS) {
+
+			session->error = errno;
+			Logger::shared().print(LogInfo, "%s: %s: %s",
+								   session->relay->host.c_str(),
+								   Connector::format(addr).c_str(),
+								   strerror(session->error));
+			close(a.fd);
+			continue;
+
+		}
+
+		// Connected or not, epoll tells: writable.
+		ev.events = EPOLLOUT;
+		ev.data.ptr = session;
+		epoll_ctl(Epfd, EPOLL_CTL_ADD, a.fd, &ev);
+
+		a.deadline = t + connector.attempt_timeout();
+		session->attempts.push_back(a);
+		session->next_attempt = t + connector.attempt_delay();
+
+		return 0;
+
+	}
+
+	errno = session->error;
+
+	return -1;
+
+}
+
+/*
+ * Connect attempts of a session, on an event or when its deadline
+ * passed: the first attempt found connected wins, the others are
+ * closed and the session goes on to the greeting. A failed or timed
+ * out attempt is closed and the next address tried at once; while
+ * some are in flight, the next one is started after Connector's
+ * attempt delay. The session fails w/ the error of the last attempt
+ * when none is left, or w/ ETIMEDOUT past ConnectTimeout.
+ * @args:	session (Session *session), Connecting
+ */
+void
+SmtpEngine::connecting(Session *session)
+{
+
+	Relay			*relay = session->relay;
+	pollfd			pfd;
+	long			t = now_ms();
+	int				error,
+					one = 1;
+	socklen_t		len;
+	size_t			i;
+
+	for (i = 0; i < session->attempts.size(); ) {
+
+		Attempt		&a = session->attempts[i];
+
+		pfd.fd = a.fd;
+		pfd.events = POLLOUT;
+		pfd.revents = 0;
+
+		if (poll(&pfd, 1, 0) > 0) {
+
+			len = sizeof(error);
+
+			if (getsockopt(a.fd, SOL_SOCKET, SO_ERROR, &error, &len) != 0)
+
+				error = errno;
+
+			if (error == 0)
+
+				break;		// Connected: it wins
+
+		}
+		else if (t >= a.deadline)
+
+			error = ETIMEDOUT;
+
+		else {
+
+			i++;			// Still connecting
+			continue;
+
+		}
+
+		Logger::shared().print(LogInfo, "%s: %s: %s", relay->host.c_str(),
+							   Connector::format(session->addrs[a.addr]).c_str(),
+							   strerror(error));
+		close(a.fd);
+		session->attempts.erase(session->attempts.begin() + i);
+		session->error = error;
+		session->next_attempt = t;	// Failed: next address at once
+
+	}
+
+	if (i < session->attempts.size()) {
+
+		Attempt		a = session->attempts[i];
+
+		session->attempts.erase(session->attempts.begin() + i);
+		abandon(session);		// Lost the race
+		session->fd = a.fd;
+		session->events = EPOLLOUT;		// As added by attempt()
+		Connector::shared().won(relay->host, relay->port,
+								session->addrs[a.addr],
+								(t - session->started) * 1000);
+
+		// Commands are small writes waiting for replies (no Nagle).
+		setsockopt(session->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+		set_state(session, Greeting, ReadTimeout);
+		watch(session, EPOLLIN);
+		return;
+
+	}
+
+	if (t - session->started >= ConnectTimeout * 1000L) {
+
+		fail(session, ETIMEDOUT);
+		return;
+
+	}
+
+	if (session->attempts.empty() || t >= session->next_attempt)
+
+		attempt(session);		// Next address, if any
+
+	if (session->attempts.empty()) {
+
+		fail(session, session->error);
+		return;
+
+	}
+
+	// Back for the next attempt, the 1st deadline, or ConnectTimeout.
+	session->deadline = session->started + ConnectTimeout * 1000L;
+
+	if (session->next_addr < session->addrs.size())
+
+		session->deadline = min(session->deadline, session->next_attempt);
+
+	for (i = 0; i < session->attempts.size(); i++)
+
+		session->deadline = min(session->deadline,
+								session->attempts[i].deadline);
+
+}
+
+/*
+ * Close the connect attempts of a session that are still in flight
+ * (which also removes them from epoll).
+ * @args:	session (Session *session)
+ */
+void
+SmtpEngine::abandon(Session *session)
+{
+
+	for (size_t i = 0; i < session->attempts.size(); i++)
+
+		close(session->attempts[i].fd);
+
+	session->attempts.clear();
+
+}
+
+/*
+ * Socket events for a session: finish the connect, write pending
+ * output, read and dispatch complete replies.
+ * @args:	session, epoll events
+ */
+void
+SmtpEngine::handle(Session *session, unsigned int events)
+{
+
+	SmtpReply		reply;
+	ssize_t			n;
+	int				found;
+	bool			eof = false;
+
+	if (session->state == Closed)
+
+		return;
+
+	if (session->state == Connecting) {
+
+		connecting(session);
+		return;
+
+	}
+
+	if ((events & EPOLLOUT) && pump(session) != 0) {
+
+		fail(session, errno);
+		return;
+
+	}
+
+	if (!(events & (EPOLLIN | EPOLLERR | EPOLLHUP)))
+
+		return;
+
+	// Dispatch each complete reply, then read more, until the
+	// socket is drained.
+	for (;;) {
+
+		while (session->state != Closed &&
+			   (found = session->reader.next(reply)) == 1) {
+
+			Logger::shared().log(LogDebug, "S", reply.text, reply.length);
+			on_reply(session, reply);
+
+		}
+
+		if (session->state == Closed)
+
+			return;
+
+		if (found < 0) {
+
+			fail(session, errno);		// Malformed reply
+			return;
+
+		}
+
+		if ((n = session->reader.fill(session->fd)) > 0)
+
+			continue;
+
+		if (n == 0)
+
+			eof = true;
+
+		else if (errno == EINTR)
+
+			continue;
+
+		else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+
+			fail(session, errno);
+			return;
+
+		}
+
+		break;
+
+	}
+
+	if (eof && session->state != Closed) {
+
+		if (session->state == Quit || session->state == Idle)
+
+			close_session(session);
+
+		else
+
+			fail(session, ECONNRESET);
+
+	}
+
+}
+
+/*
+ * State machine: a complete reply arrived in the given state.
+ * @args:	session, complete reply (const SmtpReply &reply)
+ */
+void
+SmtpEngine::on_reply(Session *session, const SmtpReply &reply)
+{
+
+	int				code = reply.code;
+
+	if (code == 421 || code == 451)
+
+		session->throttled = session->res.throttled = code;
+
+	switch (session->state) {
+
+	case Greeting:
+		if (code != 220) {
+
+			fail(session, 0);
+			return;
+
+		}
+
+		queue(session, "EHLO " + session->domain + "\r\n");
+		set_state(session, Ehlo, ReadTimeout);
+		break;
+
+	case Ehlo:
+		if (code != 250) {
+
+			// Not ESMTP: fall back to HELO.
+			queue(session, "HELO " + session->domain + "\r\n");
+			set_state(session, Helo, ReadTimeout);
+			break;
+
+		}
+
+		session->ext = MailSenderSmtp::parse_extensions(reply);
+		next_job(session);
+		break;
+
+	case Helo:
+		if (code != 250) {
+
+			fail(session, 0);
+			return;
+
+		}
+
+		next_job(session);
+		break;
+
+	case Envelope:
+		on_envelope_reply(session, code);
+		break;
+
+	case FinalReply:
+		if (session->aborted) {
+
+			finish_job(session, -1, 0);		// Nothing was sent
+
+		}
+		else {
+
+			for (size_t i = 0; i < session->res.rcpt_status.size(); i++) {
+
+				if (session->res.rcpt_status[i] == 250 ||
+					session->res.rcpt_status[i] == 251)
+
+					session->res.rcpt_status[i] = code;
+
+			}
+
+			finish_job(session, code == 250 &&
+						session->accepted ==
+						(int)session->res.rcpt_status.size() ? 0 : -1, 0);
+
+		}
+
+		next_job(session);
+		break;
+
+	case Quit:
+		close_session(session);
+		break;
+
+	default:
+		// Unsolicited reply (e.g. "421" to an idle session).
+		fail(session, 0);
+		break;
+
+	}
+
+}
+
+/*
+ * Give a session its next message: open the email file and send
+ * the envelope, all at once if the server offers PIPELINING,
+ * otherwise the first command. A session w/ nothing to do idles;
+ * one that has run MaxPerConn transactions is QUIT.
+ * @args:	ready session (Session *session)
+ */
+void
+SmtpEngine::next_job(Session *session)
+{
+
+	Relay			*relay = session->relay;
+	Entry			*entry;
+	string			from;
+	vector<string>	to;
+
+	if (!session->ready) {
+
+		session->ready = true;
+		relay->starting--;
+
+	}
+
+	for (;;) {
+
+		if (session->sent >= MaxPerConn) {
+
+			queue(session, "QUIT\r\n");
+			set_state(session, Quit, ReadTimeout);
+			return;
+
+		}
+
+		if (relay->queue.empty()) {
+
+			set_state(session, Idle, IdleTimeout);
+			relay->idle.push_back(session);
+			return;
+
+		}
+
+		entry = relay->queue.front();
+		relay->queue.pop_front();
+
+		session->job = entry;
+		session->res.id = entry->id;
+		session->res.result = -1;
+		session->res.error = 0;
+		session->res.rcpt_status.assign(entry->job.to.size(), -1);
+		session->res.throttled = 0;
+		session->res.user = entry->job.user;
+
+		// Open email file: wire-ready file or plain message
+		session->wirefd = -1;
+		session->header_done = false;
+		session->body_done = false;
+
+		if (WireCheck(entry->job.filename)) {
+
+			session->wirefd = WireOpen(entry->job.filename, from, to,
+									   session->offset,
+									   session->remaining);
+
+			if (session->wirefd >= 0)
+
+				break;
+
+		}
+		else {
+
+			session->fin.clear();
+			session->fin.open(entry->job.filename.c_str(),
+							  ios::in | ios::binary);
+
+			if (session->fin.is_open())
+
+				break;
+
+		}
+
+		finish_job(session, -1, errno);		// File error, next
+
+	}
+
+	session->cmds.clear();
+
+	if (session->sent > 0)
+
+		session->cmds.push_back("RSET\r\n");	// Reused session
+
+	session->cmds.push_back("MAIL FROM:<" + entry->job.from + ">\r\n");
+	session->first_rcpt = session->cmds.size();
+
+	for (size_t i = 0; i < entry->job.to.size(); i++)
+
+		session->cmds.push_back("RCPT TO:<" + entry->job.to[i] + ">\r\n");
+
+	session->cmds.push_back("DATA\r\n");
+
+	session->sent++;
+	session->replies = 0;
+	session->mail_ok = false;
+	session->aborted = false;
+	session->accepted = 0;
+	session->encoder.reset();
+
+	if (session->ext & SmtpSession::ExtPipelining) {
+
+		for (size_t i = 0; i < session->cmds.size(); i++)
+
+			session->wbuf += session->cmds[i];
+
+		session->next_cmd = session->cmds.size();
+
+	}
+	else {
+
+		session->wbuf += session->cmds[0];
+		session->next_cmd = 1;
+
+	}
+
+	set_state(session, Envelope, ReadTimeout);
+
+	if (pump(session) != 0)
+
+		fail(session, errno);
+
+}
+
+/*
+ * Reply to the next envelope command. Records MAIL and RCPT
+ * replies; on "354" to DATA the message data follows, unless no
+ * recipient was accepted. W/o PIPELINING the next command is only
+ * sent now, and the transaction is given up as soon as MAIL or
+ * every RCPT has failed.
+ * @args:	session, reply code (int code)
+ */
+void
+SmtpEngine::on_envelope_reply(Session *session, int code)
+{
+
+	size_t			i = session->replies++,
+					last = session->cmds.size() - 1;
+	int				first = session->first_rcpt;
+
+	if ((int)i == first - 1)
+
+		session->mail_ok = code == 250;		// MAIL FROM
+
+	else if ((int)i >= first && i < last) {
+
+		session->res.rcpt_status[i - first] = code;
+
+		// "251": user not local, will forward
+		if (session->mail_ok && (code == 250 || code == 251))
+
+			session->accepted++;
+
+	}
+	else if (i == last) {
+
+		if (code != 354) {
+
+			finish_job(session, -1, 0);		// DATA rejected
+			next_job(session);
+			return;
+
+		}
+
+		if (!session->mail_ok || session->accepted == 0) {
+
+			// Server wants data for a failed envelope: send none.
+			session->aborted = true;
+			queue(session, ".\r\n");
+			set_state(session, FinalReply, FinalTimeout);
+			return;
+
+		}
+
+		set_state(session, Body, WriteTimeout);
+
+		if (pump(session) != 0)
+
+			fail(session, errno);
+
+		return;
+
+	}
+
+	if (session->next_cmd > last || session->replies < session->next_cmd)
+
+		return;		// Pipelined, or more replies to come
+
+	// No point in going on w/o sender or recipients.
+	if (((int)i == first - 1 && !session->mail_ok) ||
+		(i == last - 1 && session->accepted == 0)) {
+
+		finish_job(session, -1, 0);
+		next_job(session);
+		return;
+
+	}
+
+	queue(session, session->cmds[session->next_cmd++]);
+
+}
+
+/*
+ * Write as much pending output as the socket takes. In the Body
+ * state, keep producing message data (sendfile() for wire files,
+ * the encoder for plain ones) until the socket is full or all data
+ * is out, then wait for the final reply.
+ * @args:	session (Session *session)
+ * @return:	0 (success, possibly waiting for the socket)
+ * - error: -1 (connection/file error, errno set)
+ */
+int
+SmtpEngine::pump(Session *session)
+{
+
+	ssize_t			n;
+
+	for (;;) {
+
+		if (session->woff < session->wbuf.length()) {
+
+			n = write(session->fd, session->wbuf.data() + session->woff,
+					  session->wbuf.length() - session->woff);
+
+			if (n < 0) {
+
+				if (errno == EINTR)
+
+					continue;
+
+				if (errno != EAGAIN && errno != EWOULDBLOCK)
+
+					return -1;
+
+				watch(session, EPOLLIN | EPOLLOUT);		// Socket full
+				return 0;
+
+			}
+
+			session->woff += n;
+
+			if (session->state == Body)
+
+				session->deadline = now_ms() + WriteTimeout * 1000L;
+
+			continue;
+
+		}
+
+		session->wbuf.clear();
+		session->woff = 0;
+
+		if (session->state != Body)
+
+			break;
+
+		if (session->wirefd >= 0 && session->remaining > 0) {
+
+			n = sendfile(session->fd, session->wirefd,
+						 &session->offset, session->remaining);
+
+			if (n < 0) {
+
+				if (errno == EINTR)
+
+					continue;
+
+				if (errno != EAGAIN && errno != EWOULDBLOCK)
+
+					return -1;
+
+				watch(session, EPOLLIN | EPOLLOUT);
+				return 0;
+
+			}
+
+			if (n == 0) {
+
+				errno = EIO;	// File shorter than expected
+				return -1;
+
+			}
+
+			session->remaining -= n;
+			session->deadline = now_ms() + WriteTimeout * 1000L;
+			continue;
+
+		}
+
+		if (session->wirefd < 0 && !session->body_done) {
+
+			if (fill_body(session) != 0)
+
+				return -1;
+
+			continue;
+
+		}
+
+		// All data written.
+		if (session->wirefd >= 0) {
+
+			close(session->wirefd);
+			session->wirefd = -1;
+
+		}
+
+		session->fin.close();
+		set_state(session, FinalReply, FinalTimeout);
+		break;
+
+	}
+
+	watch(session, EPOLLIN);
+
+	return 0;
+
+}
+
+/*
+ * Put the next piece of a plain message into the output buffer:
+ * the header (w/o Bcc: fields) first, then DataChunk-sized pieces
+ * of the body, then the end of data indicator, all encoded.
+ * @args:	session in Body state (Session *session)
+ * @return:	0 (success)
+ * - error: -1 (file error, errno set)
+ */
+int
+SmtpEngine::fill_body(Session *session)
+{
+
+	string			header;
+	size_t			chunk,
+					n;			// Encoded bytes
+
+	if (!session->header_done) {
+
+		ReadDataHeader(session->fin, header);
+		session->header_done = true;
+
+		for (size_t i = 0; i < header.length(); i += chunk) {
+
+			chunk = min(header.length() - i, (size_t)DataChunk);
+			n = session->encoder.encode(header.data() + i, chunk, &Out[0]);
+			Logger::shared().log_body(&Out[0], n);
+			session->wbuf.append(&Out[0], n);
+
+		}
+
+		return 0;
+
+	}
+
+	if (session->fin.read(&In[0], DataChunk) || session->fin.gcount() > 0) {
+
+		n = session->encoder.encode(&In[0], session->fin.gcount(), &Out[0]);
+		Logger::shared().log_body(&Out[0], n);
+		session->wbuf.append(&Out[0], n);
+		return 0;
+
+	}
+
+	if (session->fin.bad()) {
+
+		errno = EIO;
+		return -1;
+
+	}
+
+	session->wbuf.append(&Out[0], session->encoder.finish(&Out[0]));
+	session->body_done = true;
+
+	return 0;
+
+}
+
+/*
+ * Queue a command and write what the socket takes right away.
+ * @args:	session, command w/ <CRLF> (const string &cmd)
+ */
+void
+SmtpEngine::queue(Session *session, const string &cmd)
+{
+
+	Logger::shared().log(LogDebug, "C", cmd);
+	session->wbuf += cmd;
+
+	if (pump(session) != 0)
+
+		fail(session, errno);
+
+}
+
+/*
+ * The session's current message is finished: pass its result on
+ * to be collected and close its file.
+ * @args:	session, result (0: delivered to everyone, -1: not),
+ * 			errno on connection/file errors (int error)
+ */
+void
+SmtpEngine::finish_job(Session *session, int result, int error)
+{
+
+	if (session->job == NULL)
+
+		return;
+
+	session->res.result = result;
+	session->res.error = error;
+	Done.push_back(session->res);
+
+	if (session->wirefd >= 0) {
+
+		close(session->wirefd);
+		session->wirefd = -1;
+
+	}
+
+	if (session->fin.is_open())
+
+		session->fin.close();
+
+	delete session->job;
+	session->job = NULL;
+
+}
+
+/*
+ * A session failed (connection error, timeout, unexpected reply):
+ * fail its message and close it. If the relay could not even be
+ * reached and no other session to it is left, the messages queued
+ * for it fail as well rather than wait forever.
+ * @args:	session, errno (0: SMTP protocol error)
+ */
+void
+SmtpEngine::fail(Session *session, int error)
+{
+
+	Relay			*relay = session->relay;
+	bool			unreachable = !session->ready;
+
+	if (session->state == Closed)
+
+		return;
+
+	Logger::shared().print(LogWarn, "%s: session failed: %s",
+						   relay->host.c_str(), error != 0 ?
+						   strerror(error) : "SMTP error");
+	finish_job(session, -1, error);
+	close_session(session);
+
+	if (unreachable && relay->sessions == 0) {
+
+		while (!relay->queue.empty()) {
+
+			Entry	*entry = relay->queue.front();
+			Result	res;
+
+			relay->queue.pop_front();
+			res.id = entry->id;
+			res.result = -1;
+			res.error = error;
+			res.rcpt_status.assign(entry->job.to.size(), -1);
+			res.throttled = session->throttled;
+			res.user = entry->job.user;
+			Done.push_back(res);
+			delete entry;
+
+		}
+
+	}
+
+}
+
+/*
+ * Close a session's socket (which also removes it from epoll) and
+ * mark it Closed; it is deleted by reap() once no event for it can
+ * be pending.
+ * @args:	session (Session *session)
+ */
+void
+SmtpEngine::close_session(Session *session)
+{
+
+	Relay			*relay = session->relay;
+
+	if (session->state == Closed)
+
+		return;
+
+	if (session->state == Idle)
+
+		relay->idle.remove(session);
+
+	if (!session->ready)
+
+		relay->starting--;
+
+	finish_job(session, -1, ECONNRESET);
+	abandon(session);
+
+	if (session->fd >= 0)
+
+		close(session->fd);
+
+	session->state = Closed;
+	relay->sessions--;
+	Sessions--;
+
+}
+
+/*
+ * Delete sessions closed during this round of events.
+ */
+void
+SmtpEngine::reap()
+{
+
+	list<Session *>::iterator	s;
+
+	for (s = All.begin(); s != All.end(); ) {
+
+		if ((*s)->state == Closed) {
+
+			delete *s;
+			s = All.erase(s);
+
+		}
+		else
+
+			++s;
+
+	}
+
+}
+
+/*
+ * Set the epoll interest of a session's socket.
+ * @args:	session, EPOLLIN and/or EPOLLOUT
+ */
+void
+SmtpEngine::watch(Session *session, unsigned int events)
+{
+
+	epoll_event		ev;
+
+	if (session->events == events || session->state == Closed)
+
+		return;
+
+	ev.events = events;
+	ev.data.ptr = session;
+
+	epoll_ctl(Epfd, session->events == 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD,
+			  session->fd, &ev);
+
+	session->events = events;
+
+}
+
+/*
+ * Enter a state, w/ that state's timeout.
+ * @args:	session, new state, timeout in seconds
+ */
+void
+SmtpEngine::set_state(Session *session, State state, int timeout)
+{
+
+	session->state = state;
+	session->deadline = now_ms() + timeout * 1000L;
+
+}
+
+/*
+ * Sessions past the deadline of their state: idle ones are QUIT,
+ * all others fail w/ ETIMEDOUT.
+ */
+void
+SmtpEngine::check_timeouts()
+{
+
+	list<Session *>::iterator	s;
+	long			t = now_ms();
+
+	LastCheck = t;
+
+	for (s = All.begin(); s != All.end(); ++s) {
+
+		if ((*s)->state == Closed || (*s)->deadline > t)
+
+			continue;
+
+		if ((*s)->state == Connecting)
+
+			connecting(*s);		// Next attempt, or one timed out
+
+		else if ((*s)->state == Idle) {
+
+			(*s)->relay->idle.remove(*s);
+			queue(*s, "QUIT\r\n");
+
+			if ((*s)->state != Closed)
+
+				set_state(*s, Quit, ReadTimeout);
+
+		}
+		else
+
+			fail(*s, ETIMEDOUT);
+
+	}
+
+}
+
+/*
+ * @return:	milliseconds on the monotonic clock (long)
+ */
+long
+SmtpEngine::now_ms()
+{
+
+	timespec		ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000L + ts.tv_nsec / 1000000;
+
+}
+
+/*
+ * MailSender public send method, through the engine: submit the
+ * message and run the engine until it is done. Messages of other
+ * callers that complete meanwhile are left for them to collect.
+ * @args:	relay host domain (const string &host_to)
+ * 			email sender (const string &envelope_from)
+ * 			email recipients (const vector<string> &envelope_to)
+ * 			reply code per recipient (vector<int> &rcpt_status)
+ * @return:	0 (success, delivered to every recipient)
+ *  -error: -1 (errno set on connection errors, otherwise SMTP
+ *  		error, server response codes in rcpt_status)
+ */
+int
+MailSenderEngine::send(const string &host_to,
+					   const string &envelope_from,
+					   const vector<string> &envelope_to,
+					   vector<int> &rcpt_status)
+{
+
+	SmtpEngine::Job		job;
+	SmtpEngine::Result	res;
+	unsigned long		id;
+
+	job.host = host_to;
+	job.port = Port;
+	job.filename = get_filename();
+	job.from = envelope_from;
+	job.to = envelope_to;
+	job.user = NULL;
+
+	id = Engine->submit(job);
+
+	while (!Engine->complete(id, res))
+
+		Engine->run(-1);
+
+	rcpt_status = res.rcpt_status;
+	errno = res.error;
+
+	return res.result;
+
+}
@@ -0,0 +1,296 @@
+/*
+ * Mail-Sending Program
+ * SmtpEngine.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+#ifndef SMTPENGINE_HH_
+#define SMTPENGINE_HH_
+
+#include "MailSender.hh"
+#include "SmtpData.hh"
+#include "SmtpReply.hh"
+#include <string>
+#include <vector>
+#include <deque>
+#include <list>
+#include <map>
+#include <fstream>
+#include <utility>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+using namespace std;
+
+/*
+ * SmtpEngine object
+ * Non-blocking SMTP client driving any number of concurrent
+ * sessions to any number of relays from a single thread, w/ epoll.
+ * Each session is an explicit state machine:
+ * 	Connecting -> Greeting -> Ehlo (-> Helo) -> Envelope -> Body
+ * 	-> FinalReply -> (next message: Envelope | Idle | Quit)
+ * where Envelope covers RSET/MAIL/RCPT.../DATA, pipelined if the
+ * server offers PIPELINING. A session delivers queued messages for
+ * its relay one after another, stays Idle for IdleTimeout seconds
+ * when the queue runs dry, and is recycled after MaxPerConn.
+ * Connecting races non-blocking connects to the relay's addresses
+ * in the loop (Happy Eyeballs, see Connector): the next address
+ * is tried after Connector's attempt delay, or at once when one
+ * fails, each attempt w/ its own deadline; the first to connect
+ * wins. Connect (all attempts), read (waiting for a reply), write
+ * (socket full) and the final reply each have their own timeout.
+ * Bulk use:
+ * 	- submit: queue a message, returns its id
+ * 	- run: wait for and handle events (up to timeout_ms)
+ * 	- complete: collect the result of a finished message
+ */
+class SmtpEngine
+{
+  public:
+
+	 // A message to deliver.
+
+	struct Job {
+		string			host;		// Relay host
+		int				port;		// Relay port
+		string			filename;	// Email file (plain or wire)
+		string			from;		// Envelope sender
+		vector<string>	to;			// Envelope recipients
+		void			*user;		// Caller's, returned as is
+	};
+
+	 // What became of it.
+
+	struct Result {
+		unsigned long	id;			// From submit()
+		int				result;		// 0: delivered to everyone
+		int				error;		// errno on connection errors
+		vector<int>		rcpt_status;	// As MailSender::send()
+		int				throttled;	// 421/451 reply seen, or 0
+		void			*user;
+	};
+
+	enum { DefaultMaxSessions = 1000,	// Sessions, all relays
+		   DefaultMaxPerRelay = 10,		// Sessions per relay
+		   DefaultMaxPerConn = 100,		// Messages per session
+		   DataChunk = 16384 };			// Message bytes per write
+
+			 SmtpEngine(int max_sessions = DefaultMaxSessions,
+						int max_per_relay = DefaultMaxPerRelay);
+			~SmtpEngine();
+
+	 // Queue a message for delivery, return its id.
+
+	unsigned long	submit(const Job &job);
+
+	 // Handle events for up to timeout_ms (-1: until a message
+
+	 // completes), return # of results ready to collect.
+
+	int				run(int timeout_ms);
+
+	 // Collect one finished message; false if none is ready.
+
+	bool			complete(Result &result);
+
+	 // Collect a given message; false if it is not finished.
+
+	bool			complete(unsigned long id, Result &result);
+
+	 // Messages submitted and not yet collected.
+
+	size_t			pending() const { return Pending; }
+
+	 // Timeouts in seconds: connect, read (reply), write (socket
+
+	 // full), final reply to the message data, idle session.
+
+	void			set_timeouts(int connect, int read, int write,
+								 int final, int idle);
+
+	void			set_max_per_conn(int n) { MaxPerConn = n; }
+
+  private:
+
+	enum State {
+		Connecting,		// Non-blocking connect in progress
+		Greeting,		// Waiting for "220"
+		Ehlo,			// Waiting for EHLO reply
+		Helo,			// Waiting for HELO reply (no ESMTP)
+		Envelope,		// RSET/MAIL/RCPT/DATA replies
+		Body,			// Writing message data
+		FinalReply,		// Waiting for reply to the data
+		Idle,			// Waiting for a message to send
+		Quit,			// Waiting for "221"
+		Closed			// To be deleted
+	};
+
+	struct Entry;
+	struct Relay;
+	struct Session;
+	struct Attempt;
+
+	int				Epfd;			// epoll instance
+	int				MaxSessions,	// Limits
+					MaxPerRelay,
+					MaxPerConn,
+					Sessions;		// Open sessions
+	int				ConnectTimeout,	// Timeouts, secs.
+					ReadTimeout,
+					WriteTimeout,
+					FinalTimeout,
+					IdleTimeout;
+	unsigned long	NextId;
+	size_t			Pending;
+	map<pair<string, int>, Relay *>	Relays;
+	long			LastCheck;		// Last timeout check, ms
+	list<Session *>	All;			// Open sessions
+	deque<Result>	Done;			// Finished, to be collected
+	vector<char>	In,				// Message chunk, shared
+					Out;			// Encoded chunk, shared
+
+	 // Open sessions for relays w/ queued messages.
+
+	void			start_sessions();
+
+	 // Resolve relay address and start a non-blocking connect.
+
+	int				connect_session(Relay *relay);
+
+	 // Start a connect attempt on the next address of a session.
+
+	int				attempt(Session *session);
+
+	 // Check a session's connect attempts: won, failed, timed out,
+
+	 // time for the next one.
+
+	void			connecting(Session *session);
+
+	 // Close the connect attempts still in flight.
+
+	void			abandon(Session *session);
+
+	 // Socket events for a session.
+
+	void			handle(Session *session, unsigned int events);
+
+	 // Complete server reply received.
+
+	void			on_reply(Session *session, const SmtpReply &reply);
+
+	 // Give a session its next message, or let it idle.
+
+	void			next_job(Session *session);
+
+	 // Reply to a command of the envelope.
+
+	void			on_envelope_reply(Session *session, int code);
+
+	 // Write pending output, produce more message data.
+
+	int				pump(Session *session);
+
+	 // Fill the output buffer w/ encoded message data.
+
+	int				fill_body(Session *session);
+
+	 // Queue a command for writing.
+
+	void			queue(Session *session, const string &cmd);
+
+	 // Current message finished, record its result.
+
+	void			finish_job(Session *session, int result, int error);
+
+	 // Connection failed/closed: finish session and its message.
+
+	void			fail(Session *session, int error);
+
+	 // Change epoll interest, deadline.
+
+	void			watch(Session *session, unsigned int events);
+
+	void			set_state(Session *session, State state,
+							  int timeout);
+
+	 // Fail sessions whose deadline has passed.
+
+	void			check_timeouts();
+
+	 // Close a session's socket, mark it for deletion.
+
+	void			close_session(Session *session);
+
+	 // Delete sessions closed while handling events.
+
+	void			reap();
+
+	 // Milliseconds on the monotonic clock.
+
+	static long		now_ms();
+
+};
+
+/*
+ * MailSenderEngine object
+ * Derived from MailSender (abstract base class)
+ * Puts the SmtpEngine behind the MailSender::send() interface: each
+ * send() submits one message and runs the engine until it is done.
+ * Sessions left idle by one send() are reused by the next.
+ */
+class MailSenderEngine : public MailSender
+{
+  public:
+			 MailSenderEngine(const string &filename,
+							  SmtpEngine *engine,
+							  int port = 25):
+				 MailSender(filename), Engine(engine), Port(port) { }
+			~MailSenderEngine() { }
+
+	using MailSender::send;		// Single recipient form
+
+	// Send email to relay host through the engine.
+
+	int			send(const string &host_to,
+					 const string &envelope_from,
+					 const vector<string> &envelope_to,
+					 vector<int> &rcpt_status);
+
+  private:
+
+	SmtpEngine	*Engine;		// Engine to submit messages to
+	int			Port;			// Relay port
+
+};
+
+#endif /* SMTPENGINE_HH_ */
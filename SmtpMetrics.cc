@@ -0,0 +1,437 @@
+/*
+ * Mail-Sending Program
+ * SmtpMetrics.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+#include "SmtpMetrics.hh"
+#include "Arena.hh"
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cerrno>
+#include <ctime>
+
+using namespace std;
+
+const char		*PhaseNames[RelayMetrics::Phases] = {
+	"resolve", "connect", "greeting", "ehlo", "tls", "auth", "envelope",
+	"body", "final_reply", "message"
+};
+
+// Bucket bounds of the dump, seconds.
+
+const double	Bounds[] = {
+	0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05,
+	0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30, 60, 300
+};
+
+LatencyHistogram::LatencyHistogram(): Count(0), Sum(0)
+{
+
+	for (int i = 0; i < Buckets; i++)
+
+		Counts[i].store(0, memory_order_relaxed);
+
+}
+
+/*
+ * @args:	duration in microseconds (uint64_t usec)
+ */
+void
+LatencyHistogram::record(uint64_t usec)
+{
+
+	Counts[bucket(usec)].fetch_add(1, memory_order_relaxed);
+	Count.fetch_add(1, memory_order_relaxed);
+	Sum.fetch_add(usec, memory_order_relaxed);
+
+}
+
+/*
+ * Durations in the buckets that lie entirely below usec (a bucket
+ * straddling usec is left out, an error of at most 1/16).
+ * @args:	bound in microseconds (uint64_t usec)
+ * @return:	count
+ */
+uint64_t
+LatencyHistogram::count_below(uint64_t usec) const
+{
+
+	uint64_t		n = 0;
+
+	for (int b = 0; b + 1 < Buckets && bucket_low(b + 1) <= usec; b++)
+
+		n += Counts[b].load(memory_order_relaxed);
+
+	return n;
+
+}
+
+/*
+ * Values 0-15 have a bucket each. From there on, a value w/ its
+ * highest bit at position e falls in one of the 16 buckets of
+ * [2^e, 2^(e+1)), chosen by its 4 bits below the highest one.
+ * @args:	value (uint64_t usec)
+ * @return:	bucket index
+ */
+int
+LatencyHistogram::bucket(uint64_t usec)
+{
+
+	int				e,
+					b;
+
+	if (usec < SubBuckets)
+
+		return usec;
+
+	e = 63 - __builtin_clzll(usec);		// >= 4
+	b = (e - 3) * SubBuckets + ((usec >> (e - 4)) & (SubBuckets - 1));
+
+	return b < Buckets ? b : Buckets - 1;
+
+}
+
+/*
+ * @args:	bucket index (int b)
+ * @return:	smallest value in the bucket
+ */
+uint64_t
+LatencyHistogram::bucket_low(int b)
+{
+
+	int				e = b / SubBuckets + 3;
+
+	if (b < SubBuckets)
+
+		return b;
+
+	return (uint64_t)(SubBuckets + b % SubBuckets) << (e - 4);
+
+}
+
+RelayMetrics::RelayMetrics(const string &relay_host):
+	host(relay_host), bytes(0), sent(0), failed(0), retries(0),
+	connections(0), throttled(0), tls_handshakes(0), tls_resumed(0),
+	window(0), rate(0)
+{
+
+	for (int i = 0; i < 6; i++)
+
+		replies[i].store(0, memory_order_relaxed);
+
+}
+
+/*
+ * @args:	reply code, e.g. 250 (int code)
+ */
+void
+RelayMetrics::reply(int code)
+{
+
+	if (code >= 100 && code < 600)
+
+		replies[code / 100].fetch_add(1, memory_order_relaxed);
+
+}
+
+/*
+ * @args:	phase (Phase p), its start (uint64_t start, see
+ * 			SmtpMetrics::now)
+ */
+void
+RelayMetrics::time(Phase p, uint64_t start)
+{
+
+	phase[p].record(SmtpMetrics::now() - start);
+
+}
+
+SmtpMetrics::~SmtpMetrics()
+{
+
+	for (map<string, RelayMetrics *>::iterator r = Relays.begin();
+		 r != Relays.end(); ++r)
+
+		delete r->second;
+
+}
+
+/*
+ * @return:	process-wide registry (SmtpMetrics &)
+ */
+SmtpMetrics &
+SmtpMetrics::shared()
+{
+
+	static SmtpMetrics	metrics;
+
+	return metrics;
+
+}
+
+/*
+ * @args:	relay hostname (const string &host)
+ * @return:	its metrics, valid for the life of the registry
+ */
+RelayMetrics *
+SmtpMetrics::relay(const string &host)
+{
+
+	lock_guard<mutex>	guard(Lock);
+	RelayMetrics		*&relay = Relays[host];
+
+	if (relay == NULL)
+
+		relay = new RelayMetrics(host);
+
+	return relay;
+
+}
+
+/*
+ * Write every relay's metrics in the Prometheus text exposition
+ * format: a histogram of each phase in seconds
+ * (mailsender_phase_seconds) and counters for bytes written, messages
+ * by result, retries, connections, throttles, TLS handshakes (and
+ * the share resumed) and replies by class;
+ * gauges of the window and rate relays are paced to. Then the
+ * totals of all arenas (mailsender_arena_*).
+ * @args:	output stream (ostream &out)
+ */
+void
+SmtpMetrics::dump(ostream &out)
+{
+
+	lock_guard<mutex>	guard(Lock);
+	map<string, RelayMetrics *>::iterator	r;
+	const int		bounds = sizeof(Bounds) / sizeof(Bounds[0]);
+
+	out << "# HELP mailsender_phase_seconds Duration of SMTP protocol "
+		   "phases.\n"
+		<< "# TYPE mailsender_phase_seconds histogram\n";
+
+	for (r = Relays.begin(); r != Relays.end(); ++r) {
+
+		for (int p = 0; p < RelayMetrics::Phases; p++) {
+
+			const LatencyHistogram	&h = r->second->phase[p];
+			ostringstream	labels;
+
+			labels << "relay=\"" << r->first << "\",phase=\""
+				   << PhaseNames[p] << "\"";
+
+			for (int b = 0; b < bounds; b++)
+
+				out << "mailsender_phase_seconds_bucket{" << labels.str()
+					<< ",le=\"" << Bounds[b] << "\"} "
+					<< h.count_below((uint64_t)(Bounds[b] * 1e6)) << "\n";
+
+			out << "mailsender_phase_seconds_bucket{" << labels.str()
+				<< ",le=\"+Inf\"} " << h.count() << "\n"
+				<< "mailsender_phase_seconds_sum{" << labels.str() << "} "
+				<< h.sum() / 1e6 << "\n"
+				<< "mailsender_phase_seconds_count{" << labels.str() << "} "
+				<< h.count() << "\n";
+
+		}
+
+	}
+
+	out << "# HELP mailsender_bytes_total Bytes written to the relay.\n"
+		<< "# TYPE mailsender_bytes_total counter\n";
+
+	for (r = Relays.begin(); r != Relays.end(); ++r)
+
+		out << "mailsender_bytes_total{relay=\"" << r->first << "\"} "
+			<< r->second->bytes << "\n";
+
+	out << "# HELP mailsender_messages_total Messages by result.\n"
+		<< "# TYPE mailsender_messages_total counter\n";
+
+	for (r = Relays.begin(); r != Relays.end(); ++r)
+
+		out << "mailsender_messages_total{relay=\"" << r->first
+			<< "\",result=\"sent\"} " << r->second->sent << "\n"
+			<< "mailsender_messages_total{relay=\"" << r->first
+			<< "\",result=\"failed\"} " << r->second->failed << "\n";
+
+	out << "# HELP mailsender_retries_total Transactions retrying "
+		   "recipients deferred w/ 452.\n"
+		<< "# TYPE mailsender_retries_total counter\n";
+
+	for (r = Relays.begin(); r != Relays.end(); ++r)
+
+		out << "mailsender_retries_total{relay=\"" << r->first << "\"} "
+			<< r->second->retries << "\n";
+
+	out << "# HELP mailsender_connections_total SMTP sessions opened.\n"
+		<< "# TYPE mailsender_connections_total counter\n";
+
+	for (r = Relays.begin(); r != Relays.end(); ++r)
+
+		out << "mailsender_connections_total{relay=\"" << r->first << "\"} "
+			<< r->second->connections << "\n";
+
+	out << "# HELP mailsender_throttled_total Messages the relay "
+		   "throttled (421/451).\n"
+		<< "# TYPE mailsender_throttled_total counter\n";
+
+	for (r = Relays.begin(); r != Relays.end(); ++r)
+
+		out << "mailsender_throttled_total{relay=\"" << r->first << "\"} "
+			<< r->second->throttled << "\n";
+
+	out << "# HELP mailsender_tls_handshakes_total TLS handshakes, "
+		   "full or resuming a cached session.\n"
+		<< "# TYPE mailsender_tls_handshakes_total counter\n";
+
+	for (r = Relays.begin(); r != Relays.end(); ++r)
+
+		out << "mailsender_tls_handshakes_total{relay=\"" << r->first
+			<< "\",type=\"full\"} "
+			<< r->second->tls_handshakes - r->second->tls_resumed << "\n"
+			<< "mailsender_tls_handshakes_total{relay=\"" << r->first
+			<< "\",type=\"resumed\"} " << r->second->tls_resumed << "\n";
+
+	out << "# HELP mailsender_tls_resumption_ratio Share of TLS "
+		   "handshakes resumed.\n"
+		<< "# TYPE mailsender_tls_resumption_ratio gauge\n";
+
+	for (r = Relays.begin(); r != Relays.end(); ++r)
+
+		out << "mailsender_tls_resumption_ratio{relay=\"" << r->first
+			<< "\"} " << (r->second->tls_handshakes == 0 ? 0.0 :
+						 (double)r->second->tls_resumed /
+						 r->second->tls_handshakes) << "\n";
+
+	out << "# HELP mailsender_relay_window Messages in flight allowed.\n"
+		<< "# TYPE mailsender_relay_window gauge\n";
+
+	for (r = Relays.begin(); r != Relays.end(); ++r)
+
+		out << "mailsender_relay_window{relay=\"" << r->first << "\"} "
+			<< r->second->window << "\n";
+
+	out << "# HELP mailsender_relay_rate Messages per second allowed "
+		   "(0: no limit).\n"
+		<< "# TYPE mailsender_relay_rate gauge\n";
+
+	for (r = Relays.begin(); r != Relays.end(); ++r)
+
+		out << "mailsender_relay_rate{relay=\"" << r->first << "\"} "
+			<< r->second->rate << "\n";
+
+	out << "# HELP mailsender_replies_total Server replies by class.\n"
+		<< "# TYPE mailsender_replies_total counter\n";
+
+	for (r = Relays.begin(); r != Relays.end(); ++r) {
+
+		for (int c = 2; c < 6; c++)
+
+			out << "mailsender_replies_total{relay=\"" << r->first
+				<< "\",class=\"" << c << "xx\"} "
+				<< r->second->replies[c] << "\n";
+
+	}
+
+	// Arenas of all sessions and threads (see Arena): heap blocks
+	// stop growing once the buffers fit the largest transaction.
+	Arena::Stats	arena = Arena::totals();
+
+	out << "# HELP mailsender_arena_allocations_total Allocations "
+		   "served by arenas.\n"
+		<< "# TYPE mailsender_arena_allocations_total counter\n"
+		<< "mailsender_arena_allocations_total " << arena.allocs << "\n"
+		<< "# HELP mailsender_arena_bytes_total Bytes served by arenas.\n"
+		<< "# TYPE mailsender_arena_bytes_total counter\n"
+		<< "mailsender_arena_bytes_total " << arena.bytes << "\n"
+		<< "# HELP mailsender_arena_heap_blocks_total Blocks arenas took "
+		   "from the heap.\n"
+		<< "# TYPE mailsender_arena_heap_blocks_total counter\n"
+		<< "mailsender_arena_heap_blocks_total " << arena.blocks << "\n"
+		<< "# HELP mailsender_arena_resets_total Arena resets, one per "
+		   "transaction.\n"
+		<< "# TYPE mailsender_arena_resets_total counter\n"
+		<< "mailsender_arena_resets_total " << arena.resets << "\n";
+
+}
+
+/*
+ * Write the metrics to a temporary file next to path, then rename
+ * it over path, so a reader (e.g. a node exporter's textfile
+ * collector) never sees a partial dump.
+ * @args:	file name (const string &path)
+ * @return:	0 (success)
+ * - error: -1 (file error, errno set)
+ */
+int
+SmtpMetrics::dump_file(const string &path)
+{
+
+	string			tmp = path + ".tmp";
+	ofstream		out(tmp.c_str());
+
+	if (!out.is_open())
+
+		return -1;
+
+	dump(out);
+	out.close();
+
+	if (out.fail()) {
+
+		remove(tmp.c_str());
+		errno = EIO;
+		return -1;
+
+	}
+
+	return rename(tmp.c_str(), path.c_str());
+
+}
+
+/*
+ * @return:	microseconds on the monotonic clock
+ */
+uint64_t
+SmtpMetrics::now()
+{
+
+	timespec		ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+
+}
@@ -0,0 +1,185 @@
+/*
+ * Mail-Sending Program
+ * SmtpMetrics.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+
+#ifndef SMTPMETRICS_HH_
+#define SMTPMETRICS_HH_
+
+#include <string>
+#include <map>
+#include <list>
+#include <mutex>
+#include <atomic>
+#include <ostream>
+#include <stdint.h>
+
+using namespace std;
+
+/*
+ * LatencyHistogram object
+ * Lock-free log-linear (HDR-style) histogram of durations in
+ * microseconds: values below 16 have a bucket each, larger ones
+ * 16 buckets per power of two, so every bucket is within 1/16
+ * (6.25%) of the values it holds. Recording is one relaxed atomic
+ * increment per counter; any number of threads may record and dump
+ * at once.
+ * @methods:	record, count, sum, count_below (for dumps)
+ */
+class LatencyHistogram
+{
+  public:
+
+	enum { SubBuckets = 16,			// Per power of two
+		   Buckets = SubBuckets * 40 };	// Up to 2^40 us (12 days)
+
+			 LatencyHistogram();
+
+	 // Add a duration.
+
+	void			record(uint64_t usec);
+
+	 // Durations recorded, their sum.
+
+	uint64_t		count() const { return Count.load(memory_order_relaxed); }
+
+	uint64_t		sum() const { return Sum.load(memory_order_relaxed); }
+
+	 // Durations recorded that are below usec.
+
+	uint64_t		count_below(uint64_t usec) const;
+
+  private:
+
+	atomic<uint64_t>	Counts[Buckets],
+						Count,
+						Sum;			// us
+
+	 // Bucket of a value, smallest value of a bucket.
+
+	static int		bucket(uint64_t usec);
+
+	static uint64_t	bucket_low(int b);
+
+};
+
+/*
+ * RelayMetrics object
+ * What MailSenderSmtp records per relay host: a histogram of each
+ * protocol phase and counters; and the window and rate RelayRouter
+ * allows it (gauges). All members may be updated by any
+ * thread w/o locking.
+ * 	Resolve		host name lookup
+ * 	Connect		TCP connect
+ * 	Greeting	connect to "220"
+ * 	Ehlo		EHLO (or HELO) to its reply
+ * 	Tls			STARTTLS to the end of the TLS handshake
+ * 	Auth		AUTH to "235"
+ * 	Envelope	RSET/MAIL/RCPT/DATA to "354"
+ * 	Body		message data written
+ * 	FinalReply	end of data to the reply (relay queueing)
+ * 	Message		whole transaction, MAIL to final reply
+ */
+struct RelayMetrics
+{
+	enum Phase { Resolve, Connect, Greeting, Ehlo, Tls, Auth, Envelope,
+				 Body, FinalReply, Message, Phases };
+
+	string				host;
+	LatencyHistogram	phase[Phases];
+	atomic<uint64_t>	bytes,			// Written: commands and data
+						sent,			// Messages delivered to all
+						failed,			// Messages not, or not to all
+						retries,		// Transactions for 452 rcpts
+						connections,	// Sessions opened
+						throttled,		// 421/451 replies to messages
+						tls_handshakes,	// TLS sessions started
+						tls_resumed,	// ... resuming a cached one
+						replies[6];		// By class: [2] = 2xx ...
+	atomic<double>		window,			// Messages in flight allowed
+						rate;			// Messages/s allowed, 0: any
+
+						RelayMetrics(const string &relay_host);
+
+	 // Count a reply by class.
+
+	void				reply(int code);
+
+	 // Record a phase that began at start (see SmtpMetrics::now).
+
+	void				time(Phase p, uint64_t start);
+
+};
+
+/*
+ * SmtpMetrics object
+ * Registry of RelayMetrics, one per relay host for the life of the
+ * process (pointers to them stay valid), and their dump in the
+ * Prometheus text exposition format.
+ * @methods:	shared, relay (find/add), dump, dump_file
+ */
+class SmtpMetrics
+{
+  public:
+			 SmtpMetrics() { }
+			~SmtpMetrics();
+
+	 // Metrics of the whole process.
+
+	static SmtpMetrics	&shared();
+
+	 // Metrics of a relay host, added on first use.
+
+	RelayMetrics	*relay(const string &host);
+
+	 // Write all metrics (Prometheus text format).
+
+	void			dump(ostream &out);
+
+	 // Write them to a file, replaced atomically (rename).
+
+	int				dump_file(const string &path);
+
+	 // Microseconds on the monotonic clock.
+
+	static uint64_t	now();
+
+  private:
+
+	mutex			Lock;			// Guards Relays (not metrics)
+	map<string, RelayMetrics *>	Relays;
+
+};
+
+#endif /* SMTPMETRICS_HH_ */
@@ -0,0 +1,318 @@
+/*
+ * Mail-Sending Program
+ * SmtpPool.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+#include "SmtpPool.hh"
+#include "MailSenderSmtp.hh"
+#include "Logger.hh"
+#include <cerrno>
+#include <ctime>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+using namespace std;
+
+/*
+ * Pool shared by all MailSenderSmtp objects that are not given
+ * one of their own. Idle sessions are QUIT at program exit, by the
+ * pool's destructor: what QUIT uses (the metrics registry, the
+ * logger, the TLS client) is constructed first, so that it is
+ * destroyed after the pool (static objects go in reverse order).
+ * @return:	shared pool (SmtpPool &)
+ */
+SmtpPool &
+SmtpPool::shared()
+{
+
+	SmtpMetrics::shared();
+	Logger::shared();
+	TlsClient::shared();
+
+	static SmtpPool		pool;
+
+	return pool;
+
+}
+
+/*
+ * Monotonic clock, not affected by changes to the system time.
+ * @return:	seconds since an arbitrary point (time_t)
+ */
+time_t
+SmtpPool::now()
+{
+
+	timespec		ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec;
+
+}
+
+/*
+ * Hand out an idle session to relay host:port. Sessions past the
+ * idle timeout, or closed by the server while idle, are dropped
+ * along the way. The session is removed from the pool until it is
+ * released or discarded.
+ * @args:	relay host (const string &host), port (int port)
+ * @return:	open session (SmtpSession *)
+ * 			NULL (no idle session to this relay)
+ */
+SmtpSession *
+SmtpPool::acquire(const string &host, int port)
+{
+
+	IdleMap::iterator	it;
+	SmtpSession		*session;
+
+	maintain();		// Evict/keep alive before handing out
+
+	if ((it = Idle.find(RelayRef(host, port))) == Idle.end())
+
+		return NULL;	// No session to this relay
+
+	// Most recently used first: least likely to have timed out.
+	while (!it->second.empty()) {
+
+		session = it->second.back();
+		it->second.pop_back();
+
+		if (closed_by_server(session)) {
+
+			discard(session, false);	// 421 or EOF, drop
+			continue;
+
+		}
+
+		return session;
+
+	}
+
+	return NULL;
+
+}
+
+/*
+ * Return a session to the pool, idle and ready for the next
+ * transaction to its relay.
+ * @args:	open session (SmtpSession *session)
+ */
+void
+SmtpPool::release(SmtpSession *session)
+{
+
+	IdleMap::iterator	it = Idle.find(RelayRef(session->host,
+												session->port));
+
+	session->last_used = now();
+
+	if (it == Idle.end())
+
+		it = Idle.insert(make_pair(Relay(session->host, session->port),
+								   vector<SmtpSession *>())).first;
+
+	it->second.push_back(session);		// Capacity kept
+
+}
+
+/*
+ * End a session. A polite discard sends QUIT and waits for the
+ * server's "221", up to CommandTimeout secs. (and ends TLS w/
+ * close_notify, unless QUIT went unanswered); a broken session is
+ * just closed.
+ * @args:	session, no longer in the pool (SmtpSession *session)
+ * 			send QUIT first (bool polite)
+ */
+void
+SmtpPool::discard(SmtpSession *session, bool polite)
+{
+
+	int				saved = errno;	// Keep caller's error
+
+	if (polite) {
+
+		set_timeout(session, CommandTimeout);
+		polite = MailSenderSmtp::send_recv_cmd(session, "QUIT", "",
+											   221) == 0;
+
+	}
+
+	if (session->tls != NULL)
+
+		TlsClient::close(session->tls, polite);
+
+	close(session->fd);
+	delete session;
+
+	errno = saved;
+
+}
+
+/*
+ * Walk the idle sessions: evict those idle for longer than
+ * IdleTimeout, and send NOOP on those idle for longer than
+ * Keepalive so the server's own idle timer does not expire.
+ * Sessions that do not answer NOOP w/ "250" within CommandTimeout
+ * secs. (e.g. half-open, dropped by a NAT or firewall while idle)
+ * are dropped.
+ */
+void
+SmtpPool::maintain()
+{
+
+	IdleMap::iterator	it;
+	vector<SmtpSession *>::iterator	s;
+	time_t			t = now();
+
+	for (it = Idle.begin(); it != Idle.end(); ++it) {
+
+		for (s = it->second.begin(); s != it->second.end(); ) {
+
+			if (t - (*s)->last_used >= IdleTimeout) {
+
+				discard(*s);		// Expired, QUIT
+				s = it->second.erase(s);
+
+			}
+			else if (t - (*s)->last_used >= Keepalive) {
+
+				if (closed_by_server(*s)) {
+
+					discard(*s, false);
+					s = it->second.erase(s);
+					continue;
+
+				}
+
+				set_timeout(*s, CommandTimeout);
+
+				if (MailSenderSmtp::send_recv_cmd(*s, "NOOP", "") != 0) {
+
+					discard(*s, false);		// Timed out, or refused
+					s = it->second.erase(s);
+					continue;
+
+				}
+
+				set_timeout(*s, 0);			// None for transactions
+				(*s)->last_used = t;
+				++s;
+
+			}
+			else
+
+				++s;
+
+		}
+
+	}
+
+}
+
+/*
+ * QUIT and close every idle session in the pool.
+ */
+void
+SmtpPool::close_all()
+{
+
+	IdleMap::iterator	it;
+
+	for (it = Idle.begin(); it != Idle.end(); ++it) {
+
+		while (!it->second.empty()) {
+
+			discard(it->second.back());
+			it->second.pop_back();
+
+		}
+
+	}
+
+	Idle.clear();
+
+}
+
+/*
+ * Bound the time a blocking read or write on a session may take
+ * (SO_RCVTIMEO, SO_SNDTIMEO); past it, the call fails w/ EAGAIN.
+ * @args:	session (SmtpSession *session), secs. (int secs), 0: none
+ */
+void
+SmtpPool::set_timeout(SmtpSession *session, int secs)
+{
+
+	timeval			tv;
+
+	tv.tv_sec = secs;
+	tv.tv_usec = 0;
+	setsockopt(session->fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	setsockopt(session->fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+}
+
+/*
+ * An idle session has nothing to read unless the server has closed
+ * it (EOF) or announced that it is about to ("421 ... closing").
+ * Either way it is unusable; poll w/o blocking so the check costs
+ * no round trip.
+ * @args:	idle session (const SmtpSession *session)
+ * @return:	true (closed/closing or socket error), false (usable)
+ */
+bool
+SmtpPool::closed_by_server(const SmtpSession *session)
+{
+
+	pollfd			pfd;
+
+	if (!session->reader.empty() ||
+		(session->tls != NULL && SSL_has_pending(session->tls)))
+
+		return true;	// Unsolicited reply already buffered
+
+	pfd.fd = session->fd;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+
+	if (poll(&pfd, 1, 0) < 0)
+
+		return true;	// Bad descriptor
+
+	// Readable: EOF, or unsolicited "421". Error/hangup: gone.
+	return pfd.revents != 0;
+
+}
@@ -0,0 +1,184 @@
+/*
+ * Mail-Sending Program
+ * SmtpPool.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+#ifndef SMTPPOOL_HH_
+#define SMTPPOOL_HH_
+
+#include "SmtpReply.hh"
+#include "SmtpMetrics.hh"
+#include "Arena.hh"
+#include "SmtpTls.hh"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <utility>
+#include <ctime>
+#include <ostream>
+
+using namespace std;
+
+/*
+ * SmtpSession object
+ * One open, greeted and introduced (EHLO/HELO) connection to a relay.
+ * @data:	socket file descriptor (int fd)
+ * 			TLS session on it after STARTTLS, or NULL (SSL *tls)
+ * 			relay host & port the session belongs to
+ * 			# of transactions run on it (int sent)
+ * 			last time the session was used (time_t last_used)
+ * 			ESMTP extensions advertised by the server (ext)
+ * 			received, not yet read replies (SmtpReplyReader reader)
+ * 			metrics of the relay, or NULL (metrics)
+ * 			what the current transaction formats (Arena arena),
+ * 			reset after each transaction
+ */
+struct SmtpSession
+{
+	enum Extension {				// EHLO keywords (bit flags)
+		ExtPipelining		= 0x01,	// RFC 2920
+		Ext8BitMime			= 0x02,	// RFC 6152
+		ExtEnhancedStatus	= 0x04,	// RFC 2034
+		ExtChunking			= 0x08,	// RFC 3030
+		ExtStartTls			= 0x10,	// RFC 3207
+		ExtBinaryMime		= 0x20,	// RFC 3030, w/ CHUNKING
+		ExtAuth				= 0x40	// RFC 4954
+	};
+
+	int				fd;			// Socket file descriptor
+	SSL				*tls;		// TLS session, or NULL: plaintext
+	string			host;		// Relay host
+	int				port;		// Relay port
+	int				sent;		// Transactions on this session
+	time_t			last_used;	// Monotonic secs. of last command
+	unsigned int	ext;		// Supported extensions (Extension)
+	SmtpReplyReader	reader;		// Received, not yet read replies
+	RelayMetrics	*metrics;	// Phase timers, counters, or NULL
+	int				throttled;	// 421/451 reply read, or 0
+	Arena			arena;		// Commands of a transaction
+};
+
+/*
+ * SmtpPool object
+ * Pool of idle SMTP sessions keyed by relay (host, port), shared
+ * by MailSenderSmtp objects so a long-running sender only pays for
+ * connect, greeting and HELO once per relay.
+ * 	- acquire: hand out an idle session, checked for a server-side
+ * 	  close (421 or EOF) before reuse
+ * 	- release: return a session to the pool after a transaction
+ * 	- discard: end a session (QUIT) or drop a broken one
+ * 	- maintain: NOOP idle sessions every Keepalive seconds, evict
+ * 	  those idle for more than IdleTimeout seconds
+ * NOOP and QUIT wait CommandTimeout secs. at most for their reply,
+ * so a session gone half-open while idle cannot hang acquire().
+ */
+class SmtpPool
+{
+  public:
+			 SmtpPool(int idle_timeout = DefaultIdleTimeout,
+					  int keepalive = DefaultKeepalive):
+				 IdleTimeout(idle_timeout), Keepalive(keepalive) { }
+			~SmtpPool() { close_all(); }
+
+	enum { DefaultIdleTimeout = 120,	// Secs. before idle eviction
+		   DefaultKeepalive = 60,		// Secs. between NOOPs
+		   CommandTimeout = 10 };		// Secs. for a NOOP/QUIT reply
+
+	 // Pool shared by all MailSenderSmtp objects by default.
+
+	static SmtpPool	&shared();
+
+	 // Hand out a live idle session to host:port, NULL if none.
+
+	SmtpSession		*acquire(const string &host, int port);
+
+	 // Return a session to the pool, idle and ready for reuse.
+
+	void			release(SmtpSession *session);
+
+	 // End a session: QUIT (polite) or just close a broken one.
+
+	void			discard(SmtpSession *session, bool polite = true);
+
+	 // Keep idle sessions alive w/ NOOP, evict expired ones.
+
+	void			maintain();
+
+	 // QUIT and close every idle session.
+
+	void			close_all();
+
+	void			set_timeouts(int idle_timeout, int keepalive)
+					{ IdleTimeout = idle_timeout; Keepalive = keepalive; }
+
+	 // Monotonic clock in seconds, for session idle times.
+
+	static time_t	now();
+
+  private:
+
+	typedef pair<string, int>	Relay;		// (host, port) key
+	typedef pair<string_view, int>	RelayRef;	// Looks one up
+
+	 // Orders Relays, and finds them by RelayRef w/o a copy.
+
+	struct RelayLess {
+		typedef void	is_transparent;
+
+		template<class A, class B>
+		bool			operator()(const A &a, const B &b) const
+		{
+			return RelayRef(a.first, a.second) < RelayRef(b.first, b.second);
+		}
+	};
+
+	typedef map<Relay, vector<SmtpSession *>, RelayLess>	IdleMap;
+
+	int				IdleTimeout;	// Idle secs. before eviction
+	int				Keepalive;		// Idle secs. before a NOOP
+	IdleMap			Idle;			// Idle sessions per relay
+
+	 // Check whether the server closed or is closing (421) an idle
+
+	 // session, without a round trip.
+
+	static bool		closed_by_server(const SmtpSession *session);
+
+	 // Limit blocking reads/writes on a session, 0: no limit.
+
+	static void		set_timeout(SmtpSession *session, int secs);
+
+};
+
+#endif /* SMTPPOOL_HH_ */
@@ -0,0 +1,242 @@
+/*
+ * Mail-Sending Program
+ * SmtpReply.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+#include "SmtpReply.hh"
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+
+using namespace std;
+
+/*
+ * Read from a socket into the free end of the buffer (see space).
+ * @args:	socket (int fd)
+ * @return:	# of bytes read, 0 (connection closed)
+ * - error: -1 (errno set, EAGAIN on a non-blocking socket w/ nothing
+ * 			to read, EPROTO if a reply is longer than the buffer)
+ */
+ssize_t
+SmtpReplyReader::fill(int fd)
+{
+
+	char			*free;
+	size_t			len;
+	ssize_t			n;
+
+	if ((free = space(len)) == NULL)
+
+		return -1;
+
+	if ((n = read(fd, free, len)) > 0)
+
+		End += n;
+
+	return n;
+
+}
+
+/*
+ * Free end of the buffer, for bytes read from elsewhere than a
+ * socket (e.g. a TLS session), to be added w/ filled(). Bytes of
+ * replies already taken are dropped first (the replies returned so
+ * far become invalid).
+ * @args:	set to the free bytes (size_t &len)
+ * @return:	where to read to
+ * - error: NULL (errno EPROTO, a reply is longer than the buffer)
+ */
+char *
+SmtpReplyReader::space(size_t &len)
+{
+
+	if (Start > 0) {
+
+		memmove(Buf, Buf + Start, End - Start);
+		End -= Start;
+		Scan -= Start;
+		Start = 0;
+
+	}
+
+	if (End == BufSize) {
+
+		errno = EPROTO;		// No end of reply in sight
+		return NULL;
+
+	}
+
+	len = BufSize - End;
+
+	return Buf + End;
+
+}
+
+/*
+ * Parse the buffered lines not parsed yet. Every line begins w/ the
+ * same 3-digit code; all but the last have a '-' after it:
+ * 	250-first line
+ * 	250 last line
+ * A bare LF is accepted as a line end.
+ * @args:	next complete reply (SmtpReply &reply)
+ * @return:	1 (reply set), 0 (more bytes needed, see fill)
+ * - error: -1 (malformed reply, errno EPROTO)
+ */
+int
+SmtpReplyReader::next(SmtpReply &reply)
+{
+
+	const char		*p,
+					*nl;
+	int				code;
+
+	while ((nl = (const char *)memchr(Buf + Scan, '\n', End - Scan)) != NULL) {
+
+		p = Buf + Scan;
+
+		if (nl - p < 3 || p[0] < '2' || p[0] > '5' ||
+			p[1] < '0' || p[1] > '9' || p[2] < '0' || p[2] > '9' ||
+			(nl - p > 3 && p[3] != ' ' && p[3] != '-' && p[3] != '\r')) {
+
+			errno = EPROTO;		// Not "ddd[ -]text"
+			return -1;
+
+		}
+
+		code = (p[0] - '0') * 100 + (p[1] - '0') * 10 + (p[2] - '0');
+
+		if (Lines == 0)
+
+			Code = code;
+
+		else if (code != Code) {
+
+			errno = EPROTO;		// Code changed mid-reply
+			return -1;
+
+		}
+
+		if (Lines < SmtpReply::MaxLines)
+
+			Line[Lines] = Scan - Start;
+
+		Lines++;
+		Scan = nl + 1 - Buf;
+
+		if (nl - p > 3 && p[3] == '-')
+
+			continue;		// Continuation line
+
+		// Last line: hand out the reply.
+		reply.code = Code;
+		reply.text = Buf + Start;
+		reply.length = Scan - Start;
+		reply.lines = Lines;
+
+		for (int i = 0; i < Lines && i < SmtpReply::MaxLines; i++) {
+
+			const char	*s = Buf + Start + Line[i],
+						*e = (const char *)memchr(s, '\n', End - (s - Buf));
+
+			if (e > s && e[-1] == '\r')
+
+				e--;
+
+			s += (e - s > 3) ? 4 : e - s;		// Skip "ddd-"
+			reply.line[i] = s;
+			reply.len[i] = e - s;
+
+		}
+
+		parse_status(reply.line[0], reply.len[0], reply.status);
+
+		Start = Scan;
+		Lines = 0;
+
+		return 1;
+
+	}
+
+	return 0;
+
+}
+
+/*
+ * Enhanced status code (RFC 3463) at the start of a reply's text:
+ * class "." subject "." detail, followed by a space or the end of
+ * the line, e.g. "2.1.5 ok". The class must be 2, 4 or 5.
+ * @args:	line text (const char *text, size_t len)
+ * 			class/subject/detail, all 0 if none (int status[3])
+ */
+void
+SmtpReplyReader::parse_status(const char *text, size_t len, int status[3])
+{
+
+	size_t			i = 0;
+	int				n[3];
+
+	status[0] = status[1] = status[2] = 0;
+
+	for (int part = 0; part < 3; part++) {
+
+		size_t		digits = 0;
+
+		n[part] = 0;
+
+		while (i < len && text[i] >= '0' && text[i] <= '9' && digits < 3) {
+
+			n[part] = n[part] * 10 + (text[i++] - '0');
+			digits++;
+
+		}
+
+		if (digits == 0 || (part == 0 && digits != 1))
+
+			return;
+
+		if (part < 2 && (i >= len || text[i++] != '.'))
+
+			return;
+
+	}
+
+	if ((i < len && text[i] != ' ') ||
+		(n[0] != 2 && n[0] != 4 && n[0] != 5))
+
+		return;
+
+	status[0] = n[0];
+	status[1] = n[1];
+	status[2] = n[2];
+
+}
@@ -0,0 +1,132 @@
+/*
+ * Mail-Sending Program
+ * SmtpReply.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+
+#ifndef SMTPREPLY_HH_
+#define SMTPREPLY_HH_
+
+#include <cstddef>
+#include <sys/types.h>
+
+using namespace std;
+
+/*
+ * SmtpReply object
+ * One complete server reply (RFC 5321, 4.2), e.g.
+ * 	250-relay.example.com
+ * 	250-PIPELINING
+ * 	250 2.0.0 OK
+ * parsed in place: text and lines point into the reader's buffer and
+ * are valid until the reader is used again.
+ * @data:	reply code (int code), e.g. 250
+ * 			enhanced status code (RFC 3463) of the first line, e.g.
+ * 			{2, 0, 0}, or {0, 0, 0} if there is none (status)
+ * 			whole reply, line ends included (text, length)
+ * 			# of lines (lines); text of the first MaxLines, after
+ * 			the code and separator, w/o the line end (line, len)
+ */
+struct SmtpReply
+{
+	enum { MaxLines = 64 };
+
+	int				code;
+	int				status[3];
+	const char		*text;
+	size_t			length;
+	int				lines;
+	const char		*line[MaxLines];
+	size_t			len[MaxLines];
+};
+
+/*
+ * SmtpReplyReader object
+ * Per-connection receive buffer and incremental reply parser. Bytes
+ * are read into a fixed buffer (fill), and complete replies are
+ * taken from it one at a time (next); a reply split across reads is
+ * picked up where parsing left off, and bytes past the end of one
+ * reply (the next pipelined reply) stay buffered for the next call.
+ * Nothing is allocated per reply.
+ * @methods:	fill (read from a socket), space/filled (read from
+ * 				elsewhere), next (next complete reply), empty
+ * 				(nothing buffered), clear
+ */
+class SmtpReplyReader
+{
+  public:
+
+	enum { BufSize = 8192 };		// Max. reply length
+
+			 SmtpReplyReader() { clear(); }
+
+	 // Read what the socket has into the buffer.
+
+	ssize_t			fill(int fd);
+
+	 // Free end of the buffer to read into instead, and the # of
+
+	 // bytes read into it.
+
+	char			*space(size_t &len);
+
+	void			filled(size_t n) { End += n; }
+
+	 // Take the next complete reply from the buffer.
+
+	int				next(SmtpReply &reply);
+
+	 // No bytes buffered (parsed or not).
+
+	bool			empty() const { return Start == End; }
+
+	void			clear() { Start = End = Scan = 0; Lines = 0; }
+
+  private:
+
+	char			Buf[BufSize];
+	size_t			Start,			// Start of the current reply
+					End,			// End of the buffered bytes
+					Scan;			// Next line to parse
+	int				Lines;			// Lines of current reply so far
+	int				Code;			// Code of its first line
+	size_t			Line[SmtpReply::MaxLines];	// Offsets from Start
+
+	 // Parse "x.y.z" at the start of a line's text.
+
+	static void		parse_status(const char *text, size_t len,
+								 int status[3]);
+
+};
+
+#endif /* SMTPREPLY_HH_ */
@@ -0,0 +1,394 @@
+/*
+ * Mail-Sending Program
+ * SmtpTls.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+
+#include "SmtpTls.hh"
+#include "Logger.hh"
+#include <cstring>
+#include <cerrno>
+#include <arpa/inet.h>
+#include <openssl/err.h>
+#include <openssl/x509v3.h>
+
+using namespace std;
+
+/*
+ * The context trusts the system's CAs, wants TLS 1.2 or later and a
+ * valid certificate, and keeps no session cache of its own: new
+ * sessions go to new_session, into the cache by relay. OpenSSL does
+ * not clean up at exit, so sessions still pooled then may be closed.
+ */
+TlsClient::TlsClient(): Ctx(NULL), Handshakes(0), Resumed(0)
+{
+
+	OPENSSL_init_ssl(OPENSSL_INIT_NO_ATEXIT, NULL);
+
+	if ((Ctx = SSL_CTX_new(TLS_client_method())) == NULL)
+
+		return;		// start() fails
+
+	SSL_CTX_set_min_proto_version(Ctx, TLS1_2_VERSION);
+	SSL_CTX_set_verify(Ctx, SSL_VERIFY_PEER, NULL);
+	SSL_CTX_set_default_verify_paths(Ctx);
+	SSL_CTX_set_options(Ctx, SSL_OP_IGNORE_UNEXPECTED_EOF);
+	SSL_CTX_set_session_cache_mode(Ctx, SSL_SESS_CACHE_CLIENT |
+										SSL_SESS_CACHE_NO_INTERNAL_STORE);
+	SSL_CTX_sess_set_new_cb(Ctx, new_session);
+	SSL_CTX_set_app_data(Ctx, this);
+
+}
+
+TlsClient::~TlsClient()
+{
+
+	map<string, SSL_SESSION *>::iterator	it;
+
+	for (it = Sessions.begin(); it != Sessions.end(); ++it)
+
+		SSL_SESSION_free(it->second);	// NULL is fine
+
+	SSL_CTX_free(Ctx);
+
+}
+
+TlsClient &
+TlsClient::shared()
+{
+
+	static TlsClient	client;
+
+	return client;
+
+}
+
+/*
+ * Trust the CA certificates of a PEM file as well as the system's,
+ * e.g. the self-signed certificate of a test relay. To be called
+ * before the first handshake.
+ * @args:	PEM file (const string &file)
+ * @return:	0 (success)
+ * - error: -1 (file not found or not PEM, errno set)
+ */
+int
+TlsClient::add_ca(const string &file)
+{
+
+	errno = 0;
+	ERR_clear_error();
+
+	if (Ctx == NULL ||
+		SSL_CTX_load_verify_locations(Ctx, file.c_str(), NULL) != 1) {
+
+		if (errno == 0)
+
+			errno = EINVAL;		// Not a certificate
+
+		ERR_clear_error();
+		return -1;
+
+	}
+
+	return 0;
+
+}
+
+/*
+ * Handshake as a client on a connected socket (after STARTTLS was
+ * accepted), w/ SNI, and check the relay's certificate: signed by a
+ * trusted CA, for host (a name, or an IP address). If the relay
+ * issued a session before, it is offered for resumption.
+ * @args:	connected socket (int fd)
+ * 			relay host & port (const string &host, int port)
+ * 			set if the session was resumed (bool &resumed)
+ * @return:	TLS session (SSL *), to use w/ read, write, close
+ * - error: NULL (handshake failed or certificate not valid: EPROTO,
+ * 			logged; connection error, errno set)
+ */
+SSL *
+TlsClient::start(int fd, const string &host, int port, bool &resumed)
+{
+
+	SSL				*ssl;
+	unsigned char	ip[16];
+	long			verify;
+	int				ret;
+	map<string, SSL_SESSION *>::iterator	it;
+
+	resumed = false;
+	ERR_clear_error();
+
+	if (Ctx == NULL || (ssl = SSL_new(Ctx)) == NULL) {
+
+		errno = ENOMEM;
+		return NULL;
+
+	}
+
+	SSL_set_fd(ssl, fd);
+
+	if (inet_pton(AF_INET, host.c_str(), ip) == 1 ||
+		inet_pton(AF_INET6, host.c_str(), ip) == 1)
+
+		X509_VERIFY_PARAM_set1_ip_asc(SSL_get0_param(ssl), host.c_str());
+
+	else {
+
+		SSL_set_tlsext_host_name(ssl, host.c_str());
+		SSL_set1_host(ssl, host.c_str());
+
+	}
+
+	// Offer the relay's last session; new ones find their key.
+	{
+		lock_guard<mutex>	guard(Lock);
+
+		it = Sessions.insert(make_pair(host + ":" + to_string(port),
+									   (SSL_SESSION *)NULL)).first;
+
+		if (it->second != NULL)
+
+			SSL_set_session(ssl, it->second);
+
+		SSL_set_app_data(ssl, (void *)&it->first);	// Node stays put
+	}
+
+	errno = 0;
+
+	if ((ret = SSL_connect(ssl)) != 1) {
+
+		if ((verify = SSL_get_verify_result(ssl)) != X509_V_OK)
+
+			Logger::shared().print(LogWarn, "%s: certificate: %s",
+								   host.c_str(),
+								   X509_verify_cert_error_string(verify));
+
+		set_errno(ssl, ret, host.c_str());
+		SSL_free(ssl);
+		forget(host, port);
+		return NULL;
+
+	}
+
+	Handshakes++;
+
+	if ((resumed = SSL_session_reused(ssl)))
+
+		Resumed++;
+
+	Logger::shared().print(LogInfo, "%s: %s, %s%s", host.c_str(),
+						   SSL_get_version(ssl), SSL_get_cipher(ssl),
+						   resumed ? ", resumed" : "");
+
+	return ssl;
+
+}
+
+/*
+ * Read up to len bytes of a TLS session.
+ * @args:	TLS session (SSL *ssl), buffer (char *buf, size_t len)
+ * @return:	bytes read, 0 (relay closed the connection)
+ * - error: -1 (errno set)
+ */
+ssize_t
+TlsClient::read(SSL *ssl, char *buf, size_t len)
+{
+
+	int				n;
+
+	ERR_clear_error();
+	errno = 0;
+
+	if ((n = SSL_read(ssl, buf, len)) > 0)
+
+		return n;
+
+	if (SSL_get_error(ssl, n) == SSL_ERROR_ZERO_RETURN)
+
+		return 0;		// close_notify, or EOF
+
+	set_errno(ssl, n, "read");
+
+	return -1;
+
+}
+
+/*
+ * Write len bytes to a TLS session, all of them (a blocking socket
+ * w/o partial writes).
+ * @args:	TLS session (SSL *ssl), data (const char *buf, size_t len)
+ * @return:	len
+ * - error: -1 (errno set)
+ */
+ssize_t
+TlsClient::write(SSL *ssl, const char *buf, size_t len)
+{
+
+	int				n;
+
+	ERR_clear_error();
+	errno = 0;
+
+	if ((n = SSL_write(ssl, buf, len)) > 0)
+
+		return n;
+
+	set_errno(ssl, n, "write");
+
+	return -1;
+
+}
+
+/*
+ * End a TLS session: send close_notify (polite, w/o waiting for
+ * the relay's) and free it. The socket is the caller's to close.
+ * @args:	TLS session (SSL *ssl), close_notify first (bool polite)
+ */
+void
+TlsClient::close(SSL *ssl, bool polite)
+{
+
+	ERR_clear_error();
+
+	if (polite)
+
+		SSL_shutdown(ssl);
+
+	SSL_free(ssl);
+	ERR_clear_error();
+
+}
+
+/*
+ * Drop the cached session of a relay, so its next handshake is a
+ * full one.
+ * @args:	relay host & port (const string &host, int port)
+ */
+void
+TlsClient::forget(const string &host, int port)
+{
+
+	lock_guard<mutex>	guard(Lock);
+	map<string, SSL_SESSION *>::iterator	it;
+
+	if ((it = Sessions.find(host + ":" + to_string(port))) !=
+		Sessions.end() && it->second != NULL) {
+
+		SSL_SESSION_free(it->second);
+		it->second = NULL;
+
+	}
+
+}
+
+/*
+ * OpenSSL callback for each session (or TLS 1.3 ticket) the relay
+ * issues, during or after the handshake: it replaces the relay's
+ * cached session, unless it cannot be resumed.
+ * @args:	TLS session (SSL *ssl), new session (SSL_SESSION *sess)
+ * @return:	1 (the reference to sess is kept), 0 (not kept)
+ */
+int
+TlsClient::new_session(SSL *ssl, SSL_SESSION *sess)
+{
+
+	TlsClient		*client = (TlsClient *)SSL_CTX_get_app_data(
+													SSL_get_SSL_CTX(ssl));
+	const string	*key = (const string *)SSL_get_app_data(ssl);
+
+	if (key == NULL || !SSL_SESSION_is_resumable(sess))
+
+		return 0;
+
+	lock_guard<mutex>	guard(client->Lock);
+	SSL_SESSION		*&cached = client->Sessions[*key];
+
+	if (cached != NULL)
+
+		SSL_SESSION_free(cached);
+
+	cached = sess;
+
+	return 1;
+
+}
+
+/*
+ * Set errno for a failed TLS call, as the socket call would have:
+ * the socket's error is kept, EOF is ECONNRESET, a TLS protocol
+ * error (e.g. certificate not valid) is EPROTO and logged w/ the
+ * reason from OpenSSL's error queue.
+ * @args:	TLS session (SSL *ssl), return of the call (int ret)
+ * 			what failed, for the log (const char *what)
+ */
+void
+TlsClient::set_errno(SSL *ssl, int ret, const char *what)
+{
+
+	unsigned long	err;
+	char			reason[256];
+
+	switch (SSL_get_error(ssl, ret)) {
+
+	case SSL_ERROR_SYSCALL:
+		if (errno == 0)
+
+			errno = ECONNRESET;		// EOF mid-handshake
+		break;
+
+	case SSL_ERROR_ZERO_RETURN:
+		errno = ECONNRESET;
+		break;
+
+	case SSL_ERROR_WANT_READ:
+	case SSL_ERROR_WANT_WRITE:
+		errno = EAGAIN;
+		break;
+
+	default:
+		while ((err = ERR_get_error()) != 0) {
+
+			ERR_error_string_n(err, reason, sizeof(reason));
+			Logger::shared().print(LogWarn, "%s: TLS: %s", what, reason);
+
+		}
+
+		errno = EPROTO;
+		break;
+
+	}
+
+	ERR_clear_error();
+
+}
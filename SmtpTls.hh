@@ -0,0 +1,126 @@
+/*
+ * Mail-Sending Program
+ * SmtpTls.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+
+#ifndef SMTPTLS_HH_
+#define SMTPTLS_HH_
+
+#include <string>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <sys/types.h>
+#include <openssl/ssl.h>
+
+using namespace std;
+
+/*
+ * TlsClient object
+ * OpenSSL client side of STARTTLS (RFC 3207), shared by the sessions
+ * of all threads:
+ * 	- start: TLS handshake on a connected socket, the relay's
+ * 	  certificate checked against the trusted CAs and its host name
+ * 	- read, write, close: I/O on a TLS session, errno set like the
+ * 	  socket calls
+ * The system's CAs are trusted, and any added w/ add_ca (e.g. a
+ * relay's self-signed certificate).
+ * A client session cache keyed by relay (host:port) keeps the last
+ * session (TLS 1.2 session ID or ticket, TLS 1.3 ticket) each relay
+ * issued; the next handshake w/ that relay offers it, and if the
+ * relay takes it the handshake is resumed: one round trip and no
+ * certificate exchange or key agreement from scratch.
+ * @methods:	shared, add_ca, start, read, write, close, forget,
+ * 				handshakes/resumed (counters)
+ */
+class TlsClient
+{
+  public:
+			 TlsClient();
+			~TlsClient();
+
+	 // Client shared by all senders (of all threads).
+
+	static TlsClient	&shared();
+
+	 // Trust the CA certificates in a PEM file too.
+
+	int				add_ca(const string &file);
+
+	 // Handshake w/ the relay host:port on socket fd, resuming its
+
+	 // cached session if it has one.
+
+	SSL				*start(int fd, const string &host, int port,
+						   bool &resumed);
+
+	 // Read/write on a TLS session, like read()/write().
+
+	static ssize_t	read(SSL *ssl, char *buf, size_t len);
+
+	static ssize_t	write(SSL *ssl, const char *buf, size_t len);
+
+	 // End a TLS session: close_notify (polite), free it.
+
+	static void		close(SSL *ssl, bool polite = true);
+
+	 // Drop the cached session of a relay.
+
+	void			forget(const string &host, int port);
+
+	 // Handshakes done, and those resumed.
+
+	size_t			handshakes() const { return Handshakes; }
+
+	size_t			resumed() const { return Resumed; }
+
+  private:
+
+	SSL_CTX			*Ctx;
+	mutex			Lock;			// Guards Sessions
+	map<string, SSL_SESSION *>	Sessions;	// By "host:port"
+	atomic<size_t>	Handshakes,
+					Resumed;
+
+	 // New session from a relay (OpenSSL callback): cache it.
+
+	static int		new_session(SSL *ssl, SSL_SESSION *sess);
+
+	 // errno for a failed TLS call, error queue logged.
+
+	static void		set_errno(SSL *ssl, int ret, const char *what);
+
+};
+
+#endif /* SMTPTLS_HH_ */
@@ -0,0 +1,970 @@
+/*
+ * Mail-Sending Program
+ * Spool.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+
+#include "Spool.hh"
+#include "WireFile.hh"
+#include "Logger.hh"
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <cctype>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+const size_t	MaxBitmap = 1 << 20;	// Record bitmap limit (corrupt)
+
+Spool::Spool():
+	Journal(-1), NextId(1), Jitter(time(NULL) ^ getpid()), SyncData(false),
+	Stopping(false), Broken(false), Waiting(0), Appended(0), Durable(0),
+	Records(0), Failed(0)
+{
+
+	fill(Counts, Counts + Bounced + 1, 0);
+
+}
+
+Spool::~Spool()
+{
+
+	close();
+
+}
+
+/*
+ * Open a spool directory, creating it if need be, and recover the
+ * state of its messages from the journal (see replay). The journal
+ * is then compacted and the committer thread started.
+ * @args:	spool directory (const string &dir)
+ * @return:	0 (success)
+ *  -error:	-1 (file error, errno)
+ */
+int
+Spool::open(const string &dir)
+{
+
+	Dir = dir;
+
+	if ((mkdir(Dir.c_str(), 0700) != 0 && errno != EEXIST) ||
+		(mkdir((Dir + "/msg").c_str(), 0700) != 0 && errno != EEXIST))
+
+		return -1;		// Errno set
+
+	if ((Journal = ::open((Dir + "/journal").c_str(),
+						  O_RDWR | O_CREAT, 0600)) < 0)
+
+		return -1;		// Errno set
+
+	if (replay() != 0 || compact() != 0) {
+
+		int		saved = errno;
+
+		::close(Journal);
+		Journal = -1;
+		errno = saved;
+		return -1;
+
+	}
+
+	Committer = thread(&Spool::commit, this);
+
+	return 0;
+
+}
+
+/*
+ * Stop the committer, once it has written out every record.
+ */
+void
+Spool::close()
+{
+
+	{
+
+		lock_guard<mutex>	guard(Lock);
+
+		Stopping = true;
+
+	}
+
+	Wake.notify_all();
+	Ready.notify_all();
+
+	if (Committer.joinable())
+
+		Committer.join();
+
+	if (Journal >= 0)
+
+		::close(Journal);
+
+	Journal = -1;
+
+}
+
+/*
+ * Convert a message file into the spool (see WirePrepare) and add
+ * it, Pending. Its record is committed w/ the next group, after the
+ * file itself is on disk; flush() waits for that.
+ * @args:	plain message file (const string &filename)
+ * 			envelope sender, recipients (see GetEnvelope)
+ * 			message id, out (uint64_t &id)
+ * @return:	0 (success)
+ *  -error:	-1 (file error, errno; or the journal is broken, errno
+ * 			of its failed write)
+ */
+int
+Spool::enqueue(const string &filename,
+			   const string &env_from,
+			   const vector<string> &env_to,
+			   uint64_t &id)
+{
+
+	Entry			e;
+
+	{
+
+		lock_guard<mutex>	guard(Lock);
+
+		if (Broken) {
+
+			errno = Failed;
+			return -1;
+
+		}
+
+		id = NextId++;
+
+	}
+
+	if (WirePrepare(filename, path(id), env_from, env_to) != 0)
+
+		return -1;		// Errno set
+
+	e.state = Pending;
+	e.attempts = 0;
+	e.rcpts = env_to.size();
+	e.dest = env_to.empty() ? 0 : destination(env_to[0]);
+	e.next_try = 0;
+	e.done.assign((e.rcpts + 7) / 8, 0);
+	e.bounced = false;
+
+	lock_guard<mutex>	guard(Lock);
+
+	append(id, e, time(NULL));
+	SyncData = true;
+	Entries[id] = e;
+	Queue.push_back(id);
+	Counts[Pending]++;
+	Ready.notify_one();
+
+	return 0;
+
+}
+
+/*
+ * Wait for the committer to write out every record appended so far.
+ * @return:	0 (on disk)
+ *  -error:	-1 (the last journal write failed, errno; it is retried)
+ */
+int
+Spool::flush()
+{
+
+	unique_lock<mutex>	lock(Lock);
+	uint64_t		target = Appended;
+
+	Waiting++;
+	Wake.notify_one();		// No need to wait out CommitMs
+
+	while (Durable < target && !Failed && Committer.joinable())
+
+		Committed.wait(lock);
+
+	Waiting--;
+
+	if (Durable < target) {
+
+		errno = Failed ? Failed : EIO;
+		return -1;
+
+	}
+
+	return 0;
+
+}
+
+/*
+ * Take the next Pending message (Deferred ones become Pending when
+ * due), waiting up to wait_ms for one, and mark it InFlight. Its
+ * envelope is read from its wire file, less the recipients done
+ * w/ by earlier tries. A message whose file cannot be read bounces.
+ * @args:	message id, wire file, out (uint64_t &id, string &path)
+ * 			file enqueued, out (string &source), "" if unknown
+ * 			envelope to send to, out (see GetEnvelope)
+ * 			ms. to wait for a message (int wait_ms)
+ * @return:	true (message to send), false (none)
+ */
+bool
+Spool::next(uint64_t &id,
+			string &path,
+			string &source,
+			string &env_from,
+			vector<string> &env_to,
+			int wait_ms)
+{
+
+	chrono::steady_clock::time_point	until = chrono::steady_clock::now() +
+										chrono::milliseconds(wait_ms);
+	vector<string>	all;		// Recipients in the wire file
+	vector<uint8_t>	done;
+	vector<int>		trying;
+	off_t			offset,
+					length;
+	int				fd;
+
+	while (true) {
+
+		unique_lock<mutex>	lock(Lock);
+		time_t			now = time(NULL);
+
+		// Deferred messages due by now, as their destinations allow
+		Later.advance(now);
+
+		while (Later.pop(id)) {
+
+			unordered_map<uint64_t, Entry>::iterator	e = Entries.find(id);
+
+			if (e != Entries.end() && e->second.state == Deferred) {
+
+				e->second.state = Pending;
+				Counts[Deferred]--;
+				Counts[Pending]++;
+				Queue.push_back(id);
+
+			}
+
+		}
+
+		if (Queue.empty()) {
+
+			if (Stopping || chrono::steady_clock::now() >= until ||
+				Ready.wait_until(lock, until) == cv_status::timeout)
+
+				return false;
+
+			continue;
+
+		}
+
+		id = Queue.front();
+		Queue.pop_front();
+
+		Entry			&e = Entries[id];
+
+		e.state = InFlight;
+		Counts[Pending]--;
+		Counts[InFlight]++;
+		append(id, e, now);
+		done = e.done;
+		lock.unlock();
+
+		path = this->path(id);
+
+		if ((fd = WireOpen(path, env_from, all, offset, length,
+						   &source)) < 0) {
+
+			Logger::shared().print(LogError, "spool: %s: %s",
+								   path.c_str(), strerror(errno));
+			lock.lock();
+			finish(id, Bounced);
+			continue;
+
+		}
+
+		::close(fd);
+
+		env_to.clear();
+		trying.clear();
+
+		for (size_t i = 0; i < all.size(); i++) {
+
+			if (i / 8 < done.size() && (done[i / 8] >> (i % 8)) & 1)
+
+				continue;	// Sent (or refused) before
+
+			env_to.push_back(all[i]);
+			trying.push_back(i);
+
+		}
+
+		lock.lock();
+		Entries[id].trying.swap(trying);
+
+		if (!env_to.empty())
+
+			Entries[id].dest = destination(env_to[0]);
+
+		return true;
+
+	}
+
+}
+
+/*
+ * A message from next() was sent (or not): a recipient w/ a 2xx
+ * (delivered) or 5xx (refused) reply code is done w/; the others
+ * are tried again later (see Spool), MaxAttempts times at most;
+ * if none was reached, the destination is held back too. The
+ * message is Delivered (or Bounced, if any recipient refused) once
+ * no recipient is left.
+ * @args:	message id (uint64_t id)
+ * 			reply code per recipient (see MailSenderSmtp::send)
+ * @return:	Delivered, Bounced or Deferred (State)
+ */
+Spool::State
+Spool::done(uint64_t id, const vector<int> &status)
+{
+
+	lock_guard<mutex>	guard(Lock);
+	Entry			&e = Entries[id];
+	uint32_t		left = 0;
+	bool			reached = false;	// A recipient took it
+	time_t			now = time(NULL),
+					wait;
+
+	for (size_t k = 0; k < e.trying.size() && k < status.size(); k++) {
+
+		int		i = e.trying[k];
+
+		if (status[k] / 100 == 5)
+
+			e.bounced = true;
+
+		if (status[k] / 100 == 2)
+
+			reached = true;
+
+		if (status[k] / 100 == 2 || status[k] / 100 == 5)
+
+			e.done[i / 8] |= 1 << (i % 8);
+
+	}
+
+	e.trying.clear();
+
+	for (uint32_t i = 0; i < e.rcpts; i++)
+
+		left += !((e.done[i / 8] >> (i % 8)) & 1);
+
+	if (left == 0) {
+
+		State	state = e.bounced ? Bounced : Delivered;
+
+		finish(id, state);
+		return state;
+
+	}
+
+	if (++e.attempts >= MaxAttempts) {
+
+		Logger::shared().print(LogWarn, "spool: %s: %u recipient(s) "
+							   "not reached after %d tries, bounced",
+							   path(id).c_str(), left, (int)e.attempts);
+		finish(id, Bounced);
+		return Bounced;
+
+	}
+
+	wait = min((time_t)RetryAfter << (e.attempts - 1), (time_t)MaxRetryAfter);
+	e.state = Deferred;
+	e.next_try = now + wait * 3 / 4 + Jitter() % (wait / 2 + 1);
+	Counts[InFlight]--;
+	Counts[Deferred]++;
+	append(id, e, e.next_try);
+	Later.add(id, e.dest, e.next_try);
+
+	if (!reached)
+
+		Later.hold(e.dest, now + RetryAfter);
+
+	return Deferred;
+
+}
+
+/*
+ * Number of messages in a state: live ones for Pending, InFlight,
+ * Deferred; done w/ since open() for Delivered, Bounced.
+ * @args:	state (State state)
+ * @return:	# of messages (size_t)
+ */
+size_t
+Spool::count(State state)
+{
+
+	lock_guard<mutex>	guard(Lock);
+
+	return Counts[state];
+
+}
+
+/*
+ * Nothing to send now and nothing in flight: only Deferred messages,
+ * due later, are left.
+ * @return:	true (idle), false (work left)
+ */
+bool
+Spool::idle()
+{
+
+	lock_guard<mutex>	guard(Lock);
+
+	return Counts[Pending] == 0 && Counts[InFlight] == 0;
+
+}
+
+string
+Spool::path(uint64_t id) const
+{
+
+	return Dir + "/msg/" + to_string(id);
+
+}
+
+const char *
+Spool::state_name(State state)
+{
+
+	static const char	*names[] = { "pending", "in flight", "deferred",
+									 "delivered", "bounced" };
+
+	return names[state];
+
+}
+
+/*
+ * Encode a record of a message's state (see Record).
+ * @args:	where to add it (string &out)
+ * 			message id, its entry (uint64_t id, const Entry &e)
+ * 			record time (time_t t)
+ */
+void
+Spool::encode(string &out, uint64_t id, const Entry &e, time_t t) const
+{
+
+	Record			r;
+	size_t			at = out.size();
+
+	r.length = e.done.size();
+	r.id = id;
+	r.time = t;
+	r.state = e.state;
+	r.flags = e.bounced ? FlagBounced : 0;
+	r.attempts = e.attempts;
+	r.rcpts = e.rcpts;
+	r.dest = e.dest;
+	r.reserved = 0;
+
+	out.append((const char *)&r, sizeof(r));
+	out.append((const char *)e.done.data(), e.done.size());
+	r.crc = crc32(&out[at + sizeof(r.crc)],
+				  sizeof(r) - sizeof(r.crc) + r.length);
+	memcpy(&out[at], &r.crc, sizeof(r.crc));
+
+}
+
+/*
+ * Append a record to the buffer the committer writes out, waking
+ * it for the 1st record of a group (Lock held).
+ * @args:	message id, its entry (uint64_t id, const Entry &e)
+ * 			record time (time_t t)
+ */
+void
+Spool::append(uint64_t id, const Entry &e, time_t t)
+{
+
+	if (Buffer.empty())
+
+		Wake.notify_one();	// 1st of a group
+
+	encode(Buffer, id, e, t);
+	Appended++;
+
+}
+
+/*
+ * A message is done w/ (Lock held): record its final state, drop
+ * it, and have its file removed once the record is on disk.
+ * @args:	message id (uint64_t id), Delivered or Bounced (State state)
+ */
+void
+Spool::finish(uint64_t id, State state)
+{
+
+	Entry			&e = Entries[id];
+
+	Counts[e.state]--;
+	Counts[state]++;
+	e.state = state;
+	append(id, e, time(NULL));
+	Remove.push_back(id);
+	Entries.erase(id);
+
+}
+
+/*
+ * Committer thread: group commit. Takes all the records appended
+ * within CommitMs of the 1st (or until flush() is called), makes the message files
+ * they name durable (one syncfs()), then writes the records and
+ * fdatasync()s the journal; flush() waiters are then woken and the
+ * files of finished messages removed. Past CompactAfter records,
+ * the journal is rewritten instead (see compact).
+ * A group that fails to write or sync is cut back off the journal,
+ * so no later group follows a torn record (replay() would drop
+ * them all), and retried every RetryMs; its files stay until then.
+ * If the journal cannot be cut back, nothing more is committed.
+ * 	WHILE not stopping OR records left
+ * 		wait for records, then CommitMs
+ * 		IF new message files: syncfs
+ * 		write records, fdatasync journal
+ * 		IF failed: truncate journal, keep records, wait RetryMs
+ * 		ELSE remove files of finished messages
+ */
+void
+Spool::commit()
+{
+
+	unique_lock<mutex>	lock(Lock);
+	string			batch;
+	vector<uint64_t>	remove;
+	uint64_t		target,
+					n;
+	off_t			size;			// Journal before the group
+	bool			sync;
+	int				error = 0;
+
+	while (!Stopping || !Buffer.empty()) {
+
+		if (Buffer.empty()) {
+
+			Wake.wait(lock);
+			continue;
+
+		}
+
+		// Let the group fill up, unless it is waited for.
+		Wake.wait_for(lock, chrono::milliseconds(CommitMs),
+					  [this] { return Stopping || Waiting > 0; });
+
+		sync = SyncData;
+		SyncData = false;
+		target = Appended;
+		n = target - Durable;
+
+		if (Records + n > CompactAfter && Records + n > 2 * Entries.size() &&
+			(!sync || syncfs(Journal) == 0) && compact() == 0)
+
+			// Rewritten from Entries, the records pending included.
+			remove.swap(Remove);
+
+		else {
+
+			batch.swap(Buffer);
+			remove.swap(Remove);
+			lock.unlock();
+
+			if ((size = lseek(Journal, 0, SEEK_END)) < 0 ||
+				(sync && syncfs(Journal) != 0))
+
+				error = errno;
+
+			for (size_t off = 0; !error && off < batch.size(); ) {
+
+				ssize_t	w = write(Journal, batch.data() + off,
+								  batch.size() - off);
+
+				if (w < 0 && errno != EINTR)
+
+					error = errno;
+
+				off += max(w, (ssize_t)0);
+
+			}
+
+			if (!error && fdatasync(Journal) != 0)
+
+				error = errno;
+
+			if (error && (size < 0 || ftruncate(Journal, size) != 0))
+
+				Broken = true;		// Torn record stays
+
+			lock.lock();
+
+			if (error) {
+
+				// Not on disk: again, before what came in since.
+				Buffer.insert(0, batch);
+				Remove.insert(Remove.begin(), remove.begin(), remove.end());
+				remove.clear();
+				SyncData = SyncData || sync;
+
+			}
+			else
+
+				Records += n;
+
+			batch.clear();
+
+		}
+
+		if (error) {
+
+			Logger::shared().print(LogError, "spool: journal: %s, %llu "
+								   "records %s", strerror(error),
+								   (unsigned long long)(Appended - Durable),
+								   Broken ? "not written, journal left "
+								   "torn" : Stopping ? "not written"
+								   : "to retry");
+			Failed = error;
+			error = 0;
+			Committed.notify_all();		// flush() fails
+
+			if (Broken || Stopping)
+
+				break;
+
+			Wake.wait_for(lock, chrono::milliseconds(RetryMs),
+						  [this] { return Stopping; });
+			continue;
+
+		}
+
+		Failed = 0;
+		Durable = target;
+		Committed.notify_all();
+		lock.unlock();
+
+		for (size_t i = 0; i < remove.size(); i++)
+
+			unlink(path(remove[i]).c_str());
+
+		remove.clear();
+		lock.lock();
+
+	}
+
+}
+
+/*
+ * Rebuild the state of the messages from the journal: records are
+ * applied in order, the last one of a message winning; a Delivered
+ * or Bounced message is dropped. The first record that is short or
+ * fails its checksum ends the journal (torn by a crash while being
+ * written), and is cut off. Then
+ * 	InFlight messages (at the crash) are Pending again
+ * 	message files w/o a live message are removed (enqueue not
+ * 	committed, or finished but not removed yet)
+ * 	messages w/o a file are dropped, w/ an error logged
+ * @return:	0 (success)
+ *  -error:	-1 (file error, errno)
+ */
+int
+Spool::replay()
+{
+
+	string			data;
+	char			chunk[65536];
+	ssize_t			n;
+	size_t			off = 0;
+	Record			r;
+	DIR				*dir;
+	struct dirent	*d;
+	vector<uint64_t>	ids;
+
+	while ((n = read(Journal, chunk, sizeof(chunk))) > 0)
+
+		data.append(chunk, n);
+
+	if (n < 0)
+
+		return -1;		// Errno set
+
+	while (off + sizeof(r) <= data.size()) {
+
+		memcpy(&r, &data[off], sizeof(r));
+
+		if (r.length > MaxBitmap || r.state > Bounced ||
+			off + sizeof(r) + r.length > data.size() ||
+			crc32(&data[off + sizeof(r.crc)],
+				  sizeof(r) - sizeof(r.crc) + r.length) != r.crc)
+
+			break;		// Torn or corrupt: end of journal
+
+		NextId = max(NextId, r.id + 1);
+
+		if (r.state == Delivered || r.state == Bounced)
+
+			Entries.erase(r.id);
+
+		else {
+
+			Entry			&e = Entries[r.id];
+
+			e.state = (State)r.state;
+			e.attempts = r.attempts;
+			e.rcpts = r.rcpts;
+			e.dest = r.dest;
+			e.next_try = r.state == Deferred ? r.time : 0;
+			e.done.assign(data.begin() + off + sizeof(r),
+						  data.begin() + off + sizeof(r) + r.length);
+			e.done.resize((e.rcpts + 7) / 8, 0);
+			e.bounced = (r.flags & FlagBounced) != 0;
+
+		}
+
+		off += sizeof(r) + r.length;
+		Records++;
+
+	}
+
+	if (off < data.size()) {
+
+		Logger::shared().print(LogWarn, "spool: journal: %zu bytes of a "
+							   "torn record cut off", data.size() - off);
+
+		if (ftruncate(Journal, off) != 0)
+
+			return -1;	// Errno set
+
+	}
+
+	// Files of live messages; the rest go.
+	if ((dir = opendir((Dir + "/msg").c_str())) == NULL)
+
+		return -1;		// Errno set
+
+	while ((d = readdir(dir)) != NULL) {
+
+		char		*end;
+		uint64_t	id = strtoull(d->d_name, &end, 10);
+
+		if (d->d_name[0] == '.' && (d->d_name[1] == '\0' ||
+									strcmp(d->d_name, "..") == 0))
+
+			continue;
+
+		if (*end == '\0' && isdigit(d->d_name[0]) && Entries.count(id))
+
+			ids.push_back(id);
+
+		else
+
+			unlink((Dir + "/msg/" + d->d_name).c_str());
+
+	}
+
+	closedir(dir);
+	sort(ids.begin(), ids.end());
+
+	for (unordered_map<uint64_t, Entry>::iterator e = Entries.begin();
+		 e != Entries.end(); ) {
+
+		if (!binary_search(ids.begin(), ids.end(), e->first)) {
+
+			Logger::shared().print(LogError, "spool: %s: message file lost",
+								   path(e->first).c_str());
+			e = Entries.erase(e);
+
+		}
+		else
+
+			++e;
+
+	}
+
+	// Queue in order of enqueueing, Deferred by next try.
+	for (size_t i = 0; i < ids.size(); i++) {
+
+		Entry			&e = Entries[ids[i]];
+
+		if (e.state == Deferred)
+
+			Later.add(ids[i], e.dest, e.next_try);
+
+		else {
+
+			e.state = Pending;
+			Queue.push_back(ids[i]);
+
+		}
+
+		Counts[e.state]++;
+
+	}
+
+	return 0;
+
+}
+
+/*
+ * Rewrite the journal w/ one record per live message, under a
+ * temporary name, synced and renamed into place, so a crash leaves
+ * either journal whole. The new journal is then appended to.
+ * Called at open(), and by the committer w/ Lock held.
+ * @return:	0 (success)
+ *  -error:	-1 (file error, errno; the old journal stays)
+ */
+int
+Spool::compact()
+{
+
+	string			name = Dir + "/journal",
+					tmp = name + ".tmp",
+					records;
+	int				fd,
+					dirfd;
+	bool			ok;
+
+	for (unordered_map<uint64_t, Entry>::iterator e = Entries.begin();
+		 e != Entries.end(); ++e)
+
+		encode(records, e->first, e->second,
+			   e->second.state == Deferred ? e->second.next_try : time(NULL));
+
+	if ((fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND,
+					 0600)) < 0)
+
+		return -1;		// Errno set
+
+	errno = 0;
+	ok = write(fd, records.data(), records.size()) ==
+		 (ssize_t)records.size() && fdatasync(fd) == 0;
+
+	if (!ok || rename(tmp.c_str(), name.c_str()) != 0) {
+
+		int		error = errno ? errno : EIO;
+
+		::close(fd);
+		unlink(tmp.c_str());
+		errno = error;
+		return -1;
+
+	}
+
+	// The rename itself, durable
+	if ((dirfd = ::open(Dir.c_str(), O_RDONLY | O_DIRECTORY)) >= 0) {
+
+		fsync(dirfd);
+		::close(dirfd);
+
+	}
+
+	::close(Journal);
+	Journal = fd;				// Appended to from now on
+	Records = Entries.size();
+	Buffer.clear();
+
+	return 0;
+
+}
+
+/*
+ * Destination group of an address: FNV-1a hash of its domain, in
+ * lower case (two domains sharing a hash share a group).
+ * @args:	e-mail address (const string &addr)
+ * @return:	group (uint32_t)
+ */
+uint32_t
+Spool::destination(const string &addr)
+{
+
+	uint32_t		h = 2166136261u;
+
+	for (size_t i = addr.rfind('@') + 1; i < addr.length(); i++)
+
+		h = (h ^ (uint8_t)tolower(addr[i])) * 16777619u;
+
+	return h;
+
+}
+
+/*
+ * CRC-32 (IEEE 802.3, reflected), a byte at a time from a table
+ * built on first use.
+ * @args:	data, its length (const void *data, size_t len)
+ * 			CRC so far (uint32_t crc)
+ * @return:	CRC (uint32_t)
+ */
+uint32_t
+Spool::crc32(const void *data, size_t len, uint32_t crc)
+{
+
+	static uint32_t	table[256];
+	static once_flag	built;
+	const uint8_t	*p = (const uint8_t *)data;
+
+	call_once(built, [] {
+
+		for (uint32_t i = 0; i < 256; i++) {
+
+			uint32_t	c = i;
+
+			for (int k = 0; k < 8; k++)
+
+				c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+
+			table[i] = c;
+
+		}
+
+	});
+
+	crc = ~crc;
+
+	while (len-- > 0)
+
+		crc = table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+
+	return ~crc;
+
+}
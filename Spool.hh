@@ -0,0 +1,237 @@
+/*
+ * Mail-Sending Program
+ * Spool.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+
+#ifndef SPOOL_HH_
+#define SPOOL_HH_
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <ctime>
+#include <random>
+#include <stdint.h>
+#include "TimingWheel.hh"
+
+using namespace std;
+
+/*
+ * Spool object
+ * A durable on-disk delivery queue. A message is enqueued once, as
+ * a wire file (see WireFile.hh) under <dir>/msg/<id>, and every
+ * change of its state
+ * 	Pending -> InFlight -> Delivered | Bounced | Deferred -> ...
+ * is appended to <dir>/journal, a log of fixed-size, checksummed
+ * records. A record also holds which recipients are done, so a
+ * retry goes only to the others.
+ * Deferred messages wait in a TimingWheel, grouped by destination
+ * (the domain of their 1st recipient left): a retry comes after
+ * RetryAfter secs., doubling each try up to MaxRetryAfter, +/- 25%
+ * at random so retries do not bunch up. A try where no recipient
+ * was reached also holds the destination's other due retries back
+ * for RetryAfter secs., after which they are let out in growing
+ * batches (see TimingWheel).
+ * Records are written and made durable by a committer thread in
+ * groups (group commit): one syncfs() for the message files and one
+ * fdatasync() of the journal for all the messages that came in
+ * within CommitMs (or until someone waits in flush()). A message file is removed only once its final
+ * record is on disk; a group that fails is cut back off the journal
+ * and retried.
+ * open() replays the journal: the last record of a message wins,
+ * messages in flight at the crash are Pending again, a torn record
+ * at the end is cut off, files w/o a record are removed, and the
+ * journal is rewritten w/ one record per live message (also done
+ * when it grows past CompactAfter records).
+ * So mail is neither lost (enqueued: on disk before its record) nor
+ * sent twice, but for the messages in flight at a crash.
+ * @methods:	open, close, enqueue, flush, next, done, count, idle
+ */
+class Spool
+{
+  public:
+
+	enum State { Pending, InFlight, Deferred, Delivered, Bounced };
+
+	enum { CommitMs = 2,			// Group commit window
+		   CompactAfter = 100000,	// Journal records before compacting
+		   MaxAttempts = 12,		// Tries before bouncing (~16 h)
+		   RetryAfter = 60,			// Secs. before 1st retry, doubles
+		   MaxRetryAfter = 14400,	// Longest wait between tries
+		   RetryMs = 1000 };		// Wait before a failed commit again
+
+			 Spool();
+
+			 ~Spool();
+
+	 // Open (or create) a spool directory, recover its state.
+
+	int				open(const string &dir);
+
+	 // Commit what is left and stop.
+
+	void			close();
+
+	 // Add a plain message file to the spool, as a wire file.
+
+	int				enqueue(const string &filename,
+							const string &env_from,
+							const vector<string> &env_to,
+							uint64_t &id);
+
+	 // Wait until everything so far is on disk.
+
+	int				flush();
+
+	 // Message to send now, if any (up to wait_ms): its wire file,
+
+	 // the file it was enqueued from, and the recipients not done
+
+	 // yet. It is InFlight until done().
+
+	bool			next(uint64_t &id,
+						 string &path,
+						 string &source,
+						 string &env_from,
+						 vector<string> &env_to,
+						 int wait_ms = 0);
+
+	 // Result of sending a message from next(): reply code per
+
+	 // recipient given. Returns the state it is left in.
+
+	State			done(uint64_t id, const vector<int> &status);
+
+	 // # of messages in a state (Delivered, Bounced: since open).
+
+	size_t			count(State state);
+
+	 // Nothing to send, now or later, but Deferred messages.
+
+	bool			idle();
+
+	 // Wire file of a message.
+
+	string			path(uint64_t id) const;
+
+	static const char	*state_name(State state);
+
+  private:
+
+	 // Journal record: a fixed header, then a bitmap of the
+
+	 // recipients done w/. crc covers everything after it.
+
+	enum { FlagBounced = 1 };		// Some recipient refused
+
+	struct Record {
+		uint32_t		crc,
+						length;		// Bytes after the header
+		uint64_t		id,
+						time;		// Deferred: next try, epoch secs.
+		uint8_t			state,
+						flags;		// FlagBounced
+		uint16_t		attempts;
+		uint32_t		rcpts,		// # of recipients
+						dest,		// Destination (see destination)
+						reserved;
+	};
+
+	struct Entry {
+		State			state;
+		uint16_t		attempts;
+		uint32_t		rcpts,
+						dest;
+		time_t			next_try;
+		vector<uint8_t>	done;		// Bit per recipient: done w/
+		vector<int>		trying;		// Recipients sent to (InFlight)
+		bool			bounced;	// Some recipient refused
+	};
+
+	string			Dir;
+	int				Journal;		// Journal fd, O_APPEND
+	uint64_t		NextId;
+	mutex			Lock;			// Guards all below
+	condition_variable	Wake,		// Records to commit, or stop
+					Committed,		// Durable moved on
+					Ready;			// A message became Pending
+	unordered_map<uint64_t, Entry>	Entries;	// Live messages
+	deque<uint64_t>	Queue;			// Pending, in order
+	TimingWheel		Later;			// Deferred, by next try
+	minstd_rand		Jitter;			// Of retry times
+	string			Buffer;			// Records not written yet
+	vector<uint64_t>	Remove;		// Files to remove after commit
+	bool			SyncData,		// New message files in Buffer
+					Stopping,
+					Broken;			// Journal ends torn: commit no more
+	int				Waiting;		// Threads in flush()
+	uint64_t		Appended,		// Records appended, in all
+					Durable,		// ... and on disk
+					Records;		// Records in the journal file
+	int				Failed;			// errno of a failed commit, or 0
+	size_t			Counts[Bounced + 1];
+	thread			Committer;
+
+	 // Journal a message's state: encode a record, append it to
+
+	 // Buffer for the committer, finish a message (Lock held).
+
+	void			encode(string &out, uint64_t id, const Entry &e,
+						   time_t t) const;
+
+	void			append(uint64_t id, const Entry &e, time_t t);
+
+	void			finish(uint64_t id, State state);
+
+	 // Committer thread, recovery, journal rewrite.
+
+	void			commit();
+
+	int				replay();
+
+	int				compact();
+
+	 // Destination group of an address: hash of its domain.
+
+	static uint32_t	destination(const string &addr);
+
+	static uint32_t	crc32(const void *data, size_t len, uint32_t crc = 0);
+
+};
+
+#endif /* SPOOL_HH_ */
@@ -0,0 +1,395 @@
+/*
+ * Mail-Sending Program
+ * TimingWheel.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+
+#include "TimingWheel.hh"
+#include <algorithm>
+
+using namespace std;
+
+TimingWheel::TimingWheel(time_t now):
+	Now(now), Free(None), Count(0)
+{
+
+	for (int l = 0; l < Levels; l++)
+
+		for (int s = 0; s < Slots; s++)
+
+			Wheel[l][s].head = Wheel[l][s].tail = None;
+
+}
+
+/*
+ * Schedule an id: take a node (from the free list if any), find or
+ * make the destination's group and place the node in the wheel.
+ * @args:	id (uint64_t id), destination group (uint32_t dest)
+ * 			time due, epoch secs. (time_t when)
+ * @return:	handle (uint32_t)
+ */
+uint32_t
+TimingWheel::add(uint64_t id, uint32_t dest, time_t when)
+{
+
+	unordered_map<uint32_t, uint32_t>::iterator	g = GroupOf.find(dest);
+	uint32_t		n;
+
+	if (g == GroupOf.end()) {
+
+		Group			group;
+
+		group.due.head = group.due.tail = None;
+		group.held_until = 0;
+		group.second = Now;
+		group.rate = group.quota = MaxBatch;
+		group.turn = group.stalled = false;
+		g = GroupOf.insert(make_pair(dest, (uint32_t)Groups.size())).first;
+		Groups.push_back(group);
+
+	}
+
+	if (Free != None) {
+
+		n = Free;
+		Free = Nodes[n].next;
+
+	}
+	else {
+
+		n = Nodes.size();
+		Nodes.push_back(Node());
+
+	}
+
+	Nodes[n].id = id;
+	Nodes[n].when = when;
+	Nodes[n].group = g->second;
+	place(n);
+	Count++;
+
+	return n;
+
+}
+
+/*
+ * Take a scheduled or due id out, and free its node.
+ * @args:	handle from add() (uint32_t handle)
+ */
+void
+TimingWheel::cancel(uint32_t handle)
+{
+
+	unlink(list_of(Nodes[handle]), handle);
+	Nodes[handle].next = Free;
+	Free = handle;
+	Count--;
+
+}
+
+/*
+ * Tick the clock on, a second at a time, to now. At each second,
+ * the slots of the higher levels starting then cascade (top level
+ * first), their timers placed again a level or more lower, and
+ * then the level 0 slot of the second expires: its timers are due.
+ * Then the stalled groups get another chance (see release).
+ * 	WHILE clock < now
+ * 		clock++
+ * 		FOR each level L (high to low) whose slot starts now
+ * 			place again the timers of L's slot
+ * 		place the timers of level 0's slot (now due)
+ * 	release stalled groups
+ * @args:	time now, epoch secs. (time_t now)
+ */
+void
+TimingWheel::advance(time_t now)
+{
+
+	if (now <= Now)
+
+		return;
+
+	if (Count == 0)
+
+		Now = now;			// Nothing to tick through
+
+	while (Now < now) {
+
+		int				top = 0;
+
+		Now++;
+
+		while (top < Levels - 1 &&
+			   (Now & ((1LL << (SlotBits * (top + 1))) - 1)) == 0)
+
+			top++;
+
+		for (int l = top; l >= 0; l--) {
+
+			List		&slot = Wheel[l][(Now >> (SlotBits * l)) & (Slots - 1)];
+			uint32_t	n = slot.head;
+
+			slot.head = slot.tail = None;
+
+			while (n != None) {
+
+				uint32_t	next = Nodes[n].next;
+
+				place(n);
+				n = next;
+
+			}
+
+		}
+
+	}
+
+	vector<uint32_t>	stalled;
+
+	stalled.swap(Stalled);
+
+	for (size_t i = 0; i < stalled.size(); i++) {
+
+		Groups[stalled[i]].stalled = false;
+		release(stalled[i]);
+
+	}
+
+}
+
+/*
+ * Next due id: from the group whose turn it is, if it is not held
+ * and has quota left this second; the group then goes to the back
+ * of the turns. Its node is freed.
+ * @args:	id, out (uint64_t &id)
+ * @return:	true (id), false (nothing may go before the next second)
+ */
+bool
+TimingWheel::pop(uint64_t &id)
+{
+
+	while (!Turns.empty()) {
+
+		uint32_t		g = Turns.front(),
+						n;
+		Group			&group = Groups[g];
+
+		Turns.pop_front();
+		group.turn = false;
+
+		if ((n = group.due.head) == None || group.held_until > Now ||
+			group.quota == 0) {
+
+			release(g);		// Stalled, or no ids left
+			continue;
+
+		}
+
+		unlink(group.due, n);
+		id = Nodes[n].id;
+		Nodes[n].next = Free;
+		Free = n;
+		Count--;
+		group.quota--;
+		release(g);
+
+		return true;
+
+	}
+
+	return false;
+
+}
+
+/*
+ * Hold the due ids of a destination back until a time; past it,
+ * the group starts again at MinBatch a second (see advance).
+ * @args:	destination group (uint32_t dest)
+ * 			end of the hold, epoch secs. (time_t until)
+ */
+void
+TimingWheel::hold(uint32_t dest, time_t until)
+{
+
+	unordered_map<uint32_t, uint32_t>::iterator	g = GroupOf.find(dest);
+
+	if (g != GroupOf.end())
+
+		Groups[g->second].held_until = max(Groups[g->second].held_until,
+										   until);
+
+}
+
+/*
+ * Put a node where its time says: due (at or before the clock) in
+ * its group's list, else in the lowest level whose slot holds the
+ * time w/ the clock in the same slot a level up. A time past the
+ * top wheel goes to the top slot cascaded last, to be placed again.
+ * @args:	node (uint32_t n)
+ */
+void
+TimingWheel::place(uint32_t n)
+{
+
+	Node			&node = Nodes[n];
+	int				l = 0;
+	uint32_t		slot;
+
+	if (node.when <= Now) {
+
+		node.list = Due;
+		link(Groups[node.group].due, n);
+		release(node.group);
+		return;
+
+	}
+
+	while (l < Levels - 1 && (node.when >> (SlotBits * (l + 1))) !=
+							 (Now >> (SlotBits * (l + 1))))
+
+		l++;
+
+	if ((node.when >> (SlotBits * (l + 1))) != (Now >> (SlotBits * (l + 1))))
+
+		slot = ((Now >> (SlotBits * l)) - 1) & (Slots - 1);	// Too far
+
+	else
+
+		slot = (node.when >> (SlotBits * l)) & (Slots - 1);
+
+	node.list = l * Slots + slot;
+	link(Wheel[l][slot], n);
+
+}
+
+/*
+ * Give a group w/ due ids its turn, if it is not held and has quota
+ * left. Its quota is refilled to its rate the 1st time in a second:
+ * twice the rate if the last batch was used up (up to MaxBatch),
+ * MinBatch if a hold just ended. A held group, or one w/o quota,
+ * is stalled: advance() tries it again next second.
+ * @args:	group index (uint32_t g)
+ */
+void
+TimingWheel::release(uint32_t g)
+{
+
+	Group			&group = Groups[g];
+
+	if (group.turn || group.stalled || group.due.head == None)
+
+		return;
+
+	if (group.second != Now && group.held_until <= Now) {
+
+		if (group.held_until != 0) {
+
+			group.held_until = 0;	// Back: start slow
+			group.rate = MinBatch;
+
+		}
+		else if (group.quota == 0)
+
+			group.rate = min(group.rate * 2, (uint32_t)MaxBatch);
+
+		group.quota = group.rate;
+		group.second = Now;
+
+	}
+
+	if (group.held_until > Now || group.quota == 0) {
+
+		group.stalled = true;
+		Stalled.push_back(g);
+
+	}
+	else {
+
+		group.turn = true;
+		Turns.push_back(g);
+
+	}
+
+}
+
+void
+TimingWheel::link(List &list, uint32_t n)
+{
+
+	Nodes[n].next = None;
+	Nodes[n].prev = list.tail;
+
+	if (list.tail != None)
+
+		Nodes[list.tail].next = n;
+
+	else
+
+		list.head = n;
+
+	list.tail = n;
+
+}
+
+void
+TimingWheel::unlink(List &list, uint32_t n)
+{
+
+	Node			&node = Nodes[n];
+
+	if (node.prev != None)
+
+		Nodes[node.prev].next = node.next;
+
+	else
+
+		list.head = node.next;
+
+	if (node.next != None)
+
+		Nodes[node.next].prev = node.prev;
+
+	else
+
+		list.tail = node.prev;
+
+}
+
+TimingWheel::List &
+TimingWheel::list_of(const Node &node)
+{
+
+	return node.list == Due ? Groups[node.group].due :
+		   Wheel[node.list / Slots][node.list % Slots];
+
+}
@@ -0,0 +1,163 @@
+/*
+ * Mail-Sending Program
+ * TimingWheel.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+
+#ifndef TIMINGWHEEL_HH_
+#define TIMINGWHEEL_HH_
+
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <ctime>
+#include <stdint.h>
+
+using namespace std;
+
+/*
+ * TimingWheel object
+ * Schedules ids (deferred messages) to come due at a time, in 1 s
+ * ticks, for any number of them: a hierarchical timing wheel of
+ * Levels wheels of Slots slots, level L slots Slots^L seconds wide,
+ * so up to Slots^Levels seconds (194 days) ahead. A timer goes into
+ * the lowest level it fits; when the clock reaches a slot of a
+ * higher level, its timers move down a level ("cascade"), and
+ * those of the level 0 slot of the second are due. Timers are kept
+ * in doubly linked lists of a node pool, so add, cancel and expiry
+ * are O(1) each.
+ * Each id belongs to a destination group. Due ids wait in their
+ * group's list, and pop() takes them in turn from the groups, each
+ * releasing at most its rate per second: MaxBatch, but after a
+ * hold() (the destination deferring) the group keeps its ids until
+ * the hold ends, then starts again at MinBatch a second, doubling
+ * each second its batch is used up. So the backlog of a destination
+ * that comes back is let out gradually, not all at once.
+ * Not thread-safe: the caller locks.
+ * @methods:	add, cancel, advance, pop, hold, size
+ */
+class TimingWheel
+{
+  public:
+
+	enum { Levels = 4,				// Wheels
+		   SlotBits = 6,			// log2 of Slots
+		   Slots = 1 << SlotBits,	// Slots per wheel
+		   MinBatch = 8,			// Ids/s of a group just released
+		   MaxBatch = 4096 };		// Ids/s of a group at full speed
+
+	enum { None = 0xffffffff };		// No node (add() never returns it)
+
+			 TimingWheel(time_t now = time(NULL));
+
+	 // Schedule id to be due at when, in group dest; returns a
+
+	 // handle for cancel(), good until the id is popped.
+
+	uint32_t		add(uint64_t id, uint32_t dest, time_t when);
+
+	 // Take an id out, due or not.
+
+	void			cancel(uint32_t handle);
+
+	 // Move the clock on to now; timers passed are due.
+
+	void			advance(time_t now);
+
+	 // Next due id, groups taking turns; false if none may go now.
+
+	bool			pop(uint64_t &id);
+
+	 // Keep the due ids of group dest back until until.
+
+	void			hold(uint32_t dest, time_t until);
+
+	 // # of ids scheduled or due.
+
+	size_t			size() const { return Count; }
+
+  private:
+
+	enum { Due = Levels * Slots };	// Node's list: a group's due list
+
+	struct List {
+		uint32_t		head,
+						tail;
+	};
+
+	struct Node {
+		uint64_t		id;
+		time_t			when;
+		uint32_t		next,		// In list, or free list
+						prev,
+						group,		// Index in Groups
+						list;		// Level * Slots + slot, or Due
+	};
+
+	struct Group {
+		List			due;		// Due ids, in order
+		time_t			held_until,
+						second;		// Second of quota
+		uint32_t		rate,		// Ids released per second
+						quota;		// ... left that second
+		bool			turn,		// In Turns
+						stalled;	// In Stalled
+	};
+
+	time_t			Now;
+	vector<Node>	Nodes;
+	uint32_t		Free;			// Free list of Nodes
+	size_t			Count;
+	List			Wheel[Levels][Slots];
+	vector<Group>	Groups;
+	unordered_map<uint32_t, uint32_t>	GroupOf;	// dest -> Groups
+	deque<uint32_t>	Turns;			// Groups w/ ids to release
+	vector<uint32_t>	Stalled;	// ... held or out of quota
+
+	 // Put a node in the wheel (or its due list) for its time.
+
+	void			place(uint32_t n);
+
+	 // Give a group its turn, or stall it till a later second.
+
+	void			release(uint32_t g);
+
+	void			link(List &list, uint32_t n);
+
+	void			unlink(List &list, uint32_t n);
+
+	List			&list_of(const Node &node);
+
+};
+
+#endif /* TIMINGWHEEL_HH_ */
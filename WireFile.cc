@@ -0,0 +1,279 @@
+/*
+ * Mail-Sending Program
+ * WireFile.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+#include "WireFile.hh"
+#include "SmtpData.hh"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+/*
+ * Convert a plain message file to a wire file. The wire file is
+ * written under a temporary name and renamed into place, so a
+ * reader never sees half of it.
+ * 	Write envelope: magic line, "S <source>", "F <sender>",
+ * 	"T <recipient>"..., blank line
+ * 	Write header w/o Bcc: fields, encoded (SmtpDataEncoder)
+ * 	WHILE read chunk != EOF
+ * 		write chunk, encoded (CRLF, dot-stuffing)
+ * 	write ".<CRLF>" (end of data)
+ * @args:	plain message file (const string &src)
+ * 			wire file to write (const string &dst)
+ * 			envelope sender, recipients (see GetEnvelope)
+ * @return:	0 (success)
+ *  -error:	-1 (file error, errno)
+ */
+int
+WirePrepare(const string &src,
+			const string &dst,
+			const string &env_from,
+			const vector<string> &env_to)
+{
+
+	const size_t	chunk = 65536;	// Bytes read at a time
+	ifstream		fin;
+	ofstream		fout;
+	string			header,			// Header w/o Bcc: fields
+					tmp = dst + ".tmp";
+	vector<char>	in(chunk),
+					out(SmtpDataEncoder::max_output(chunk) +
+						SmtpDataEncoder::MaxFinish);
+	SmtpDataEncoder	encoder;
+
+	fin.open(src.c_str(), ios::in | ios::binary);
+
+	if (!fin.is_open())
+
+		return -1;		// Errno set
+
+	fout.open(tmp.c_str(), ios::out | ios::binary | ios::trunc);
+
+	if (!fout.is_open())
+
+		return -1;		// Errno set
+
+	fout << WireMagic << "\n" << "S " << src << "\n"
+		 << "F " << env_from << "\n";
+
+	for (unsigned int i = 0; i < env_to.size(); i++)
+
+		fout << "T " << env_to[i] << "\n";
+
+	fout << "\n";
+
+	ReadDataHeader(fin, header);
+
+	for (size_t i = 0; i < header.length(); i += chunk)
+
+		fout.write(&out[0],
+				   encoder.encode(header.data() + i,
+								  min(chunk, header.length() - i),
+								  &out[0]));
+
+	while (fin.read(&in[0], chunk) || fin.gcount() > 0)
+
+		fout.write(&out[0], encoder.encode(&in[0], fin.gcount(), &out[0]));
+
+	fout.write(&out[0], encoder.finish(&out[0]));	// End of data
+	fout.close();
+
+	if (fout.fail() || fin.bad() || rename(tmp.c_str(), dst.c_str()) != 0) {
+
+		int		saved = errno;
+
+		unlink(tmp.c_str());
+		errno = saved ? saved : EIO;
+		return -1;
+
+	}
+
+	return 0;
+
+}
+
+/*
+ * Check the first line of a file for the wire file magic, w/ one
+ * pread() into a buffer on the stack.
+ * @args:	file name (const string &path)
+ * @return:	true (wire file), false (plain file or unreadable)
+ */
+bool
+WireCheck(const string &path)
+{
+
+	char			head[64];		// Magic line and more
+	ssize_t			n;
+	int				fd;
+
+	if ((fd = open(path.c_str(), O_RDONLY)) < 0)
+
+		return false;
+
+	n = pread(fd, head, sizeof(head), 0);
+	close(fd);
+
+	return n >= (ssize_t)WireMagic.length() &&
+		   WireMagic.compare(0, string::npos, head,
+							 WireMagic.length()) == 0 &&
+		   (n == (ssize_t)WireMagic.length() ||
+			head[WireMagic.length()] == '\n');
+
+}
+
+/*
+ * Find the message data of a wire file from its first bytes (e.g.
+ * a sender's first read of it): past the blank line that ends the
+ * envelope. No copy of the envelope is made.
+ * @args:	start of a file (const char *head, size_t len)
+ * @return:	offset of the message data (off_t)
+ * 			0 (not a wire file)
+ *  -error:	-1 (envelope not all in head)
+ */
+off_t
+WireData(const char *head, size_t len)
+{
+
+	const char		*end;
+	size_t			magic = WireMagic.length();
+
+	if (len <= magic || WireMagic.compare(0, string::npos, head, magic) != 0 ||
+		head[magic] != '\n')
+
+		return 0;		// Not a wire file
+
+	if ((end = (const char *)memmem(head + magic, len - magic,
+									"\n\n", 2)) == NULL)
+
+		return -1;
+
+	return end + 2 - head;
+
+}
+
+/*
+ * Open a wire file and read its envelope. The returned descriptor
+ * is used to sendfile() the message data, which starts at offset
+ * and runs to the end of the file.
+ * @args:	wire file name (const string &path)
+ * 			envelope sender, recipients (returned)
+ * 			offset & length of the message data (returned)
+ * 			source file name, "" if not recorded (returned, if
+ * 			source is not NULL)
+ * @return:	file descriptor (success)
+ *  -error:	-1 (file error, errno; not a wire file, errno EINVAL)
+ */
+int
+WireOpen(const string &path,
+		 string &env_from,
+		 vector<string> &env_to,
+		 off_t &offset,
+		 off_t &length,
+		 string *source)
+{
+
+	ifstream		fin(path.c_str(), ios::in | ios::binary);
+	string			line;
+	struct stat		st;
+	int				fd;
+
+	env_from.clear();
+	env_to.clear();
+
+	if (source != NULL)
+
+		source->clear();
+
+	if (!fin.is_open())
+
+		return -1;		// Errno set
+
+	if (!getline(fin, line) || line != WireMagic) {
+
+		errno = EINVAL;
+		return -1;		// Not a wire file
+
+	}
+
+	while (getline(fin, line) && !line.empty()) {
+
+		if (line.compare(0, 2, "F ") == 0)
+
+			env_from = line.substr(2);
+
+		else if (line.compare(0, 2, "T ") == 0)
+
+			env_to.push_back(line.substr(2));
+
+		else if (line.compare(0, 2, "S ") == 0 && source != NULL)
+
+			*source = line.substr(2);
+
+	}
+
+	if (!fin || env_from.empty() || env_to.empty()) {
+
+		errno = EINVAL;
+		return -1;		// Truncated envelope
+
+	}
+
+	offset = fin.tellg();
+	fin.close();
+
+	if ((fd = open(path.c_str(), O_RDONLY)) < 0)
+
+		return -1;		// Errno set
+
+	if (fstat(fd, &st) != 0) {
+
+		close(fd);
+		return -1;
+
+	}
+
+	length = st.st_size - offset;
+
+	return fd;
+
+}
@@ -0,0 +1,97 @@
+/*
+ * Mail-Sending Program
+ * WireFile.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+#ifndef WIREFILE_HH_
+#define WIREFILE_HH_
+
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+using namespace std;
+
+/*
+ * Wire-ready message files
+ * A wire file holds a message exactly as it goes out after the
+ * server's "354": CRLF line endings, leading dots doubled, Bcc
+ * fields removed and the final ".<CRLF>" in place. The DATA phase
+ * can then sendfile() it from the page cache to the socket w/o
+ * copying it through user space.
+ * Since Bcc is gone from the header, the envelope is stored in
+ * front of the data:
+ * 	MAILSENDER-WIRE 1\n
+ * 	S <source file>\n		(plain file it was made from, if any)
+ * 	F <sender>\n
+ * 	T <recipient>\n			(one per recipient)
+ * 	\n
+ * 	<message data>
+ * Plain message files are converted once, when they enter the
+ * system (see WirePrepare).
+ */
+
+const string	WireMagic = "MAILSENDER-WIRE 1";	// 1st line
+const string	WireSuffix = ".wire";				// File name suffix
+
+// Convert a plain message file to a wire file (atomically).
+
+int				WirePrepare(const string &src,
+							const string &dst,
+							const string &env_from,
+							const vector<string> &env_to);
+
+// Check whether a file is a wire file.
+
+bool			WireCheck(const string &path);
+
+// Offset of the message data, from the first bytes of a file:
+
+// 0 if not a wire file, -1 if its envelope is longer than len.
+
+off_t			WireData(const char *head, size_t len);
+
+// Open a wire file: read its envelope (and source file name, if
+
+// asked), return a file descriptor and the offset/length of the
+
+// message data.
+
+int				WireOpen(const string &path,
+						 string &env_from,
+						 vector<string> &env_to,
+						 off_t &offset,
+						 off_t &length,
+						 string *source = NULL);
+
+#endif /* WIREFILE_HH_ */
@@ -0,0 +1,148 @@
+/*
+ * Mail-Sending Program
+ * WorkQueue.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+#include "WorkQueue.hh"
+
+using namespace std;
+
+/*
+ * Create an empty deque per worker.
+ * @args:	# of worker threads (int workers)
+ */
+WorkQueue::WorkQueue(int workers): Steals(0)
+{
+
+	for (int i = 0; i < workers; i++)
+
+		Deques.push_back(new Deque);
+
+}
+
+WorkQueue::~WorkQueue()
+{
+
+	for (size_t i = 0; i < Deques.size(); i++)
+
+		delete Deques[i];
+
+}
+
+/*
+ * Add an item to the back of a worker's deque.
+ * @args:	worker # (int worker), item (size_t item)
+ */
+void
+WorkQueue::push(int worker, size_t item)
+{
+
+	lock_guard<mutex>	guard(Deques[worker]->lock);
+
+	Deques[worker]->items.push_back(item);
+
+}
+
+/*
+ * Next item for a worker: the front of its own deque or, once that
+ * is empty, an item stolen from another worker.
+ * @args:	worker # (int worker), next item (size_t &item)
+ * @return:	true (item set), false (no work left anywhere)
+ */
+bool
+WorkQueue::pop(int worker, size_t &item)
+{
+
+	Deque			*own = Deques[worker];
+
+	do {
+
+		lock_guard<mutex>	guard(own->lock);
+
+		if (!own->items.empty()) {
+
+			item = own->items.front();
+			own->items.pop_front();
+			return true;
+
+		}
+
+	} while (steal(worker));
+
+	return false;
+
+}
+
+/*
+ * Steal from the other workers, in turn starting w/ the next one:
+ * take the back half (rounded up) of the first non-empty deque, the
+ * items its owner would get to last, into the thief's deque.
+ * @args:	stealing worker # (int thief)
+ * @return:	true (stole something), false (all deques empty)
+ */
+bool
+WorkQueue::steal(int thief)
+{
+
+	int				n = Deques.size();
+	deque<size_t>	loot;
+
+	for (int i = 1; i < n; i++) {
+
+		Deque		*victim = Deques[(thief + i) % n];
+
+		{
+			lock_guard<mutex>	guard(victim->lock);
+			size_t				half = (victim->items.size() + 1) / 2;
+
+			loot.assign(victim->items.end() - half, victim->items.end());
+			victim->items.erase(victim->items.end() - half,
+								victim->items.end());
+		}
+
+		if (!loot.empty()) {
+
+			lock_guard<mutex>	guard(Deques[thief]->lock);
+
+			Deques[thief]->items.insert(Deques[thief]->items.end(),
+										loot.begin(), loot.end());
+			Steals++;
+			return true;
+
+		}
+
+	}
+
+	return false;
+
+}
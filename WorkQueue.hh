@@ -0,0 +1,97 @@
+/*
+ * Mail-Sending Program
+ * WorkQueue.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+
+#ifndef WORKQUEUE_HH_
+#define WORKQUEUE_HH_
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <cstddef>
+
+using namespace std;
+
+/*
+ * WorkQueue object
+ * Work-stealing queue of work items (e.g. indexes of email files)
+ * for a fixed set of worker threads. Each worker owns a deque:
+ * 	- push: add an item to a worker's own deque
+ * 	- pop: take the next item from the worker's own deque (front,
+ * 	  oldest first); when it is empty, steal half of the items at
+ * 	  the back of another worker's deque
+ * A worker only contends w/ others when it steals, or when another
+ * worker steals from it. Items are never added once workers run,
+ * so pop() returning false means all work has been handed out.
+ * @methods:	push, pop, steals (# of successful steals)
+ */
+class WorkQueue
+{
+  public:
+			 WorkQueue(int workers);
+			~WorkQueue();
+
+	 // Add an item to a worker's deque.
+
+	void			push(int worker, size_t item);
+
+	 // Next item for a worker, stolen if its deque is empty.
+
+	bool			pop(int worker, size_t &item);
+
+	 // # of steals so far.
+
+	size_t			steals() const { return Steals; }
+
+  private:
+
+	 // One worker's deque, on its own cache line(s).
+
+	struct alignas(64) Deque {
+		mutex			lock;
+		deque<size_t>	items;
+	};
+
+	vector<Deque *>	Deques;
+	atomic<size_t>	Steals;
+
+	 // Move half of another worker's items to the thief's deque.
+
+	bool			steal(int thief);
+
+};
+
+#endif /* WORKQUEUE_HH_ */
@@ -0,0 +1,327 @@
+/*
+ * Mail-Sending Program
+ * AddressBench.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+
+/*
+ * Microbenchmark: AddressValidator kernels, one address at a time
+ * and in batch, vs. CheckEmailSyntax, the per-address check it
+ * replaced in main.cc (kept below as it was, bugs and all).
+ * A list of addresses like those of a mailing list (mostly valid,
+ * some w/ typos) is built in memory and checked repeatedly; the
+ * best run of each is reported in millions of addresses per second.
+ *
+ * usage: addresscheck [addresses] [runs]
+ */
+
+#include "../AddressValidator.hh"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdlib>
+#include <ctime>
+
+using namespace std;
+
+// Seconds on the monotonic clock.
+
+double			Now();
+
+// Build a list of n addresses.
+
+void			MakeList(vector<string> &list, size_t n);
+
+// Former check, from main.cc.
+
+int				CheckEmailSyntax(const string &addr);
+
+int
+main(int argc, char **argv)
+{
+
+	size_t			n = argc > 1 ? atoi(argv[1]) : 1000000;
+	int				runs = argc > 2 ? atoi(argv[2]) : 5;
+	vector<string>	list;
+	vector<string_view>	views;
+	vector<uint8_t>	status(n);
+	vector<uint64_t>	bits((n + 63) / 64);
+	double			start,
+					best;
+	size_t			valid = 0;
+
+	MakeList(list, n);
+	views.assign(list.begin(), list.end());
+
+	cout << fixed << setprecision(1);
+	cout << n << " addresses, " << runs << " runs, best of each\n";
+
+	best = 1e9;
+
+	for (int r = 0; r < runs; r++) {
+
+		start = Now();
+		valid = 0;
+
+		for (size_t i = 0; i < n; i++)
+
+			valid += CheckEmailSyntax(list[i]) == 0;
+
+		best = min(best, Now() - start);
+
+	}
+
+	cout << "  " << left << setw(24) << "CheckEmailSyntax" << right
+		 << setw(8) << n / best / 1e6 << " M/s (" << valid << " valid)\n";
+
+	for (int k = AddressValidator::Scalar; k <= AddressValidator::Sse2; k++) {
+
+		AddressValidator	validator((AddressValidator::Kernel)k);
+
+		if (k == AddressValidator::Sse2 &&
+			validator.kernel_name() != string("sse2"))
+
+			continue;	// Not supported here
+
+		best = 1e9;
+
+		for (int r = 0; r < runs; r++) {
+
+			start = Now();
+			valid = validator.check(&views[0], n, &status[0]);
+			best = min(best, Now() - start);
+
+		}
+
+		cout << "  " << left << setw(24)
+			 << string("batch status ") + validator.kernel_name() << right
+			 << setw(8) << n / best / 1e6 << " M/s (" << valid
+			 << " valid)\n";
+
+		best = 1e9;
+
+		for (int r = 0; r < runs; r++) {
+
+			start = Now();
+			valid = validator.valid_bits(&views[0], n, &bits[0]);
+			best = min(best, Now() - start);
+
+		}
+
+		cout << "  " << left << setw(24)
+			 << string("batch bitmap ") + validator.kernel_name() << right
+			 << setw(8) << n / best / 1e6 << " M/s (" << valid
+			 << " valid)\n";
+
+	}
+
+	return 0;
+
+}
+
+/*
+ * @return:	monotonic clock, in seconds (double)
+ */
+double
+Now()
+{
+
+	timespec		ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+
+}
+
+/*
+ * Build a list of first.last/initials addresses at a few domains,
+ * one in 50 w/ a typo (double dot, missing '@', trailing dot or
+ * a space).
+ * @args:	list (vector<string> &list), # of addresses (size_t n)
+ */
+void
+MakeList(vector<string> &list, size_t n)
+{
+
+	const char		*names[] = { "joseph", "bart", "alice", "bob",
+								 "carol", "dave", "erin", "frank" },
+					*domains[] = { "pdx.edu", "example.com",
+								   "mail.example.org", "cs.pdx.edu",
+								   "list-server.example.net" };
+	string			addr;
+
+	srand(300);
+	list.clear();
+
+	for (size_t i = 0; i < n; i++) {
+
+		addr = names[rand() % 8];
+
+		if (rand() % 2)
+
+			addr += string(".") + names[rand() % 8];
+
+		if (rand() % 4 == 0)
+
+			addr += to_string(rand() % 1000);
+
+		addr += string("@") + domains[rand() % 5];
+
+		switch (rand() % 200) {
+
+		case 0:		addr.insert(1, "..");		break;
+		case 1:		addr.erase(addr.find('@'), 1);	break;
+		case 2:		addr += ".";				break;
+		case 3:		addr.insert(2, " ");		break;
+
+		}
+
+		list.push_back(addr);
+
+	}
+
+}
+
+/*
+ * CheckEmailSyntax as it was in main.cc before AddressValidator.
+ * @args:	e-mail address (const string &)
+ * @return:	0 (success)
+ * - error: -1 (fail)
+ */
+int
+CheckEmailSyntax(const string &addr)
+{
+
+	int				a_pos = 0;		// Position of '@' char
+	string			non_alphanum = "~`!.#$%^&\'*{|}-_+=";
+									// String containing all legal alpha-
+									// numeric ASCII symbols.
+	unsigned int	addr_len = addr.length(),
+									// Length of address, must be < 254
+					local_len,		// Length of local (before @)
+									//   equal to a_pos - 1, must be < 64
+					domain_len,		// Length of domain (after @)
+									//   equal to addr.length - a_pos
+					domain_start;	// Position of 1st char in domain.
+
+	// Must be: 5 < Address length < 254
+	if (addr_len > 255 || addr_len < 5) {
+
+		// Illegal address length.
+		return -1;
+
+	}
+
+	a_pos = addr.find('@');		// Find position of '@' symbol.
+
+	if (a_pos < 2 || a_pos > 65 ) {
+
+		// Local must be: 0 < local < 65.
+		return -1;		// Illegal address.
+
+	}
+
+	local_len = a_pos;
+	domain_start = a_pos + 1;
+	domain_len = addr_len - a_pos - 1;
+
+	// Verify legality of each char in local
+	for (unsigned int i = 0; i < local_len; i++) {
+
+		if (isalnum(addr[i]) == 0) {		// Non-alphanumeric
+
+			// Check if char is legal non-alphanumeric.
+			if (non_alphanum.find(addr[i]) == 0) {
+
+				return -1;	// Illegal char in local.
+
+			}
+
+		}
+
+	}
+
+	// Square braces around IP address domain is legal.
+	if (addr[domain_start] == '[' && addr[domain_len - 1] == ']') {
+
+		domain_len -= 2;
+		++domain_start;
+
+	}
+
+	// Verify legality of each char in domain
+	for (unsigned int i = 0; i < domain_len; i++) {
+
+		if (isalnum(addr[i + domain_start]) == 0) {	// Non-alphanumeric
+
+			if (addr[i + domain_start] != '.' &&
+				addr[i + domain_start] != '-') {	// Not '.' or '-'
+
+				return -1;	// Illegal char in domain.
+
+			}
+
+		}
+
+	}
+
+	// Verify '.' is not 1st or last char in local.
+	if (addr[0] == '.' || addr[local_len - 1] == '.') {
+
+		return -1;	// Illegal address syntax.
+
+	}
+
+	// Verify '.' is not 1st or last char in domain.
+	if (addr[domain_start] == '.' || addr[domain_len - 1] == '.') {
+
+		return -1;	// Illegal address syntax.
+
+	}
+
+	// Verify '.' does not appear consecutively.
+	for (unsigned int i = 0; i > 0; i = addr.find('.', i + 1)) {
+
+		if (i == (addr.find('.', i + 1) - 1)) {
+
+			return -1;	// Illegal address syntax.
+		}
+
+	}
+
+	return 0;	// Valid e-mail address.
+
+}
@@ -0,0 +1,306 @@
+/*
+ * Mail-Sending Program
+ * AllocBench.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+
+/*
+ * Heap allocations per message of MailSenderSmtp::send(), counted by
+ * replacing the global operator new: n messages (1000 by default)
+ * to a relay, normally the local sink (see SmtpSink.cc), from a
+ * plain file, a wire file and memory (set_text), one session each.
+ * Each mode sends a round first, so buffers, arenas and the session
+ * have grown to the message; then the allocations of the n
+ * messages are counted. Steady-state sending should make none.
+ * Reported per mode: heap allocations per message, and the arena
+ * totals (see Arena) of the run.
+ *
+ * usage: allocbench [-h host] [-p port] [-n msgs]
+ */
+
+#include "../MailSenderSmtp.hh"
+#include "../WireFile.hh"
+#include "../Arena.hh"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include <cstdio>
+#include <csignal>
+#include <unistd.h>
+
+using namespace std;
+
+static atomic<uint64_t>	Allocations(0);		// operator new calls
+
+void *
+operator new(size_t len)
+{
+
+	void		*p;
+
+	Allocations.fetch_add(1, memory_order_relaxed);
+
+	if ((p = malloc(len ? len : 1)) == NULL)
+
+		throw bad_alloc();
+
+	return p;
+
+}
+
+void *
+operator new[](size_t len)
+{
+
+	return operator new(len);
+
+}
+
+void
+operator delete(void *p) noexcept
+{
+
+	free(p);
+
+}
+
+void
+operator delete[](void *p) noexcept
+{
+
+	free(p);
+
+}
+
+void
+operator delete(void *p, size_t) noexcept
+{
+
+	free(p);
+
+}
+
+void
+operator delete[](void *p, size_t) noexcept
+{
+
+	free(p);
+
+}
+
+// Write the message file, w/ 10 recipients.
+
+string			MakeMessage(const string &dir, string &from,
+							vector<string> &to);
+
+// Send msgs messages, return the heap allocations made.
+
+uint64_t		Run(const string &host, int port, const string &file,
+					const string &text, int msgs,
+					const string &from, const vector<string> &to,
+					int &failed);
+
+int
+main(int argc, char **argv)
+{
+
+	string			host = "127.0.0.1",
+					from,
+					text;
+	vector<string>	to;
+	int				port = 2525,
+					msgs = 1000,
+					opt;
+	char			dir[] = "/tmp/allocbenchXXXXXX";
+
+	while ((opt = getopt(argc, argv, "h:p:n:")) != -1) {
+
+		switch (opt) {
+
+		case 'h':	host = optarg;					break;
+		case 'p':	port = atoi(optarg);			break;
+		case 'n':	msgs = atoi(optarg);			break;
+
+		default:
+			cerr << "usage: " << argv[0]
+				 << " [-h host] [-p port] [-n msgs]\n";
+			return 1;
+
+		}
+
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+
+	if (mkdtemp(dir) == NULL || msgs <= 0) {
+
+		perror("allocbench");
+		return 1;
+
+	}
+
+	string			file = MakeMessage(dir, from, to),
+					wire = file + WireSuffix;
+	ifstream		fin(file.c_str(), ios::in | ios::binary);
+	ostringstream	buf;
+
+	buf << fin.rdbuf();
+	text = buf.str();
+
+	if (WirePrepare(file, wire, from, to) != 0) {
+
+		perror(wire.c_str());
+		return 1;
+
+	}
+
+	const char		*modes[] = { "plain", "wire", "memory" };
+
+	cout << setw(8) << "mode" << setw(8) << "sent" << setw(7) << "failed"
+		 << setw(12) << "allocs/msg" << setw(14) << "arena allocs"
+		 << setw(14) << "arena blocks" << endl;
+
+	for (int m = 0; m < 3; m++) {
+
+		Arena::Stats	before = Arena::totals(),
+						after;
+		int				failed;
+		uint64_t		n;
+
+		n = Run(host, port, m == 1 ? wire : file, m == 2 ? text : "",
+				msgs, from, to, failed);
+		after = Arena::totals();
+
+		cout << fixed << setprecision(2)
+			 << setw(8) << modes[m] << setw(8) << msgs - failed
+			 << setw(7) << failed
+			 << setw(12) << (double)n / msgs
+			 << setw(14) << after.allocs - before.allocs
+			 << setw(14) << after.blocks - before.blocks << endl;
+
+	}
+
+	unlink(wire.c_str());
+	unlink(file.c_str());
+	rmdir(dir);
+
+	return 0;
+
+}
+
+/*
+ * Send a round to warm up, then msgs messages w/ one sender and
+ * session, counting the heap allocations of the latter.
+ * @args:	relay host/port, message file, its text or "" (send the
+ * 			file), # of messages, envelope, failures (int &failed)
+ * @return:	heap allocations of the msgs messages
+ */
+uint64_t
+Run(const string &host, int port, const string &file, const string &text,
+	int msgs, const string &from, const vector<string> &to, int &failed)
+{
+
+	SmtpPool		pool;
+	MailSenderSmtp	client(file, 1000000, &pool);
+	vector<int>		status;
+	uint64_t		start = 0;
+
+	client.set_port(port);
+
+	if (!text.empty())
+
+		client.set_text(text.data(), text.size());
+
+	failed = 0;
+
+	for (int i = -msgs; i < msgs; i++) {
+
+		if (i == 0)
+
+			start = Allocations.load();
+
+		if (client.send(host, from, to, status) != 0 && i >= 0)
+
+			failed++;
+
+	}
+
+	return Allocations.load() - start;
+
+}
+
+/*
+ * Write a 10 KB message to 10 recipients, 76-column text lines,
+ * some beginning w/ '.'.
+ * @args:	directory, envelope found (string &from, vector<string> &to)
+ * @return:	file name
+ */
+string
+MakeMessage(const string &dir, string &from, vector<string> &to)
+{
+
+	string			name = dir + "/msg",
+					line(74, 'x');
+	ofstream		out(name.c_str(), ios::out | ios::binary);
+
+	from = "bench@allocbench.test";
+	out << "From: " << from << "\n";
+
+	for (int i = 0; i < 10; i++) {
+
+		ostringstream	rcpt;
+
+		rcpt << "rcpt" << i << "@sink.test";
+		to.push_back(rcpt.str());
+		out << "To: " << to.back() << "\n";
+
+	}
+
+	out << "Subject: allocations\n\n";
+
+	for (int i = 0; i < 10240 / 75; i++) {
+
+		line[0] = i % 10 == 0 ? '.' : 'x';
+		out << line << "\n";
+
+	}
+
+	return name;
+
+}
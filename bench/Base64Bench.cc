@@ -0,0 +1,234 @@
+/*
+ * Mail-Sending Program
+ * Base64Bench.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+
+/*
+ * Microbenchmark: Base64Encoder kernels vs. a plain base64 encoder
+ * that builds the text of an attachment in a string, as the
+ * scripts that wrote base64 files did. Random data is encoded
+ * repeatedly, by each kernel in 64 KB reads (not a multiple of 57
+ * bytes, so lines are split between reads); the best run of each
+ * is reported in MB/s of input. The output of each kernel is
+ * compared w/ the plain encoder's; "differs" would be a bug.
+ *
+ * usage: base64bench [data-MB] [runs]
+ */
+
+#include "../Mime.hh"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+using namespace std;
+
+const size_t	Chunk = 65536;		// Bytes encoded at a time
+
+// Seconds on the monotonic clock.
+
+double			Now();
+
+// Plain encoder: the whole text, 76-column CRLF lines.
+
+void			Plain(const string &data, string &text);
+
+// Encoder in Chunk-sized pieces, into text.
+
+void			Encode(Base64Encoder &encoder, const string &data,
+					   vector<char> &out, string &text);
+
+int
+main(int argc, char **argv)
+{
+
+	size_t			size = (argc > 1 ? atoi(argv[1]) : 64) << 20;
+	int				runs = argc > 2 ? atoi(argv[2]) : 5;
+	string			data(size, '\0'),
+					expect,
+					text;
+	vector<char>	out(Base64Encoder::max_output(Chunk));
+	double			start,
+					best;
+	const char		*names[] = { "", "scalar", "ssse3", "avx2" };
+
+	srand(300);
+
+	for (size_t i = 0; i < size; i++)
+
+		data[i] = rand();
+
+	data.resize(size - 1);		// Last line short, padded w/ '='
+
+	cout << fixed << setprecision(1);
+	cout << "data: " << data.length() / 1048576.0 << " MB, "
+		 << runs << " runs, best of each\n";
+
+	best = 1e9;
+
+	for (int r = 0; r < runs; r++) {
+
+		start = Now();
+		Plain(data, expect);
+		best = min(best, Now() - start);
+
+	}
+
+	cout << "  " << left << setw(18) << "plain string" << right
+		 << setw(10) << data.length() / best / 1048576.0
+		 << " MB/s (" << expect.length() << " bytes out)\n";
+
+	// Each encoder kernel the CPU supports
+	for (int k = Base64Encoder::Scalar; k <= Base64Encoder::Avx2; k++) {
+
+		Base64Encoder	encoder((Base64Encoder::Kernel)k);
+
+		if (encoder.kernel_name() != string(names[k]))
+
+			continue;	// Not supported here
+
+		best = 1e9;
+
+		for (int r = 0; r < runs; r++) {
+
+			start = Now();
+			Encode(encoder, data, out, text);
+			best = min(best, Now() - start);
+
+		}
+
+		cout << "  " << left << setw(18)
+			 << string("encoder ") + encoder.kernel_name() << right
+			 << setw(10) << data.length() / best / 1048576.0
+			 << " MB/s (" << text.length() << " bytes out"
+			 << (text == expect ? "" : ", DIFFERS") << ")\n";
+
+	}
+
+	return 0;
+
+}
+
+/*
+ * @return:	monotonic clock, in seconds (double)
+ */
+double
+Now()
+{
+
+	timespec		ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+
+}
+
+/*
+ * Plain encoder: 3 bytes at a time appended to a string, a CRLF
+ * every 76 characters.
+ * @args:	data (const string &data), base64 text (string &text)
+ */
+void
+Plain(const string &data, string &text)
+{
+
+	static const char	alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+									 "abcdefghijklmnopqrstuvwxyz"
+									 "0123456789+/";
+	size_t			col = 0;
+
+	text.clear();
+
+	for (size_t i = 0; i < data.length(); i += 3) {
+
+		unsigned int	v = (unsigned char)data[i] << 16;
+		size_t			n = min((size_t)3, data.length() - i);
+
+		if (n > 1)
+
+			v |= (unsigned char)data[i + 1] << 8;
+
+		if (n > 2)
+
+			v |= (unsigned char)data[i + 2];
+
+		text += alphabet[v >> 18];
+		text += alphabet[(v >> 12) & 63];
+		text += n > 1 ? alphabet[(v >> 6) & 63] : '=';
+		text += n > 2 ? alphabet[v & 63] : '=';
+
+		if ((col += 4) == 76 || i + 3 >= data.length()) {
+
+			text += "\r\n";
+			col = 0;
+
+		}
+
+	}
+
+}
+
+/*
+ * Encoder path: Chunk-sized pieces into one reused output buffer,
+ * each piece appended to the text (reserved, so the copy is not
+ * what is measured).
+ * @args:	encoder, data (const string &data), output buffer,
+ * 			base64 text (string &text)
+ */
+void
+Encode(Base64Encoder &encoder, const string &data, vector<char> &out,
+	   string &text)
+{
+
+	size_t			n;
+
+	text.clear();
+	text.reserve(Base64Encoder::max_output(data.length()));
+
+	for (size_t i = 0; i < data.length(); i += Chunk) {
+
+		n = encoder.encode(data.data() + i, min(Chunk, data.length() - i),
+						   &out[0]);
+		text.append(&out[0], n);
+
+	}
+
+	n = encoder.finish(&out[0]);
+	text.append(&out[0], n);
+
+}
@@ -0,0 +1,547 @@
+/*
+ * Mail-Sending Program
+ * ConnectCheck.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+/*
+ * Check: connect races (Happy Eyeballs), of Connector and of
+ * SmtpEngine, against a relay whose 1st address is dead. Both
+ * addresses are on loopback, w/ the same port: the dead one,
+ * 127.0.0.2, is a listener whose backlog is full, so a connect to
+ * it hangs (its SYNs are dropped); the live one, 127.0.0.1, is a
+ * small SMTP server. race.test resolves to both, dead first, and
+ * dead.test to the dead one alone, from a stub DNS server run in
+ * this process (see bench/DnsCheck.cc). Checked: the live address
+ * wins after one attempt delay, the winner is tried first next
+ * time, a lone dead address fails w/ ETIMEDOUT at the attempt
+ * deadline, and the engine delivers through the race and fails at
+ * its own connect timeout. Each check prints ok or FAIL; the exit
+ * status is the number of failures.
+ *
+ * usage: connectcheck
+ */
+
+#include "../Connector.hh"
+#include "../Resolver.hh"
+#include "../SmtpEngine.hh"
+#include "../SmtpMetrics.hh"
+#include "../Logger.hh"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <arpa/nameser.h>
+
+using namespace std;
+
+const char		*Dead = "127.0.0.2",	// Listener w/ a full backlog
+				*Live = "127.0.0.1";	// SMTP server
+const int		Delay = 250,		// Connector's attempt delay, ms.
+				Deadline = 1000;	// Connector's attempt timeout, ms.
+int				Failures = 0;
+
+// Listening TCP socket on ip:port (port 0: any), or -1.
+
+int				Listen(const char *ip, int &port, int backlog);
+
+// Answer DNS queries on a UDP socket, forever.
+
+void			ServeDns(int fd);
+
+// Accept SMTP sessions on a listening socket, forever.
+
+void			ServeSmtp(int fd);
+
+// Talk SMTP on a connection, just accepting everything.
+
+void			Talk(int fd);
+
+// Address of ip:port.
+
+Resolver::Address	Address(const char *ip, int port);
+
+// Connect w/ connector to host:port at addrs: ms. taken, peer.
+
+int				Connect(Connector &connector, const string &host,
+						int port, const vector<Resolver::Address> &addrs,
+						long &ms, string &peer);
+
+// Deliver a message w/ engine to host:port: ms. taken.
+
+int				Deliver(SmtpEngine &engine, const string &host, int port,
+						const string &filename, long &ms, int &error);
+
+// Print and count a check.
+
+void			Check(const string &what, bool ok);
+
+int
+main()
+{
+
+	Connector		connector(Delay, Deadline);
+	SmtpEngine		engine,
+					slow;
+	vector<Resolver::Address>	race,
+								dead;
+	Resolver::Address	addr;
+	char			filename[] = "/tmp/connectcheck.XXXXXX";
+	string			peer;
+	long			ms;
+	int				port = 0,
+					dns_port = 0,
+					live,
+					full,
+					filler,
+					dns,
+					fd,
+					r,
+					error;
+
+	// SMTP server, then the dead listener on the same port.
+	if ((live = Listen(Live, port, 16)) < 0 ||
+		(full = Listen(Dead, port, 0)) < 0) {
+
+		perror("listeners");
+		return 1;
+
+	}
+
+	// Fill the dead listener's backlog: it drops SYNs from now on.
+	addr = Address(Dead, port);
+
+	if ((filler = socket(AF_INET, SOCK_STREAM, 0)) < 0 ||
+		connect(filler, (sockaddr *)&addr.addr, addr.len) != 0) {
+
+		perror("backlog filler");
+		return 1;
+
+	}
+
+	addr = Address(Live, dns_port);
+
+	if ((dns = socket(AF_INET, SOCK_DGRAM, 0)) < 0 ||
+		bind(dns, (sockaddr *)&addr.addr, addr.len) != 0 ||
+		getsockname(dns, (sockaddr *)&addr.addr, &addr.len) != 0) {
+
+		perror("stub DNS server");
+		return 1;
+
+	}
+
+	dns_port = ntohs(((sockaddr_in *)&addr.addr)->sin_port);
+	thread(ServeSmtp, live).detach();
+	thread(ServeDns, dns).detach();
+	Resolver::shared().set_nameserver(Live, dns_port);
+	cout << "relay on " << Dead << " (dead) and " << Live << ", port "
+		 << port << "; stub DNS server on port " << dns_port << "\n";
+
+	race.push_back(Address(Dead, port));
+	race.push_back(Address(Live, port));
+	dead.push_back(Address(Dead, port));
+
+	// Connector: the race, the winner first next time, a timeout.
+	fd = Connect(connector, "race.test", port, race, ms, peer);
+	Check("dead, then live: live wins after the attempt delay (" +
+		  to_string(ms) + " ms)",
+		  fd >= 0 && peer == Live && ms >= Delay - 10 && ms < Delay + 250);
+	close(fd);
+
+	fd = Connect(connector, "race.test", port, race, ms, peer);
+	Check("again: the winner tried first (" + to_string(ms) + " ms)",
+		  fd >= 0 && peer == Live && ms < Delay - 50);
+	close(fd);
+
+	fd = Connect(connector, "dead.test", port, dead, ms, peer);
+	error = errno;
+	Check("dead alone: ETIMEDOUT at the attempt deadline (" +
+		  to_string(ms) + " ms)",
+		  fd == -1 && error == ETIMEDOUT && ms >= Deadline - 10 &&
+		  ms < Deadline + 500);
+
+	// SmtpEngine: the same, in its loop, w/ names from the stub.
+	if ((fd = mkstemp(filename)) < 0) {
+
+		perror("message file");
+		return 1;
+
+	}
+
+	close(fd);
+	ofstream(filename) << "From: a@x.org\nTo: b@y.org\nSubject: check\n\n"
+					   << "body\n";
+	Connector::shared().set_timeouts(Delay, Deadline);
+	engine.set_timeouts(30, 10, 10, 10, 5);
+
+	r = Deliver(engine, "race.test", port, filename, ms, error);
+	Check("engine, dead then live: delivered after the attempt delay (" +
+		  to_string(ms) + " ms)",
+		  r == 0 && ms >= Delay - 10 && ms < Delay + 500);
+
+	r = Deliver(engine, "dead.test", port, filename, ms, error);
+	Check("engine, dead alone: ETIMEDOUT at the attempt deadline (" +
+		  to_string(ms) + " ms)",
+		  r != 0 && error == ETIMEDOUT && ms >= Deadline - 10 &&
+		  ms < Deadline + 500);
+
+	// Its own connect timeout (1 s) before the attempt's (10 s).
+	Connector::shared().set_timeouts(Delay, 10 * Deadline);
+	slow.set_timeouts(1, 10, 10, 10, 5);
+	r = Deliver(slow, "dead.test", port, filename, ms, error);
+	Check("engine, dead alone: ETIMEDOUT at its connect timeout (" +
+		  to_string(ms) + " ms)",
+		  r != 0 && error == ETIMEDOUT && ms >= 1000 - 10 &&
+		  ms < 1000 + 500);
+
+	unlink(filename);
+	close(filler);
+	close(full);
+	Logger::shared().stop();
+	cout << (Failures ? "FAILED: " : "passed, ") << Failures
+		 << " failure(s)\n";
+
+	return Failures;
+
+}
+
+/*
+ * @args:	IPv4 address (const char *ip)
+ * 			port, 0: any, set to the one bound (int &port)
+ * 			listen() backlog (int backlog)
+ * @return:	listening socket
+ * - error: -1 (errno set)
+ */
+int
+Listen(const char *ip, int &port, int backlog)
+{
+
+	Resolver::Address	addr = Address(ip, port);
+	int				fd,
+					one = 1;
+
+	if ((fd = socket(AF_INET, SOCK_STREAM, 0)) < 0)
+
+		return -1;
+
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+	if (bind(fd, (sockaddr *)&addr.addr, addr.len) != 0 ||
+		listen(fd, backlog) != 0 ||
+		getsockname(fd, (sockaddr *)&addr.addr, &addr.len) != 0) {
+
+		close(fd);
+		return -1;
+
+	}
+
+	port = ntohs(((sockaddr_in *)&addr.addr)->sin_port);
+
+	return fd;
+
+}
+
+/*
+ * Answer A queries for race.test (the dead address, then the live
+ * one) and dead.test (the dead one); anything else, and AAAA
+ * queries, get no records.
+ * @args:	bound UDP socket (int fd)
+ */
+void
+ServeDns(int fd)
+{
+
+	unsigned char	query[NS_PACKETSZ],
+					answer[NS_PACKETSZ];
+	sockaddr_in		from;
+	socklen_t		len;
+	vector<string>	addrs;
+	string			name;
+	in_addr			a4;
+	ssize_t			n;
+	int				pos,
+					end;
+
+	while (true) {
+
+		len = sizeof(from);
+
+		if ((n = recvfrom(fd, query, sizeof(query), 0,
+						  (sockaddr *)&from, &len)) < NS_HFIXEDSZ)
+
+			continue;
+
+		name.clear();
+
+		for (pos = NS_HFIXEDSZ; pos < n && query[pos] != 0;
+			 pos += query[pos] + 1) {
+
+			if (!name.empty())
+
+				name += '.';
+
+			name.append((const char *)query + pos + 1, query[pos]);
+
+		}
+
+		if ((pos += 5) > n)
+
+			continue;
+
+		addrs.clear();
+
+		if (ns_get16(query + pos - 4) == ns_t_a && name == "race.test")
+
+			addrs.push_back(Dead), addrs.push_back(Live);
+
+		else if (ns_get16(query + pos - 4) == ns_t_a && name == "dead.test")
+
+			addrs.push_back(Dead);
+
+		// Header and question as asked; answers after them.
+		memcpy(answer, query, pos);
+		end = pos;
+
+		for (size_t i = 0; i < addrs.size(); i++) {
+
+			inet_pton(AF_INET, addrs[i].c_str(), &a4);
+			ns_put16(0xc000 | NS_HFIXEDSZ, answer + end);	// The name asked
+			ns_put16(ns_t_a, answer + end + 2);
+			ns_put16(ns_c_in, answer + end + 4);
+			ns_put32(300, answer + end + 6);
+			ns_put16(4, answer + end + 10);
+			memcpy(answer + end + 12, &a4, 4);
+			end += 16;
+
+		}
+
+		answer[2] = 0x84 | (query[2] & 0x01);	// Response, authoritative, RD
+		answer[3] = 0x80 | ns_r_noerror;		// RA
+		ns_put16(addrs.size(), answer + 6);
+		ns_put16(0, answer + 8);
+		ns_put16(0, answer + 10);
+		sendto(fd, answer, end, 0, (sockaddr *)&from, len);
+
+	}
+
+}
+
+/*
+ * @args:	listening socket (int fd)
+ */
+void
+ServeSmtp(int fd)
+{
+
+	int				conn;
+
+	while (true) {
+
+		if ((conn = accept(fd, NULL, NULL)) >= 0)
+
+			thread(Talk, conn).detach();
+
+	}
+
+}
+
+/*
+ * Reply 250 to every command, 354 to DATA (and 250 after its end),
+ * 221 to QUIT; no extensions.
+ * @args:	connection (int fd)
+ */
+void
+Talk(int fd)
+{
+
+	FILE			*in = fdopen(dup(fd), "r");
+	char			line[1024];
+	bool			data = false;
+	const char		*reply;
+
+	if (in == NULL || write(fd, "220 live\r\n", 10) != 10) {
+
+		if (in != NULL)
+
+			fclose(in);
+
+		close(fd);
+		return;
+
+	}
+
+	while (fgets(line, sizeof(line), in) != NULL) {
+
+		if (data) {
+
+			if (strcmp(line, ".\r\n") != 0)
+
+				continue;
+
+			data = false;
+			reply = "250 queued\r\n";
+
+		}
+		else if (strncasecmp(line, "DATA", 4) == 0) {
+
+			data = true;
+			reply = "354 go ahead\r\n";
+
+		}
+		else if (strncasecmp(line, "QUIT", 4) == 0)
+
+			reply = "221 bye\r\n";
+
+		else
+
+			reply = "250 ok\r\n";
+
+		if (write(fd, reply, strlen(reply)) < 0 ||
+			strncmp(reply, "221", 3) == 0)
+
+			break;
+
+	}
+
+	fclose(in);
+	close(fd);
+
+}
+
+/*
+ * @args:	IPv4 address (const char *ip), port (int port)
+ * @return:	the address (Resolver::Address)
+ */
+Resolver::Address
+Address(const char *ip, int port)
+{
+
+	Resolver::Address	addr;
+	sockaddr_in		*sin = (sockaddr_in *)&addr.addr;
+
+	memset(&addr, 0, sizeof(addr));
+	sin->sin_family = AF_INET;
+	sin->sin_port = htons(port);
+	inet_pton(AF_INET, ip, &sin->sin_addr);
+	addr.len = sizeof(*sin);
+
+	return addr;
+
+}
+
+/*
+ * @args:	connector (Connector &connector)
+ * 			relay, its addresses (see Connector::connect)
+ * 			ms. taken, peer's address, out (long &ms, string &peer)
+ * @return:	connected socket
+ * - error: -1 (errno set)
+ */
+int
+Connect(Connector &connector, const string &host, int port,
+		const vector<Resolver::Address> &addrs, long &ms, string &peer)
+{
+
+	uint64_t		start = SmtpMetrics::now();
+	sockaddr_in		sin;
+	socklen_t		len = sizeof(sin);
+	char			ip[INET_ADDRSTRLEN];
+	int				fd,
+					saved;
+
+	fd = connector.connect(host, port, addrs);
+	saved = errno;
+	ms = (SmtpMetrics::now() - start) / 1000;
+	peer.clear();
+
+	if (fd >= 0 && getpeername(fd, (sockaddr *)&sin, &len) == 0)
+
+		peer = inet_ntop(AF_INET, &sin.sin_addr, ip, sizeof(ip));
+
+	errno = saved;
+
+	return fd;
+
+}
+
+/*
+ * @args:	engine (SmtpEngine &engine)
+ * 			relay (const string &host, int port)
+ * 			message file (const string &filename)
+ * 			ms. taken, errno of a failure, out (long &ms, int &error)
+ * @return:	result of the message (0: delivered)
+ */
+int
+Deliver(SmtpEngine &engine, const string &host, int port,
+		const string &filename, long &ms, int &error)
+{
+
+	uint64_t		start = SmtpMetrics::now();
+	SmtpEngine::Job	job;
+	SmtpEngine::Result	result;
+
+	job.host = host;
+	job.port = port;
+	job.filename = filename;
+	job.from = "a@x.org";
+	job.to.push_back("b@y.org");
+	job.user = NULL;
+	engine.submit(job);
+
+	while (!engine.complete(result))
+
+		engine.run(-1);
+
+	ms = (SmtpMetrics::now() - start) / 1000;
+	error = result.error;
+
+	return result.result;
+
+}
+
+/*
+ * @args:	what was checked (const string &), result (bool ok)
+ */
+void
+Check(const string &what, bool ok)
+{
+
+	cout << (ok ? "  ok    " : "  FAIL  ") << what << "\n";
+	Failures += !ok;
+
+}
@@ -0,0 +1,240 @@
+/*
+ * Mail-Sending Program
+ * DataEncoderBench.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+/*
+ * Microbenchmark: SmtpDataEncoder kernels vs. the per-line DATA
+ * path it replaced in MailSenderSmtp::smtp_client (getline into a
+ * 1 kb buffer, append line + "\n" to a string).
+ * A synthetic message of mixed line lengths (some lines starting
+ * w/ '.') is built in memory and encoded repeatedly; the best run
+ * of each method is reported in MB/s of input.
+ *
+ * usage: dataencoder [message-MB] [runs]
+ */
+
+#include "../SmtpData.hh"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <ctime>
+
+using namespace std;
+
+const size_t	Chunk = 65536;		// Bytes encoded at a time
+
+// Seconds on the monotonic clock.
+
+double			Now();
+
+// Build a message of about size bytes.
+
+void			MakeMessage(string &msg, size_t size);
+
+// Old per-line path, returns output size.
+
+size_t			PerLine(const string &msg, string &to_send);
+
+// Encoder in Chunk-sized pieces, returns output size.
+
+size_t			Encode(SmtpDataEncoder &encoder,
+					   const string &msg,
+					   vector<char> &out);
+
+int
+main(int argc, char **argv)
+{
+
+	size_t			size = (argc > 1 ? atoi(argv[1]) : 64) << 20;
+	int				runs = argc > 2 ? atoi(argv[2]) : 5;
+	string			msg,
+					to_send;
+	vector<char>	out(SmtpDataEncoder::max_output(Chunk) +
+						SmtpDataEncoder::MaxFinish);
+	double			start,
+					best;
+	size_t			n = 0;
+
+	MakeMessage(msg, size);
+
+	cout << fixed << setprecision(1);
+	cout << "message: " << msg.length() / 1048576.0 << " MB, "
+		 << runs << " runs, best of each\n";
+
+	// Current per-line approach
+	best = 1e9;
+
+	for (int r = 0; r < runs; r++) {
+
+		start = Now();
+		n = PerLine(msg, to_send);
+		best = min(best, Now() - start);
+
+	}
+
+	cout << "  " << left << setw(18) << "per-line getline" << right
+		 << setw(10) << msg.length() / best / 1048576.0
+		 << " MB/s (" << n << " bytes out)\n";
+
+	// Each encoder kernel the CPU supports
+	for (int k = SmtpDataEncoder::Scalar; k <= SmtpDataEncoder::Avx2; k++) {
+
+		SmtpDataEncoder	encoder((SmtpDataEncoder::Kernel)k);
+
+		if (encoder.kernel_name() != string(k == SmtpDataEncoder::Scalar ?
+											"scalar" :
+											k == SmtpDataEncoder::Sse2 ?
+											"sse2" : "avx2"))
+
+			continue;	// Not supported here
+
+		best = 1e9;
+
+		for (int r = 0; r < runs; r++) {
+
+			start = Now();
+			n = Encode(encoder, msg, out);
+			best = min(best, Now() - start);
+
+		}
+
+		cout << "  " << left << setw(18)
+			 << string("encoder ") + encoder.kernel_name() << right
+			 << setw(10) << msg.length() / best / 1048576.0
+			 << " MB/s (" << n << " bytes out)\n";
+
+	}
+
+	return 0;
+
+}
+
+/*
+ * @return:	monotonic clock, in seconds (double)
+ */
+double
+Now()
+{
+
+	timespec		ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+
+}
+
+/*
+ * Build a message of about size bytes: a short header, then lines
+ * of 0 to 120 characters, one in 20 starting w/ '.'.
+ * @args:	message (string &msg), size in bytes (size_t size)
+ */
+void
+MakeMessage(string &msg, size_t size)
+{
+
+	srand(300);
+
+	msg = "From: bench@example.com\nTo: sink@example.com\n"
+		  "Subject: encoder benchmark\n\n";
+
+	while (msg.length() < size) {
+
+		int		len = rand() % 121;
+
+		if (rand() % 20 == 0)
+
+			msg.append(1, '.');
+
+		for (int i = 0; i < len; i++)
+
+			msg.append(1, 'a' + (i % 26));
+
+		msg.append(1, '\n');
+
+	}
+
+}
+
+/*
+ * Per-line path: getline() into a 1 kb buffer, append to a string
+ * w/ "\n", add the terminator.
+ * @args:	message (const string &msg), output (string &to_send)
+ * @return:	output size
+ */
+size_t
+PerLine(const string &msg, string &to_send)
+{
+
+	istringstream	fin(msg);
+	char			buffer[1024];
+
+	to_send.clear();
+
+	while (fin.getline(buffer, sizeof(buffer))) {
+
+		to_send.append(buffer);
+		to_send.append("\n");
+
+	}
+
+	to_send.append("\r\n.\r\n");
+
+	return to_send.length();
+
+}
+
+/*
+ * Encoder path: Chunk-sized pieces into one reused output buffer.
+ * @args:	encoder, message (const string &msg)
+ * 			output buffer (vector<char> &out)
+ * @return:	output size
+ */
+size_t
+Encode(SmtpDataEncoder &encoder, const string &msg, vector<char> &out)
+{
+
+	size_t			n = 0;
+
+	for (size_t i = 0; i < msg.length(); i += Chunk)
+
+		n += encoder.encode(msg.data() + i,
+							min(Chunk, msg.length() - i), &out[0]);
+
+	return n + encoder.finish(&out[0]);
+
+}
@@ -0,0 +1,438 @@
+/*
+ * Mail-Sending Program
+ * DnsCheck.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+/*
+ * Check: Resolver against a stub DNS server, run in this process
+ * on a UDP port of 127.0.0.1 and set as the nameserver. The stub
+ * answers from a small zone (A/AAAA, MX w/ and w/o records, null
+ * MX, NXDOMAIN, SERVFAIL, a slow name) and counts the queries it
+ * gets. Checked: answers and errnos, MX order, caching for the TTL
+ * of the records and for the negative/transient TTLs, and that
+ * threads resolving one name at once cause one lookup. Each check
+ * prints ok or FAIL; the exit status is the number of failures.
+ *
+ * usage: dnscheck
+ */
+
+#include "../Resolver.hh"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <arpa/nameser.h>
+
+using namespace std;
+
+// Record of the stub's zone.
+
+struct Record {
+	string			name;
+	int				type,			// ns_t_a, ns_t_aaaa, ns_t_mx
+					ttl;
+	string			rdata;
+};
+
+vector<Record>	Zone;
+set<string>		Failing;		// Answered w/ SERVFAIL
+set<string>		Slow;			// Answered after 200 ms
+mutex			Lock;			// Guards Queries
+map<string, int>	Queries;	// Queries per name
+int				Failures = 0;
+
+// Fill the zone.
+
+void			MakeZone();
+
+// Answer queries on a UDP socket, forever.
+
+void			Serve(int fd);
+
+// Build the answer to a query.
+
+int				Answer(const unsigned char *query, int len,
+					   unsigned char *answer);
+
+// Resolve slow.test, from a thread.
+
+void			ResolveSlow(Resolver *resolver, int *result);
+
+// Queries the stub got for a name.
+
+int				Count(const string &name);
+
+// Print and count a check.
+
+void			Check(const string &what, bool ok);
+
+int
+main()
+{
+
+	Resolver		resolver;
+	vector<Resolver::Address>	addrs;
+	vector<string>	hosts;
+	vector<thread>	threads;
+	vector<int>		results(8);
+	sockaddr_in		sin;
+	socklen_t		len = sizeof(sin);
+	char			ip[INET6_ADDRSTRLEN];
+	size_t			lookups;
+	int				fd,
+					r,
+					missing,
+					failing,
+					host,
+					answered = 0;
+
+	MakeZone();
+
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if ((fd = socket(AF_INET, SOCK_DGRAM, 0)) < 0 ||
+		bind(fd, (sockaddr *)&sin, sizeof(sin)) != 0 ||
+		getsockname(fd, (sockaddr *)&sin, &len) != 0) {
+
+		perror("stub DNS server");
+		return 1;
+
+	}
+
+	thread(Serve, fd).detach();
+	resolver.set_nameserver("127.0.0.1", ntohs(sin.sin_port));
+
+	cout << "stub DNS server on 127.0.0.1:" << ntohs(sin.sin_port) << "\n";
+
+	// Addresses, IPv6 first, w/ the port.
+	r = resolver.resolve("host.test", 25, addrs);
+	Check("host.test: AAAA and A, IPv6 first",
+		  r == 0 && addrs.size() == 2 &&
+		  addrs[0].addr.ss_family == AF_INET6 &&
+		  addrs[1].addr.ss_family == AF_INET &&
+		  ntohs(((sockaddr_in *)&addrs[1].addr)->sin_port) == 25 &&
+		  strcmp(inet_ntop(AF_INET, &((sockaddr_in *)&addrs[1].addr)->sin_addr,
+						   ip, sizeof(ip)), "192.0.2.10") == 0);
+
+	host = Count("host.test");
+	r = resolver.resolve("host.test", 587, addrs);
+	Check("host.test: cached, port of the new call",
+		  r == 0 && Count("host.test") == host && resolver.hits() == 1 &&
+		  ntohs(((sockaddr_in6 *)&addrs[0].addr)->sin6_port) == 587);
+
+	// MX, by preference; implicit MX; null MX.
+	r = resolver.resolve_mx("mx.test", hosts);
+	Check("mx.test: exchangers by preference",
+		  r == 0 && hosts.size() == 2 && hosts[0] == "a.mx.test" &&
+		  hosts[1] == "b.mx.test");
+
+	r = resolver.resolve_mx("nomx.test", hosts);
+	Check("nomx.test: no MX, the domain itself",
+		  r == 0 && hosts.size() == 1 && hosts[0] == "nomx.test");
+
+	r = resolver.resolve_mx("nullmx.test", hosts);
+	Check("nullmx.test: null MX, EHOSTUNREACH",
+		  r == -1 && errno == EHOSTUNREACH);
+
+	// Failures: NXDOMAIN for the negative TTL, SERVFAIL briefly.
+	r = resolver.resolve("missing.test", 25, addrs);
+	Check("missing.test: NXDOMAIN, EHOSTUNREACH",
+		  r == -1 && errno == EHOSTUNREACH);
+
+	missing = Count("missing.test");
+	r = resolver.resolve("missing.test", 25, addrs);
+	Check("missing.test: failure cached",
+		  r == -1 && errno == EHOSTUNREACH &&
+		  Count("missing.test") == missing);
+
+	r = resolver.resolve("failing.test", 25, addrs);
+	Check("failing.test: SERVFAIL, EAGAIN", r == -1 && errno == EAGAIN);
+
+	failing = Count("failing.test");
+	r = resolver.resolve("short.test", 25, addrs);
+	Check("short.test: A w/ TTL 1", r == 0 && addrs.size() == 1);
+
+	this_thread::sleep_for(chrono::milliseconds(2100));
+
+	r = resolver.resolve("short.test", 25, addrs);
+	Check("short.test: asked again after its TTL",
+		  r == 0 && Count("short.test") == 4);
+
+	r = resolver.resolve("failing.test", 25, addrs);
+	Check("failing.test: asked again after TransientTtl",
+		  r == -1 && errno == EAGAIN && Count("failing.test") > failing);
+
+	r = resolver.resolve("missing.test", 25, addrs);
+	Check("missing.test: still cached (NegativeTtl)",
+		  r == -1 && Count("missing.test") == missing);
+
+	// One lookup for threads resolving the same name.
+	lookups = resolver.lookups();
+
+	for (size_t i = 0; i < results.size(); i++)
+
+		threads.push_back(thread(ResolveSlow, &resolver, &results[i]));
+
+	for (size_t i = 0; i < threads.size(); i++) {
+
+		threads[i].join();
+		answered += results[i] == 1;
+
+	}
+
+	Check("slow.test: 8 threads, one lookup",
+		  answered == 8 && Count("slow.test") == 2 &&
+		  resolver.lookups() == lookups + 1);
+
+	resolver.flush();
+	r = resolver.resolve("host.test", 25, addrs);
+	Check("host.test: asked again after flush",
+		  r == 0 && Count("host.test") == host * 2);
+
+	cout << (Failures ? "FAILED: " : "passed, ") << Failures
+		 << " failure(s)\n";
+
+	return Failures;
+
+}
+
+/*
+ * The zone: host.test (AAAA, A), short.test (A, TTL 1), slow.test
+ * (A, answered late), mx.test (two MX, listed in the wrong order),
+ * nomx.test (A, no MX), nullmx.test ("0 ."), failing.test
+ * (SERVFAIL); anything else is NXDOMAIN.
+ */
+void
+MakeZone()
+{
+
+	unsigned char	a6[16],
+					a4[4];
+	string			mx;
+
+	inet_pton(AF_INET6, "2001:db8::10", a6);
+	Zone.push_back({ "host.test", ns_t_aaaa, 300, string((char *)a6, 16) });
+	inet_pton(AF_INET, "192.0.2.10", a4);
+	Zone.push_back({ "host.test", ns_t_a, 300, string((char *)a4, 4) });
+	Zone.push_back({ "short.test", ns_t_a, 1, string((char *)a4, 4) });
+	Zone.push_back({ "slow.test", ns_t_a, 300, string((char *)a4, 4) });
+	Zone.push_back({ "nomx.test", ns_t_a, 300, string((char *)a4, 4) });
+
+	// Preference, then the exchanger's name in labels.
+	mx = string("\0\12\1b\2mx\4test\0", 13);
+	Zone.push_back({ "mx.test", ns_t_mx, 300, mx });
+	mx = string("\0\5\1a\2mx\4test\0", 13);
+	Zone.push_back({ "mx.test", ns_t_mx, 60, mx });
+	Zone.push_back({ "nullmx.test", ns_t_mx, 300, string("\0\0\0", 3) });
+
+	Zone.push_back({ "failing.test", ns_t_a, 300, string((char *)a4, 4) });
+	Failing.insert("failing.test");
+	Slow.insert("slow.test");
+
+}
+
+/*
+ * @args:	bound UDP socket (int fd)
+ */
+void
+Serve(int fd)
+{
+
+	unsigned char	query[NS_PACKETSZ],
+					answer[NS_PACKETSZ];
+	sockaddr_in		from;
+	socklen_t		len;
+	int				n;
+
+	for (;;) {
+
+		len = sizeof(from);
+
+		if ((n = recvfrom(fd, query, sizeof(query), 0,
+						  (sockaddr *)&from, &len)) < NS_HFIXEDSZ)
+
+			continue;
+
+		if ((n = Answer(query, n, answer)) > 0)
+
+			sendto(fd, answer, n, 0, (sockaddr *)&from, len);
+
+	}
+
+}
+
+/*
+ * Answer a query from the zone: the records of its name and type,
+ * NXDOMAIN for an unknown name, SERVFAIL for a failing one.
+ * @args:	query (const unsigned char *query, int len)
+ * 			answer buffer, NS_PACKETSZ bytes (unsigned char *answer)
+ * @return:	length of the answer
+ * - error: 0 (malformed query, no answer)
+ */
+int
+Answer(const unsigned char *query, int len, unsigned char *answer)
+{
+
+	string			name;
+	int				pos = NS_HFIXEDSZ,
+					type,
+					rcode = ns_r_nxdomain,
+					count = 0,
+					end;
+
+	while (pos < len && query[pos] != 0) {
+
+		if (!name.empty())
+
+			name += '.';
+
+		name.append((const char *)query + pos + 1, query[pos]);
+		pos += query[pos] + 1;
+
+	}
+
+	if ((pos += 5) > len)
+
+		return 0;
+
+	type = ns_get16(query + pos - 4);
+
+	{
+		lock_guard<mutex>	guard(Lock);
+
+		Queries[name]++;
+	}
+
+	if (Slow.count(name))
+
+		this_thread::sleep_for(chrono::milliseconds(200));
+
+	// Header and question as asked; answers after them.
+	memcpy(answer, query, pos);
+	end = pos;
+
+	for (size_t i = 0; i < Zone.size(); i++) {
+
+		if (Zone[i].name != name)
+
+			continue;
+
+		rcode = ns_r_noerror;
+
+		if (Zone[i].type != type)
+
+			continue;
+
+		if (end + 12 + (int)Zone[i].rdata.size() > NS_PACKETSZ)
+
+			break;
+
+		ns_put16(0xc000 | NS_HFIXEDSZ, answer + end);	// The name asked
+		ns_put16(type, answer + end + 2);
+		ns_put16(ns_c_in, answer + end + 4);
+		ns_put32(Zone[i].ttl, answer + end + 6);
+		ns_put16(Zone[i].rdata.size(), answer + end + 10);
+		memcpy(answer + end + 12, Zone[i].rdata.data(), Zone[i].rdata.size());
+		end += 12 + Zone[i].rdata.size();
+		count++;
+
+	}
+
+	if (Failing.count(name)) {
+
+		rcode = ns_r_servfail;
+		count = 0;
+		end = pos;
+
+	}
+
+	answer[2] = 0x84 | (query[2] & 0x01);	// Response, authoritative, RD
+	answer[3] = 0x80 | rcode;				// RA
+	ns_put16(count, answer + 6);
+	ns_put16(0, answer + 8);
+	ns_put16(0, answer + 10);
+
+	return end;
+
+}
+
+/*
+ * @args:	resolver (Resolver *resolver)
+ * 			addresses found, -1 on failure (int *result)
+ */
+void
+ResolveSlow(Resolver *resolver, int *result)
+{
+
+	vector<Resolver::Address>	addrs;
+
+	*result = resolver->resolve("slow.test", 25, addrs) == 0 ?
+			  (int)addrs.size() : -1;
+
+}
+
+/*
+ * @args:	name (const string &)
+ * @return:	queries for it so far (int)
+ */
+int
+Count(const string &name)
+{
+
+	lock_guard<mutex>	guard(Lock);
+
+	return Queries[name];
+
+}
+
+/*
+ * @args:	what was checked (const string &), result (bool ok)
+ */
+void
+Check(const string &what, bool ok)
+{
+
+	cout << (ok ? "  ok    " : "  FAIL  ") << what << "\n";
+	Failures += !ok;
+
+}
@@ -0,0 +1,253 @@
+/*
+ * Mail-Sending Program
+ * HeaderScanBench.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+
+/*
+ * Microbenchmark: HeaderScanner vs. the header parsing it replaced
+ * in GetEnvelope (fin.get()/peek() into a string, then a substr()
+ * per line and per field name). Headers of a growing number of
+ * fields (Received:-like filler, From/To/Cc near the end, some
+ * folded) are built in memory and scanned repeatedly; the best run
+ * of each is reported in ns per header field.
+ *
+ * usage: headerscan [runs]
+ */
+
+#include "../HeaderScanner.hh"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <strings.h>
+
+using namespace std;
+
+// Seconds on the monotonic clock.
+
+double			Now();
+
+// Build a message w/ a header of fields fields.
+
+void			MakeMessage(string &msg, int fields);
+
+// Old get()/peek() + substr() path, returns fields found.
+
+int				PerChar(const string &msg);
+
+// HeaderScanner path, returns fields found.
+
+int				Scan(HeaderScanner &scanner, const string &msg);
+
+int
+main(int argc, char **argv)
+{
+
+	int				runs = argc > 1 ? atoi(argv[1]) : 5,
+					sizes[] = { 10, 100, 1000, 10000 },
+					found = 0,
+					reps;
+	HeaderScanner	scanner;
+	string			msg;
+	double			start,
+					per_char,
+					scan;
+
+	cout << fixed << setprecision(1);
+	cout << runs << " runs, best of each, ns per header field\n"
+		 << setw(8) << "fields" << setw(12) << "per-char"
+		 << setw(12) << "scanner" << "\n";
+
+	for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+
+		MakeMessage(msg, sizes[s]);
+		reps = max(1, 100000 / sizes[s]);
+		per_char = scan = 1e9;
+
+		for (int r = 0; r < runs; r++) {
+
+			start = Now();
+
+			for (int i = 0; i < reps; i++)
+
+				found += PerChar(msg);
+
+			per_char = min(per_char, Now() - start);
+			start = Now();
+
+			for (int i = 0; i < reps; i++)
+
+				found += Scan(scanner, msg);
+
+			scan = min(scan, Now() - start);
+
+		}
+
+		cout << setw(8) << sizes[s]
+			 << setw(12) << per_char / reps / sizes[s] * 1e9
+			 << setw(12) << scan / reps / sizes[s] * 1e9 << "\n";
+
+	}
+
+	return found == 0;		// Keep the work
+
+}
+
+/*
+ * @return:	monotonic clock, in seconds (double)
+ */
+double
+Now()
+{
+
+	timespec		ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+
+}
+
+/*
+ * Build a message: fields - 3 filler fields (every fourth folded
+ * over two lines), then From:, To: and Cc:, a blank line and a
+ * short body.
+ * @args:	message (string &msg), header fields (int fields)
+ */
+void
+MakeMessage(string &msg, int fields)
+{
+
+	ostringstream	out;
+
+	for (int i = 0; i < fields - 3; i++) {
+
+		out << "Received: from relay" << i << ".example.net by mx."
+			<< "example.org";
+
+		if (i % 4 == 0)
+
+			out << ";\n\tTue, 18 Oct 2026 09:30:00 +0000";
+
+		out << "\n";
+
+	}
+
+	out << "From: \"Bench\" <bench@example.com>\n"
+		<< "To: sink@example.org, other@example.org\n"
+		<< "Cc: copy@example.org\n\n"
+		<< "body\n";
+	msg = out.str();
+
+}
+
+/*
+ * Old path: the header char by char into a string, then per line
+ * a substr() of the field and of its name.
+ * @args:	message (const string &msg)
+ * @return:	From/To/Cc fields found
+ */
+int
+PerChar(const string &msg)
+{
+
+	istringstream	fin(msg);
+	string			header,
+					field,
+					name;
+	size_t			pos = 0,
+					end,
+					colon;
+	char			ch;
+	int				found = 0;
+
+	while (fin.get(ch) && (fin.peek() != '\n' || ch != '\n'))
+
+		header.append(1, ch);
+
+	header.append("\n");
+
+	while (pos < header.length()) {
+
+		end = header.find('\n', pos);
+		field.assign(header, pos, end - pos);
+
+		while (end + 1 < header.length() &&
+			   (header[end + 1] == ' ' || header[end + 1] == '\t')) {
+
+			pos = end + 1;
+			end = header.find('\n', pos);
+			field.append(header, pos, end - pos);
+
+		}
+
+		pos = end + 1;
+
+		if ((colon = field.find(':')) == string::npos)
+
+			continue;
+
+		name = field.substr(0, colon);
+
+		if (strcasecmp(name.c_str(), "From") == 0 ||
+			strcasecmp(name.c_str(), "To") == 0 ||
+			strcasecmp(name.c_str(), "Cc") == 0)
+
+			found++;
+
+	}
+
+	return found;
+
+}
+
+/*
+ * Scanner path.
+ * @args:	scanner (reused), message (const string &msg)
+ * @return:	From/To/Cc fields found
+ */
+int
+Scan(HeaderScanner &scanner, const string &msg)
+{
+
+	scanner.scan(msg.data(), msg.length());
+
+	return scanner.count(HeaderScanner::From) +
+		   scanner.count(HeaderScanner::To) +
+		   scanner.count(HeaderScanner::Cc);
+
+}
@@ -0,0 +1,399 @@
+/*
+ * Mail-Sending Program
+ * LoadDriver.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+
+/*
+ * Load driver for benchmarks: sends messages through SmtpEngine to
+ * a relay, normally the local sink (see SmtpSink.cc), for each
+ * combination of message size, recipient count and concurrency:
+ * 	-s sizes	message sizes in bytes, k/m suffixes (e.g. 1k,100k)
+ * 	-r counts	recipients per message (e.g. 1,10)
+ * 	-c levels	messages in flight, one session each (e.g. 1,8,64)
+ * 	-n msgs		messages per combination
+ * 	-w			send wire files (sendfile) instead of plain ones
+ * The load is closed-loop: a new message is submitted as soon as
+ * one completes, so there are always "concurrency" in flight. The
+ * latency of a message is from its submission to the relay's reply
+ * to its data. Reported per combination: messages/s, message
+ * bytes/s and p50/p99/p999 latency.
+ *
+ * usage: loaddriver [-h host] [-p port] [-n msgs] [-s sizes]
+ * 		  [-r counts] [-c levels] [-w]
+ */
+
+#include "../SmtpEngine.hh"
+#include "../WireFile.hh"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+#include <csignal>
+#include <ctime>
+#include <unistd.h>
+
+using namespace std;
+
+/*
+ * Results of one combination.
+ */
+struct Run
+{
+	size_t			size;			// Message bytes
+	int				rcpts,			// Recipients per message
+					concurrency;
+	int				sent,
+					failed;
+	double			seconds;		// Wall time
+	vector<double>	latency;		// ms per message, sorted
+};
+
+// Seconds on the monotonic clock.
+
+double			Now();
+
+// Parse a comma-separated list of sizes ("1k,10k,1m").
+
+vector<size_t>	ParseList(const string &list);
+
+// Write a message file of about size bytes, return its name.
+
+string			MakeMessage(const string &dir, size_t size, int rcpts,
+							bool wire);
+
+// Send msgs messages, concurrency at a time.
+
+void			Load(const string &host, int port, const string &file,
+					 int msgs, Run &run);
+
+// Latency percentile of a sorted sample.
+
+double			Percentile(const vector<double> &sorted, double p);
+
+int
+main(int argc, char **argv)
+{
+
+	string			host = "127.0.0.1";
+	int				port = 2525,
+					msgs = 1000,
+					opt;
+	bool			wire = false;
+	vector<size_t>	sizes = ParseList("1k,10k,100k"),
+					rcpts = ParseList("1,10"),
+					levels = ParseList("1,8,64");
+	char			dir[] = "/tmp/loaddriverXXXXXX";
+
+	while ((opt = getopt(argc, argv, "h:p:n:s:r:c:w")) != -1) {
+
+		switch (opt) {
+
+		case 'h':	host = optarg;					break;
+		case 'p':	port = atoi(optarg);			break;
+		case 'n':	msgs = atoi(optarg);			break;
+		case 's':	sizes = ParseList(optarg);		break;
+		case 'r':	rcpts = ParseList(optarg);		break;
+		case 'c':	levels = ParseList(optarg);		break;
+		case 'w':	wire = true;					break;
+
+		default:
+			cerr << "usage: " << argv[0] << " [-h host] [-p port]"
+				 << " [-n msgs] [-s sizes] [-r counts] [-c levels] [-w]\n";
+			return 1;
+
+		}
+
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+
+	if (mkdtemp(dir) == NULL) {
+
+		perror("loaddriver");
+		return 1;
+
+	}
+
+	cout << setw(8) << "size" << setw(7) << "rcpts" << setw(6) << "conc"
+		 << setw(8) << "sent" << setw(7) << "failed"
+		 << setw(10) << "msgs/s" << setw(10) << "MB/s"
+		 << setw(9) << "p50 ms" << setw(9) << "p99 ms"
+		 << setw(9) << "p999 ms" << endl;
+
+	for (size_t s = 0; s < sizes.size(); s++) {
+
+		for (size_t r = 0; r < rcpts.size(); r++) {
+
+			string	file = MakeMessage(dir, sizes[s], rcpts[r], wire);
+
+			for (size_t c = 0; c < levels.size(); c++) {
+
+				Run		run;
+
+				run.size = sizes[s];
+				run.rcpts = rcpts[r];
+				run.concurrency = levels[c];
+				Load(host, port, file, msgs, run);
+
+				cout << fixed << setprecision(1)
+					 << setw(8) << run.size << setw(7) << run.rcpts
+					 << setw(6) << run.concurrency
+					 << setw(8) << run.sent << setw(7) << run.failed
+					 << setw(10) << run.sent / run.seconds
+					 << setw(10) << run.sent * run.size / run.seconds / 1e6
+					 << setprecision(2)
+					 << setw(9) << Percentile(run.latency, 0.50)
+					 << setw(9) << Percentile(run.latency, 0.99)
+					 << setw(9) << Percentile(run.latency, 0.999) << endl;
+
+			}
+
+			unlink(file.c_str());
+
+		}
+
+	}
+
+	rmdir(dir);
+
+	return 0;
+
+}
+
+/*
+ * Closed-loop load: keep run.concurrency messages submitted to one
+ * engine (one session each), submit another as each completes.
+ * @args:	relay host/port, message file, # of messages, results
+ */
+void
+Load(const string &host, int port, const string &file, int msgs, Run &run)
+{
+
+	SmtpEngine			engine(SmtpEngine::DefaultMaxSessions,
+							   run.concurrency);
+	SmtpEngine::Job		job;
+	SmtpEngine::Result	res;
+	vector<double>		start(msgs);	// Submission times
+	int					submitted = 0;
+	double				t0 = Now();
+
+	engine.set_max_per_conn(1000000);	// Sessions last the whole run
+
+	job.host = host;
+	job.port = port;
+	job.filename = file;
+	job.from = "bench@loaddriver.test";
+
+	for (int i = 0; i < run.rcpts; i++) {
+
+		ostringstream	rcpt;
+
+		rcpt << "rcpt" << i << "@sink.test";
+		job.to.push_back(rcpt.str());
+
+	}
+
+	run.sent = run.failed = 0;
+	run.latency.clear();
+
+	while (run.sent + run.failed < msgs) {
+
+		while (submitted < msgs &&
+			   submitted - run.sent - run.failed < run.concurrency) {
+
+			job.user = (void *)(size_t)submitted;
+			start[submitted++] = Now();
+			engine.submit(job);
+
+		}
+
+		engine.run(-1);
+
+		while (engine.complete(res)) {
+
+			run.latency.push_back((Now() - start[(size_t)res.user]) * 1000);
+
+			if (res.result == 0)
+
+				run.sent++;
+
+			else
+
+				run.failed++;
+
+		}
+
+	}
+
+	run.seconds = Now() - t0;
+	sort(run.latency.begin(), run.latency.end());
+
+}
+
+/*
+ * Write a message of about size bytes: a header for rcpts
+ * recipients and 76-column text lines, some beginning w/ '.', or
+ * its wire file (see WireFile.hh).
+ * @args:	directory, size in bytes, # of recipients, wire file?
+ * @return:	file name
+ */
+string
+MakeMessage(const string &dir, size_t size, int rcpts, bool wire)
+{
+
+	ostringstream	name;
+	string			line(74, 'x');
+	ofstream		out;
+	size_t			written = 0;
+	vector<string>	to;
+
+	name << dir << "/msg-" << size << "-" << rcpts;
+	out.open(name.str().c_str(), ios::out | ios::binary);
+	out << "From: bench@loaddriver.test\n";
+
+	for (int i = 0; i < rcpts; i++) {
+
+		ostringstream	rcpt;
+
+		rcpt << "rcpt" << i << "@sink.test";
+		to.push_back(rcpt.str());
+		out << "To: " << to.back() << "\n";
+
+	}
+
+	out << "Subject: load " << size << "\n\n";
+
+	for (int i = 0; written < size; i++) {
+
+		line[0] = i % 10 == 0 ? '.' : 'x';
+		out << line << "\n";
+		written += line.length() + 1;
+
+	}
+
+	out.close();
+
+	if (!wire)
+
+		return name.str();
+
+	string		wire_name = name.str() + WireSuffix;
+
+	if (WirePrepare(name.str(), wire_name, "bench@loaddriver.test", to) != 0) {
+
+		perror(wire_name.c_str());
+		exit(1);
+
+	}
+
+	unlink(name.str().c_str());
+
+	return wire_name;
+
+}
+
+/*
+ * Parse "a,b,c" where each item is a number w/ an optional k (1024)
+ * or m (1048576) suffix.
+ * @args:	list (const string &list)
+ * @return:	the numbers
+ */
+vector<size_t>
+ParseList(const string &list)
+{
+
+	vector<size_t>	items;
+	istringstream	in(list);
+	string			item;
+
+	while (getline(in, item, ',')) {
+
+		size_t		n = strtoul(item.c_str(), NULL, 10);
+		char		unit = item.empty() ? 0 : item[item.length() - 1];
+
+		if (unit == 'k' || unit == 'K')
+
+			n <<= 10;
+
+		else if (unit == 'm' || unit == 'M')
+
+			n <<= 20;
+
+		if (n > 0)
+
+			items.push_back(n);
+
+	}
+
+	return items;
+
+}
+
+/*
+ * @args:	sorted sample, fraction (e.g. 0.99)
+ * @return:	value below which that fraction of the sample falls
+ */
+double
+Percentile(const vector<double> &sorted, double p)
+{
+
+	if (sorted.empty())
+
+		return 0;
+
+	size_t		i = (size_t)(p * sorted.size());
+
+	return sorted[min(i, sorted.size() - 1)];
+
+}
+
+/*
+ * @return:	seconds on the monotonic clock
+ */
+double
+Now()
+{
+
+	timespec		ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+
+}
@@ -0,0 +1,235 @@
+/*
+ * Mail-Sending Program
+ * MergeBench.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+
+/*
+ * Microbenchmark: mail merge w/ a compiled MergeTemplate vs. what
+ * it replaced, messages pre-rendered to files (a find/replace per
+ * placeholder into a new string, written out, read back by the
+ * sender). n recipients (100000 by default) of a CSV file are
+ * rendered both ways; reported in ns per message. The messages are
+ * compared, and any that differ are counted: they should be none.
+ *
+ * usage: mergebench [recipients]
+ */
+
+#include "../MailMerge.hh"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <unistd.h>
+
+using namespace std;
+
+const char		Template[] =
+	"From: Joseph Lee <jlee@pdx.edu>\n"
+	"To: {{name}} <{{email}}>\n"
+	"Subject: Your order {{order}}\n"
+	"\n"
+	"Dear {{name}},\n"
+	"\n"
+	"your order {{order}} of {{items}} items ships on {{date}}.\n"
+	"Track it at https://example.com/track/{{order}}.\n"
+	"\n"
+	"Regards,\n"
+	"Joseph\n";
+
+// Seconds on the monotonic clock.
+
+double			Now();
+
+// Replace each "{{name}}" of text w/ value.
+
+void			Replace(string &text, const string &name,
+						const string &value);
+
+int
+main(int argc, char **argv)
+{
+
+	size_t			n = argc > 1 ? atol(argv[1]) : 100000,
+					differ = 0;
+	char			dir[] = "/tmp/mergebenchXXXXXX";
+	string			data,
+					message;
+	vector<string>	columns;
+	MergeTemplate	tmpl;
+	MergeData		records;
+	MergeData::Record	rec;
+	vector<char>	out,
+					bcc;
+	double			start,
+					compiled,
+					files;
+
+	if (mkdtemp(dir) == NULL) {
+
+		perror(dir);
+		return 1;
+
+	}
+
+	data = string(dir) + "/data.csv";
+
+	{
+		ofstream	fout(data.c_str());
+
+		fout << "name,email,order,items,date\n";
+
+		for (size_t i = 0; i < n; i++)
+
+			fout << "\"User " << i << "\",user" << i << "@example.com,"
+				 << 100000 + i << "," << i % 7 + 1 << ",2026-11-"
+				 << i % 28 + 1 << "\n";
+	}
+
+	if (tmpl.compile(Template) != 0 || records.open(data) != 0 ||
+		records.bind(tmpl.fields()) != 0) {
+
+		cerr << "setup: " << tmpl.error() << records.error() << "\n";
+		return 1;
+
+	}
+
+	// Compiled template, rendered into a reused buffer
+	start = Now();
+
+	for (size_t i = 0; i < n; i++) {
+
+		records.read(i, rec);
+		tmpl.render(rec.values.data(), out, bcc);
+
+	}
+
+	compiled = Now() - start;
+
+	// Pre-rendered files: render, write out, read back
+	start = Now();
+
+	for (size_t i = 0; i < n; i++) {
+
+		string			name = string(dir) + "/m" + to_string(i);
+		ostringstream	text;
+
+		message = Template;
+		records.read(i, rec);
+
+		for (size_t f = 0; f < tmpl.fields().size(); f++)
+
+			Replace(message, tmpl.fields()[f], string(rec.values[f]));
+
+		{
+			ofstream	fout(name.c_str());
+
+			fout << message;
+		}
+
+		ifstream	fin(name.c_str());
+
+		text << fin.rdbuf();
+		message = text.str();
+		unlink(name.c_str());
+
+	}
+
+	files = Now() - start;
+
+	for (size_t i = 0; i < n; i++) {
+
+		records.read(i, rec);
+		tmpl.render(rec.values.data(), out, bcc);
+		message = Template;
+
+		for (size_t f = 0; f < tmpl.fields().size(); f++)
+
+			Replace(message, tmpl.fields()[f], string(rec.values[f]));
+
+		differ += message != string(out.begin(), out.end());
+
+	}
+
+	unlink(data.c_str());
+	rmdir(dir);
+
+	cout << fixed << setprecision(1);
+	cout << n << " messages, ns per message\n"
+		 << setw(12) << "compiled" << setw(12) << compiled / n * 1e9 << "\n"
+		 << setw(12) << "files" << setw(12) << files / n * 1e9 << "\n";
+	cout << differ << " differ\n";
+
+	return differ != 0;
+
+}
+
+/*
+ * @args:	text (string &text), placeholder name (const string &name)
+ * 			its value (const string &value)
+ */
+void
+Replace(string &text, const string &name, const string &value)
+{
+
+	string			key = "{{" + name + "}}";
+	size_t			pos = 0;
+
+	while ((pos = text.find(key, pos)) != string::npos) {
+
+		text.replace(pos, key.length(), value);
+		pos += value.length();
+
+	}
+
+}
+
+/*
+ * @return:	monotonic clock, in seconds (double)
+ */
+double
+Now()
+{
+
+	timespec		ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+
+}
@@ -0,0 +1,641 @@
+/*
+ * Mail-Sending Program
+ * SmtpSink.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+
+/*
+ * Local SMTP sink server for benchmarks: accepts any number of
+ * sessions and messages and throws the messages away. One epoll
+ * loop serves all connections; replies are held back to simulate
+ * a slow relay.
+ * 	-l ms	latency added to every reply (after the one before it)
+ * 	-d ms	extra latency of the reply to the message data
+ * 	-t n	throttle: at most n messages/s in total, MAIL FROM over
+ * 			the rate gets "451 4.7.1"
+ * 	-r pct	reject pct % of RCPT TO w/ "550 5.1.1"
+ * 	-P		do not offer PIPELINING
+ * 	-b		offer CHUNKING and BINARYMIME (BDAT, RFC 3030)
+ * Totals are printed when the sink is stopped (SIGINT/SIGTERM).
+ *
+ * usage: smtpsink [-p port] [-l ms] [-d ms] [-t msgs/s] [-r pct] [-P]
+ * 		  [-b]
+ */
+
+#include <iostream>
+#include <string>
+#include <deque>
+#include <map>
+#include <algorithm>
+#include <set>
+#include <utility>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <csignal>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+using namespace std;
+
+const int		MaxEvents = 256;
+
+/*
+ * One client connection.
+ */
+struct Conn
+{
+	int				fd;
+	string			in,				// Received, not yet handled
+					out;			// Replies due, not yet written
+	bool			in_data,		// Receiving message data
+					in_chunk,		// Receiving a BDAT chunk
+					last_chunk,		// ... the LAST one
+					closing;		// Close once out is written
+	size_t			chunk;			// Bytes of the chunk still due
+	int				match;			// Chars of <CRLF>.<CRLF> matched
+	bool			mail;			// MAIL FROM accepted
+	int				rcpts;			// RCPT TO accepted
+	long			last_due;		// When the last reply is due, ms
+	deque<pair<long, string> >	replies;	// Held back replies
+};
+
+struct Settings
+{
+	int				latency,		// ms per reply
+					data_latency,	// Extra ms for the final reply
+					rate,			// Messages/s, 0: unlimited
+					reject;			// % of RCPT rejected
+	bool			pipelining,
+					chunking;		// Offer CHUNKING
+};
+
+struct Totals
+{
+	unsigned long	sessions,
+					messages,
+					bytes,
+					throttled,
+					rejected;
+};
+
+volatile sig_atomic_t	Stop = 0;
+
+// Milliseconds on the monotonic clock.
+
+long			Now();
+
+// Handle the received commands/data of a connection.
+
+void			Receive(Conn *conn, const Settings &set, Totals &tot);
+
+// Hold back a reply until its due time.
+
+void			Reply(Conn *conn, const string &reply, int delay);
+
+// Write due replies; false if the connection is to be closed.
+
+bool			Flush(Conn *conn, long now);
+
+// Throttle: true if a message may start now.
+
+bool			Admit(const Settings &set);
+
+void
+OnSignal(int)
+{
+
+	Stop = 1;
+
+}
+
+int
+main(int argc, char **argv)
+{
+
+	Settings		set = { 0, 0, 0, 0, true, false };
+	Totals			tot = { 0, 0, 0, 0, 0 };
+	int				port = 2525,
+					opt,
+					lfd,
+					epfd,
+					one = 1,
+					n,
+					wait;
+	sockaddr_in		addr;
+	epoll_event		ev,
+					evs[MaxEvents];
+	map<int, Conn *>	conns;
+	char			buf[65536];
+
+	while ((opt = getopt(argc, argv, "p:l:d:t:r:Pb")) != -1) {
+
+		switch (opt) {
+
+		case 'p':	port = atoi(optarg);				break;
+		case 'l':	set.latency = atoi(optarg);			break;
+		case 'd':	set.data_latency = atoi(optarg);	break;
+		case 't':	set.rate = atoi(optarg);			break;
+		case 'r':	set.reject = atoi(optarg);			break;
+		case 'P':	set.pipelining = false;				break;
+		case 'b':	set.chunking = true;				break;
+
+		default:
+			cerr << "usage: " << argv[0] << " [-p port] [-l ms] [-d ms]"
+				 << " [-t msgs/s] [-r pct] [-P] [-b]\n";
+			return 1;
+
+		}
+
+	}
+
+	signal(SIGINT, OnSignal);
+	signal(SIGTERM, OnSignal);
+	signal(SIGPIPE, SIG_IGN);
+
+	lfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+	setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if (bind(lfd, (sockaddr *)&addr, sizeof(addr)) != 0 ||
+		listen(lfd, 1024) != 0) {
+
+		perror("smtpsink");
+		return 1;
+
+	}
+
+	epfd = epoll_create1(0);
+	ev.events = EPOLLIN;
+	ev.data.ptr = NULL;		// Listening socket
+	epoll_ctl(epfd, EPOLL_CTL_ADD, lfd, &ev);
+
+	cerr << "smtpsink: listening on 127.0.0.1:" << port << endl;
+
+	while (!Stop) {
+
+		long		now = Now(),
+					next = -1;
+
+		// Sleep until the next held back reply is due, or retry
+		// soon a write that found the socket full.
+		for (map<int, Conn *>::iterator c = conns.begin();
+			 c != conns.end(); ++c) {
+
+			if (!c->second->out.empty())
+
+				next = now + 1;
+
+			else if (!c->second->replies.empty() &&
+					 (next < 0 || c->second->replies.front().first < next))
+
+				next = c->second->replies.front().first;
+
+		}
+
+		wait = next < 0 ? 1000 : (next > now ? next - now : 0);
+
+		if ((n = epoll_wait(epfd, evs, MaxEvents, wait)) < 0 &&
+			errno != EINTR)
+
+			break;
+
+		for (int i = 0; i < n; i++) {
+
+			Conn	*conn = (Conn *)evs[i].data.ptr;
+			int		fd;
+
+			if (conn == NULL) {
+
+				while ((fd = accept4(lfd, NULL, NULL, SOCK_NONBLOCK)) >= 0) {
+
+					setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+					conn = new Conn;
+					conn->fd = fd;
+					conn->in_data = false;
+					conn->in_chunk = false;
+					conn->closing = false;
+					conn->match = 2;
+					conn->mail = false;
+					conn->rcpts = 0;
+					conn->last_due = 0;
+					conns[fd] = conn;
+					ev.events = EPOLLIN;
+					ev.data.ptr = conn;
+					epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+					tot.sessions++;
+					Reply(conn, "220 smtpsink ready\r\n", set.latency);
+
+				}
+
+				continue;
+
+			}
+
+			ssize_t		got;
+			bool		eof = false;
+
+			while ((got = read(conn->fd, buf, sizeof(buf))) > 0)
+
+				conn->in.append(buf, got);
+
+			if (got == 0 || (got < 0 && errno != EAGAIN))
+
+				eof = true;
+
+			Receive(conn, set, tot);
+
+			if (eof) {
+
+				close(conn->fd);
+				conns.erase(conn->fd);
+				delete conn;
+
+			}
+
+		}
+
+		now = Now();
+
+		for (map<int, Conn *>::iterator c = conns.begin();
+			 c != conns.end(); ) {
+
+			if (!Flush(c->second, now)) {
+
+				close(c->first);
+				delete c->second;
+				conns.erase(c++);
+
+			}
+			else
+
+				++c;
+
+		}
+
+	}
+
+	cout << "sessions " << tot.sessions << ", messages " << tot.messages
+		 << ", bytes " << tot.bytes << ", throttled " << tot.throttled
+		 << ", rejected " << tot.rejected << endl;
+
+	return 0;
+
+}
+
+/*
+ * Handle what a connection has sent: message data up to the
+ * <CRLF>.<CRLF> that ends it, the bytes of a BDAT chunk, otherwise
+ * one command per line.
+ * @args:	connection, sink settings, totals
+ */
+void
+Receive(Conn *conn, const Settings &set, Totals &tot)
+{
+
+	static const char	end[] = "\r\n.\r\n";
+	size_t			pos = 0,
+					nl;
+
+	// An empty chunk ("BDAT 0 LAST") is over w/o any data.
+	while (pos < conn->in.length() || (conn->in_chunk && conn->chunk == 0)) {
+
+		if (conn->in_chunk) {
+
+			size_t		n = min(conn->chunk, conn->in.length() - pos);
+
+			pos += n;
+			tot.bytes += n;
+
+			if ((conn->chunk -= n) > 0)
+
+				break;			// Rest of the chunk not in yet
+
+			conn->in_chunk = false;
+
+			if (conn->rcpts == 0)
+
+				Reply(conn, "503 5.5.1 no valid recipients\r\n",
+					  set.latency);
+
+			else if (conn->last_chunk) {
+
+				tot.messages++;
+				conn->mail = false;
+				conn->rcpts = 0;
+				Reply(conn, "250 2.0.0 queued\r\n",
+					  set.latency + set.data_latency);
+
+			}
+			else
+
+				Reply(conn, "250 2.0.0 chunk ok\r\n", set.latency);
+
+			continue;
+
+		}
+
+		if (conn->in_data) {
+
+			// Match <CRLF>.<CRLF> across reads; the DATA line's
+			// own CRLF counts as the first one.
+			while (pos < conn->in.length() && conn->match < 5) {
+
+				if (conn->match == 0) {
+
+					// Nothing matched: skip to the next CR.
+					const char	*p = conn->in.data() + pos,
+								*cr = (const char *)memchr(p, '\r',
+											conn->in.length() - pos);
+					size_t		skip = cr ? cr - p : conn->in.length() - pos;
+
+					tot.bytes += skip;
+
+					if ((pos += skip) == conn->in.length())
+
+						break;
+
+				}
+
+				char	ch = conn->in[pos++];
+
+				tot.bytes++;
+
+				if (ch == end[conn->match])
+
+					conn->match++;
+
+				else
+
+					conn->match = (ch == '\r') ? 1 : 0;
+
+			}
+
+			if (conn->match == 5) {
+
+				conn->in_data = false;
+				tot.messages++;
+				Reply(conn, "250 2.0.0 queued\r\n",
+					  set.latency + set.data_latency);
+
+			}
+
+			continue;
+
+		}
+
+		if ((nl = conn->in.find('\n', pos)) == string::npos)
+
+			break;
+
+		string		cmd = conn->in.substr(pos, nl - pos);
+
+		pos = nl + 1;
+
+		if (strncasecmp(cmd.c_str(), "EHLO", 4) == 0)
+
+			Reply(conn, string("250-smtpsink\r\n") +
+				  (set.pipelining ? "250-PIPELINING\r\n" : "") +
+				  (set.chunking ? "250-CHUNKING\r\n250-BINARYMIME\r\n" : "") +
+				  "250 8BITMIME\r\n", set.latency);
+
+		else if (set.chunking && strncasecmp(cmd.c_str(), "BDAT", 4) == 0) {
+
+			// "BDAT <size> [LAST]", the chunk follows the CRLF.
+			char	*end;
+
+			conn->chunk = strtoul(cmd.c_str() + 4, &end, 10);
+			conn->last_chunk = strncasecmp(end, " LAST", 5) == 0;
+			conn->in_chunk = true;
+
+		}
+
+		else if (strncasecmp(cmd.c_str(), "HELO", 4) == 0 ||
+				 strncasecmp(cmd.c_str(), "RSET", 4) == 0 ||
+				 strncasecmp(cmd.c_str(), "NOOP", 4) == 0) {
+
+			if (strncasecmp(cmd.c_str(), "NOOP", 4) != 0) {
+
+				conn->mail = false;
+				conn->rcpts = 0;
+
+			}
+
+			Reply(conn, "250 2.0.0 ok\r\n", set.latency);
+
+		}
+		else if (strncasecmp(cmd.c_str(), "MAIL", 4) == 0) {
+
+			if (Admit(set)) {
+
+				conn->mail = true;
+				Reply(conn, "250 2.1.0 ok\r\n", set.latency);
+
+			}
+
+			else {
+
+				tot.throttled++;
+				Reply(conn, "451 4.7.1 slow down\r\n", set.latency);
+
+			}
+
+		}
+		else if (strncasecmp(cmd.c_str(), "RCPT", 4) == 0) {
+
+			if (!conn->mail)
+
+				Reply(conn, "503 5.5.1 need MAIL\r\n", set.latency);
+
+			else if (set.reject > 0 && rand() % 100 < set.reject) {
+
+				tot.rejected++;
+				Reply(conn, "550 5.1.1 no such user\r\n", set.latency);
+
+			}
+			else {
+
+				conn->rcpts++;
+				Reply(conn, "250 2.1.5 ok\r\n", set.latency);
+
+			}
+
+		}
+		else if (strncasecmp(cmd.c_str(), "DATA", 4) == 0) {
+
+			if (conn->rcpts == 0) {
+
+				Reply(conn, "503 5.5.1 no valid recipients\r\n",
+					  set.latency);
+				continue;
+
+			}
+
+			conn->in_data = true;
+			conn->mail = false;
+			conn->rcpts = 0;
+			conn->match = 2;		// After the DATA line's CRLF
+			Reply(conn, "354 go ahead\r\n", set.latency);
+
+		}
+		else if (strncasecmp(cmd.c_str(), "QUIT", 4) == 0) {
+
+			Reply(conn, "221 2.0.0 bye\r\n", set.latency);
+			conn->replies.back().second += '\0';	// Close after it
+
+		}
+		else
+
+			Reply(conn, "500 5.5.2 what?\r\n", set.latency);
+
+	}
+
+	conn->in.erase(0, pos);
+
+}
+
+/*
+ * Hold back a reply: it is due delay ms after now, or after the
+ * reply before it, whichever is later (replies stay in order).
+ * @args:	connection, reply text, delay in ms
+ */
+void
+Reply(Conn *conn, const string &reply, int delay)
+{
+
+	long		due = max(Now(), conn->last_due) + delay;
+
+	conn->last_due = due;
+	conn->replies.push_back(make_pair(due, reply));
+
+}
+
+/*
+ * Write the replies that are due. A reply ending in '\0' (to QUIT)
+ * closes the connection once written.
+ * @args:	connection, current time in ms
+ * @return:	true (keep), false (close the connection)
+ */
+bool
+Flush(Conn *conn, long now)
+{
+
+	while (!conn->replies.empty() && conn->replies.front().first <= now) {
+
+		string	&reply = conn->replies.front().second;
+
+		if (!reply.empty() && reply[reply.length() - 1] == '\0') {
+
+			reply.erase(reply.length() - 1);
+			conn->closing = true;
+
+		}
+
+		conn->out += reply;
+		conn->replies.pop_front();
+
+	}
+
+	while (!conn->out.empty()) {
+
+		ssize_t		n = write(conn->fd, conn->out.data(), conn->out.length());
+
+		if (n <= 0)
+
+			return n < 0 && errno == EAGAIN;
+
+		conn->out.erase(0, n);
+
+	}
+
+	return !conn->closing;
+
+}
+
+/*
+ * Token bucket of rate tokens/s, up to rate tokens.
+ * @args:	sink settings
+ * @return:	true (a message may start), false (over the rate)
+ */
+bool
+Admit(const Settings &set)
+{
+
+	static double	tokens = 0;
+	static long		last = 0;
+	long			now = Now();
+
+	if (set.rate <= 0)
+
+		return true;
+
+	if (last == 0)
+
+		tokens = set.rate;
+
+	tokens = min((double)set.rate, tokens + (now - last) * set.rate / 1000.0);
+	last = now;
+
+	if (tokens < 1)
+
+		return false;
+
+	tokens--;
+
+	return true;
+
+}
+
+/*
+ * @return:	milliseconds on the monotonic clock
+ */
+long
+Now()
+{
+
+	timespec		ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000L + ts.tv_nsec / 1000000;
+
+}
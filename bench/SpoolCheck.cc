@@ -0,0 +1,458 @@
+/*
+ * Mail-Sending Program
+ * SpoolCheck.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+/*
+ * Check: Spool, in a scratch directory under /tmp. Failures of the
+ * journal are injected by wrapping write(), fdatasync() and
+ * ftruncate() (linked w/ --wrap), and time() is wrapped so Deferred
+ * messages can be made due. Checked: enqueue and counts across a
+ * reopen, message files removed once their final record is on
+ * disk, a group that fails to sync or is written short retried
+ * whole, a journal that cannot be cut back refusing enqueue and
+ * its torn tail cut off on reopen, the journal compacted to one
+ * record per live message, and a bounced recipient remembered
+ * across a reopen. Each check prints ok or FAIL; the exit status
+ * is the number of failures.
+ *
+ * usage: spoolcheck
+ */
+
+#include "../Spool.hh"
+#include "../Logger.hh"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+// Failures to inject, and the clock's offset.
+
+bool			FailWrite = false,	// Next write: half and a byte, ENOSPC
+				FailSync = false,	// fdatasync: EIO
+				FailTrunc = false;	// ftruncate: EIO
+time_t			Clock = 0;			// Secs. added to time()
+int				Failures = 0;
+
+extern "C" {
+
+ssize_t			__real_write(int fd, const void *buf, size_t n);
+int				__real_fdatasync(int fd);
+int				__real_ftruncate(int fd, off_t length);
+time_t			__real_time(time_t *t);
+
+ssize_t			__wrap_write(int fd, const void *buf, size_t n);
+int				__wrap_fdatasync(int fd);
+int				__wrap_ftruncate(int fd, off_t length);
+time_t			__wrap_time(time_t *t);
+
+}
+
+// Plain message file to enqueue.
+
+void			MakeMessage(const string &filename);
+
+// Take the next message and give its result.
+
+Spool::State	Send(Spool &spool, const vector<int> &status);
+
+// Wait (up to 1 s) for the spool to hold n message files.
+
+size_t			Files(const string &dir, size_t n);
+
+// Size of a spool's journal.
+
+off_t			JournalSize(const string &dir);
+
+// Print and count a check.
+
+void			Check(const string &what, bool ok);
+
+int
+main()
+{
+
+	char			base[] = "/tmp/spoolcheck.XXXXXX";
+	string			dir,
+					msg,
+					path,
+					source,
+					from;
+	vector<string>	one(1, "b@y.org"),
+					two;
+	vector<string>	to;
+	uint64_t		id;
+	off_t			record,			// Bytes per record (1 recipient)
+					size;
+	int				r,
+					error;
+
+	if (mkdtemp(base) == NULL) {
+
+		perror("scratch directory");
+		return 1;
+
+	}
+
+	dir = string(base) + "/q";
+	msg = string(base) + "/msg.txt";
+	MakeMessage(msg);
+	two.push_back("b@y.org");
+	two.push_back("c@y.org");
+	cout << "spool in " << dir << "\n";
+
+	{
+
+		Spool			spool;
+
+		// Enqueue: files, counts, all on disk after flush().
+		r = spool.open(dir);
+		Check("open a new spool", r == 0);
+
+		for (int i = 0; i < 5; i++)
+
+			r |= spool.enqueue(msg, "a@x.org", one, id);
+
+		Check("enqueue 5, flush",
+			  r == 0 && spool.flush() == 0 && id == 5 &&
+			  spool.count(Spool::Pending) == 5 && Files(dir, 5) == 5);
+
+		// Delivered: the file goes once the record is on disk.
+		Check("deliver 2", Send(spool, vector<int>(1, 250)) ==
+			  Spool::Delivered && Send(spool, vector<int>(1, 250)) ==
+			  Spool::Delivered && spool.flush() == 0 &&
+			  spool.count(Spool::Delivered) == 2 && Files(dir, 3) == 3);
+		spool.close();
+
+	}
+
+	{
+
+		Spool			spool;
+
+		// Reopen: the same messages, one record each.
+		r = spool.open(dir);
+		size = JournalSize(dir);
+		record = size / 3;
+		Check("reopen: 3 pending, journal compacted",
+			  r == 0 && spool.count(Spool::Pending) == 3 &&
+			  Files(dir, 3) == 3 && record > 0 && size == 3 * record);
+
+		// A group that fails to sync is retried, its file kept.
+		FailSync = true;
+		Send(spool, vector<int>(1, 250));
+		r = spool.flush();
+		error = errno;
+		Check("fdatasync fails: flush fails w/ EIO, file kept",
+			  r == -1 && error == EIO && Files(dir, 3) == 3 &&
+			  JournalSize(dir) == size);
+		FailSync = false;
+		this_thread::sleep_for(chrono::milliseconds(Spool::RetryMs + 300));
+		Check("group retried: on disk, file removed",
+			  spool.flush() == 0 && Files(dir, 2) == 2);
+
+		// A short write is cut back off and retried whole.
+		size = JournalSize(dir);
+		FailWrite = true;
+		r = spool.enqueue(msg, "a@x.org", one, id);
+		Check("short write: flush fails w/ ENOSPC",
+			  r == 0 && spool.flush() == -1 && errno == ENOSPC &&
+			  JournalSize(dir) == size);
+		this_thread::sleep_for(chrono::milliseconds(Spool::RetryMs + 300));
+		Check("group retried: on disk", spool.flush() == 0);
+		spool.close();
+
+	}
+
+	{
+
+		Spool			spool;
+
+		r = spool.open(dir);
+		Check("reopen: 3 pending, no record lost",
+			  r == 0 && spool.count(Spool::Pending) == 3 &&
+			  Files(dir, 3) == 3 && JournalSize(dir) == 3 * record);
+
+		// The journal cannot be cut back: torn, no more enqueue.
+		FailWrite = true;
+		FailTrunc = true;
+		Send(spool, vector<int>(1, 250));
+		r = spool.flush();
+		error = errno;
+		Check("short write, ftruncate fails: flush fails",
+			  r == -1 && error == ENOSPC);
+		r = spool.enqueue(msg, "a@x.org", one, id);
+		error = errno;
+		Check("journal torn: enqueue refused w/ its errno",
+			  r == -1 && error == ENOSPC);
+		spool.close();
+		FailTrunc = false;
+
+	}
+
+	size = JournalSize(dir);
+
+	{
+
+		Spool			spool;
+
+		// The delivery never made it: still pending.
+		r = spool.open(dir);
+		Check("reopen: torn record cut off, 3 pending",
+			  r == 0 && size % record != 0 &&
+			  spool.count(Spool::Pending) == 3 && Files(dir, 3) == 3 &&
+			  JournalSize(dir) == 3 * record);
+		spool.close();
+
+	}
+
+	// A recipient refused, the other deferred, then delivered.
+	dir = string(base) + "/q2";
+
+	{
+
+		Spool			spool;
+
+		r = spool.open(dir);
+		r |= spool.enqueue(msg, "a@x.org", two, id);
+		Check("1 message, 2 recipients: 550, 450: deferred",
+			  r == 0 && Send(spool, { 550, 450 }) == Spool::Deferred &&
+			  spool.flush() == 0);
+		spool.close();
+
+	}
+
+	{
+
+		Spool			spool;
+
+		r = spool.open(dir);
+		Check("reopen: deferred", r == 0 &&
+			  spool.count(Spool::Deferred) == 1);
+		Clock += Spool::MaxRetryAfter * 2;
+		Check("due: its source file, only the deferred recipient left",
+			  spool.next(id, path, source, from, to) &&
+			  source == msg && to.size() == 1 &&
+			  to[0] == "c@y.org");
+		Check("250: bounced, the 550 remembered",
+			  spool.done(id, vector<int>(1, 250)) == Spool::Bounced &&
+			  spool.flush() == 0 && Files(dir, 0) == 0);
+		spool.close();
+
+	}
+
+	Logger::shared().stop();
+	system(("rm -rf " + string(base)).c_str());
+	cout << (Failures ? "FAILED: " : "passed, ") << Failures
+		 << " failure(s)\n";
+
+	return Failures;
+
+}
+
+/*
+ * @args:	name (const string &filename)
+ */
+void
+MakeMessage(const string &filename)
+{
+
+	ofstream		out(filename.c_str());
+
+	out << "From: a@x.org\nTo: b@y.org, c@y.org\nSubject: check\n\n"
+		<< "body line\n.dot line\n";
+
+}
+
+/*
+ * @args:	spool (Spool &spool)
+ * 			reply code per recipient (const vector<int> &status)
+ * @return:	state it is left in; InFlight if none was there
+ */
+Spool::State
+Send(Spool &spool, const vector<int> &status)
+{
+
+	uint64_t		id;
+	string			path,
+					source,
+					from;
+	vector<string>	to;
+
+	if (!spool.next(id, path, source, from, to))
+
+		return Spool::InFlight;
+
+	return spool.done(id, status);
+
+}
+
+/*
+ * The spool removes files after it commits, so give it a moment.
+ * @args:	spool directory (const string &dir)
+ * 			files expected (size_t n)
+ * @return:	files in <dir>/msg (size_t)
+ */
+size_t
+Files(const string &dir, size_t n)
+{
+
+	size_t			files = 0;
+
+	for (int tries = 0; tries < 100; tries++) {
+
+		DIR				*d = opendir((dir + "/msg").c_str());
+		struct dirent	*e;
+
+		files = 0;
+
+		while (d != NULL && (e = readdir(d)) != NULL)
+
+			files += e->d_name[0] != '.';
+
+		if (d != NULL)
+
+			closedir(d);
+
+		if (files == n)
+
+			break;
+
+		this_thread::sleep_for(chrono::milliseconds(10));
+
+	}
+
+	return files;
+
+}
+
+/*
+ * @args:	spool directory (const string &dir)
+ * @return:	bytes, -1 if none (off_t)
+ */
+off_t
+JournalSize(const string &dir)
+{
+
+	struct stat		st;
+
+	return stat((dir + "/journal").c_str(), &st) == 0 ? st.st_size : -1;
+
+}
+
+/*
+ * @args:	what was checked (const string &), result (bool ok)
+ */
+void
+Check(const string &what, bool ok)
+{
+
+	cout << (ok ? "  ok    " : "  FAIL  ") << what << "\n";
+	Failures += !ok;
+
+}
+
+/*
+ * The wrappers: the failure, if set, else the real call.
+ */
+ssize_t
+__wrap_write(int fd, const void *buf, size_t n)
+{
+
+	if (FailWrite && n > 2) {
+
+		FailWrite = false;
+		__real_write(fd, buf, n / 2 + 1);		// A torn record
+		errno = ENOSPC;
+		return -1;
+
+	}
+
+	return __real_write(fd, buf, n);
+
+}
+
+int
+__wrap_fdatasync(int fd)
+{
+
+	if (FailSync) {
+
+		errno = EIO;
+		return -1;
+
+	}
+
+	return __real_fdatasync(fd);
+
+}
+
+int
+__wrap_ftruncate(int fd, off_t length)
+{
+
+	if (FailTrunc) {
+
+		errno = EIO;
+		return -1;
+
+	}
+
+	return __real_ftruncate(fd, length);
+
+}
+
+time_t
+__wrap_time(time_t *t)
+{
+
+	time_t			now = __real_time(NULL) + Clock;
+
+	if (t != NULL)
+
+		*t = now;
+
+	return now;
+
+}
@@ -0,0 +1,218 @@
+/*
+ * Mail-Sending Program
+ * TimingWheelBench.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Joseph Lee
+ *	
+ *		CS 300: Assignment #2
+ *	Instructor: Bart Massey
+ */
+
+/*	Copyright (c) 2010 Joseph Lee
+
+	Permission is hereby granted, free of charge, to any person obtaining
+	a copy of this software and associated documentation files
+	(the "Software"), to deal in the Software without restriction,
+	including without limitation the rights	to use, copy, modify, merge,
+	publish, distribute, sublicense, and/or sell copies of the Software,
+	and to permit persons to whom the Software is furnished to do so,
+	subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included
+	in all copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+	CLAIM, DAMAGES OR OTHER	LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+	*/
+
+
+
+/*
+ * Microbenchmark: TimingWheel vs. a multimap of (time, id), the
+ * deferred queue the spool used before. n timers (1M by default)
+ * are scheduled over 16 hours among 1000 destinations, a tenth of
+ * them cancelled, and the clock run to the end, taking every id
+ * as it is due; reported in ns per timer for each phase. Ids due
+ * late (or never) are counted, they should be none. Then 100000
+ * timers of one held destination come due at once, and the ids
+ * released in each of the first seconds after the hold show the
+ * ramp.
+ *
+ * usage: wheelbench [timers]
+ */
+
+#include "../TimingWheel.hh"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <map>
+#include <random>
+#include <cstdlib>
+#include <ctime>
+
+using namespace std;
+
+const time_t	Start = 1800000000;		// Clock at start
+const time_t	Span = 16 * 3600;		// Timers over 16 hours
+
+// Seconds on the monotonic clock.
+
+double			Now();
+
+int
+main(int argc, char **argv)
+{
+
+	size_t			n = argc > 1 ? atol(argv[1]) : 1000000,
+					late = 0,
+					taken = 0;
+	vector<time_t>	when(n);
+	vector<uint32_t>	dest(n),
+					handle(n);
+	vector<multimap<time_t, uint64_t>::iterator>	where(n);
+	multimap<time_t, uint64_t>	later;
+	minstd_rand		random(1);
+	TimingWheel		wheel(Start);
+	uint64_t		id;
+	double			start,
+					add[2],
+					cancel[2],
+					expire[2];
+
+	for (size_t i = 0; i < n; i++) {
+
+		when[i] = Start + 1 + random() % Span;
+		dest[i] = random() % 1000;
+
+	}
+
+	// TimingWheel
+	start = Now();
+
+	for (size_t i = 0; i < n; i++)
+
+		handle[i] = wheel.add(i, dest[i], when[i]);
+
+	add[0] = Now() - start;
+	start = Now();
+
+	for (size_t i = 0; i < n; i += 10)
+
+		wheel.cancel(handle[i]);
+
+	cancel[0] = Now() - start;
+	start = Now();
+
+	for (time_t t = Start + 1; t <= Start + Span; t++) {
+
+		wheel.advance(t);
+
+		while (wheel.pop(id)) {
+
+			late += when[id] != t;
+			taken++;
+
+		}
+
+	}
+
+	expire[0] = Now() - start;
+	late += n - n / 10 - taken;
+
+	// multimap
+	start = Now();
+
+	for (size_t i = 0; i < n; i++)
+
+		where[i] = later.insert(make_pair(when[i], (uint64_t)i));
+
+	add[1] = Now() - start;
+	start = Now();
+
+	for (size_t i = 0; i < n; i += 10)
+
+		later.erase(where[i]);
+
+	cancel[1] = Now() - start;
+	start = Now();
+
+	for (time_t t = Start + 1; t <= Start + Span; t++) {
+
+		while (!later.empty() && later.begin()->first <= t) {
+
+			taken += later.begin()->second != 0;
+			later.erase(later.begin());
+
+		}
+
+	}
+
+	expire[1] = Now() - start;
+
+	cout << fixed << setprecision(1);
+	cout << n << " timers, ns per timer\n"
+		 << setw(10) << "" << setw(10) << "add" << setw(10) << "cancel"
+		 << setw(10) << "expire" << "\n";
+
+	for (int k = 0; k < 2; k++)
+
+		cout << setw(10) << (k == 0 ? "wheel" : "multimap")
+			 << setw(10) << add[k] / n * 1e9
+			 << setw(10) << cancel[k] / (n / 10) * 1e9
+			 << setw(10) << expire[k] / (n - n / 10) * 1e9 << "\n";
+
+	cout << late << " late or lost\n";
+
+	// Thundering herd: one destination held, then let go
+	TimingWheel		herd(Start);
+
+	for (size_t i = 0; i < 100000; i++)
+
+		herd.add(i, 7, Start + 1 + i % 60);
+
+	herd.hold(7, Start + 60);
+	cout << "released per second after a hold:";
+
+	for (time_t t = Start + 1; t <= Start + 70 && herd.size() > 0; t++) {
+
+		size_t		released = 0;
+
+		herd.advance(t);
+
+		while (herd.pop(id))
+
+			released++;
+
+		if (t >= Start + 60)
+
+			cout << " " << released;
+
+	}
+
+	cout << "\n";
+
+	return late != 0;
+
+}
+
+/*
+ * @return:	monotonic clock, in seconds (double)
+ */
+double
+Now()
+{
+
+	timespec		ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+
+}
@@ -39,10 +39,13 @@
  * The default values set the relay host to "mailhost.cecs.pdx.edu"
  * and the default SMTP port of 25.
  * The 3rd data member represents the Authentication method used by
- * the particular host. At this point, authentication is disabled and
- * set to the default value of "0".
+ * the particular host: "0" (none, the default), "plain" or "login";
+ * the user=, pass= and tls= tags it needs are added to the line by
+ * hand (see config_help).
  * The command-line help switch prints the config_help file that shows
  * how to use the config program.
+ * Any number of relays may be set up instead w/ "--relay" options,
+ * each "host[:port[:weight[:max-conn]]]", one line per relay.
  */
 
 #include <iostream>
@@ -63,14 +66,22 @@ const string	HelpFile = "config_help";
 
 int HelpCheck(const char *help_req);
 
+// Write one relay line per "--relay host[:port[:weight[:max-conn]]]"
+
+int WriteRelays(int argc, char **argv);
+
 int
 main(int argc, char **argv) {
 
 	string			host,	// SMTP relay host
 					port,	// Port number
-					auth;	// Authentication type: "0" for none
+					auth;	// Authentication: "0" for none, "plain", "login"
 	ofstream		fout;
 
+	if (argc > 1 && strcmp(argv[1], "--relay") == 0)
+
+		return WriteRelays(argc, argv);
+
 	switch (argc) {
 
 	case 1:
@@ -97,7 +108,14 @@ main(int argc, char **argv) {
 	case 4:
 		host = argv[1];
 		port = argv[2];
-		auth = DefaultAuth;	// Authentication disabled
+		auth = argv[3];
+
+		if (auth != DefaultAuth && auth != "plain" && auth != "login") {
+
+			cout << "Error: authentication is 0, plain or login.\n";
+			return -1;
+
+		}
 		break;
 
 	default:
@@ -119,7 +137,97 @@ main(int argc, char **argv) {
 	}
 
 	fout.open(FileName.c_str());
-	fout << "host=" << host << " port=" << port << " auth=" << auth;
+	fout << "host=" << host << " port=" << port << " auth=" << auth << "\n";
+	fout.close();
+
+	cout << "Configuration complete.\n";
+
+	return 0;
+
+}
+
+/*
+ * Write the configuration file w/ a line per relay, from options
+ * "--relay host[:port[:weight[:max-conn]]]" (defaults: port 25,
+ * weight 1, max-conn 0, no cap).
+ * @args:	cmd-line args (int argc, char **argv)
+ * @return:	0 (success)
+ * 			-1 (bad option or relay)
+ */
+int
+WriteRelays(int argc, char **argv)
+{
+
+	string			lines,		// File contents
+					field[4];	// host, port, weight, max-conn
+	const char		*defaults[4] = { "", "25", "1", "0" };
+	ofstream		fout;
+
+	for (int i = 1; i < argc; i += 2) {
+
+		string	spec;
+		size_t	pos = 0,
+				colon;
+		int		n = 0;
+
+		if (strcmp(argv[i], "--relay") != 0 || i + 1 >= argc) {
+
+			cout << "Error: expected \"--relay host[:port[:weight"
+				 << "[:max-conn]]]\".\n";
+			return -1;
+
+		}
+
+		spec = argv[i + 1];
+
+		for (n = 0; n < 4; n++) {
+
+			colon = spec.find(':', pos);
+			field[n] = spec.substr(pos, colon - pos);
+
+			if (colon == string::npos)
+
+				break;
+
+			pos = colon + 1;
+
+		}
+
+		if (n == 4 || field[0].empty()) {
+
+			cout << "Error: bad relay \"" << spec << "\".\n";
+			return -1;
+
+		}
+
+		for (int f = 1; f < 4; f++) {
+
+			if (f > n || field[f].empty())
+
+				field[f] = defaults[f];
+
+			for (unsigned int c = 0; c < field[f].length(); c++) {
+
+				if (isdigit(field[f][c]) == 0) {
+
+					cout << "Error: non-numeric value in \"" << spec
+						 << "\".\n";
+					return -1;
+
+				}
+
+			}
+
+		}
+
+		lines += "host=" + field[0] + " port=" + field[1] + " auth=" +
+				 DefaultAuth + " weight=" + field[2] + " max_conn=" +
+				 field[3] + "\n";
+
+	}
+
+	fout.open(FileName.c_str());
+	fout << lines;
 	fout.close();
 
 	cout << "Configuration complete.\n";
@@ -39,602 +39,1893 @@
  * the MailSender object. Its derived class MailSenderSmtp sends the
  * contents of the file via SMTP interface through a specified relay
  * server (by default, host "mailhost.cecs.pdx.edu" port 25).
+ *
+ * Several relays may be configured, w/ weights and connection caps
+ * (see LoadRelays). Each message goes through the relay a
+ * RelayRouter picks (lowest recent latency and error rate), and is
+ * sent again through another if its relay fails.
+ *
+ * A relay may want STARTTLS and AUTH (see LoadRelays): its sessions
+ * start TLS, resuming the last TLS session w/ that relay where it
+ * can (see TlsClient), and log in before the first message.
+ *
+ * Batch mode: any number of files and/or directories (every regular
+ * file inside is sent) may be given. All of them are delivered over
+ * one reused SMTP session, recycled every "-m" messages, and a result
+ * line is printed per file.
+ *
+ * Wire-ready files (see WireFile.hh) are sent w/ sendfile(). "-p dir"
+ * converts plain files into wire files in dir once, when they enter
+ * the system; files already converted (and not changed since) are
+ * not converted again.
+ *
+ * "-c n" sends through SmtpEngine instead (see SmtpEngine.hh): files
+ * are delivered over up to n sessions at once, driven by one epoll
+ * loop, and result lines are printed as files complete.
+ *
+ * "--threads n" spreads the batch over n worker threads instead (see
+ * Worker), each parsing, converting and sending files over its own
+ * sessions.
+ *
+ * "--spool dir" keeps a durable delivery queue in dir (see Spool.hh):
+ * the files are enqueued there and sent from it by the workers as
+ * they come in; a recipient the relays do not reach yet is tried
+ * again by a later run. Messages still queued after a crash are
+ * sent by the next run, "--spool dir" w/o files just drains it.
+ *
+ * "--template file --data file" is mail merge instead of files: the
+ * template (see MergeTemplate) is compiled once and a message is
+ * rendered in memory for each record of the data file, CSV or
+ * JSONL (see MergeData), and sent w/o touching the disk; a result
+ * line is printed per record, "data-file:line".
+ *
+ * "--attach file" (repeatable) attaches file to every message, plain
+ * files or rendered ones: each goes out multipart/mixed w/ the file
+ * base64-encoded as it is read (see MailSenderSmtp::set_attachments).
+ * Not w/ -c, -p or --spool, which send wire files.
+ *
+ * "--metrics file" writes per-relay latency histograms of each SMTP
+ * phase and counters (see SmtpMetrics.hh) to file in Prometheus text
+ * format, at exit and whenever the process gets SIGUSR1.
+ *
+ * Warnings and errors are logged to stderr (see Logger.hh), or to
+ * "--log-file file". "-v" adds session events, "-vv" the SMTP
+ * transcript, and "--log-body" w/ "-vv" the message data as sent.
+ *
+ * usage: mailsender [-c sessions | --threads n]
+ * 		  [-m max-messages-per-connection] [-p wire-dir | --spool dir]
+ * 		  [--metrics file] [-v[v]] [--log-file file] [--log-body]
+ * 		  [--attach file ...] file|dir ... | --template file --data file
+ */
+
+#include "MailSenderSmtp.hh"
+#include "SmtpEngine.hh"
+#include "WorkQueue.hh"
+#include "SmtpMetrics.hh"
+#include "Logger.hh"
+#include "WireFile.hh"
+#include "HeaderScanner.hh"
+#include "AddressValidator.hh"
+#include "RelayRouter.hh"
+#include "Spool.hh"
+#include "MailMerge.hh"
+#include "Arena.hh"
+#include "SmtpTls.hh"
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <fstream>
+#include <cctype>
+#include <sstream>
+#include <charconv>
+#include <deque>
+#include <cstring>
+#include <strings.h>
+#include <cstdlib>
+#include <cerrno>
+#include <csignal>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <getopt.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+const string	ConfigFile = "mailsender.conf";		// Config filename
+
+const AddressValidator	Validator;		// Envelope address syntax
+
+// Mail merge: a template and the data of its recipients.
+
+struct Merge {
+	MergeTemplate	tmpl;			// Compiled message template
+	MergeData		data;			// Records, bound to its fields
+	string			name;			// Data file, for result lines
+};
+
+// Driver function, receives command-line file names,
+
+// process email file information/address, instantiate
+
+// MailSender object to send the emails.
+
+int				Driver(const vector<string> &filenames,
+					   const Merge *merge,
+					   const vector<MimeAttachment> *attachments,
+					   int max_per_conn,
+					   const string &wire_dir,
+					   const string &spool_dir,
+					   int concurrency,
+					   int threads);
+
+// What the worker threads share: the batch, relays and results.
+
+struct Batch {
+	const vector<string>	*filenames;	// Email files
+	const Merge		*merge;			// Or: records to render, or NULL
+	const vector<MimeAttachment>	*attachments;	// Or NULL
+	RelayRouter		*router;		// SMTP relays, picks one per file
+	int				max_per_conn;	// Messages per SMTP session
+	string			wire_dir;		// Wire file directory, or ""
+	WorkQueue		*queue;			// Indexes of files to send
+	Spool			*spool;			// Or: spool to send from
+	atomic<bool>	enqueued;		// All files are in the spool
+	mutex			lock;			// Guards cout, failed
+	int				failed;			// # files not sent
+};
+
+// Dump metrics to a file whenever SIGUSR1 arrives.
+
+void			DumpOnSignal(const string &path);
+
+void			MetricsThread(string path, sigset_t set);
+
+// Worker thread: send files from the batch w/ its own sessions.
+
+void			Worker(Batch *batch, int self);
+
+// Merge worker thread: render and send records of the batch.
+
+void			MergeWorker(Batch *batch, int self);
+
+// Spool worker thread: send messages from the spool as they come.
+
+void			SpoolWorker(Batch *batch);
+
+// Enqueue the files of the batch into its spool.
+
+void			Enqueue(Batch *batch);
+
+// Send a file through the relays, failing over to another one.
+
+int				SendRouted(MailSenderSmtp &client,
+						   RelayRouter &router,
+						   const string &env_from,
+						   const vector<string> &env_to,
+						   vector<int> &status);
+
+// Relay failure w/ nothing delivered: send again elsewhere.
+
+bool			FailOver(int result, int error, const vector<int> &status);
+
+// Find the envelope of a file and convert it to a wire file.
+
+int				Prepare(const string &filename,
+						const string &wire_dir,
+						string &env_from,
+						vector<string> &env_to,
+						string &send_name,
+						ostream &out);
+
+// Print the result of sending a file.
+
+int				Report(ostream &out,
+					   const string &filename,
+					   const vector<string> &env_to,
+					   int result,
+					   const vector<int> &status);
+
+// Convert an email file to a wire file in wire_dir, once.
+
+int				PrepareWire(const string &filename,
+							const string &wire_dir,
+							const string &env_from,
+							const vector<string> &env_to,
+							string &wire_name);
+
+// Add a command-line file, or the files of a directory, to the batch.
+
+int				CollectFiles(const string &path,
+							 vector<string> &filenames);
+
+// Find sender/recipient email addresses.
+
+int				GetEnvelope(const string &filename,
+							string &env_from,
+							vector<string> &env_to,
+							ostream &out = cout);
+
+// Envelope of a scanned header, plus more recipients.
+
+int				ScanEnvelope(const HeaderScanner &scanner,
+							 string_view more,
+							 string &env_from,
+							 vector<string> &env_to,
+							 ostream &out);
+
+// Split an address header field into e-mail addresses.
+
+void			ParseAddressList(string_view list, Arena &arena,
+								 vector<string_view> &addrs);
+
+// Load relays from configuration file
+
+int				LoadRelays(vector<RelayConfig> &relays);
+
+// Parse a configuration file line (one relay).
+
+int				ParseConfig(const string &line, RelayConfig &relay);
+
+int
+main(int argc, char **argv) {	// One or more cmd-line args expected.
+
+	vector<string>	filenames;	// Cmd-line args: email files.
+	string			wire_dir,	// Convert to wire files here
+					spool_dir,	// Durable queue directory
+					template_file,	// Mail merge template
+					data_file,	// and its recipient data
+					metrics,	// Dump metrics to this file
+					log_file;	// Log here instead of stderr
+	int				max_per_conn = MailSenderSmtp::DefaultMaxPerConn,
+					concurrency = 0,	// Sessions at once (engine)
+					threads = 0,		// Worker threads, 0: none
+					level = LogWarn,	// Log level (-v: more)
+					opt;
+	bool			log_body = false;	// Log message data too
+	Merge			merge;		// --template, --data
+	vector<MimeAttachment>	attachments;	// --attach
+	MimeAttachment	part;
+	static option	longopts[] = {
+		{ "threads", required_argument, NULL, 't' },
+		{ "metrics", required_argument, NULL, 'M' },
+		{ "log-file", required_argument, NULL, 'L' },
+		{ "log-body", no_argument, NULL, 'B' },
+		{ "spool", required_argument, NULL, 'S' },
+		{ "template", required_argument, NULL, 'T' },
+		{ "data", required_argument, NULL, 'D' },
+		{ "attach", required_argument, NULL, 'A' },
+		{ NULL, 0, NULL, 0 }
+	};
+
+	while ((opt = getopt_long(argc, argv, "c:m:M:p:t:v",
+							  longopts, NULL)) != -1) {
+
+		switch (opt) {
+
+		case 'A':	// Attach a file to each message
+			if (MimeAttach(optarg, part) != 0) {
+
+				cout << "Error, attachment " << optarg << ": "
+					 << strerror(errno) << endl;
+				return 1;
+
+			}
+
+			attachments.push_back(part);
+			break;
+
+		case 'B':	// Log message data (w/ -vv)
+			log_body = true;
+			break;
+
+		case 'D':	// Mail merge data file
+			data_file = optarg;
+			break;
+
+		case 'c':	// Concurrent sessions, through SmtpEngine
+			if ((concurrency = atoi(optarg)) < 1) {
+
+				cout << "Error, invalid session count: " << optarg << endl;
+				return 1;
+
+			}
+			break;
+
+		case 'm':	// Max. messages per SMTP session
+			if ((max_per_conn = atoi(optarg)) < 1) {
+
+				cout << "Error, invalid message count: " << optarg << endl;
+				return 1;
+
+			}
+			break;
+
+		case 'L':	// Log file
+			log_file = optarg;
+			break;
+
+		case 'M':	// Prometheus metrics file
+			metrics = optarg;
+			break;
+
+		case 'p':	// Wire file directory
+			wire_dir = optarg;
+			break;
+
+		case 'S':	// Spool directory
+			spool_dir = optarg;
+			break;
+
+		case 'T':	// Mail merge template
+			template_file = optarg;
+			break;
+
+		case 't':	// Worker threads, each w/ its own sessions
+			if ((threads = atoi(optarg)) < 1) {
+
+				cout << "Error, invalid thread count: " << optarg << endl;
+				return 1;
+
+			}
+			break;
+
+		case 'v':	// More verbose log: info, then debug
+			level = min(level + 1, (int)LogDebug);
+			break;
+
+		default:
+			cout << "usage: " << argv[0]
+				 << " [-c sessions | --threads n]"
+				 << " [-m max-messages-per-connection]"
+				 << " [-p wire-dir | --spool dir]"
+				 << " [--metrics file] [-v[v]] [--log-file file]"
+				 << " [--log-body] [--attach file ...] file|dir ..."
+				 << " | --template file --data file\n";
+			return 1;
+
+		}
+
+	}
+
+	if (concurrency > 0 && threads > 0) {
+
+		cout << "Error, -c and --threads are exclusive.\n";
+		return 1;
+
+	}
+
+	if (!spool_dir.empty() && (concurrency > 0 || !wire_dir.empty())) {
+
+		cout << "Error, --spool does not go w/ -c or -p.\n";
+		return 1;
+
+	}
+
+	if (!attachments.empty() && (concurrency > 0 || !wire_dir.empty() ||
+								 !spool_dir.empty())) {
+
+		cout << "Error, --attach does not go w/ -c, -p or --spool.\n";
+		return 1;
+
+	}
+
+	if (template_file.empty() != data_file.empty()) {
+
+		cout << "Error, --template and --data go together.\n";
+		return 1;
+
+	}
+
+	if (!template_file.empty() && (optind < argc || concurrency > 0 ||
+								   !wire_dir.empty() ||
+								   !spool_dir.empty())) {
+
+		cout << "Error, --template does not go w/ files, -c, -p"
+			 << " or --spool.\n";
+		return 1;
+
+	}
+
+	// Confirm command-line arguments (none: drain the spool)
+	if (optind >= argc && spool_dir.empty() && template_file.empty()) {
+
+		cout << "Error, invalid arguments: " << argc << endl;
+		return 1;	// Error, exit program.
+
+	}
+
+	// A relay closing on us must fail the write, not kill us.
+	signal(SIGPIPE, SIG_IGN);
+
+	Logger::shared().set_level((LogLevel)level);
+	Logger::shared().set_body(log_body);
+
+	if (!log_file.empty() && Logger::shared().open(log_file) != 0) {
+
+		perror(log_file.c_str());
+		return 1;
+
+	}
+
+	if (!metrics.empty())
+
+		DumpOnSignal(metrics);
+
+	for (int i = optind; i < argc; i++) {
+
+		if (CollectFiles(argv[i], filenames) != 0) {
+
+			perror(argv[i]);
+			return 1;	// Error, exit program.
+
+		}
+
+	}
+
+	// Compile the template, index the records it is merged w/.
+	if (!template_file.empty()) {
+
+		if (merge.tmpl.load(template_file) != 0) {
+
+			cout << "Error, template " << template_file << ": "
+				 << merge.tmpl.error() << endl;
+			return 1;
+
+		}
+
+		if (merge.data.open(data_file) != 0 ||
+			merge.data.bind(merge.tmpl.fields()) != 0) {
+
+			cout << "Error, data " << data_file << ": "
+				 << merge.data.error() << endl;
+			return 1;
+
+		}
+
+		merge.name = data_file;
+
+	}
+
+	int		result = Driver(filenames,
+							template_file.empty() ? NULL : &merge,
+							attachments.empty() ? NULL : &attachments,
+							max_per_conn, wire_dir, spool_dir,
+							concurrency, threads);	// Driver function.
+
+	if (!metrics.empty() && SmtpMetrics::shared().dump_file(metrics) != 0)
+
+		perror(metrics.c_str());
+
+	Logger::shared().stop();		// Write out the rest of the log
+
+	return result == 0 ? 0 : 1;		// Success, or error.
+
+}
+
+/*
+ * Dump metrics on demand: block SIGUSR1 in this thread (and so in
+ * every thread started later) and leave it to a thread of its own
+ * that waits for the signal w/ sigwait() and writes the file, so
+ * no work is done in a signal handler.
+ * @args:	metrics file (const string &path)
+ */
+void
+DumpOnSignal(const string &path)
+{
+
+	sigset_t		set;
+
+	sigemptyset(&set);
+	sigaddset(&set, SIGUSR1);
+	pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+	thread(MetricsThread, path, set).detach();
+
+}
+
+/*
+ * Metrics thread: write the metrics file each time SIGUSR1 arrives.
+ * @args:	metrics file (string path), signals to wait for (set)
+ */
+void
+MetricsThread(string path, sigset_t set)
+{
+
+	int				sig;
+
+	while (sigwait(&set, &sig) == 0) {
+
+		if (SmtpMetrics::shared().dump_file(path) != 0)
+
+			perror(path.c_str());
+
+	}
+
+}
+
+/*
+ * Add a command-line argument to the batch. A regular file is added
+ * as is, a directory adds each regular file within it (sorted by
+ * name, hidden files skipped).
+ * @args:	file or directory name (const string &path)
+ * 			batch of email files (vector<string> &filenames)
+ * @return:	0 (success)
+ *  -error: -1 (path not found/unreadable, errno)
+ */
+int
+CollectFiles(const string &path, vector<string> &filenames)
+{
+
+	struct stat		st;
+	DIR				*dir;
+	dirent			*ent;
+	vector<string>	entries;	// Files found in directory
+
+	if (stat(path.c_str(), &st) != 0)
+
+		return -1;		// Errno set
+
+	if (!S_ISDIR(st.st_mode)) {
+
+		filenames.push_back(path);
+		return 0;
+
+	}
+
+	if ((dir = opendir(path.c_str())) == NULL)
+
+		return -1;		// Errno set
+
+	while ((ent = readdir(dir)) != NULL) {
+
+		string	name = path + "/" + ent->d_name;
+
+		if (ent->d_name[0] == '.' ||
+			stat(name.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+
+			continue;	// Hidden, vanished or not a file
+
+		entries.push_back(name);
+
+	}
+
+	closedir(dir);
+
+	sort(entries.begin(), entries.end());
+	filenames.insert(filenames.end(), entries.begin(), entries.end());
+
+	return 0;
+
+}
+
+/*
+ * Driver method
+ * Load the relays once and send every email file in the batch,
+ * each through the relay the RelayRouter picks, one of three ways:
+ * W/o options, one MailSenderSmtp object (see Worker) sends the
+ * files one after the other on this thread, keeping its session
+ * open between files.
+ * W/ "--threads", the files are spread over a WorkQueue and sent by
+ * that many Worker threads at once, each w/ its own MailSenderSmtp
+ * and SmtpPool; an idle worker steals files from a busy one.
+ * W/ "-c", the envelope of every file is found first (see Prepare),
+ * then files are submitted to an SmtpEngine, which delivers them
+ * over up to "concurrency" sessions per relay at once. A file is
+ * submitted once the router has a relay under its cap for it, so
+ * routing follows the latencies seen so far; a relay w/o a cap is
+ * capped at "concurrency" messages in flight.
+ * A result line is printed for each file (see Report), followed by
+ * a summary.
+ * @args: email filenames (const vector<string> &filenames)
+ * 		  records to merge instead, or NULL (const Merge *merge)
+ * 		  files attached to each message, or NULL
+ * 		  (const vector<MimeAttachment> *attachments)
+ * 		  max. messages per SMTP session (int max_per_conn)
+ * 		  wire file directory, or "" (const string &wire_dir)
+ * 		  sessions at once, 0: no SmtpEngine (int concurrency)
+ * 		  worker threads, 0: none (int threads)
+ * @return: 0 (on success, every file sent)
+ * -errors: -1 (configuration error, or at least one file failed:
+ * 				File not found, improper email address syntax,
+ * 				connection error, SMTP connection error)
+ * 				Handled by errno or SMTP server replies.
+ *
+ */
+int
+Driver(const vector<string> &filenames,
+	   const Merge *merge,
+	   const vector<MimeAttachment> *attachments,
+	   int max_per_conn,
+	   const string &wire_dir,
+	   const string &spool_dir,
+	   int concurrency,
+	   int threads)
+{
+
+	vector<RelayConfig>	relays;	// SMTP relays
+	Batch			batch;		// Files, results
+	int				workers = max(threads, 1);
+	WorkQueue		queue(workers);
+	Spool			spool;		// Durable queue (--spool)
+	vector<thread>	pool;		// Worker threads
+	size_t			messages = merge ? merge->data.records()
+									 : filenames.size();
+
+	// Load relay hosts/ports/authorization types
+	if (LoadRelays(relays) == -1) {
+
+		if (errno)
+
+			perror("Error loading configuration file");
+
+		else
+
+			// Errno not set, load host error.
+			cout << "Configuration file load error. ";
+
+		cout << "Please run \"config\"\n";
+		return -1;
+
+	}
+
+	for (unsigned int r = 0; r < relays.size(); r++) {
+
+		if (relays[r].auth != "0" &&
+			((strcasecmp(relays[r].auth.c_str(), "plain") != 0 &&
+			  strcasecmp(relays[r].auth.c_str(), "login") != 0) ||
+			 relays[r].user.empty() || relays[r].tls == 0)) {
+
+			cout << "Unsupported authentication for " << relays[r].host
+				 << " in " << ConfigFile << " (auth=plain|login needs"
+				 << " user=, pass= and tls=1|2).\n";
+			return -1;
+
+		}
+
+		if (concurrency > 0 && (relays[r].tls != 0 || relays[r].auth != "0")) {
+
+			cout << "Error, -c does not go w/ TLS or AUTH (relay "
+				 << relays[r].host << ").\n";
+			return -1;
+
+		}
+
+		if (!relays[r].cafile.empty() &&
+			TlsClient::shared().add_ca(relays[r].cafile) != 0) {
+
+			perror(relays[r].cafile.c_str());
+			return -1;
+
+		}
+
+	}
+
+	cout << "Attempting to connect to";
+
+	for (unsigned int r = 0; r < relays.size(); r++) {
+
+		cout << (r > 0 ? ", " : " ") << relays[r].host;
+
+		if (relays[r].port != MailSenderSmtp::DefaultPort)
+
+			cout << ":" << relays[r].port;
+
+		if (concurrency > 0 && relays[r].max_conn == 0)
+
+			relays[r].max_conn = concurrency;	// Keep routing live
+
+	}
+
+	cout << endl;
+
+	RelayRouter		router(relays);
+
+	batch.filenames = &filenames;
+	batch.merge = merge;
+	batch.attachments = attachments;
+	batch.router = &router;
+	batch.max_per_conn = max_per_conn;
+	batch.wire_dir = wire_dir;
+	batch.queue = &queue;
+	batch.spool = spool_dir.empty() ? NULL : &spool;
+	batch.enqueued = false;
+	batch.failed = 0;
+
+	if (batch.spool && spool.open(spool_dir) != 0) {
+
+		perror(spool_dir.c_str());
+		return -1;
+
+	}
+
+	if (concurrency > 0) {
+
+		SmtpEngine			engine(SmtpEngine::DefaultMaxSessions,
+								   concurrency);
+		SmtpEngine::Job		job;
+		SmtpEngine::Result	res;
+		size_t				n = filenames.size();
+		vector<string>		env_from(n),	// Envelopes, files to send
+							send_name(n);
+		vector<vector<string> >	env_to(n);
+		vector<int>			relay(n);		// Relay of each file
+		vector<uint64_t>	tried(n, 0),	// Relays tried (bits)
+							started(n);		// Submit time, us
+		deque<size_t>		todo;			// Files to submit
+		int					r,
+							wait;			// Ms. for a token, or -1
+
+		engine.set_max_per_conn(max_per_conn);
+
+		for (size_t i = 0; i < n; i++) {
+
+			if (Prepare(filenames[i], wire_dir, env_from[i], env_to[i],
+						send_name[i], cout) != 0)
+
+				batch.failed++;
+
+			else
+
+				todo.push_back(i);
+
+		}
+
+		while (!todo.empty() || engine.pending() > 0) {
+
+			// Submit while a relay is free, retries first.
+			while (!todo.empty() &&
+				   (r = router.try_pick(tried[todo.front()])) >= 0) {
+
+				size_t	i = todo.front();
+
+				todo.pop_front();
+				relay[i] = r;
+				tried[i] |= 1ULL << r;
+				started[i] = SmtpMetrics::now();
+				job.host = relays[r].host;
+				job.port = relays[r].port;
+				job.filename = send_name[i];
+				job.from = env_from[i];
+				job.to = env_to[i];
+				job.user = (void *)i;	// Index of the file
+				engine.submit(job);
+
+			}
+
+			// Relays held back by their rate: come back for a token.
+			wait = todo.empty() ? -1 : router.delay(tried[todo.front()]);
+
+			if (engine.pending() == 0 && wait < 0) {
+
+				// Left w/ files no relay will take.
+				batch.failed += todo.size();
+				break;
+
+			}
+
+			engine.run(wait);
+
+			// Results in order of completion
+			while (engine.complete(res)) {
+
+				size_t	i = (size_t)res.user;
+				bool	again = FailOver(res.result, res.error,
+										 res.rcpt_status);
+
+				router.done(relay[i], !again,
+							SmtpMetrics::now() - started[i],
+							res.throttled != 0);
+
+				if (again && (~tried[i] & router.all()) != 0) {
+
+					todo.push_front(i);		// Next relay, soon
+					continue;
+
+				}
+
+				errno = res.error;
+
+				if (Report(cout, filenames[i], env_to[i],
+						   res.result, res.rcpt_status) != 0)
+
+					batch.failed++;
+
+			}
+
+		}
+
+	}
+	else if (batch.spool) {
+
+		// Workers send from the spool while it is being filled.
+		for (int i = 0; i < threads; i++)
+
+			pool.push_back(thread(SpoolWorker, &batch));
+
+		Enqueue(&batch);
+
+		if (threads == 0)
+
+			SpoolWorker(&batch);
+
+		for (int i = 0; i < threads; i++)
+
+			pool[i].join();
+
+		spool.close();
+
+		cout << spool.count(Spool::Delivered) << " sent, "
+			 << spool.count(Spool::Deferred) << " deferred, "
+			 << batch.failed << " failed.\n";
+
+		return batch.failed == 0 ? 0 : -1;
+
+	}
+	else {
+
+		void	(*work)(Batch *, int) = merge ? MergeWorker : Worker;
+
+		if (messages == 0) {
+
+			// E.g. an empty directory: nothing to send w/.
+			cout << "0 sent, 0 failed.\n";
+			return 0;
+
+		}
+
+		// Contiguous runs of files (records) per worker, stolen
+		// from the back.
+		for (size_t i = 0; i < messages; i++)
+
+			queue.push(i * workers / messages, i);
+
+		if (threads == 0)
+
+			work(&batch, 0);
+
+		else {
+
+			for (int i = 0; i < threads; i++)
+
+				pool.push_back(thread(work, &batch, i));
+
+			for (int i = 0; i < threads; i++)
+
+				pool[i].join();
+
+		}
+
+	}
+
+	cout << messages - batch.failed << " sent, "
+		 << batch.failed << " failed.\n";
+
+	return batch.failed == 0 ? 0 : -1;
+
+}
+
+/*
+ * Worker thread
+ * Standard SMTP, no authorization protocol: one MailSenderSmtp
+ * object w/ its own SmtpPool, so no session is shared between
+ * threads. For each file taken from the batch's WorkQueue, find
+ * its envelope, convert it (see Prepare) and send it through the
+ * relays (see SendRouted). The result
+ * lines of a file are built up privately and printed in one piece,
+ * so the output of workers does not interleave.
+ * @args:	shared batch (Batch *batch), worker # (int self)
  */
+void
+Worker(Batch *batch, int self)
+{
 
-#include "MailSenderSmtp.hh"
-#include <iostream>
-#include <string>
-#include <fstream>
-#include <cctype>
-#include <sstream>
-#include <cmath>
-#include <cstring>
-#include <cerrno>
+	const vector<string>	&filenames = *batch->filenames;
+	SmtpPool		sessions;	// This worker's idle sessions
+	MailSenderSmtp	client("", batch->max_per_conn, &sessions);
+	ostringstream	out;		// Result lines of a file
+	string			env_from,	// Email sender address
+					send_name;	// File to send (may be wire file)
+	vector<string>	env_to;		// Email recipient addresses
+	vector<int>		status;		// Reply code per recipient
+	size_t			i;			// File index
+	int				result;
 
-using namespace std;
+	client.set_attachments(batch->attachments);
 
-const string	ConfigFile = "mailsender.conf";		// Config filename
+	while (batch->queue->pop(self, i)) {
 
-// Driver function, receives command-line file name,
+		out.str("");
 
-// process email file information/address, instantiate
+		if ((result = Prepare(filenames[i], batch->wire_dir, env_from,
+							  env_to, send_name, out)) == 0) {
 
-// MailSender object to send email.
+			client.set_filename(send_name);
 
-int				Driver(const string &filename);
+			// Attempt to send e-mail, once for all recipients.
+			result = Report(out, filenames[i], env_to,
+							SendRouted(client, *batch->router, env_from,
+									   env_to, status),
+							status);
 
-// Find sender/recipient email address.
+		}
 
-int				GetEnvelope(const string &filename,
-							string &env_from,
-							string &env_to);
+		lock_guard<mutex>	guard(batch->lock);
+
+		cout << out.str() << flush;
+
+		if (result != 0)
+
+			batch->failed++;
+
+	}
 
-// Verify validity of the format/syntax of an email address.
+	sessions.close_all();		// QUIT the open sessions
 
-int				CheckEmailSyntax(const string &addr);
+}
+
+/*
+ * Merge worker thread
+ * Like Worker, but for each record taken from the batch's
+ * WorkQueue, render the message of the template (see
+ * MergeTemplate::render) into a buffer reused from record to
+ * record, find its envelope in the rendered header (see
+ * ScanEnvelope) and send it from memory (see
+ * MailSenderSmtp::set_text). Record values, message and header scan
+ * all live in buffers of the thread; nothing is written to disk.
+ * @args:	shared batch (Batch *batch), worker # (int self)
+ */
+void
+MergeWorker(Batch *batch, int self)
+{
 
-// Load relay host from configuration file
+	const Merge		&merge = *batch->merge;
+	SmtpPool		sessions;	// This worker's idle sessions
+	MailSenderSmtp	client("", batch->max_per_conn, &sessions);
+	MergeData::Record	rec;	// Values of a record
+	HeaderScanner	scanner;	// Of the rendered message
+	vector<char>	message,	// Rendered message
+					bcc;		// and its Bcc: addresses
+	ostringstream	out;		// Result lines of a record
+	string			label,		// "data-file:line"
+					env_from;	// Email sender address
+	vector<string>	env_to;		// Email recipient addresses
+	vector<int>		status;		// Reply code per recipient
+	size_t			i;			// Record index
+	int				result;
 
-int				LoadHost(string &host, int &port, string &auth);
+	client.set_attachments(batch->attachments);
 
-// Parse configuration file data (string).
+	while (batch->queue->pop(self, i)) {
 
-int				ParseConfig(string &parsed,
-							string &buffer,
-							string tag,
-							int pos = 0);
+		out.str("");
+		label = merge.name + ":" + to_string(merge.data.line(i));
 
-// Parse configuration file data (int).
+		if ((result = merge.data.read(i, rec)) != 0)
 
-int				ParseConfig(int &parsed,
-							string &buffer,
-							string tag,
-							int pos = 0);
+			out << label << ": FAILED (data error: " << rec.error << ")\n";
 
-int
-main(int argc, char **argv) {	// Single cmd-line arg expected.
+		else {
 
-	string			filename;	// Cmd-line arg: email filename.
+			merge.tmpl.render(rec.values.data(), message, bcc);
+			scanner.scan(message.data(), message.size());
 
-	// Confirm command-line arguments
-	if (argc != 2) {
+			if ((result = ScanEnvelope(scanner,
+									   string_view(bcc.data(), bcc.size()),
+									   env_from, env_to, out)) != 0)
 
-		cout << "Error, invalid arguments: " << argc << endl;
-		return 1;	// Error, exit program.
+				out << label << ": FAILED (envelope error)\n";
+
+			else {
+
+				client.set_text(message.data(), message.size());
+
+				// Attempt to send e-mail, once for all recipients.
+				result = Report(out, label, env_to,
+								SendRouted(client, *batch->router,
+										   env_from, env_to, status),
+								status);
+
+			}
+
+		}
+
+		lock_guard<mutex>	guard(batch->lock);
+
+		cout << out.str() << flush;
+
+		if (result != 0)
+
+			batch->failed++;
 
 	}
 
-	filename = argv[1];
+	sessions.close_all();		// QUIT the open sessions
+
+}
+
+/*
+ * Enqueue each file of the batch into its spool, once its envelope
+ * is found (see Prepare), and wait for them all to be on disk
+ * before the workers may stop (see SpoolWorker). A file that cannot
+ * be enqueued gets its "FAILED" result line.
+ * @args:	shared batch (Batch *batch)
+ */
+void
+Enqueue(Batch *batch)
+{
+
+	const vector<string>	&filenames = *batch->filenames;
+	ostringstream	out;		// Result lines of a file
+	string			env_from,
+					send_name;
+	vector<string>	env_to;
+	uint64_t		id;
+
+	for (size_t i = 0; i < filenames.size(); i++) {
+
+		out.str("");
+
+		if (Prepare(filenames[i], "", env_from, env_to, send_name,
+					out) == 0) {
+
+			if (batch->spool->enqueue(filenames[i], env_from, env_to,
+									  id) == 0) {
+
+				Logger::shared().print(LogInfo, "%s: queued as %s",
+									   filenames[i].c_str(),
+									   batch->spool->path(id).c_str());
+				continue;
+
+			}
+
+			out << filenames[i] << ": FAILED (spool error: "
+				<< strerror(errno) << ")\n";
+
+		}
 
-	if (Driver(filename) <= 0) {	// Driver function.
+		lock_guard<mutex>	guard(batch->lock);
 
-		return 1;	// Error.
+		cout << out.str() << flush;
+		batch->failed++;
 
 	}
 
-	return 0;		// Success, end program.
+	if (batch->spool->flush() != 0)
+
+		perror("Error writing spool journal");
+
+	batch->enqueued = true;
 
 }
 
 /*
- * Driver method
- * Use GetEnvelope to retrieve email address information.
- * Instantiate MailSenderSmtp object with email file
- * MailSenderSmtp.Send to send contents of email to specified
- * addresses to SMTP server: host.
- * @args: filename string
- * @return: 0 (on success)
- * -errors: -1 (File not found, improper email address syntax,
- * 				connection error, SMTP connection error)
- * 				Handled by errno or SMTP server replies.
- *
+ * Spool worker thread
+ * Like Worker, but takes messages from the batch's spool (see
+ * Spool::next), as they are enqueued, and reports each result
+ * back to the spool (see Spool::done), which retries the recipients
+ * not reached yet in a later run. Stops when everything is
+ * enqueued and nothing is left to send but Deferred messages.
+ * @args:	shared batch (Batch *batch)
+ */
+void
+SpoolWorker(Batch *batch)
+{
+
+	Spool			&spool = *batch->spool;
+	SmtpPool		sessions;	// This worker's idle sessions
+	MailSenderSmtp	client("", batch->max_per_conn, &sessions);
+	ostringstream	out;		// Result lines of a message
+	string			path,		// Wire file of the message
+					name,		// File it was enqueued from
+					env_from;
+	vector<string>	env_to;		// Recipients not reached yet
+	vector<int>		status;		// Reply code per recipient
+	uint64_t		id;
+	int				result;
+	Spool::State	state;
+
+	while (true) {
+
+		if (!spool.next(id, path, name, env_from, env_to, 100)) {
+
+			if (batch->enqueued && spool.idle())
+
+				break;		// Deferred ones (if any) are not due
+
+			continue;
+
+		}
+
+		if (name.empty())
+
+			name = path;		// Enqueued before names were kept
+
+		out.str("");
+		client.set_filename(path);
+		result = SendRouted(client, *batch->router, env_from, env_to, status);
+		state = spool.done(id, status);
+		Report(out, name, env_to, result, status);
+
+		if (state == Spool::Deferred)
+
+			out << name << ": deferred\n";
+
+		lock_guard<mutex>	guard(batch->lock);
+
+		cout << out.str() << flush;
+
+		if (state == Spool::Bounced)
+
+			batch->failed++;
+
+	}
+
+	sessions.close_all();		// QUIT the open sessions
+
+}
+
+/*
+ * Send the current file of a client through the relay the router
+ * picks (waiting for one under its cap), and through the next
+ * relay, and so on, while the relay fails w/o delivering it (see
+ * FailOver). Each attempt is reported to the router w/ its time.
+ * @args:	sender, set to the file (MailSenderSmtp &client)
+ * 			relays (RelayRouter &router)
+ * 			envelope (see MailSender::send)
+ * 			reply code per recipient, out (vector<int> &status)
+ * @return:	result of the last attempt (see MailSender::send),
+ * 			errno of it kept
+ *  -error:	-1 (no relay)
  */
 int
-Driver(const string &filename)
+SendRouted(MailSenderSmtp &client,
+		   RelayRouter &router,
+		   const string &env_from,
+		   const vector<string> &env_to,
+		   vector<int> &status)
 {
 
-	string			env_from,	// Email sender address
-					env_to,		// Email recipient address
-					hostname,	// SMTP relay server hostname
-					auth;		// Hostname authorization type
-	int				port;		// Hostname port number
-	MailSender		*Client;	// Ptr to object to send email
+	uint64_t		tried = 0,	// Relays tried (bits)
+					start;
+	int				r,
+					result = -1,
+					error = 0;
+	bool			again;
 
-	// Extract sender & rcpt email addresses from file (header)
-	if ((GetEnvelope(filename, env_from, env_to)) != 0) {
+	status.assign(env_to.size(), -1);
 
-		if (errno)
+	do {
 
-			perror("File load error");
+		if ((r = router.pick(tried)) < 0)
 
-		return -1;
+			break;
+
+		tried |= 1ULL << r;
+		client.set_port(router.relay(r).port);
+		client.set_chunk_size((size_t)router.relay(r).chunk * 1024);
+		client.set_tls((MailSenderSmtp::TlsPolicy)router.relay(r).tls);
+		client.set_auth(router.relay(r).auth == "0" ? "" : router.relay(r).auth,
+						router.relay(r).user, router.relay(r).pass);
+		start = SmtpMetrics::now();
+		errno = 0;
+
+		result = client.send(router.relay(r).host, env_from, env_to, status);
+		error = errno;
+		again = FailOver(result, error, status);
+		router.done(r, !again, SmtpMetrics::now() - start,
+					client.throttled() != 0);
+
+	} while (again && (~tried & router.all()) != 0);
+
+	errno = error;
+
+	return result;
+
+}
+
+/*
+ * Is a failed message to be sent again through another relay: the
+ * relay failed (connection error, timeout, errno set) and took no
+ * recipient for good, so nobody gets it twice.
+ * @args:	result, errno of the send (int result, int error)
+ * 			reply code per recipient (const vector<int> &status)
+ * @return:	true (fail over), false (done w/ this message)
+ */
+bool
+FailOver(int result, int error, const vector<int> &status)
+{
+
+	if (result == 0 || error == 0)
+
+		return false;		// Sent, or refused by the relay
+
+	for (unsigned int i = 0; i < status.size(); i++) {
+
+		if (status[i] == 250 || status[i] == 251)
+
+			return false;	// Delivered to some
 
 	}
 
-	// Load hostname/port/authorization type
-	if (LoadHost(hostname, port, auth) == -1) {
+	return true;
 
+}
+
+/*
+ * Get a file ready to send: extract its envelope (see GetEnvelope)
+ * and, if a wire directory is given, convert it to a wire file
+ * there (see PrepareWire). A file that cannot be sent gets its
+ * "FAILED" result line here.
+ * @args:	email file (const string &filename)
+ * 			wire file directory, or "" (const string &wire_dir)
+ * 			envelope sender, recipients (see GetEnvelope)
+ * 			file to send, the email or wire file (string &send_name)
+ * 			where to print the result (ostream &out)
+ * @return:	0 (ready to send)
+ *  -error:	-1 (file or envelope error)
+ */
+int
+Prepare(const string &filename,
+		const string &wire_dir,
+		string &env_from,
+		vector<string> &env_to,
+		string &send_name,
+		ostream &out)
+{
+
+	errno = 0;
+
+	// Extract sender & rcpt email addresses from file (header)
+	if (GetEnvelope(filename, env_from, env_to, out) != 0) {
+
+		out << filename << ": FAILED (";
 		if (errno)
 
-			perror("Error loading configuration file");
+			out << "file load error: " << strerror(errno);
 
 		else
 
-			// Errno not set, load host error.
-			cout << "Configuration file load error. ";
+			out << "envelope error";
 
-		cout << "Please run \"config\"\n";
+		out << ")\n";
+		return -1;
+
+	}
+
+	send_name = filename;
+
+	// Convert to wire-ready file, once
+	if (!wire_dir.empty() &&
+		PrepareWire(filename, wire_dir,
+					env_from, env_to, send_name) != 0) {
+
+		out << filename << ": FAILED (wire file error: "
+			<< strerror(errno) << ")\n";
 		return -1;
 
 	}
 
-	if (port == 25 && auth == "0")
+	return 0;
+
+}
+
+/*
+ * Print the result line of a file: "sent" or "FAILED" w/ the reason,
+ * and for failures what became of each recipient.
+ * @args:	where to print it (ostream &out)
+ * 			email file (const string &filename)
+ * 			envelope recipients (const vector<string> &env_to)
+ * 			result of MailSender::send (int result), errno set
+ * 			reply code per recipient (const vector<int> &status)
+ * @return:	result
+ */
+int
+Report(ostream &out,
+	   const string &filename,
+	   const vector<string> &env_to,
+	   int result,
+	   const vector<int> &status)
+{
+
+	if (result == 0) {
 
-		// Standard SMTP, no authorization protocol
-		Client = new MailSenderSmtp(filename);
+		out << filename << ": sent (" << env_to.size()
+			<< " recipient" << (env_to.size() == 1 ? "" : "s") << ")\n";
+		return 0;
 
-	cout << "Attempting to connect to " << hostname << endl;
+	}
 
-	// Attempt to send e-mail.
-	if (Client->send(hostname, env_from, env_to) != 0) {
+	int		sent = 0;
 
-		if (errno)
+	for (unsigned int j = 0; j < status.size(); j++)
+
+		sent += status[j] / 100 == 2;		// 250, 251
+
+	out << filename << ": FAILED (";
+	if (errno)
 
-			perror("Connection error");		// Error: connection.
+		// Error: connection.
+		out << "connection error: " << strerror(errno);
 
+	else if (sent > 0)
+
+		// Error: some recipients rejected.
+		out << "sent to " << sent << " of " << env_to.size()
+			<< " recipients";
+
+	else
+
+		// Error: errno not set, server response error.
+		out << "SMTP protocol error";
+
+	out << ")\n";
+
+	// Which recipients did (not) get it.
+	for (unsigned int j = 0; j < env_to.size(); j++) {
+
+		out << "  " << env_to[j] << ": ";
+
+		if (status[j] / 100 == 2)
+
+			out << "sent\n";
+
+		else if (status[j] < 0)
+
+			out << "no reply\n";
 
 		else
 
-			// Error: errno not set, server response error.
-			cout << "SMTP Protocol Error, email not sent.\n";
+			out << "rejected (" << status[j] << ")\n";
+
+	}
+
+	return result;
+
+}
+
+/*
+ * Convert an email file into a wire file (see WireFile.hh) named
+ * after it in wire_dir. A wire file that is newer than the email
+ * file is already up to date and is not converted again; an email
+ * file that is a wire file itself is used as is.
+ * @args:	email file (const string &filename)
+ * 			wire file directory (const string &wire_dir)
+ * 			envelope sender, recipients (see GetEnvelope)
+ * 			name of the file to send (string &wire_name)
+ * @return:	0 (success)
+ *  -error:	-1 (file error, errno)
+ */
+int
+PrepareWire(const string &filename,
+			const string &wire_dir,
+			const string &env_from,
+			const vector<string> &env_to,
+			string &wire_name)
+{
+
+	struct stat		src,
+					dst;
+	size_t			slash = filename.rfind('/');
+
+	if (WireCheck(filename)) {
+
+		wire_name = filename;		// Already wire-ready
+		return 0;
 
 	}
 
-	return 0;	// Successfully sent email
+	wire_name = wire_dir + "/" +
+				(slash == string::npos ? filename
+									   : filename.substr(slash + 1)) +
+				WireSuffix;
+
+	if (stat(filename.c_str(), &src) != 0)
+
+		return -1;		// Errno set
+
+	if (stat(wire_name.c_str(), &dst) == 0 &&
+		dst.st_mtime >= src.st_mtime && WireCheck(wire_name))
+
+		return 0;		// Converted before
+
+	return WirePrepare(filename, wire_name, env_from, env_to);
 
 }
 
 /*
  * GetEnvelope method
  * Open e-mail file, process header contents and extract e-mail
- * addresses of sender & recipient.
+ * addresses of sender & recipients.
  *
  * Search unprocessed header text for sender, recipient
- * e-mail address:
- *
- * Set input file stream: filename (of email)
+ * e-mail addresses:
  *
- * Place header into temporary buffer:
- * 	WHILE getline != end of file AND next char != '\n' (ifstream.peek)
- * 		(Header & Body separated by blank line)
- * 		THEN add line to Temp Header Buffer
+ * Scan the header once (see HeaderScanner): only the header region
+ * of the file is read, into a buffer reused by the calling thread,
+ * and field values are views into it. Folded fields are unfolded
+ * by ParseAddressList, which takes CRLF + WSP as whitespace:
+ * 	Sender = first address of the From: field
+ * 	Recipients = each address of the To:, Cc: and Bcc: fields
+ * 		(comma-separated, see ParseAddressList)
  *
- * Find email addresses of sender/recipient:
- * Search Header buffer string for ':' position
- * 	WHILE Header contains next ':' (position = string.find(':', position))
- * 		IF substring Header (position - 4 to position) == "From"
- * 			IF whitespace THEN flush whitespace
- * 			IF Header[position] == '<'
- * 				THEN Sender = Header (position + 1 TO next '>')
- * 			ELSE Sender = Header (position + 1 TO whitespace)
- *
- * 		ELSE IF substring Header (position - 2 TO position) == "To"
- * 			IF whitespace THEN flush whitespace
- * 			IF Header[position] == '<'
- * 				THEN Recipient = Header (position + 1 TO next '>')
- * 			ELSE Recipient = Header (position - 2 TO whitespace)
+ * Duplicate recipients are only added once. Recipients w/ bad
+ * syntax (see AddressValidator) are reported and left out.
  *
  * @args:	filename (const string &)
  * 			email address of sender (const string &env_from)
- * 			email address of recipient (const string &env_to)
+ * 			email addresses of recipients (vector<string> &env_to)
+ * 			where to report bad addresses (ostream &out)
  * @return: 0 (on Success)
  * -errors: -1 (File not found),
- * 			 1 (email address not found/improperly formatted)
+ * 			-1 (email address not found/improperly formatted)
  */
 int
 GetEnvelope(const string &filename,
 			string &env_from,
-			string &env_to)
+			vector<string> &env_to,
+			ostream &out)
 {
 
-	string			header;		// Unsorted e-mail header
-	unsigned int	from_pos,	// Beginning of sender address string.
-					to_pos,		// Beginning of recipient string.
-					pos = 0;
-	char			ch;
-	ifstream		fin;
+	static thread_local HeaderScanner	scanner;	// Buffer reused
 
-	fin.open(filename.c_str());
-	if (fin == NULL)	// File not found.
+	env_from.clear();
 
-		return -1;		// Errno set
+	// Wire file: envelope stored in front of the message.
+	if (WireCheck(filename)) {
+
+		off_t	offset,
+				length;
+		int		fd;
+
+		if ((fd = WireOpen(filename, env_from, env_to,
+						   offset, length)) < 0)
 
-	// Dig through email file for envelope information (header).
-	// ** Header ends with 2 newline characters.
-	while (fin.get(ch) && (fin.peek() != '\n' || ch != '\n')) {
+			return -1;	// Errno set
 
-		header.append(1, ch);
+		close(fd);
+		return 0;
 
 	}
 
-	fin.close();
+	if (scanner.scan(filename) != 0) {	// File not found/read.
 
-	// Find sender/recipient email address by searching "From:" & "To:"
-	while ((pos = header.find(':', pos)) > 0 &&
-		   pos < header.length()) {	// Search for ':'
+		env_to.clear();
+		return -1;		// Errno set
 
-		if (pos > 3) {	// If position of ':' can be preceded by 'From'
+	}
 
-			// Check for Sender match
-			if (strncasecmp((header.substr(pos - 4, 4)).c_str(),
-							 "From", 4) == 0) { // Look for 'FROM'
+	return ScanEnvelope(scanner, "", env_from, env_to, out);
 
-				from_pos = pos + 1;	// Set beginning of from address
+}
 
-				// Flush whitespace, find beginning of from address.
-				while (header[from_pos] == ' ') {
+/*
+ * Envelope of a scanned header (see GetEnvelope), w/ further
+ * recipients that are not in it, e.g. the Bcc: addresses of a
+ * MergeTemplate.
+ * Addresses are parsed into an Arena kept by the calling thread and
+ * copied once, into the strings of env_to, whose capacity is reused
+ * from the last envelope.
+ * @args:	scanned header (const HeaderScanner &scanner)
+ * 			more recipients, an address list (string_view more)
+ * 			envelope, where to report bad addresses (see GetEnvelope)
+ * @return: 0 (on Success)
+ * -errors: -1 (email address not found/improperly formatted)
+ */
+int
+ScanEnvelope(const HeaderScanner &scanner,
+			 string_view more,
+			 string &env_from,
+			 vector<string> &env_to,
+			 ostream &out)
+{
 
-					from_pos++;	// Increment position
+	// Reused by the calling thread: no heap allocation per message
+	// once they have grown to the largest header.
+	static thread_local Arena				arena(16384);
+	static thread_local vector<string_view>	from,	// From: addresses
+											to,		// To:/Cc:/Bcc:
+											addrs;	// Sender, then recipients
+	static thread_local vector<uint8_t>		status;	// AddressValidator::Status
+	size_t									count = 0;	// Recipients kept
 
-				}
+	arena.reset();
+	from.clear();
+	to.clear();
+	addrs.clear();
+	env_from.clear();
 
-				pos = from_pos;	// Beginning of sender pos.
-				while (header[pos] != ' ' && header[pos] != '\n' &&
-					   header[pos] != '\0' && header[pos] != ':' &&
-					   header[pos] != ',' && header[pos] != '\r'
-						&& pos < header.length()) {
+	// Sender/recipient email addresses, field by field.
+	for (int i = 0; i < scanner.count(HeaderScanner::From); i++)
 
-					pos++;	// Iterator
+		ParseAddressList(scanner.value(HeaderScanner::From, i), arena, from);
 
-				}
+	for (int f = HeaderScanner::To; f <= HeaderScanner::Bcc; f++) {
 
-				// Assign "from" email address
-				env_from = header.substr(from_pos, pos - from_pos);
+		for (int i = 0; i < scanner.count((HeaderScanner::Field)f); i++)
 
-			}
+			ParseAddressList(scanner.value((HeaderScanner::Field)f, i),
+							 arena, to);
 
-		}
+	}
 
-		// Search for recipient address
-		if (pos > 1) {	// Check if ':' can be preceded by "To"
+	ParseAddressList(more, arena, to);
 
-			// Check for Sender match
-			if (strncasecmp((header.substr(pos - 2, pos)).c_str(),
-							"To", 2) == 0) {	// Check for 'TO'
+	// If addresses are empty.
+	if (from.empty() || to.empty()) {
 
-				to_pos = pos + 1;	// Set beginning of To: address
+		env_to.clear();
+		out << "Error: file envelope addresses incorrect.\n";
+		return -1;		// Addresses not found, error.
 
-				// Flush whitespace
-				while (header[to_pos] == ' ') {
+	}
 
-					to_pos++;	// Increment position
+	env_from.assign(from[0]);
 
-				}
+	// Check syntax of sender and recipients in one batch.
+	addrs.push_back(from[0]);
+	addrs.insert(addrs.end(), to.begin(), to.end());
+	status.resize(addrs.size());
+	Validator.check(&addrs[0], addrs.size(), &status[0]);
 
-				pos = to_pos;	// Beginning of recipient pos.
-				while (header[pos] != ' ' && header[pos] != '\n' &&
-					  header[pos] != '\0' && header[pos] != ':' &&
-					  header[pos] != ',' && pos < header.length()) {
+	if (status[0] != AddressValidator::Valid) {
 
-					pos++;	// Iterator
+		env_to.clear();
+		out << "Email file address syntax error: " << env_from << " ("
+			<< AddressValidator::status_name(
+					(AddressValidator::Status)status[0]) << ")\n";
+		return -1;
 
-				}
+	}
 
-				// Assign To: address.
-				env_to = header.substr(to_pos, pos - to_pos);
+	for (unsigned int i = 0; i < to.size(); i++) {
 
-			}
+		if (status[i + 1] != AddressValidator::Valid) {
 
-		}
+			out << "Email file address syntax error: " << to[i] << " ("
+				<< AddressValidator::status_name(
+						(AddressValidator::Status)status[i + 1]) << ")\n";
+			continue;	// Skip bad recipient
 
-		pos++;	// Increment iterator.
+		}
 
-	}
+		if (find(env_to.begin(), env_to.begin() + count, to[i]) !=
+			env_to.begin() + count)
 
-	// Remove angle brackets surrounding addresses if any
-	if (env_from[0] == '<' && env_from[env_from.length() - 1] == '>')
+			continue;	// Once per recipient
 
-		env_from = env_from.substr(1, env_from.length() - 2);
+		// Strings of the last envelope are overwritten, keeping
+		// their capacity.
+		if (count < env_to.size())
 
-	if (env_to[0] == '<' && env_to[env_to.length() - 1] == '>')
+			env_to[count].assign(to[i]);
 
-		env_to = env_to.substr(1, env_to.length() - 2);
+		else
 
-	// If addresses are empty.
-	if (env_from.length() == 0 || env_to.length() == 0) {
+			env_to.emplace_back(to[i]);
 
-		cout << "Error: file envelope addresses incorrect.\n";
-		return -1;		// Addresses not found, error.
+		count++;
 
 	}
 
-	// Function to check email syntax.
-	if (CheckEmailSyntax(env_from) != 0 ||
-		CheckEmailSyntax(env_to) != 0) {
+	env_to.resize(count);
 
-		cout << "Email file address syntax error.\n";
-		return -1;
+	if (env_to.empty())
 
-	}
+		return -1;		// No valid recipient
 
 	return 0;	// Return success.
 
 }
 
 /*
- * Check if email address meets all guidelines for syntax as stated by
- * RFC 5322 (section 3.4.1) and RFC 5321.
- * 		Cannot contain more than 254 chars or less than 5 chars
- * 		Cannot have local more than 64 chars or less than 1
- * 		Cannot have local w/ chars besides alpha-numeric and
- * 			~`!.#$%^&\'*{|}-_+=
- * 		Cannot have domain w/ char besides alpha-numeric and
- * 			. (period) or - (hyphen)
- * 		Domain or local cannot start or end w/ . (period)
- * 		Cannot contain consecutive . (periods)
- * 		Domain MAY be in square brackets IF in IP-address form
- * @args:	e-mail address (const string &)
- * @return:	0 (success)
- * - error: -1 (fail)
- *
- *	Address = Local@Domain
- *
- * 	IF NOT(5 < Address length < 254)
- * 		THEN fail
- *
- * 	IF NOT(0 < Local length < 65)
- * 		THEN fail
- *
- *	IF Local chars NOT alpha-numeric OR
- *		~`!.#$%^&\'*{|}-_+="	(one of these symbols)
- *		THEN fail
- *
- *	IF Domain chars NOT alpha-numeric OR
- *		.-		(period OR hyphen)
- *		THEN fail
- *
- *	IF Address first OR last char == '.'
- *		THEN fail
- *
- *	IF Address char == '.' AND
- *		Address char + 1 == '.'
- *		THEN fail
- *
+ * Split the value of an address header field (RFC 5322, 3.4) into
+ * plain e-mail addresses, e.g.
+ * 	"Lee, Joseph" <jlee@pdx.edu>, bart@pdx.edu (Bart), team: a@b.c;
+ * gives jlee@pdx.edu, bart@pdx.edu and a@b.c.
+ * Commas inside quoted strings, comments and angle brackets do not
+ * separate addresses. A group name ("team:") and the trailing ';'
+ * are dropped.
+ * The addresses are written into one region of the arena, as long
+ * as the field, so a message header costs no heap allocation once
+ * the arena has grown to it.
+ * @args:	field value (string_view list)
+ * 			where the addresses are kept (Arena &arena)
+ * 			addresses found, appended (vector<string_view> &addrs)
  */
-int
-CheckEmailSyntax(const string &addr)
+void
+ParseAddressList(string_view list, Arena &arena,
+				 vector<string_view> &addrs)
 {
 
-	int				a_pos = 0;		// Position of '@' char
-	string			non_alphanum = "~`!.#$%^&\'*{|}-_+=";
-									// String containing all legal alpha-
-									// numeric ASCII symbols.
-	unsigned int	addr_len = addr.length(),
-									// Length of address, must be < 254
-					local_len,		// Length of local (before @)
-									//   equal to a_pos - 1, must be < 64
-					domain_len,		// Length of domain (after @)
-									//   equal to addr.length - a_pos
-					domain_start;	// Position of 1st char in domain.
-
-	// Must be: 5 < Address length < 254
-	if (addr_len > 255 || addr_len < 5) {
-
-		// Illegal address length.
-		return -1;
+	char			*addr,		// Address outside of angle brackets
+					*angle;		// Address inside angle brackets
+	size_t			addr_len = 0,
+					angle_len = 0;
+	bool			quoted = false,	// In "quoted string"
+					in_angle = false,	// In <angle brackets>
+					has_angle = false;	// Entry had <...>
+	int				comment = 0;	// (Comment) nesting depth
 
-	}
+	if (list.empty())
 
-	a_pos = addr.find('@');		// Find position of '@' symbol.
+		return;
 
-	if (a_pos < 2 || a_pos > 65 ) {
+	// An address is never longer than the field: each entry starts
+	// after the last one, so the views found stay put.
+	addr = arena.alloc_array<char>(list.length());
+	angle = arena.alloc_array<char>(list.length());
 
-		// Local must be: 0 < local < 65.
-		return -1;		// Illegal address.
+	for (size_t i = 0; i <= list.length(); i++) {
 
-	}
+		char	ch = i < list.length() ? list[i] : ',';
 
-	local_len = a_pos;
-	domain_start = a_pos + 1;
-	domain_len = addr_len - a_pos - 1;
+		if (quoted) {
 
-	// Verify legality of each char in local
-	for (unsigned int i = 0; i < local_len; i++) {
+			if (ch == '\\' && i + 1 < list.length())
 
-		if (isalnum(addr[i]) == 0) {		// Non-alphanumeric
+				i++;			// Quoted pair
 
-			// Check if char is legal non-alphanumeric.
-			if (non_alphanum.find(addr[i]) == 0) {
+			else if (ch == '"')
 
-				return -1;	// Illegal char in local.
+				quoted = false;
 
-			}
+			continue;			// Display name, not address
 
 		}
 
-	}
+		if (comment > 0) {
 
-	// Square braces around IP address domain is legal.
-	if (addr[domain_start] == '[' && addr[domain_len - 1] == ']') {
+			if (ch == '(')
 
-		domain_len -= 2;
-		++domain_start;
+				comment++;
 
-	}
+			else if (ch == ')')
+
+				comment--;
 
-	// Verify legality of each char in domain
-	for (unsigned int i = 0; i < domain_len; i++) {
+			continue;
 
-		if (isalnum(addr[i + domain_start]) == 0) {	// Non-alphanumeric
+		}
 
-			if (addr[i + domain_start] != '.' &&
-				addr[i + domain_start] != '-') {	// Not '.' or '-'
+		if (in_angle) {
 
-				return -1;	// Illegal char in domain.
+			if (ch == '>')
 
-			}
+				in_angle = false;
+
+			else
+
+				angle[angle_len++] = ch;
+
+			continue;
 
 		}
 
-	}
+		switch (ch) {
 
-	// Verify '.' is not 1st or last char in local.
-	if (addr[0] == '.' || addr[local_len - 1] == '.') {
+		case '"':
+			quoted = true;
+			break;
 
-		return -1;	// Illegal address syntax.
+		case '(':
+			comment = 1;
+			break;
 
-	}
+		case '<':
+			in_angle = has_angle = true;
+			angle_len = 0;
+			break;
 
-	// Verify '.' is not 1st or last char in domain.
-	if (addr[domain_start] == '.' || addr[domain_len - 1] == '.') {
+		case ':':		// "group-name:"
+			addr_len = 0;
+			break;
 
-		return -1;	// Illegal address syntax.
+		case ',':		// End of an address
+		case ';':		// End of a group
+			if (has_angle && angle_len > 0) {
 
-	}
+				addrs.emplace_back(angle, angle_len);
+				angle += angle_len;
+
+			} else if (!has_angle && addr_len > 0) {
+
+				addrs.emplace_back(addr, addr_len);
+				addr += addr_len;
 
-	// Verify '.' does not appear consecutively.
-	for (unsigned int i = 0; i > 0; i = addr.find('.', i + 1)) {
+			}
+
+			addr_len = angle_len = 0;
+			has_angle = false;
+			break;
 
-		if (i == (addr.find('.', i + 1) - 1)) {
+		default:
+			if (!isspace(ch))
+
+				addr[addr_len++] = ch;
 
-			return -1;	// Illegal address syntax.
 		}
 
 	}
 
-	return 0;	// Valid e-mail address.
-
 }
 
 /*
- * Using ifstream, load hostname settings from configuration file
- * "mailsender.conf" which contains a single line with the format:
- * 		host=<hostname> port=<portnumber> auth=0
- * Authorization type currently disabled.
- * Call sub-method "ParseConfig(...)" to handle string parsing
- * from file.
- * @args:	hostname (string &host),
- * 			port number (int &port),
- * 			authentication type (string &auth)
+ * Using ifstream, load the relays from configuration file
+ * "mailsender.conf", one relay per line:
+ * 		host=<hostname> [port=<portnumber>] [auth=0|plain|login]
+ * 			[user=<name>] [pass=<password>] [tls=0|1|2] [cafile=<file>]
+ * 			[weight=<share>] [min_conn=<messages>] [max_conn=<messages>]
+ * 			[min_rate=<messages/s>] [max_rate=<messages/s>]
+ * 			[chunk=<KiB>]
+ * Blank lines and lines starting w/ '#' are skipped. Port defaults
+ * to 25, weight to 1, auth to "0" (none). tls=1 starts TLS if the
+ * relay offers STARTTLS, tls=2 always (default 0: plaintext); the
+ * relay's certificate must be signed by a system CA, or one in
+ * cafile (PEM). AUTH w/ user and pass needs TLS; values may not
+ * contain whitespace. The messages in flight and per second are
+ * paced between floors and ceilings (see RelayRouter): min_conn
+ * defaults to 1, max_conn to 0 (no cap), min_rate to 1, max_rate
+ * to 0 (no ceiling, no limit until the relay throttles). Messages
+ * go to a relay that offers CHUNKING in BDAT chunks of chunk KiB,
+ * 1024 by default; chunk=0 keeps to DATA. A single-line file made
+ * by an older "config" is one relay.
+ * Call sub-method "ParseConfig(...)" to handle each line.
+ * @args:	relays found (vector<RelayConfig> &relays)
  * @return:	0 (success)
- *  -error: -1 (file not found: errno, improper format)
+ *  -error: -1 (file not found: errno, improper format, no relay)
  */
 int
-LoadHost(string &host, int &port, string &auth)
+LoadRelays(vector<RelayConfig> &relays)
 {
 
 	ifstream		fin;	// Input file stream
-	string			buf;	// Config file buffer
-	int				i;		// Index
+	string			line;	// Config file line
+	RelayConfig		relay;
 
+	relays.clear();
 	fin.open(ConfigFile.c_str());
 
 	if (fin.fail())
 
 		return -1;		// Config file not found, errno
 
-	getline(fin, buf);
+	while (getline(fin, line)) {
 
-	fin.close();
+		size_t	start = line.find_first_not_of(" \t\r");
 
-	// Find hostname
+		if (start == string::npos || line[start] == '#')
 
-	if ((i = ParseConfig(host, buf, "host=")) == -1)
+			continue;		// Blank line, comment
 
-		return -1;		// File stream parse error
+		errno = 0;
 
-	// Find port number
+		if (ParseConfig(line, relay) == -1 ||
+			relays.size() == RelayRouter::MaxRelays)
 
-	if ((i = ParseConfig(port, buf, "port=", i)) == -1)
+			return -1;		// Format error
 
-		return -1;	// port tag not found
+		relays.push_back(relay);
 
-	// Find authorization type
-
-	if ((i = ParseConfig(auth, buf, "auth=", i)) == -1)
+	}
 
-		return -1;	// auth tag not found
+	errno = 0;
 
-	return 0;		// success
+	return relays.empty() ? -1 : 0;
 
 }
 
 /*
- * Parse a segment of buffer, searching for given 'tag' starting at
- * a position, retrieving the following substring.
- * Use <sstream> to convert buffer string to a stream and use '>>'
- * extraction operator to input following string.
- * @args:	found string (string &parsed),
- * 			unparsed buffer (string &buffer),
- * 			tag to search for in buffer (string tag),
- * 			position in buffer to start searching (int pos)
- * @return:	position after found string, from int pos (success)
- *  -error:	-1 (parameter not found)
+ * Parse one relay line of the configuration file, made of
+ * whitespace-separated "tag=value" pairs (see LoadRelays). Unknown
+ * tags are an error.
+ * Split the line in place, as views: no temporary string per pair.
+ * @args:	configuration line (const string &line)
+ * 			relay found (RelayConfig &relay)
+ * @return:	0 (success)
+ *  -error:	-1 (no host, bad number, unknown tag)
  */
 int
-ParseConfig(string &parsed, string &buffer, string tag, int pos)
+ParseConfig(const string &line, RelayConfig &relay)
 {
 
-	stringstream	buf_str;
+	string_view		rest(line),
+					tag,
+					value;
+	size_t			start,
+					end,
+					eq;
+	const char		*last;	// End of value
+	from_chars_result	res;
+	long			n;
+
+	relay.host.clear();
+	relay.port = MailSenderSmtp::DefaultPort;
+	relay.weight = 1;
+	relay.min_conn = 1;
+	relay.max_conn = 0;
+	relay.min_rate = 1;
+	relay.max_rate = 0;
+	relay.auth = "0";
+	relay.user.clear();
+	relay.pass.clear();
+	relay.tls = MailSenderSmtp::TlsOff;
+	relay.cafile.clear();
+	relay.chunk = MailSenderSmtp::DefaultChunkSize / 1024;
+
+	while ((start = rest.find_first_not_of(" \t\r\n")) != string_view::npos) {
+
+		rest.remove_prefix(start);
+		end = min(rest.find_first_of(" \t\r\n"), rest.length());
+
+		if ((eq = rest.substr(0, end).find('=')) == string_view::npos)
+
+			return -1;
+
+		tag = rest.substr(0, eq);
+		value = rest.substr(eq + 1, end - eq - 1);
+		rest.remove_prefix(end);
+
+		if (tag == "host" || tag == "auth" || tag == "user" ||
+			tag == "pass" || tag == "cafile") {
+
+			(tag == "host" ? relay.host : tag == "auth" ? relay.auth :
+			 tag == "user" ? relay.user : tag == "pass" ? relay.pass :
+			 relay.cafile).assign(value);
+			continue;
 
-	if ((pos = buffer.find(tag)) == -1)
+		}
 
-		return -1;		// tag not found
+		last = value.data() + value.length();
+		res = from_chars(value.data(), last, n);
 
-	else
+		if (value.empty() || res.ec != errc() || res.ptr != last ||
+			n < 0 || n > 65535)
 
-		pos += tag.length();
+			return -1;		// Not a number
 
-	buf_str.str(buffer.substr(pos));
-	buf_str >> parsed;
+		if (tag == "port" && n > 0)
 
-	if (buf_str.bad())	// check bad stream input
+			relay.port = n;
 
-		return -1;		// error: check errno
+		else if (tag == "weight" && n > 0)
 
-	buf_str.clear();
+			relay.weight = n;
 
-	return pos + parsed.length();	// return position after string
+		else if (tag == "min_conn" && n > 0)
 
-}
+			relay.min_conn = n;
 
-/*
- * ParseConfig: overloaded function
- * Parses an integer value instead of a string.
- * For use w/ port number retrieval.
- * @args:	found int (int &parsed),
- * 			unparsed buffer (string &buffer),
- * 			tag to search for in buffer (string tag),
- * 			position in buffer to start searching (int pos)
- * @return:	position after found int, from int pos (success)
- *  -error:	-1 (parameter not found)
- */
-int
-ParseConfig(int &parsed, string &buffer, string tag, int pos)
-{
+		else if (tag == "max_conn")
 
-	stringstream	buf_str;	// Set string to stream buffer
+			relay.max_conn = n;
 
-	if ((pos = buffer.find(tag)) == -1)
+		else if (tag == "min_rate" && n > 0)
 
-		return -1;		// tag not found
+			relay.min_rate = n;
 
-	else
+		else if (tag == "max_rate")
+
+			relay.max_rate = n;
 
-		pos += tag.length();
+		else if (tag == "chunk")
 
-	buf_str.str(buffer.substr(pos));
-	buf_str >> parsed;
+			relay.chunk = n;
 
-	if (buf_str.bad())	// check bad stream input
+		else if (tag == "tls" && n <= MailSenderSmtp::TlsRequired)
 
-		return -1;		// error: check errno
+			relay.tls = n;
 
-	buf_str.clear();
+		else
+
+			return -1;		// Unknown tag, or 0
+
+	}
 
-	// Return position after integer
-	return pos +
-		   static_cast<int>(floor(log10(parsed)));
-	// Use log-base10 to calc length of integer
+	return relay.host.empty() ? -1 : 0;
 
 }